@@ -12,10 +12,12 @@
 #define CORAL_BUS_VARIABLE_IO_HPP_INCLUDED
 
 #include <chrono>
+#include <cstddef>
 #include <memory>
-#include <queue>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <coral/model.hpp>
 #include <coral/net.hpp>
@@ -31,7 +33,18 @@ namespace bus
 {
 
 
-/// A class which handles publishing of variable values on the network.
+// Defined in coral/bus/shared_variables.hpp
+class SharedVariableWriter;
+class SharedVariableReader;
+
+
+/**
+\brief  A class which handles publishing of variable values on the network.
+
+Where the platform supports it, values published with the batch version of
+Publish() are also written to a shared-memory region, from which
+VariableSubscriber objects on the same host read them directly.
+*/
 class VariablePublisher
 {
 public:
@@ -42,6 +55,18 @@ public:
     */
     VariablePublisher();
 
+    /// Destructor
+    ~VariablePublisher() noexcept;
+
+    VariablePublisher(const VariablePublisher&) = delete;
+    VariablePublisher& operator=(const VariablePublisher&) = delete;
+
+    /// Move constructor
+    VariablePublisher(VariablePublisher&&) noexcept;
+
+    /// Move assignment operator
+    VariablePublisher& operator=(VariablePublisher&&) noexcept;
+
     /**
     \brief  Binds to a local endpoint.
 
@@ -86,12 +111,50 @@ public:
         coral::model::VariableID variableID,
         coral::model::ScalarValue value);
 
+    /**
+    \brief  Publishes the values of several variables in a single message.
+
+    This is equivalent to calling the single-variable Publish() function for
+    each element of `values`, but it is far cheaper when there are many
+    variables, as all values are packed into one network message.
+    VariableSubscriber accepts both formats.
+
+    \param [in] stepID      Time step ID
+    \param [in] slaveID     Slave ID
+    \param [in] values      An array of (variable ID, value) pairs.  The
+                            variable IDs are paired with the slave ID as for
+                            the single-variable Publish() function.
+    \param [in] count       The size of the `values` array.
+
+    \pre Bind() has been called successfully on this instance.
+    */
+    void Publish(
+        coral::model::StepID stepID,
+        coral::model::SlaveID slaveID,
+        const std::pair<coral::model::VariableID, coral::model::ScalarValue>* values,
+        std::size_t count);
+
 private:
     std::unique_ptr<zmq::socket_t> m_socket;
+    std::unique_ptr<SharedVariableWriter> m_sharedWriter;
 };
 
 
-/// A class which handles subscriptions to and receiving of variable values.
+/**
+\brief  A class which handles subscriptions to and receiving of variable values.
+
+Each subscribed-to variable is assigned a *slot*, a small integer which
+stays the same for as long as the variable is subscribed to.  Received values
+are stored per slot, so the values may be retrieved by slot index with no
+lookup, which is useful when the same set of variables is read in every time
+step.
+
+Values from publishers on the same host are read directly from their
+shared-memory regions (see VariablePublisher) rather than received over the
+network, as long as all the variables subscribed to from a publisher are
+available there.  Other values, including all string values, are received
+over the network.  This is decided automatically, per publisher.
+*/
 class VariableSubscriber
 {
 public:
@@ -102,6 +165,18 @@ public:
     */
     VariableSubscriber();
 
+    /// Destructor
+    ~VariableSubscriber() noexcept;
+
+    VariableSubscriber(const VariableSubscriber&) = delete;
+    VariableSubscriber& operator=(const VariableSubscriber&) = delete;
+
+    /// Move constructor
+    VariableSubscriber(VariableSubscriber&&) noexcept;
+
+    /// Move assignment operator
+    VariableSubscriber& operator=(VariableSubscriber&&) noexcept;
+
     /**
     \brief  Connects to the remote endpoints from which variable values should
             be received.
@@ -122,9 +197,14 @@ public:
     /**
     \brief Subscribes to the given variable.
 
+    If the variable is already subscribed to, this has no effect.
+
+    \returns
+        The slot assigned to the variable.  When the variable is
+        unsubscribed from, the slot may be reused for another variable.
     \pre Connect() has been called successfully on this instance.
     */
-    void Subscribe(const coral::model::Variable& variable);
+    std::size_t Subscribe(const coral::model::Variable& variable);
 
     /**
     \brief Unsubscribes from the given variable.
@@ -139,15 +219,22 @@ public:
 
     \param [in] stepID      The timestep ID for which we should wait for
                             variable data.
-    \param [in] timeout     How long to wait without receiving any data.
+    \param [in] timeout     How long to wait in total for the data to arrive.
                             A negative value means to wait indefinitely.
 
+    A variable which is not included in a batch message from its slave is
+    considered to be unchanged, so if the subscriber already has a value for
+    it from an earlier time step, that value is used for this time step too
+    once a batch for this (or a later) time step has been received from the
+    slave.  This supports slaves which only publish outputs that have
+    changed.
+
     \returns Whether a value has been received for all variables.
     \pre Connect() has been called successfully on this instance.
     */
     bool Update(
         coral::model::StepID stepID,
-        std::chrono::milliseconds timeout);
+        std::chrono::microseconds timeout);
 
     /**
     \brief  Returns the value of the given variable which was acquired with the
@@ -166,23 +253,134 @@ public:
     const coral::model::ScalarValue& Value(const coral::model::Variable& variable)
         const;
 
-private:
-    typedef std::queue<std::pair<coral::model::StepID, coral::model::ScalarValue>>
-        ValueQueue;
+    /**
+    \brief  Returns the value acquired with the last Update() call for the
+            variable which is assigned to the given slot.
+
+    This is equivalent to the other Value() function, but faster.
+
+    \param [in] slot        A slot index returned by Subscribe() or Slot().
+    \pre Update() has been called successfully.
+    */
+    const coral::model::ScalarValue& Value(std::size_t slot) const;
+
+    /**
+    \brief  Returns the slot assigned to the given variable.
 
-    // A hash function for Variable objects, so we can put them in a
-    // std::unordered_map (below)
-    struct VariableHash
+    \throws std::out_of_range
+        If the variable is not subscribed to.
+    */
+    std::size_t Slot(const coral::model::Variable& variable) const;
+
+private:
+    // The values received for one variable, along with the IDs of the time
+    // steps they belong to, in a ring buffer ordered by step ID.  The buffer
+    // normally holds one or two values, since publishers are at most one
+    // step ahead of us, but it grows if needed.  If the first value is older
+    // than the current step, it is the last known value, which is held
+    // until a newer one arrives.
+    struct SlotData
     {
-        std::size_t operator()(const coral::model::Variable& v) const
-        {
-            return static_cast<std::size_t>((v.Slave() << 16) + v.ID());
-        }
+        coral::model::Variable variable;
+        bool active = false;
+        bool missing = false;
+
+        // The shared-memory region the values are read from, if any, and
+        // the variable's entry in its directory.
+        SharedVariableReader* sharedReader = nullptr;
+        std::size_t sharedEntry = NO_SLOT;
+        std::vector<std::pair<coral::model::StepID, coral::model::ScalarValue>> ring;
+        std::size_t head = 0;
+        std::size_t size = 0;
     };
 
+    // Returns the slot assigned to `variable`, or NO_SLOT if none.
+    std::size_t FindSlot(const coral::model::Variable& variable) const noexcept;
+
+    // Adds and removes entries in m_slotTable.
+    void InsertSlotTableEntry(std::size_t slot);
+    void EraseSlotTableEntry(std::size_t slot) noexcept;
+
+    // Rebuilds m_slotTable with room for at least `slotCount` entries.
+    void RebuildSlotTable(std::size_t slotCount);
+
+    // Stores a received value iff it is from the current (or a newer)
+    // timestep and it is one we're listening for.  (Wrt. the latter,
+    // unsubscriptions may take time to come into effect.)
+    void Enqueue(
+        const coral::model::Variable& variable,
+        coral::model::StepID stepID,
+        coral::model::ScalarValue&& value);
+
+    // Opens the shared-memory regions of local publishers which have become
+    // ready since the last call, and switches their slaves over to them.
+    void ResolveSharedRegions();
+
+    // Returns the ready shared-memory region for `slave`, or null if none.
+    SharedVariableReader* SharedReaderFor(coral::model::SlaveID slave) const;
+
+    // Switches a slave over to shared memory, if all its subscribed-to
+    // variables are available there, or back to the network.
+    void UseSharedMemory(coral::model::SlaveID slave, SharedVariableReader& reader);
+    void UseNetwork(coral::model::SlaveID slave);
+
+    // Reads the values for the current step from shared memory for all
+    // missing variables which are read from there, and returns the number
+    // which are still missing.
+    std::size_t ReadSharedValues();
+
+    static const std::size_t NO_SLOT = static_cast<std::size_t>(-1);
+
     coral::model::StepID m_currentStepID;
     std::unique_ptr<zmq::socket_t> m_socket;
-    std::unordered_map<coral::model::Variable, ValueQueue, VariableHash> m_values;
+
+    // The slots, indexed by slot number.  Inactive slots are reused.
+    std::vector<SlotData> m_slots;
+    std::vector<std::size_t> m_freeSlots;
+
+    // An open-addressing hash table (with linear probing) which maps
+    // variables to slots.  Each entry is a slot index plus one, so that
+    // zero can signify an empty entry.  The size is a power of two.
+    std::vector<std::size_t> m_slotTable;
+    std::size_t m_activeSlots;
+
+    // The number of active slots which have no value for the current time
+    // step.  This is only maintained during Update().
+    std::size_t m_missingValues;
+
+    struct SlaveData
+    {
+        // The number of subscribed-to variables.  Batch messages from the
+        // slave are subscribed to as long as this is nonzero.
+        std::size_t subscriptions = 0;
+
+        // Slots which only have an old value for the current time step, and
+        // which are therefore satisfied by any batch message from the slave
+        // for the current step.  This is only maintained during Update().
+        std::vector<std::size_t> heldSlots;
+
+        // The ID of the newest time step for which a batch message has been
+        // received from the slave.  With pipelined steps, this may be ahead
+        // of the step which is being waited for.
+        coral::model::StepID newestBatchStep = coral::model::INVALID_STEP_ID;
+
+        // The shared-memory region which the slave's values are read from,
+        // or null if they are received over the network.
+        SharedVariableReader* sharedReader = nullptr;
+    };
+    std::unordered_map<coral::model::SlaveID, SlaveData> m_slaves;
+
+    // The shared-memory regions of the local publishers we're connected to.
+    // A region is "resolved" when its publisher has initialised it, at
+    // which point we know which slave it belongs to.
+    struct SharedRegion
+    {
+        std::string name;
+        std::unique_ptr<SharedVariableReader> reader;
+        bool resolved = false;
+    };
+    std::vector<SharedRegion> m_sharedRegions;
+    std::size_t m_unresolvedRegions;
 };
 
 
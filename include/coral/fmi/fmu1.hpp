@@ -154,6 +154,36 @@ public:
     bool SetBooleanVariable(coral::model::VariableID variable, bool value) override;
     bool SetStringVariable(coral::model::VariableID variable, const std::string& value) override;
 
+    std::unique_ptr<coral::slave::VariableList> PrepareVariables(
+        coral::model::DataType dataType,
+        std::vector<coral::model::VariableID> variables) const override;
+
+    void GetRealVariables(
+        const coral::slave::VariableList& variables,
+        double* values) const override;
+    void GetIntegerVariables(
+        const coral::slave::VariableList& variables,
+        int* values) const override;
+    void GetBooleanVariables(
+        const coral::slave::VariableList& variables,
+        bool* values) const override;
+    void GetStringVariables(
+        const coral::slave::VariableList& variables,
+        std::string* values) const override;
+
+    bool SetRealVariables(
+        const coral::slave::VariableList& variables,
+        const double* values) override;
+    bool SetIntegerVariables(
+        const coral::slave::VariableList& variables,
+        const int* values) override;
+    bool SetBooleanVariables(
+        const coral::slave::VariableList& variables,
+        const bool* values) override;
+    bool SetStringVariables(
+        const coral::slave::VariableList& variables,
+        const std::string* values) override;
+
     // coral::fmi::SlaveInstance methods
     std::shared_ptr<coral::fmi::FMU> FMU() const override;
 
@@ -173,6 +203,12 @@ private:
     std::string m_instanceName;
     coral::model::TimePoint m_startTime = 0.0;
     coral::model::TimePoint m_stopTime  = coral::model::ETERNITY;
+
+    // Scratch buffers for the functions that get/set several variables at
+    // once, kept between calls to avoid reallocation.
+    // (The element types are those of fmi1_boolean_t and fmi1_string_t.)
+    mutable std::vector<char> m_booleanBuffer;
+    mutable std::vector<const char*> m_stringBuffer;
 };
 
 
@@ -12,6 +12,9 @@
 
 #include <coral/master/cluster.hpp>
 #include <coral/master/execution.hpp>
+#include <coral/master/in_process.hpp>
+#include <coral/master/realtime.hpp>
+#include <coral/master/statistics.hpp>
 
 
 namespace coral
@@ -14,6 +14,7 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <system_error>
 #include <vector>
 
 #include <coral/config.h>
@@ -58,6 +59,38 @@ public:
         std::vector<std::string> providers;
     };
 
+    /**
+     *  \brief
+     *  A request for the instantiation of a slave, and its outcome, for use
+     *  with `InstantiateSlaves()`.
+     */
+    struct SlaveInstantiation
+    {
+        /// [Input] The ID of the slave provider that should instantiate the slave.
+        std::string slaveProviderID;
+
+        /// [Input] The UUID of the slave type.
+        std::string slaveTypeUUID;
+
+        /// [Output] The slave's network location, if it was instantiated.
+        coral::net::SlaveLocator locator;
+
+        /// [Output] The error which occurred, if any.
+        std::error_code error;
+
+        /// [Output] A more detailed error message, if available.
+        std::string errorMessage;
+
+        /// Default constructor.
+        SlaveInstantiation() noexcept { }
+
+        /// Constructor which sets the `#slaveProviderID` and `#slaveTypeUUID` fields.
+        SlaveInstantiation(std::string slaveProviderID_, std::string slaveTypeUUID_)
+            : slaveProviderID(std::move(slaveProviderID_))
+            , slaveTypeUUID(std::move(slaveTypeUUID_))
+        { }
+    };
+
     /**
      *  \brief
      *  Constructor.
@@ -130,6 +163,38 @@ public:
         const std::string& slaveTypeUUID,
         std::chrono::milliseconds timeout);
 
+    /**
+     *  \brief
+     *  Requests that several slaves be spawned, concurrently.
+     *
+     *  All requests are sent at once from the background thread, and the
+     *  function returns when every one of them has either succeeded or
+     *  failed.  Each slave provider gets up to `maxConcurrentPerProvider`
+     *  requests at a time, over separate connections, while the rest wait
+     *  in a queue.  The timeouts apply to each request, as for
+     *  `InstantiateSlave()`, counted from the time it is sent.
+     *
+     *  \param [in,out] slaves
+     *      The slaves to instantiate.  On return, the `locator` field of each
+     *      element is set if the slave was instantiated, and the `error` and
+     *      `errorMessage` fields otherwise.
+     *  \param [in] timeout
+     *      How much time each slave gets to start up.
+     *      A negative value means no limit.
+     *  \param [in] maxConcurrentPerProvider
+     *      The maximum number of requests which may be in progress at the
+     *      same time for each slave provider.  Must be at least 1.
+     *
+     *  \throws std::runtime_error
+     *      If one or more slaves could not be instantiated.  This is thrown
+     *      after all requests have completed, and the `error` fields tell
+     *      which ones failed.
+     */
+    void InstantiateSlaves(
+        std::vector<SlaveInstantiation>& slaves,
+        std::chrono::milliseconds timeout,
+        std::size_t maxConcurrentPerProvider = 8);
+
 private:
     class Private;
     std::unique_ptr<Private> m_private;
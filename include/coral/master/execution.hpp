@@ -19,6 +19,8 @@
 
 #include <coral/config.h>
 #include <coral/master/execution_options.hpp>
+#include <coral/master/realtime.hpp>
+#include <coral/master/statistics.hpp>
 #include <coral/model.hpp>
 #include <coral/net.hpp>
 
@@ -275,7 +277,7 @@ public:
      */
     StepResult Step(
         coral::model::TimeDuration stepSize,
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         std::vector<std::pair<coral::model::SlaveID, StepResult>>* slaveResults = nullptr);
 
     /**
@@ -290,7 +292,90 @@ public:
      *      The communications timeout used to detect loss of communication
      *      with slaves.  A negative value means no timeout.
      */
-    void AcceptStep(std::chrono::milliseconds timeout);
+    void AcceptStep(std::chrono::microseconds timeout);
+
+    /**
+     *  \brief
+     *  Confirms and completes a time step, and initiates the next one.
+     *
+     *  This has the same effect as `AcceptStep()` followed by `Step()`,
+     *  but each slave only needs a single round trip for both,
+     *  which makes a noticeable difference when steps are short.  Slaves
+     *  which do not support this are sent the two commands in turn.
+     *
+     *  This method may be called instead of `AcceptStep()` after a
+     *  successful `Step()` or `AcceptStepAndStep()` call.  Since the
+     *  last step must still be accepted, a simulation which never discards
+     *  steps would typically call `Step()` once, then
+     *  `AcceptStepAndStep()` repeatedly, and finally `AcceptStep()`.
+     *
+     *  \param [in] stepSize
+     *      How much the simulation should be advanced in time.
+     *      This must be a positive number.
+     *  \param [in] timeout
+     *      The communications timeout used to detect loss of communication
+     *      with slaves.  This should cover both the time it takes to
+     *      accept the previous step and to perform the next one.
+     *      A negative value means no timeout.
+     *  \param [in] slaveResults
+     *      An optional vector which, if given, will be cleared and filled
+     *      with the result reported by each slave.
+     *
+     *  \returns
+     *      Whether the new time step was successful, as for `Step()`.
+     */
+    StepResult AcceptStepAndStep(
+        coral::model::TimeDuration stepSize,
+        std::chrono::microseconds timeout,
+        std::vector<std::pair<coral::model::SlaveID, StepResult>>* slaveResults = nullptr);
+
+    /**
+     *  \brief
+     *  Enables real-time pacing of time steps.
+     *
+     *  While real-time pacing is enabled, `Step()` and `AcceptStepAndStep()`
+     *  wait until the wall-clock time at which the step is due before
+     *  starting it, so that simulated time advances at the rate given by
+     *  `options.realTimeFactor`.  The waiting is done by the execution's
+     *  background communication thread, with a short period of busy
+     *  polling just before each deadline (see `RealTimeOptions::spinDuration`),
+     *  so it is not affected by how long the calling thread takes between
+     *  calls.  The schedule is computed from the start of the first step
+     *  after this function is called, so it does not drift.
+     *
+     *  If real-time pacing is already enabled, the schedule and the
+     *  statistics are reset.
+     *
+     *  \param [in] options
+     *      Real-time pacing options.
+     *
+     *  \throws std::invalid_argument if any of the options are invalid.
+     */
+    void EnableRealTime(const RealTimeOptions& options = RealTimeOptions());
+
+    /// Disables real-time pacing and discards the real-time statistics.
+    void DisableRealTime();
+
+    /**
+     *  \brief
+     *  Returns statistics about how well the execution has kept to its
+     *  real-time schedule.
+     *
+     *  If real-time pacing is not enabled, all the statistics are zero.
+     */
+    coral::master::RealTimeStatistics RealTimeStatistics() const;
+
+    /**
+     *  \brief
+     *  Returns statistics about how long each slave spends on the different
+     *  phases of its time steps.
+     *
+     *  The statistics cover the most recent steps, as specified by
+     *  `ExecutionOptions::statisticsWindow`.  Slaves which do not report
+     *  how they spend their time only have statistics for the round trip
+     *  time.
+     */
+    ExecutionStatistics Statistics() const;
 
     /**
      *  \brief
@@ -11,6 +11,7 @@
 #define CORAL_MASTER_EXECUTION_OPTIONS_HPP
 
 #include <chrono>
+#include <cstddef>
 #include <coral/model.hpp>
 
 
@@ -57,7 +58,31 @@ struct ExecutionOptions
      *  This is used when slaves exchange variable values among themselves.
      *  A negative value means no timeout.
      */
-    std::chrono::milliseconds slaveVariableRecvTimeout = std::chrono::seconds(1);
+    std::chrono::microseconds slaveVariableRecvTimeout = std::chrono::seconds(1);
+
+    /**
+     *  \brief
+     *  Whether the master should communicate with all slaves through a
+     *  single socket.
+     *
+     *  By default, the master has a separate socket for each slave, and
+     *  sends one command at a time to each of them.  If this is `true`,
+     *  all control messages are instead multiplexed over one socket, and
+     *  commands to the same slave may be pipelined.  This scales better
+     *  to executions with many slaves.
+     */
+    bool multiplexSlaveControl = false;
+
+    /**
+     *  \brief
+     *  The number of samples covered by each of the per-slave step
+     *  statistics returned by `Execution::Statistics()`.
+     *
+     *  The statistics are based on timing information recorded for every
+     *  STEP and ACCEPT_STEP command, so each sample roughly corresponds to
+     *  one time step.  Zero disables the collection of statistics.
+     */
+    std::size_t statisticsWindow = 1000;
 };
 
 
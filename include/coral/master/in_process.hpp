@@ -0,0 +1,131 @@
+/**
+\file
+\brief Defines the coral::master::InProcessSlaves class.
+\copyright
+    Copyright 2013-present, SINTEF Ocean.
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#ifndef CORAL_MASTER_IN_PROCESS_HPP
+#define CORAL_MASTER_IN_PROCESS_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <coral/config.h>
+#include <coral/net.hpp>
+#include <coral/slave/instance.hpp>
+
+
+namespace coral
+{
+namespace master
+{
+
+
+/**
+ *  \brief
+ *  Runs slaves in the master process.
+ *
+ *  This is an alternative to ProviderCluster for systems where all slaves
+ *  can run on the same machine as the master.  Each slave instance is run by
+ *  a coral::slave::Runner in a separate thread, and it communicates with the
+ *  master and the other slaves through ZMQ "inproc" endpoints rather than
+ *  over the network.  The locators returned by Add() can be passed to
+ *  `Execution::Reconstitute()` as usual, so the rest of the Execution API is
+ *  unchanged.
+ *
+ *  Each slave has its own thread, in which the Runner handles communication
+ *  with the master and the other slaves.  The time steps themselves, i.e.
+ *  the `coral::slave::Instance::DoStep()` calls, are performed by a fixed
+ *  pool of worker threads which is shared by all the slaves, so the CPU is
+ *  not oversubscribed when there are more slaves than cores.  Each slave has
+ *  a preferred worker, and a worker which has nothing to do steals steps
+ *  that are queued for the others.  Thus, a slave with an unusually slow
+ *  model only occupies one worker and does not hold up the others.  The
+ *  Runner thread waits for its slave's step to complete, so the barrier
+ *  semantics of the execution are unchanged.
+ *
+ *  After a step, the slaves exchange variable values through shared memory
+ *  rather than over the "inproc" sockets, on platforms where this is
+ *  supported (see coral::bus::SharedVariableReader).  The copying is done
+ *  while the slaves process the master's "accept step" command.
+ *
+ *  \remark
+ *  The destructor waits for all slave threads to end.  A slave thread ends
+ *  when the execution is terminated with `Execution::Terminate()`, or if the
+ *  slave has had no contact with the master for the amount of time given to
+ *  Add().  The Execution should therefore be terminated before an object of
+ *  this class is destroyed.
+ */
+class InProcessSlaves
+{
+public:
+    /**
+     *  \brief
+     *  Constructor.
+     *
+     *  \param [in] maxConcurrentSteps
+     *      The number of worker threads, i.e., the maximum number of slaves
+     *      which may perform a time step at the same time.  Zero means the
+     *      number of hardware threads.
+     */
+    explicit InProcessSlaves(std::size_t maxConcurrentSteps = 0);
+
+    /// Destructor.  Waits for all slave threads to end.
+    ~InProcessSlaves() noexcept;
+
+    // Disable copying
+    InProcessSlaves(const InProcessSlaves&) = delete;
+    InProcessSlaves& operator=(const InProcessSlaves&) = delete;
+
+    /// Move constructor
+    InProcessSlaves(InProcessSlaves&&) noexcept;
+
+    /// Move assignment operator.  Waits for this object's slave threads to end.
+    InProcessSlaves& operator=(InProcessSlaves&&) noexcept;
+
+    /**
+     *  \brief
+     *  Starts running a slave instance in a new thread.
+     *
+     *  \param [in] instance
+     *      The slave instance.  It must not be used by anyone else while the
+     *      slave is running.
+     *  \param [in] commTimeout
+     *      How long the slave may go without hearing from the master before
+     *      it shuts itself down.  A negative value means no limit.
+     *
+     *  \returns
+     *      An object that contains the information needed to connect to
+     *      the slave, which can be passed to `Execution::Reconstitute()`.
+     */
+    coral::net::SlaveLocator Add(
+        std::shared_ptr<coral::slave::Instance> instance,
+        std::chrono::seconds commTimeout);
+
+    /// The number of slaves that have been added.
+    std::size_t Size() const noexcept;
+
+    /// The number of worker threads which perform the slaves' time steps.
+    std::size_t MaxConcurrentSteps() const noexcept;
+
+private:
+    // The worker pool which performs the time steps, and a slave instance
+    // wrapper which uses it.  Defined in the .cpp file.
+    class StepExecutor;
+    class ExecutorInstance;
+
+    void JoinAll() noexcept;
+
+    std::shared_ptr<StepExecutor> m_stepExecutor;
+    std::vector<std::thread> m_threads;
+};
+
+
+}}      // namespace
+#endif  // header guard
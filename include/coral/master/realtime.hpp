@@ -0,0 +1,197 @@
+/**
+\file
+\brief Real-time pacing of time steps.
+\copyright
+    Copyright 2013-present, SINTEF Ocean.
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#ifndef CORAL_MASTER_REALTIME_HPP
+#define CORAL_MASTER_REALTIME_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <coral/model.hpp>
+
+
+namespace coral
+{
+namespace master
+{
+
+
+/// What to do when a time step starts more than one step period late.
+enum class OverrunPolicy
+{
+    /**
+     *  Keep the original schedule, and start the following steps
+     *  immediately until the simulation has caught up with the wall clock.
+     */
+    catchUp,
+
+    /**
+     *  Give up the lost wall-clock time, so that the following steps are
+     *  scheduled relative to the late one.  The simulation then falls
+     *  permanently behind the original schedule.
+     */
+    skip,
+};
+
+
+/**
+ *  \brief
+ *  Options for real-time pacing of an execution.
+ *
+ *  An object of this type may be passed to `Execution::EnableRealTime()`.
+ */
+struct RealTimeOptions
+{
+    /**
+     *  \brief
+     *  The real-time factor, i.e., how fast simulated time should pass
+     *  relative to wall-clock time.
+     *
+     *  A value of 1 means real time, while e.g. 2 means twice as fast.
+     *  Must be positive.
+     */
+    double realTimeFactor = 1.0;
+
+    /// What to do when a step starts more than one step period late.
+    OverrunPolicy overrunPolicy = OverrunPolicy::catchUp;
+
+    /**
+     *  \brief
+     *  How long before a step is due the master stops sleeping and starts
+     *  polling continuously.
+     *
+     *  A longer spin period makes steps start closer to their due time,
+     *  at the expense of CPU usage.  Must not be negative.
+     */
+    std::chrono::microseconds spinDuration = std::chrono::microseconds(200);
+
+    /// The width of each bin in the step lateness histogram.  Must be positive.
+    std::chrono::microseconds histogramBinWidth = std::chrono::microseconds(50);
+
+    /// The number of bins in the step lateness histogram.  Must be positive.
+    std::size_t histogramBinCount = 40;
+};
+
+
+/// Statistics about how well an execution has kept to its real-time schedule.
+struct RealTimeStatistics
+{
+    /// The number of paced steps.
+    std::uint64_t stepCount = 0;
+
+    /// The number of steps which started more than one step period late.
+    std::uint64_t overrunCount = 0;
+
+    /// The number of step periods given up with `OverrunPolicy::skip`.
+    std::uint64_t skippedPeriods = 0;
+
+    /// The mean time from a step was due until it was started.
+    std::chrono::nanoseconds meanLateness = std::chrono::nanoseconds(0);
+
+    /// The maximum time from a step was due until it was started.
+    std::chrono::nanoseconds maxLateness = std::chrono::nanoseconds(0);
+
+    /// The width of each bin in `latenessHistogram`.
+    std::chrono::microseconds histogramBinWidth = std::chrono::microseconds(0);
+
+    /**
+     *  \brief
+     *  A histogram of step lateness.
+     *
+     *  Element `i` is the number of steps which started between
+     *  `i*histogramBinWidth` and `(i+1)*histogramBinWidth` after they were
+     *  due.  The last element also includes all steps which were later
+     *  than that.
+     */
+    std::vector<std::uint64_t> latenessHistogram;
+};
+
+
+/**
+ *  \brief
+ *  Computes the wall-clock times at which time steps should start in order
+ *  to run a simulation in real time.
+ *
+ *  Step start times are computed from a fixed origin (the start of the first
+ *  step), by adding the wall-clock duration of each step, so errors do not
+ *  accumulate over time.
+ *
+ *  This class is used by `Execution` when real-time pacing is enabled, but
+ *  it may also be used on its own.
+ */
+class RealTimePacer
+{
+public:
+    /// The clock used for pacing.
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     *  \brief
+     *  Constructor.
+     *
+     *  \throws std::invalid_argument if any of the options are invalid.
+     */
+    explicit RealTimePacer(const RealTimeOptions& options);
+
+    /// The options given to the constructor.
+    const RealTimeOptions& Options() const noexcept;
+
+    /**
+     *  \brief
+     *  Returns the time at which the next step should start.
+     *
+     *  Before the first step, and after `Reset()`, this is a time in the
+     *  distant past, i.e., the next step is due immediately.
+     */
+    Clock::time_point NextStepTime() const noexcept;
+
+    /**
+     *  \brief
+     *  Registers the start of a time step, and schedules the next one.
+     *
+     *  \param [in] stepSize
+     *      The simulated duration of the step.  Must be positive.
+     *  \param [in] now
+     *      The time at which the step starts.
+     */
+    void StepStarted(
+        coral::model::TimeDuration stepSize,
+        Clock::time_point now = Clock::now());
+
+    /**
+     *  \brief
+     *  Restarts the schedule, so that the next step is due immediately and
+     *  becomes the new origin.
+     *
+     *  This is useful after the simulation has been deliberately paused.
+     *  The statistics are not reset.
+     */
+    void Reset() noexcept;
+
+    /// Returns statistics about the steps registered so far.
+    RealTimeStatistics Statistics() const;
+
+private:
+    RealTimeOptions m_options;
+    bool m_started;
+    Clock::time_point m_nextStepTime;
+
+    std::uint64_t m_stepCount;
+    std::uint64_t m_overrunCount;
+    std::uint64_t m_skippedPeriods;
+    double m_latenessSum;
+    Clock::duration m_maxLateness;
+    std::vector<std::uint64_t> m_histogram;
+};
+
+
+}} // namespace
+#endif // header guard
@@ -0,0 +1,105 @@
+/**
+\file
+\brief Types that describe where the time goes in an execution's time steps.
+\copyright
+    Copyright 2013-present, SINTEF Ocean.
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#ifndef CORAL_MASTER_STATISTICS_HPP
+#define CORAL_MASTER_STATISTICS_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <coral/model.hpp>
+
+
+namespace coral
+{
+namespace master
+{
+
+
+/**
+ *  \brief
+ *  Statistics about a set of duration samples.
+ *
+ *  The samples are the most recent ones, up to the number given by
+ *  `ExecutionOptions::statisticsWindow`.
+ */
+struct LatencyStatistics
+{
+    /// The number of samples.
+    std::uint64_t sampleCount = 0;
+
+    /// The mean duration.
+    std::chrono::microseconds mean = std::chrono::microseconds(0);
+
+    /// The maximum duration.
+    std::chrono::microseconds max = std::chrono::microseconds(0);
+
+    /**
+     *  \brief
+     *  A histogram of the durations, with bins whose widths increase
+     *  exponentially.
+     *
+     *  Element 0 is the number of samples shorter than 1 microsecond, and
+     *  element `i > 0` the number of samples between `2^(i-1)` and `2^i`
+     *  microseconds.  The last element also includes all samples which
+     *  are longer than that.  The vector is empty if there are no samples.
+     */
+    std::vector<std::uint64_t> histogram;
+};
+
+
+/**
+ *  \brief
+ *  A breakdown of how long a slave spends on the different phases of a
+ *  time step.
+ *
+ *  All but `roundTrip` and `network` are reported by the slave itself,
+ *  and are only available for slaves which support it.
+ */
+struct SlaveStepStatistics
+{
+    /// The slave's ID.
+    coral::model::SlaveID slaveID = coral::model::INVALID_SLAVE_ID;
+
+    /// The slave's name.
+    std::string slaveName;
+
+    /// The time spent performing the time step itself.
+    LatencyStatistics doStep;
+
+    /// The time spent getting and publishing the values of output variables.
+    LatencyStatistics publish;
+
+    /// The time spent waiting for and setting the values of input variables.
+    LatencyStatistics inputWait;
+
+    /**
+     *  \brief
+     *  The time spent in transit, i.e., the round trip time minus the time
+     *  the slave was busy.
+     */
+    LatencyStatistics network;
+
+    /// The time from a command is sent until its reply is received.
+    LatencyStatistics roundTrip;
+};
+
+
+/// Statistics about the time steps of an execution.
+struct ExecutionStatistics
+{
+    /// Per-slave statistics, ordered by slave ID.
+    std::vector<SlaveStepStatistics> slaves;
+};
+
+
+}} // namespace
+#endif // header guard
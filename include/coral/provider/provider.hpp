@@ -10,6 +10,7 @@
 #ifndef CORAL_PROVIDER_PROVIDER_HPP_INCLUDED
 #define CORAL_PROVIDER_PROVIDER_HPP_INCLUDED
 
+#include <cstddef>
 #include <exception>
 #include <functional>
 #include <memory>
@@ -58,13 +59,20 @@ public:
         Note that the exception handler will be called *in* the background
         thread, so care should be taken not to implement it in a thread-unsafe
         manner.
+    \param [in] maxConcurrentInstantiations
+        The maximum number of slave instantiations that may be in progress
+        at the same time.  Further requests are queued until one of the
+        ongoing instantiations completes.  This only applies to slave types
+        which support non-blocking instantiation (see
+        SlaveCreator::StartInstantiation()).  Must be at least 1.
     */
     SlaveProvider(
         const std::string& slaveProviderID,
         std::vector<std::unique_ptr<SlaveCreator>>&& slaveTypes,
         const coral::net::ip::Address& networkInterface,
         coral::net::ip::Port discoveryPort,
-        std::function<void(std::exception_ptr)> exceptionHandler = nullptr);
+        std::function<void(std::exception_ptr)> exceptionHandler = nullptr,
+        std::size_t maxConcurrentInstantiations = 8);
 
     SlaveProvider(const SlaveProvider&) = delete;
     SlaveProvider& operator=(const SlaveProvider&) = delete;
@@ -11,18 +11,63 @@
 #define CORAL_PROVIDER_SLAVE_CREATOR_HPP_INCLUDED
 
 #include <chrono>
+#include <memory>
 #include <string>
 
 #include <coral/model.hpp>
 #include <coral/net.hpp>
 
 
+// Forward declaration to avoid dependency on ZMQ headers
+namespace zmq { class socket_t; }
+
+
 namespace coral
 {
 namespace provider
 {
 
 
+/**
+\brief  A slave instantiation which has been started with
+        SlaveCreator::StartInstantiation(), but which has not yet completed.
+
+Destroying an object of this type before Complete() has been called means
+that the instantiation is abandoned, e.g. because it timed out.
+*/
+class PendingInstantiation
+{
+public:
+    /**
+    \brief  A socket which becomes readable when the instantiation is ready
+            to be completed.
+
+    The slave provider will poll this socket and call Complete() as soon as
+    it has incoming messages.  The socket must remain valid for the lifetime
+    of this object.
+    */
+    virtual zmq::socket_t& Socket() = 0;
+
+    /**
+    \brief  Completes the instantiation.
+
+    This function is called once, when Socket() has incoming messages.  It
+    must not block, and it must not throw.
+
+    If the slave was successfully instantiated, the function must update
+    `slaveLocator` (see SlaveCreator::Instantiate()) and return `true`.
+    Otherwise, it must update `failureDescription` with a textual description
+    of the reasons for the failure and return `false`.
+    */
+    virtual bool Complete(
+        coral::net::SlaveLocator& slaveLocator,
+        std::string& failureDescription) = 0;
+
+    // Virtual destructor to allow deletion through base class reference.
+    virtual ~PendingInstantiation() { }
+};
+
+
 /// An interface for classes that create slaves of a specific type.
 class SlaveCreator
 {
@@ -77,6 +122,46 @@ public:
     */
     virtual std::string InstantiationFailureDescription() const = 0;
 
+    /**
+    \brief  Starts the instantiation of a new slave without waiting for it to
+            complete.
+
+    Slave types for which instantiation takes a while (e.g. because it
+    involves starting a new process) may override this function so that the
+    slave provider can serve other requests, including other instantiations,
+    in the meantime.  The slave provider takes care of the timeout; if the
+    instantiation has not completed in time, the returned object is simply
+    destroyed.
+
+    The default implementation returns `nullptr`, which means that the slave
+    provider should call Instantiate() instead.
+
+    \param [in] timeout
+        How long the master will wait for the slave to start up.
+
+    \returns an object which represents the ongoing instantiation, or `nullptr`
+        if this slave type only supports blocking instantiation.
+    \throws std::runtime_error if the instantiation could not be started.
+    */
+    virtual std::unique_ptr<PendingInstantiation> StartInstantiation(
+        std::chrono::milliseconds /*timeout*/)
+    {
+        return nullptr;
+    }
+
+    /**
+    \brief  Performs periodic housekeeping.
+
+    The slave provider calls this function at regular intervals (about once
+    per second) from its background thread, also when no instantiation
+    requests arrive.  Slave types which keep resources around between
+    requests, e.g. a pool of idle slaves, may override it to check on and
+    replenish them.  The function must not block, and it must not throw.
+
+    The default implementation does nothing.
+    */
+    virtual void Maintain() { }
+
     // Virtual destructor to allow deletion through base class reference.
     virtual ~SlaveCreator() { }
 };
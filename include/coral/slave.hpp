@@ -13,6 +13,8 @@
 #include <coral/slave/exception.hpp>
 #include <coral/slave/instance.hpp>
 #include <coral/slave/logging.hpp>
+#include <coral/slave/publishing.hpp>
+#include <coral/slave/recording.hpp>
 #include <coral/slave/runner.hpp>
 
 
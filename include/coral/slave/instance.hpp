@@ -10,7 +10,10 @@
 #ifndef CORAL_SLAVE_INSTANCE_HPP
 #define CORAL_SLAVE_INSTANCE_HPP
 
+#include <cstddef>
+#include <memory>
 #include <string>
+#include <vector>
 #include <coral/model.hpp>
 
 namespace coral
@@ -19,6 +22,40 @@ namespace slave
 {
 
 
+/**
+\brief  A list of variables of one data type, for use with the functions in
+        Instance that get or set several variables at once.
+
+Objects of this class are created with Instance::PrepareVariables().
+Implementations of Instance may derive from it to store information which
+they need for fast access to the variables, such as their own variable
+references.
+*/
+class VariableList
+{
+public:
+    /// Constructor.
+    VariableList(
+        coral::model::DataType dataType,
+        std::vector<coral::model::VariableID> variables);
+
+    virtual ~VariableList() = default;
+
+    /// The data type of the variables.
+    coral::model::DataType DataType() const noexcept;
+
+    /// The variable IDs.
+    const std::vector<coral::model::VariableID>& Variables() const noexcept;
+
+    /// The number of variables.
+    std::size_t Size() const noexcept;
+
+private:
+    coral::model::DataType m_dataType;
+    std::vector<coral::model::VariableID> m_variables;
+};
+
+
 /**
 \brief  An interface for classes that represent slave instances.
 
@@ -26,12 +63,12 @@ The function call sequence is as follows:
 
   1. `Setup()`:
         Configure the slave and enter initialisation mode.
-  2. `Get...Variable()`, `Set...Variable()`:
+  2. `Get...Variable[s]()`, `Set...Variable[s]()`:
         Variable initialisation.  The functions may be called multiple times
         in any order.
   3. `StartSimulation()`:
         End initialisation mode, start simulation.
-  4. `DoStep()`, `Get...Variable()`, `Set...Variable()`:
+  4. `DoStep()`, `Get...Variable[s]()`, `Set...Variable[s]()`:
         Simulation.  The functions may be called multiple times in any order.
   5. `EndSimulation()`:
         End simulation.
@@ -180,6 +217,124 @@ public:
     */
     virtual bool SetStringVariable(coral::model::VariableID variable, const std::string& value) = 0;
 
+    /**
+    \brief  Prepares a list of variables for use with the functions that
+            get or set several variables at once.
+
+    The returned object may be used with the `Get...Variables()` and
+    `Set...Variables()` functions for the given data type, on this instance
+    only, and for as long as the instance exists.  Preparing the list in
+    advance allows implementations to translate variable IDs to their own
+    representation once, rather than on every call.
+
+    The default implementation checks the variables against TypeDescription()
+    and returns a plain VariableList.
+
+    \param [in] dataType
+        The data type of the variables.
+    \param [in] variables
+        The variable IDs, in the order in which values will be passed to and
+        from the bulk functions.
+
+    \throws std::logic_error
+        If one of the IDs does not refer to a variable of type `dataType`.
+    */
+    virtual std::unique_ptr<VariableList> PrepareVariables(
+        coral::model::DataType dataType,
+        std::vector<coral::model::VariableID> variables) const;
+
+    /**
+    \brief  Retrieves the values of several real variables.
+
+    The default implementation calls GetRealVariable() for each variable.
+    Implementations should override it if there is a more efficient way to
+    retrieve many values at once.
+
+    \param [in] variables
+        A list of variables which has been created by calling
+        PrepareVariables() on this instance.
+    \param [out] values
+        An array of length `variables.Size()`, which will be filled with the
+        variable values, in the same order as `variables.Variables()`.
+
+    \throws std::logic_error
+        If `variables` is not a list of real variables.
+    */
+    virtual void GetRealVariables(
+        const VariableList& variables,
+        double* values) const;
+
+    /**
+    \brief  Retrieves the values of several integer variables.
+    \see GetRealVariables()
+    */
+    virtual void GetIntegerVariables(
+        const VariableList& variables,
+        int* values) const;
+
+    /**
+    \brief  Retrieves the values of several boolean variables.
+    \see GetRealVariables()
+    */
+    virtual void GetBooleanVariables(
+        const VariableList& variables,
+        bool* values) const;
+
+    /**
+    \brief  Retrieves the values of several string variables.
+    \see GetRealVariables()
+    */
+    virtual void GetStringVariables(
+        const VariableList& variables,
+        std::string* values) const;
+
+    /**
+    \brief  Sets the values of several real variables.
+
+    The default implementation calls SetRealVariable() for each variable.
+    Implementations should override it if there is a more efficient way to
+    set many values at once.
+
+    \param [in] variables
+        A list of variables which has been created by calling
+        PrepareVariables() on this instance.
+    \param [in] values
+        An array of length `variables.Size()` which contains the values, in
+        the same order as `variables.Variables()`.
+
+    \returns
+        Whether all values were set successfully.
+    \throws std::logic_error
+        If `variables` is not a list of real variables.
+    */
+    virtual bool SetRealVariables(
+        const VariableList& variables,
+        const double* values);
+
+    /**
+    \brief  Sets the values of several integer variables.
+    \see SetRealVariables()
+    */
+    virtual bool SetIntegerVariables(
+        const VariableList& variables,
+        const int* values);
+
+    /**
+    \brief  Sets the values of several boolean variables.
+    \see SetRealVariables()
+    */
+    virtual bool SetBooleanVariables(
+        const VariableList& variables,
+        const bool* values);
+
+    /**
+    \brief  Sets the values of several string variables.
+    \see SetRealVariables()
+    */
+    virtual bool SetStringVariables(
+        const VariableList& variables,
+        const std::string* values);
+
     // Because it's an interface:
     virtual ~Instance() { }
 };
@@ -13,8 +13,11 @@
 #include <fstream>
 #include <memory>
 #include <string>
+#include <vector>
 
+#include <coral/model.hpp>
 #include <coral/slave/instance.hpp>
+#include <coral/slave/recording.hpp>
 
 
 namespace coral
@@ -39,10 +42,16 @@ public:
         to this name.  If no prefix is required, and the string only
         contains a directory name, it should end with a directory separator
         (a slash).
+    \param [in] spec
+        Which variables to log, and how often.
+
+    \throws std::invalid_argument
+        If `spec.stepInterval` is less than 1.
     */
     explicit LoggingInstance(
         std::shared_ptr<Instance> instance,
-        const std::string& outputFilePrefix = std::string{});
+        const std::string& outputFilePrefix = std::string{},
+        const RecordingSpec& spec = RecordingSpec{});
 
     // slave::Instance methods.
     coral::model::SlaveTypeDescription TypeDescription() const override;
@@ -64,11 +73,24 @@ public:
     bool SetIntegerVariable(coral::model::VariableID variable, int value) override;
     bool SetBooleanVariable(coral::model::VariableID variable, bool value) override;
     bool SetStringVariable(coral::model::VariableID variable, const std::string& value) override;
+    std::unique_ptr<VariableList> PrepareVariables(coral::model::DataType dataType, std::vector<coral::model::VariableID> variables) const override;
+    void GetRealVariables(const VariableList& variables, double* values) const override;
+    void GetIntegerVariables(const VariableList& variables, int* values) const override;
+    void GetBooleanVariables(const VariableList& variables, bool* values) const override;
+    void GetStringVariables(const VariableList& variables, std::string* values) const override;
+    bool SetRealVariables(const VariableList& variables, const double* values) override;
+    bool SetIntegerVariables(const VariableList& variables, const int* values) override;
+    bool SetBooleanVariables(const VariableList& variables, const bool* values) override;
+    bool SetStringVariables(const VariableList& variables, const std::string* values) override;
 
 private:
     std::shared_ptr<Instance> m_instance;
     std::string m_outputFilePrefix;
+    RecordingSpec m_spec;
     std::ofstream m_outputStream;
+    std::vector<coral::model::VariableDescription> m_variables;
+    int m_stepsSinceLogged;
+    coral::model::TimePoint m_lastLoggedT;
 };
 
 
@@ -0,0 +1,102 @@
+/**
+\file
+\brief  Defines options that control how slaves publish their output values.
+\copyright
+    Copyright 2013-present, SINTEF Ocean.
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#ifndef CORAL_SLAVE_PUBLISHING_HPP_INCLUDED
+#define CORAL_SLAVE_PUBLISHING_HPP_INCLUDED
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <coral/model.hpp>
+
+
+namespace coral
+{
+namespace slave
+{
+
+
+/**
+\brief  Specifies when the value of an output variable is published.
+
+A default-constructed object specifies that the value is published in every
+time step.
+*/
+struct PublishPolicy
+{
+    /**
+    \brief  Whether the value is only published when it has changed since
+            it was last published.
+
+    If this is `false`, the remaining fields are ignored.
+    */
+    bool onChange = false;
+
+    /**
+    \brief  For real variables, how much the value must change, in absolute
+            terms, to be published.
+
+    The change is measured against the last published value, so small changes
+    do not accumulate unnoticed.  A change which is larger than both this and
+    the relative deadband is published.  Zero means that any change is
+    published.  Non-real variables are always published when they change.
+    */
+    double absoluteDeadband = 0.0;
+
+    /**
+    \brief  For real variables, how much the value must change, relative to
+            the magnitude of the last published value, to be published.
+
+    See `absoluteDeadband`.
+    */
+    double relativeDeadband = 0.0;
+};
+
+
+/**
+\brief  Specifies how a slave publishes the values of its output variables.
+
+Values which are not published in a time step are taken to be unchanged by
+the receiving slaves.  To make sure that they never end up with outdated
+values, every output is published regardless of policy in the first time
+step, whenever the master requests it (e.g. after reconfiguring the
+execution), and periodically in "keyframes".
+*/
+struct PublishOptions
+{
+    /// The policy for variables which do not match any entry in `variables`.
+    PublishPolicy defaultPolicy;
+
+    /**
+    \brief  Policies for specific variables.
+
+    Each entry consists of a variable name pattern and the policy for the
+    matching variables.  The patterns may contain the wildcards `*`, which
+    matches any sequence of characters, and `?`, which matches any single
+    character.  If a variable matches several patterns, the first one is
+    used.
+    */
+    std::vector<std::pair<std::string, PublishPolicy>> variables;
+
+    /**
+    \brief  The number of time steps between keyframes, in which all outputs
+            are published.
+
+    Zero means that there are no periodic keyframes.
+    */
+    int keyframeInterval = 100;
+
+    /// Returns the policy for the given variable.
+    const PublishPolicy& PolicyFor(const coral::model::VariableDescription& variable) const;
+};
+
+
+}} // namespace
+#endif // header guard
@@ -0,0 +1,346 @@
+/**
+\file
+\brief  Defines the coral::slave::RecordingInstance class and related
+        functionality for reading the recordings it produces.
+\copyright
+    Copyright 2013-present, SINTEF Ocean.
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#ifndef CORAL_SLAVE_RECORDING_HPP_INCLUDED
+#define CORAL_SLAVE_RECORDING_HPP_INCLUDED
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <coral/model.hpp>
+#include <coral/slave/instance.hpp>
+
+
+namespace coral
+{
+namespace slave
+{
+
+
+/**
+\brief  Specifies which variables to record, and how often.
+
+This is used by RecordingInstance and LoggingInstance.  A default-constructed
+object specifies that all variables should be recorded in every time step.
+*/
+struct RecordingSpec
+{
+    /**
+    \brief  The names of the variables to record.
+
+    The names may contain the wildcards `*`, which matches any sequence of
+    characters, and `?`, which matches any single character.  An empty list
+    means that all variables are recorded.
+    */
+    std::vector<std::string> variables;
+
+    /**
+    \brief  The causalities of the variables to record.
+
+    This is a bitwise OR of coral::model::Causality values, or zero to record
+    variables of all causalities.
+    */
+    int causalities = 0;
+
+    /// Record only every `stepInterval`th time step.  Must be at least 1.
+    int stepInterval = 1;
+
+    /**
+    \brief  The minimum amount of simulation time that must pass between
+            recorded time steps.
+
+    Time steps which would be recorded according to `stepInterval`, but
+    which end less than this long after the last recorded one, are skipped.
+    */
+    coral::model::TimeDuration minTimeInterval = 0.0;
+
+    /// Returns whether the given variable should be recorded.
+    bool Includes(const coral::model::VariableDescription& variable) const;
+
+    /**
+    \brief  Returns whether a time step should be recorded.
+
+    \param [in] stepsSinceRecorded
+        The number of time steps since the last recorded step, including the
+        current one.  (I.e., this is 1 for the step right after a recorded
+        one.)
+    \param [in] timeSinceRecorded
+        The amount of simulation time between the end of the last recorded
+        time step and the end of the current one.  This should be infinite
+        if no time step has been recorded yet.
+    */
+    bool IsDue(
+        int stepsSinceRecorded,
+        coral::model::TimeDuration timeSinceRecorded) const;
+};
+
+
+/// Options that control how RecordingInstance buffers values in memory.
+struct RecordingBufferOptions
+{
+    /**
+    \brief  The number of blocks of values which are allocated.
+
+    One block at a time is filled with values, while the others are either
+    waiting to be written to disk, being written, or free.  This must be at
+    least 2.  More blocks make it possible to ride out longer disk latency
+    spikes without affecting DoStep(), at the cost of more memory (on the
+    order of a megabyte per block).
+    */
+    std::size_t blockCount = 4;
+
+    /**
+    \brief  What to do if no block is free when values should be recorded.
+
+    If this is `false`, DoStep() waits for the background thread to finish
+    writing a block.  If it is `true`, the values for the time step are
+    discarded instead, so that disk output never slows down the simulation.
+    */
+    bool dropWhenFull = false;
+};
+
+
+/// Statistics about the buffering done by a RecordingInstance.
+struct RecordingStatistics
+{
+    /// The number of time steps whose values have been recorded.
+    std::uint64_t recordedSteps = 0;
+
+    /// The number of time steps whose values were dropped because no block was free.
+    std::uint64_t droppedSteps = 0;
+
+    /// The number of time steps in which DoStep() had to wait for a free block.
+    std::uint64_t blockedSteps = 0;
+
+    /// The total time DoStep() has spent waiting for free blocks.
+    std::chrono::nanoseconds blockedTime = std::chrono::nanoseconds(0);
+};
+
+
+/**
+\brief  A slave instance wrapper that records variable values to a file in
+        a compact binary format.
+
+This serves the same purpose as LoggingInstance, but is much cheaper per
+time step.  Rather than formatting values as text, the values of the
+recorded variables are collected with the bulk getter functions of the wrapped
+instance and stored in typed columns in memory.  When enough time steps have
+been collected to fill a block (on the order of a megabyte), the block is
+handed over to a background thread which writes it to disk.  A fixed number
+of blocks are allocated up front and reused, as specified by
+RecordingBufferOptions.  This means that in most time steps, DoStep() only
+copies values into memory.  Statistics about the buffering are logged when
+the simulation ends, and are available through Statistics().
+
+The resulting files have the extension ".coralrec" and may be read with
+RecordingReader, or converted to CSV with ExportCSV().
+*/
+class RecordingInstance : public Instance
+{
+public:
+    /**
+    \brief  Constructs a RecordingInstance that wraps the given slave
+            instance and adds recording to it.
+
+    \param [in] instance
+        The slave instance to be wrapped by this one.
+    \param [in] outputFilePrefix
+        A directory and prefix for the output file.  An execution- and
+        slave-specific name as well as a ".coralrec" extension will be
+        appended to this name.  If no prefix is required, and the string only
+        contains a directory name, it should end with a directory separator
+        (a slash).
+    \param [in] spec
+        Which variables to record, and how often.
+    \param [in] bufferOptions
+        How values are buffered in memory before being written to disk.
+
+    \throws std::invalid_argument
+        If `spec.stepInterval` is less than 1 or `bufferOptions.blockCount`
+        is less than 2.
+    */
+    explicit RecordingInstance(
+        std::shared_ptr<Instance> instance,
+        const std::string& outputFilePrefix = std::string{},
+        const RecordingSpec& spec = RecordingSpec{},
+        const RecordingBufferOptions& bufferOptions = RecordingBufferOptions{});
+
+    /// Destructor.  Writes any outstanding values to the file.
+    ~RecordingInstance() noexcept;
+
+    RecordingInstance(const RecordingInstance&) = delete;
+    RecordingInstance& operator=(const RecordingInstance&) = delete;
+
+    // slave::Instance methods.
+    coral::model::SlaveTypeDescription TypeDescription() const override;
+    void Setup(
+        const std::string& slaveName,
+        const std::string& executionName,
+        coral::model::TimePoint startTime,
+        coral::model::TimePoint stopTime,
+        bool adaptiveStepSize,
+        double relativeTolerance) override;
+    void StartSimulation() override;
+    void EndSimulation() override;
+    bool DoStep(coral::model::TimePoint currentT, coral::model::TimeDuration deltaT) override;
+    double GetRealVariable(coral::model::VariableID variable) const override;
+    int GetIntegerVariable(coral::model::VariableID variable) const override;
+    bool GetBooleanVariable(coral::model::VariableID variable) const override;
+    std::string GetStringVariable(coral::model::VariableID variable) const override;
+    bool SetRealVariable(coral::model::VariableID variable, double value) override;
+    bool SetIntegerVariable(coral::model::VariableID variable, int value) override;
+    bool SetBooleanVariable(coral::model::VariableID variable, bool value) override;
+    bool SetStringVariable(coral::model::VariableID variable, const std::string& value) override;
+    std::unique_ptr<VariableList> PrepareVariables(coral::model::DataType dataType, std::vector<coral::model::VariableID> variables) const override;
+    void GetRealVariables(const VariableList& variables, double* values) const override;
+    void GetIntegerVariables(const VariableList& variables, int* values) const override;
+    void GetBooleanVariables(const VariableList& variables, bool* values) const override;
+    void GetStringVariables(const VariableList& variables, std::string* values) const override;
+    bool SetRealVariables(const VariableList& variables, const double* values) override;
+    bool SetIntegerVariables(const VariableList& variables, const int* values) override;
+    bool SetBooleanVariables(const VariableList& variables, const bool* values) override;
+    bool SetStringVariables(const VariableList& variables, const std::string* values) override;
+
+    /**
+    \brief  Statistics about the buffering of values in the current (or most
+            recent) simulation.
+
+    This function may not be called concurrently with DoStep().
+    */
+    RecordingStatistics Statistics() const;
+
+private:
+    // Owns the background thread and the blocks.  Defined in the .cpp file.
+    class Writer;
+
+    std::shared_ptr<Instance> m_instance;
+    std::string m_outputFilePrefix;
+    RecordingSpec m_spec;
+    RecordingBufferOptions m_bufferOptions;
+    std::unique_ptr<Writer> m_writer;
+    int m_stepsSinceRecorded;
+    coral::model::TimePoint m_lastRecordedT;
+
+    // The variables to record, grouped by data type, and scratch space
+    // for one time step's worth of values.
+    std::unique_ptr<VariableList> m_realVariables;
+    std::unique_ptr<VariableList> m_integerVariables;
+    std::unique_ptr<VariableList> m_booleanVariables;
+    std::unique_ptr<VariableList> m_stringVariables;
+    std::vector<double> m_realRow;
+    std::vector<int> m_integerRow;
+    std::unique_ptr<bool[]> m_booleanRow;
+    std::vector<std::string> m_stringRow;
+};
+
+
+/**
+\brief  Reads files produced by RecordingInstance.
+
+The recorded values are read one time step ("row") at a time, but the file
+is read and decoded one block at a time.
+*/
+class RecordingReader
+{
+public:
+    /**
+    \brief  Opens a recording file and reads its header.
+
+    \throws std::runtime_error
+        If the file could not be opened, or if it is not a valid recording
+        file.
+    */
+    explicit RecordingReader(const std::string& path);
+
+    /// The name of the execution in which the values were recorded.
+    const std::string& ExecutionName() const;
+
+    /// The name of the slave whose values were recorded.
+    const std::string& SlaveName() const;
+
+    /// The name of the slave type whose values were recorded.
+    const std::string& SlaveTypeName() const;
+
+    /**
+    \brief  The recorded variables.
+
+    The order is the same as the slave type's variable list, and also
+    corresponds to the order of the values returned by ReadRow().
+    */
+    const std::vector<coral::model::VariableDescription>& Variables() const;
+
+    /**
+    \brief  Reads the values of all variables for the next time step.
+
+    \param [out] time
+        The time point at the end of the time step.
+    \param [out] values
+        The variable values, in the same order as Variables().
+    \returns
+        `true` if a time step was read, `false` if the end of the file
+        was reached.
+    \throws std::runtime_error
+        On I/O error or if the file is corrupt.
+    */
+    bool ReadRow(
+        coral::model::TimePoint& time,
+        std::vector<coral::model::ScalarValue>& values);
+
+private:
+    bool ReadBlock();
+
+    std::ifstream m_file;
+    std::string m_executionName;
+    std::string m_slaveName;
+    std::string m_slaveTypeName;
+    std::vector<coral::model::VariableDescription> m_variables;
+    // For each variable, its column index among variables of the same type.
+    std::vector<std::size_t> m_columns;
+    std::size_t m_realCount;
+    std::size_t m_integerCount;
+    std::size_t m_booleanCount;
+    std::size_t m_stringCount;
+    std::uint64_t m_fileSize;
+
+    // The current block, decoded.
+    std::vector<char> m_buffer;
+    std::size_t m_blockRows;
+    std::size_t m_nextRow;
+    std::vector<double> m_times;
+    std::vector<double> m_reals;
+    std::vector<int> m_integers;
+    std::vector<char> m_booleans;
+    std::vector<std::string> m_strings;
+};
+
+
+/**
+\brief  Writes the contents of a recording to a CSV file.
+
+The format is the same as the one produced by LoggingInstance, i.e., one
+column for the time and one for each variable, with a header row which
+contains the variable names.
+
+\param [in] recording
+    A recording which has not been read from yet.
+\param [out] output
+    The stream to which the CSV data should be written.
+*/
+void ExportCSV(RecordingReader& recording, std::ostream& output);
+
+
+}} // namespace
+#endif // header guard
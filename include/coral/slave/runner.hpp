@@ -15,6 +15,7 @@
 #include <coral/config.h>
 #include <coral/net.hpp>
 #include <coral/slave/instance.hpp>
+#include <coral/slave/publishing.hpp>
 
 
 namespace coral
@@ -36,7 +37,8 @@ public:
         std::shared_ptr<Instance> slaveInstance,
         const coral::net::Endpoint& controlEndpoint,
         const coral::net::Endpoint& dataPubEndpoint,
-        std::chrono::seconds commTimeout);
+        std::chrono::seconds commTimeout,
+        const PublishOptions& publishOptions = PublishOptions{});
 
     Runner(Runner&&) noexcept;
 
@@ -0,0 +1,215 @@
+/**
+\file
+\brief  Main header file for coral::trace (but also contains a macro).
+\copyright
+    Copyright 2013-present, SINTEF Ocean.
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#ifndef CORAL_TRACE_HPP
+#define CORAL_TRACE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+
+namespace coral
+{
+/**
+\brief  Event tracing for profiling.
+
+When tracing is enabled, the library records the begin and end times of
+the phases of each time step (in the master, the slaves and the
+communication reactors) into per-thread buffers which are allocated in
+advance.  When the program is done, the events can be written to a file
+in the JSON-based Trace Event Format, which can be loaded into Chrome's
+`about:tracing` page or the Perfetto UI.
+
+Recording an event is cheap, and involves no locking or memory
+allocation.  If a thread's buffer is full, further events from that
+thread are dropped (and counted).  When tracing is disabled, recording
+an event amounts to checking a flag.
+
+Category, event and argument names must be string literals, or otherwise
+remain valid until the trace has been written.
+*/
+namespace trace
+{
+
+
+/// The clock used for event timestamps.
+using Clock = std::chrono::steady_clock;
+
+
+/**
+\brief  Enables tracing in this process.
+
+`bufferSize` is the max. number of events recorded by each thread.
+Buffers are allocated when a thread records its first event, and
+calling this function again has no effect on existing buffers.
+*/
+void Enable(std::size_t bufferSize = 1000000);
+
+
+namespace detail
+{
+    extern std::atomic<bool> g_enabled;
+}
+
+
+/// Returns whether tracing is enabled in this process.
+inline bool Enabled() noexcept
+{
+    return detail::g_enabled.load(std::memory_order_relaxed);
+}
+
+
+/// Sets the name by which this process is shown in the trace.
+void SetProcessName(const std::string& name);
+
+
+/**
+\brief  Sets the name by which the calling thread is shown in the trace.
+
+This has no effect if tracing is disabled.
+*/
+void SetThreadName(const char* name) noexcept;
+
+
+/**
+\brief  Adds a sample to the estimate of the offset between a reference
+        clock (normally the master's) and this process' trace clock.
+
+`sample` must be the time at which a message was sent, according to the
+reference clock, minus the time at which it was received, according to
+this process' clock.  This is a lower bound for the actual offset, and
+the largest sample seen so far is used as the estimate.  The estimate is
+added to all timestamps when the trace is written, so that traces from
+several processes can be shown on one timeline.
+*/
+void AddClockOffsetSample(std::chrono::nanoseconds sample) noexcept;
+
+
+/**
+\brief  Returns the time since the epoch of `Clock`, in the format used in
+        messages to other processes.
+*/
+std::int64_t ClockNanoseconds(Clock::time_point t = Clock::now()) noexcept;
+
+
+/**
+\brief  Records a synchronous event on the calling thread.
+
+Synchronous events on the same thread must be properly nested.  If
+`argName` is not null, `argValue` is shown as an argument of the event.
+*/
+void RecordEvent(
+    const char* category,
+    const char* name,
+    Clock::time_point begin,
+    Clock::time_point end,
+    const char* argName = nullptr,
+    std::int64_t argValue = 0) noexcept;
+
+
+/**
+\brief  Records an asynchronous event, i.e., one which may overlap other
+        events on the same thread.
+
+Events which have the same category and `id` are shown on the same
+track.  This is used, for example, to show the commands which the master
+has sent to each slave, with the slave ID as the event ID.
+*/
+void RecordAsyncEvent(
+    const char* category,
+    const char* name,
+    std::int64_t id,
+    Clock::time_point begin,
+    Clock::time_point end,
+    const char* argName = nullptr,
+    std::int64_t argValue = 0) noexcept;
+
+
+/**
+\brief  Writes all events recorded so far, in the Trace Event Format.
+
+Threads may keep recording events while this function is running, but
+those are not guaranteed to be included.
+*/
+void Write(std::ostream& stream);
+
+
+/// Writes all events recorded so far to a file.  See Write(std::ostream&).
+void Write(const std::string& path);
+
+
+/// The number of events dropped so far because a buffer was full.
+std::uint64_t DroppedEventCount() noexcept;
+
+
+/**
+\brief  Records a synchronous event which lasts for the lifetime of the
+        object.
+
+The start time is only read if tracing is enabled when the object is
+created.
+*/
+class Scope
+{
+public:
+    /// Starts the event.  See RecordEvent() for the meaning of the arguments.
+    Scope(
+        const char* category,
+        const char* name,
+        const char* argName = nullptr,
+        std::int64_t argValue = 0) noexcept
+        : m_category(category)
+        , m_name(name)
+        , m_argName(argName)
+        , m_argValue(argValue)
+        , m_enabled(Enabled())
+    {
+        if (m_enabled) m_begin = Clock::now();
+    }
+
+    /// Ends the event.
+    ~Scope() noexcept
+    {
+        if (m_enabled) {
+            RecordEvent(m_category, m_name, m_begin, Clock::now(), m_argName, m_argValue);
+        }
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    const char* m_category;
+    const char* m_name;
+    const char* m_argName;
+    std::int64_t m_argValue;
+    bool m_enabled;
+    Clock::time_point m_begin;
+};
+
+
+}} // namespace
+
+
+#define CORAL_TRACE_CONCAT_IMPL(a, b) a ## b
+#define CORAL_TRACE_CONCAT(a, b) CORAL_TRACE_CONCAT_IMPL(a, b)
+
+/**
+\def    CORAL_TRACE_SCOPE(category, name, ...)
+\brief  Records a synchronous event which lasts until the end of the
+        current scope.  See coral::trace::Scope.
+*/
+#define CORAL_TRACE_SCOPE(...) \
+    coral::trace::Scope CORAL_TRACE_CONCAT(coralTraceScope_, __LINE__)(__VA_ARGS__)
+
+#endif // header guard
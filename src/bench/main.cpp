@@ -0,0 +1,823 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/numeric/conversion/cast.hpp>
+
+#include <coral/config.h>
+#include <coral/fmi/fmu.hpp>
+#include <coral/fmi/importer.hpp>
+#include <coral/log.hpp>
+#include <coral/master.hpp>
+#include <coral/model.hpp>
+#include <coral/slave/instance.hpp>
+#include <coral/util/console.hpp>
+
+#include "micro_benchmarks.hpp"
+
+
+// =============================================================================
+// Allocation counting
+// =============================================================================
+
+// All dynamic allocations in the process, including those made by the
+// slave threads and by ZMQ, go through these.
+namespace
+{
+    std::atomic<std::uint64_t> g_allocationCount{0};
+}
+
+
+void* operator new(std::size_t size)
+{
+    ++g_allocationCount;
+    if (const auto ptr = std::malloc(size == 0 ? 1 : size)) return ptr;
+    throw std::bad_alloc();
+}
+
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+
+void operator delete(void* ptr, std::size_t /*size*/) noexcept
+{
+    std::free(ptr);
+}
+
+
+namespace
+{
+    const char* MY_NAME = "coral_bench";
+
+
+// =============================================================================
+// Synthetic slave
+// =============================================================================
+
+    /*
+    A slave with a configurable number of output and input variables, all of
+    the same data type, and a configurable amount of computational work per
+    time step.
+
+    Outputs have IDs 0 to outputCount-1, and inputs the IDs after that.
+    In each step, output `i` is set to a function of input `i % inputCount`,
+    so that values actually change and propagate through connections.
+    */
+    class SyntheticSlave : public coral::slave::Instance
+    {
+    public:
+        SyntheticSlave(
+            coral::model::DataType dataType,
+            std::size_t outputCount,
+            std::size_t inputCount,
+            std::uint64_t computeCost)
+            : m_dataType(dataType)
+            , m_outputCount(outputCount)
+            , m_inputCount(inputCount)
+            , m_computeCost(computeCost)
+            , m_stepCount(0)
+        {
+            const auto n = outputCount + inputCount;
+            switch (dataType) {
+                case coral::model::REAL_DATATYPE:    m_reals.resize(n); break;
+                case coral::model::INTEGER_DATATYPE: m_integers.resize(n); break;
+                case coral::model::BOOLEAN_DATATYPE: m_booleans.resize(n); break;
+                case coral::model::STRING_DATATYPE:  m_strings.resize(n); break;
+            }
+        }
+
+        coral::model::SlaveTypeDescription TypeDescription() const override
+        {
+            std::vector<coral::model::VariableDescription> variables;
+            for (std::size_t i = 0; i < m_outputCount + m_inputCount; ++i) {
+                const bool isOutput = i < m_outputCount;
+                variables.emplace_back(
+                    static_cast<coral::model::VariableID>(i),
+                    isOutput
+                        ? "out" + std::to_string(i)
+                        : "in" + std::to_string(i - m_outputCount),
+                    m_dataType,
+                    isOutput
+                        ? coral::model::OUTPUT_CAUSALITY
+                        : coral::model::INPUT_CAUSALITY,
+                    m_dataType == coral::model::REAL_DATATYPE
+                        ? coral::model::CONTINUOUS_VARIABILITY
+                        : coral::model::DISCRETE_VARIABILITY);
+            }
+            return coral::model::SlaveTypeDescription(
+                "coral.bench.SyntheticSlave",
+                "9d7d1a6e-3b0c-4f5e-8c41-7a2f0e6b5d13",
+                "Synthetic slave used by the Coral benchmark suite",
+                "Coral developers",
+                "0.1",
+                variables);
+        }
+
+        void Setup(
+            const std::string& /*slaveName*/,
+            const std::string& /*executionName*/,
+            coral::model::TimePoint /*startTime*/,
+            coral::model::TimePoint /*stopTime*/,
+            bool /*adaptiveStepSize*/,
+            double /*relativeTolerance*/) override { }
+
+        void StartSimulation() override { }
+
+        void EndSimulation() override { }
+
+        bool DoStep(
+            coral::model::TimePoint /*currentT*/,
+            coral::model::TimeDuration /*deltaT*/) override
+        {
+            // A busy loop whose cost does not depend on the machine's load,
+            // unlike sleeping or spinning until a deadline.
+            std::uint64_t x = m_stepCount;
+            for (std::uint64_t i = 0; i < m_computeCost; ++i) {
+                x = x * 6364136223846793005u + 1442695040888963407u;
+            }
+            m_sink = x;
+            ++m_stepCount;
+
+            const bool hasInput = m_inputCount > 0;
+            for (std::size_t i = 0; i < m_outputCount; ++i) {
+                const auto in = hasInput ? m_outputCount + i % m_inputCount : 0;
+                switch (m_dataType) {
+                    case coral::model::REAL_DATATYPE:
+                        m_reals[i] = (hasInput ? m_reals[in] : 0.0) + 1.0;
+                        break;
+                    case coral::model::INTEGER_DATATYPE:
+                        m_integers[i] = (hasInput ? m_integers[in] : 0) + 1;
+                        break;
+                    case coral::model::BOOLEAN_DATATYPE:
+                        m_booleans[i] = hasInput ? !m_booleans[in] : (m_stepCount % 2 == 0);
+                        break;
+                    case coral::model::STRING_DATATYPE:
+                        m_strings[i] = std::to_string(m_stepCount);
+                        break;
+                }
+            }
+            return true;
+        }
+
+        double GetRealVariable(coral::model::VariableID v) const override
+        {
+            CheckVariable(v, coral::model::REAL_DATATYPE);
+            return m_reals[v];
+        }
+
+        int GetIntegerVariable(coral::model::VariableID v) const override
+        {
+            CheckVariable(v, coral::model::INTEGER_DATATYPE);
+            return m_integers[v];
+        }
+
+        bool GetBooleanVariable(coral::model::VariableID v) const override
+        {
+            CheckVariable(v, coral::model::BOOLEAN_DATATYPE);
+            return m_booleans[v] != 0;
+        }
+
+        std::string GetStringVariable(coral::model::VariableID v) const override
+        {
+            CheckVariable(v, coral::model::STRING_DATATYPE);
+            return m_strings[v];
+        }
+
+        bool SetRealVariable(coral::model::VariableID v, double value) override
+        {
+            CheckVariable(v, coral::model::REAL_DATATYPE);
+            m_reals[v] = value;
+            return true;
+        }
+
+        bool SetIntegerVariable(coral::model::VariableID v, int value) override
+        {
+            CheckVariable(v, coral::model::INTEGER_DATATYPE);
+            m_integers[v] = value;
+            return true;
+        }
+
+        bool SetBooleanVariable(coral::model::VariableID v, bool value) override
+        {
+            CheckVariable(v, coral::model::BOOLEAN_DATATYPE);
+            m_booleans[v] = value;
+            return true;
+        }
+
+        bool SetStringVariable(coral::model::VariableID v, const std::string& value) override
+        {
+            CheckVariable(v, coral::model::STRING_DATATYPE);
+            m_strings[v] = value;
+            return true;
+        }
+
+    private:
+        void CheckVariable(coral::model::VariableID v, coral::model::DataType t) const
+        {
+            if (t != m_dataType || v >= m_outputCount + m_inputCount) {
+                throw std::logic_error("Invalid variable ID: " + std::to_string(v));
+            }
+        }
+
+        const coral::model::DataType m_dataType;
+        const std::size_t m_outputCount;
+        const std::size_t m_inputCount;
+        const std::uint64_t m_computeCost;
+        std::uint64_t m_stepCount;
+        volatile std::uint64_t m_sink;
+
+        std::vector<double> m_reals;
+        std::vector<int> m_integers;
+        std::vector<char> m_booleans;
+        std::vector<std::string> m_strings;
+    };
+
+
+// =============================================================================
+// Benchmark cases
+// =============================================================================
+
+    struct Settings
+    {
+        coral::model::DataType dataType = coral::model::REAL_DATATYPE;
+        std::size_t inputsPerSlave = 0; // 0 means the same as the outputs
+        std::uint64_t computeCost = 0;
+        std::size_t warmupSteps = 100;
+        std::size_t steps = 1000;
+        double stepSize = 0.01;
+        std::size_t stepThreads = 0;
+        bool multiplex = false;
+        unsigned int seed = 1;
+
+        // If set, slaves are instances of this FMU rather than SyntheticSlave.
+        std::string fmuPath;
+        std::shared_ptr<coral::fmi::FMU> fmu;
+    };
+
+
+    struct Case
+    {
+        std::size_t slaves;
+        std::size_t variables;
+        double density;
+    };
+
+
+    struct Result
+    {
+        Case params;
+        std::size_t connections;
+        double wallTime; // seconds
+        double stepsPerSecond;
+        double rti;
+        double p50Latency; // microseconds
+        double p99Latency;
+        double maxLatency;
+        double allocationsPerStep;
+    };
+
+
+    // Returns the element at quantile `q` of a sorted vector, using the
+    // nearest-rank method.
+    double Quantile(const std::vector<double>& sorted, double q)
+    {
+        if (sorted.empty()) return 0.0;
+        const auto rank = static_cast<std::size_t>(
+            std::ceil(q * static_cast<double>(sorted.size())));
+        return sorted[std::min(std::max(rank, std::size_t{1}), sorted.size()) - 1];
+    }
+
+
+    /*
+    Finds the IDs of the output and input variables of the given data type
+    in a slave type description.  Only these are connected, so connections
+    are always between variables of the same type.
+    */
+    void FindPorts(
+        const coral::model::SlaveTypeDescription& description,
+        coral::model::DataType dataType,
+        std::vector<coral::model::VariableID>& outputs,
+        std::vector<coral::model::VariableID>& inputs)
+    {
+        outputs.clear();
+        inputs.clear();
+        for (const auto& v : description.Variables()) {
+            if (v.DataType() != dataType) continue;
+            if (v.Causality() == coral::model::OUTPUT_CAUSALITY) {
+                outputs.push_back(v.ID());
+            } else if (v.Causality() == coral::model::INPUT_CAUSALITY) {
+                inputs.push_back(v.ID());
+            }
+        }
+    }
+
+
+    /*
+    Connects round(density * inputs) of each slave's inputs to outputs of
+    other, randomly chosen, slaves.  The choices only depend on the seed,
+    so the same case always gets the same connections.  There are no
+    connections if there is only one slave.
+
+    One configuration is returned per slave, even if it has no connections,
+    so that the caller can add other settings to it.
+    */
+    std::vector<coral::master::SlaveConfig> MakeConnections(
+        const std::vector<coral::master::AddedSlave>& slaves,
+        const std::vector<coral::model::VariableID>& outputs,
+        const std::vector<coral::model::VariableID>& inputs,
+        double density,
+        unsigned int seed,
+        std::size_t& connectionCount)
+    {
+        std::vector<coral::master::SlaveConfig> configs;
+        connectionCount = 0;
+        const bool connect = slaves.size() >= 2 && !outputs.empty();
+
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<std::size_t> otherSlave(
+            0, connect ? slaves.size() - 2 : 0);
+        std::uniform_int_distribution<std::size_t> output(
+            0, connect ? outputs.size() - 1 : 0);
+        const auto connected = connect
+            ? static_cast<std::size_t>(
+                std::lround(density * static_cast<double>(inputs.size())))
+            : std::size_t{0};
+        for (std::size_t s = 0; s < slaves.size(); ++s) {
+            std::vector<coral::model::VariableSetting> settings;
+            for (std::size_t i = 0; i < connected; ++i) {
+                auto source = otherSlave(rng);
+                if (source >= s) ++source;
+                settings.emplace_back(
+                    inputs[i],
+                    coral::model::Variable(
+                        slaves[source].info.ID(),
+                        outputs[output(rng)]));
+            }
+            connectionCount += settings.size();
+            configs.emplace_back(slaves[s].info.ID(), std::move(settings));
+        }
+        return configs;
+    }
+
+
+    /*
+    Returns the ID of the FMU's "iterations" parameter (see the synthetic
+    test FMU in src/test_fmus), which sets its computational work per time
+    step, or -1 if it has none.
+    */
+    std::int64_t FindIterationsParameter(
+        const coral::model::SlaveTypeDescription& description)
+    {
+        for (const auto& v : description.Variables()) {
+            if (v.Name() == "iterations"
+                    && v.DataType() == coral::model::INTEGER_DATATYPE
+                    && v.Causality() == coral::model::PARAMETER_CAUSALITY) {
+                return v.ID();
+            }
+        }
+        return -1;
+    }
+
+
+    Result RunCase(const Case& c, const Settings& settings)
+    {
+        const auto commTimeout = std::chrono::seconds(10);
+        const auto stepTimeout = std::chrono::seconds(60);
+        const auto inputCount =
+            settings.inputsPerSlave == 0 ? c.variables : settings.inputsPerSlave;
+
+        // The slave threads must outlive the execution.
+        coral::master::InProcessSlaves slaveThreads(settings.stepThreads);
+        std::vector<coral::master::AddedSlave> slaves;
+        for (std::size_t s = 0; s < c.slaves; ++s) {
+            std::shared_ptr<coral::slave::Instance> instance;
+            if (settings.fmu) {
+                instance = settings.fmu->InstantiateSlave();
+            } else {
+                instance = std::make_shared<SyntheticSlave>(
+                    settings.dataType, c.variables, inputCount, settings.computeCost);
+            }
+            slaves.emplace_back(
+                slaveThreads.Add(instance, commTimeout),
+                "slave" + std::to_string(s));
+        }
+
+        coral::master::ExecutionOptions execOptions;
+        execOptions.multiplexSlaveControl = settings.multiplex;
+        execOptions.slaveVariableRecvTimeout = commTimeout;
+        auto exec = coral::master::Execution(MY_NAME, execOptions);
+        exec.Reconstitute(slaves, commTimeout);
+
+        const auto description = settings.fmu
+            ? settings.fmu->Description()
+            : SyntheticSlave(settings.dataType, c.variables, inputCount, 0)
+                .TypeDescription();
+        std::vector<coral::model::VariableID> outputs, inputs;
+        FindPorts(description, settings.dataType, outputs, inputs);
+
+        Result result;
+        result.params = c;
+        result.params.variables = outputs.size();
+        auto configs = MakeConnections(
+            slaves, outputs, inputs, c.density, settings.seed, result.connections);
+        if (settings.fmu && settings.computeCost > 0) {
+            const auto iterations = FindIterationsParameter(description);
+            if (iterations < 0) {
+                throw std::runtime_error(
+                    "--compute was given, but the FMU has no integer "
+                    "\"iterations\" parameter");
+            }
+            for (auto& config : configs) {
+                config.variableSettings.emplace_back(
+                    static_cast<coral::model::VariableID>(iterations),
+                    boost::numeric_cast<int>(settings.computeCost));
+            }
+        }
+        bool anySettings = false;
+        for (const auto& config : configs) {
+            if (!config.variableSettings.empty()) anySettings = true;
+        }
+        if (anySettings) exec.Reconfigure(configs, commTimeout);
+
+        std::vector<double> latencies;
+        latencies.reserve(settings.steps);
+        std::uint64_t allocationsAtStart = 0;
+        auto startTime = std::chrono::steady_clock::now();
+        bool stepPending = false;
+        for (std::size_t i = 0; i < settings.warmupSteps + settings.steps; ++i) {
+            if (i == settings.warmupSteps) {
+                allocationsAtStart = g_allocationCount;
+                startTime = std::chrono::steady_clock::now();
+            }
+            const auto t0 = std::chrono::steady_clock::now();
+            const auto stepResult = stepPending
+                ? exec.AcceptStepAndStep(settings.stepSize, stepTimeout)
+                : exec.Step(settings.stepSize, stepTimeout);
+            const auto t1 = std::chrono::steady_clock::now();
+            if (stepResult != coral::master::StepResult::completed) {
+                throw std::runtime_error("A slave failed to perform a time step");
+            }
+            stepPending = true;
+            if (i >= settings.warmupSteps) {
+                latencies.push_back(
+                    std::chrono::duration<double, std::micro>(t1 - t0).count());
+            }
+        }
+        const auto endTime = std::chrono::steady_clock::now();
+        const auto allocations = g_allocationCount - allocationsAtStart;
+        exec.AcceptStep(commTimeout);
+        exec.Terminate();
+
+        const auto steps = static_cast<double>(settings.steps);
+        result.wallTime = std::chrono::duration<double>(endTime - startTime).count();
+        result.stepsPerSecond = steps / result.wallTime;
+        result.rti = steps * settings.stepSize / result.wallTime;
+        std::sort(latencies.begin(), latencies.end());
+        result.p50Latency = Quantile(latencies, 0.50);
+        result.p99Latency = Quantile(latencies, 0.99);
+        result.maxLatency = latencies.empty() ? 0.0 : latencies.back();
+        result.allocationsPerStep = static_cast<double>(allocations) / steps;
+        return result;
+    }
+
+
+// =============================================================================
+// Output
+// =============================================================================
+
+    const char* DataTypeName(coral::model::DataType dataType)
+    {
+        switch (dataType) {
+            case coral::model::REAL_DATATYPE:    return "real";
+            case coral::model::INTEGER_DATATYPE: return "integer";
+            case coral::model::BOOLEAN_DATATYPE: return "boolean";
+            case coral::model::STRING_DATATYPE:  return "string";
+        }
+        return "unknown";
+    }
+
+
+    void PrintTextHeader(std::ostream& out)
+    {
+        out << std::setw(7) << "slaves"
+            << std::setw(10) << "variables"
+            << std::setw(9) << "density"
+            << std::setw(13) << "connections"
+            << std::setw(12) << "steps/s"
+            << std::setw(10) << "RTI"
+            << std::setw(12) << "p50 (us)"
+            << std::setw(12) << "p99 (us)"
+            << std::setw(12) << "max (us)"
+            << std::setw(13) << "allocs/step"
+            << std::endl;
+    }
+
+
+    void PrintTextRow(std::ostream& out, const Result& r)
+    {
+        out << std::fixed
+            << std::setw(7) << r.params.slaves
+            << std::setw(10) << r.params.variables
+            << std::setw(9) << std::setprecision(2) << r.params.density
+            << std::setw(13) << r.connections
+            << std::setw(12) << std::setprecision(1) << r.stepsPerSecond
+            << std::setw(10) << std::setprecision(2) << r.rti
+            << std::setw(12) << std::setprecision(1) << r.p50Latency
+            << std::setw(12) << r.p99Latency
+            << std::setw(12) << r.maxLatency
+            << std::setw(13) << r.allocationsPerStep
+            << std::endl;
+    }
+
+
+    void PrintCSVHeader(std::ostream& out)
+    {
+        out << "slaves,variables,density,connections,wall_time_s,steps_per_s,"
+               "rti,p50_latency_us,p99_latency_us,max_latency_us,allocations_per_step"
+            << std::endl;
+    }
+
+
+    void PrintCSVRow(std::ostream& out, const Result& r)
+    {
+        out << std::setprecision(9)
+            << r.params.slaves << ','
+            << r.params.variables << ','
+            << r.params.density << ','
+            << r.connections << ','
+            << r.wallTime << ','
+            << r.stepsPerSecond << ','
+            << r.rti << ','
+            << r.p50Latency << ','
+            << r.p99Latency << ','
+            << r.maxLatency << ','
+            << r.allocationsPerStep
+            << std::endl;
+    }
+
+
+    void PrintJSON(
+        std::ostream& out,
+        const Settings& settings,
+        const std::vector<Result>& results)
+    {
+        out << std::setprecision(9)
+            << "{\n"
+            << "  \"benchmark\": \"" << MY_NAME << "\",\n"
+            << "  \"coralVersion\": \"" << CORAL_VERSION_STRING << "\",\n"
+            << "  \"settings\": {"
+            << "\"dataType\": \"" << DataTypeName(settings.dataType) << "\", "
+            << "\"inputsPerSlave\": " << settings.inputsPerSlave << ", "
+            << "\"computeCost\": " << settings.computeCost << ", "
+            << "\"warmupSteps\": " << settings.warmupSteps << ", "
+            << "\"steps\": " << settings.steps << ", "
+            << "\"stepSize\": " << settings.stepSize << ", "
+            << "\"stepThreads\": " << settings.stepThreads << ", "
+            << "\"multiplex\": " << (settings.multiplex ? "true" : "false") << ", "
+            << "\"seed\": " << settings.seed << ", "
+            << "\"fmu\": \"" << settings.fmuPath << "\"},\n"
+            << "  \"results\": [";
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const auto& r = results[i];
+            out << (i == 0 ? "\n" : ",\n")
+                << "    {\"slaves\": " << r.params.slaves
+                << ", \"variables\": " << r.params.variables
+                << ", \"density\": " << r.params.density
+                << ", \"connections\": " << r.connections
+                << ", \"wallTime\": " << r.wallTime
+                << ", \"stepsPerSecond\": " << r.stepsPerSecond
+                << ", \"rti\": " << r.rti
+                << ", \"p50LatencyUs\": " << r.p50Latency
+                << ", \"p99LatencyUs\": " << r.p99Latency
+                << ", \"maxLatencyUs\": " << r.maxLatency
+                << ", \"allocationsPerStep\": " << r.allocationsPerStep
+                << "}";
+        }
+        out << "\n  ]\n}" << std::endl;
+    }
+
+
+// =============================================================================
+// Command line
+// =============================================================================
+
+    template<typename T>
+    std::vector<T> ParseList(const std::string& option, const std::string& value)
+    {
+        std::vector<std::string> items;
+        boost::split(items, value, boost::is_any_of(","));
+        std::vector<T> list;
+        for (auto& item : items) {
+            boost::trim(item);
+            try {
+                list.push_back(boost::lexical_cast<T>(item));
+            } catch (const boost::bad_lexical_cast&) {
+                throw std::runtime_error(
+                    "Invalid value for --" + option + ": " + value);
+            }
+        }
+        return list;
+    }
+
+
+    coral::model::DataType ParseDataType(const std::string& name)
+    {
+        if (name == "real")    return coral::model::REAL_DATATYPE;
+        if (name == "integer") return coral::model::INTEGER_DATATYPE;
+        if (name == "boolean") return coral::model::BOOLEAN_DATATYPE;
+        if (name == "string")  return coral::model::STRING_DATATYPE;
+        throw std::runtime_error("Invalid value for --type: " + name);
+    }
+
+
+    std::string MicroBenchmarkHelp()
+    {
+        std::string help =
+            "Comma-separated list of micro-benchmarks to run instead of "
+            "executions.  The available ones are:";
+        for (const auto& b : MicroBenchmarks()) {
+            help += std::string("\n  ") + b.name + ": " + b.description;
+        }
+        return help;
+    }
+
+
+    void RunMicroBenchmarks(const std::string& names, std::ostream& out)
+    {
+        for (const auto& name : ParseList<std::string>("micro", names)) {
+            const auto b = std::find_if(
+                MicroBenchmarks().begin(),
+                MicroBenchmarks().end(),
+                [&] (const MicroBenchmark& m) { return name == m.name; });
+            if (b == MicroBenchmarks().end()) {
+                throw std::runtime_error("Invalid value for --micro: " + name);
+            }
+            out << "== " << b->name << " ==" << std::endl;
+            b->run(out);
+        }
+    }
+}
+
+
+int main(int argc, const char** argv)
+{
+try {
+    namespace po = boost::program_options;
+    po::options_description options("Options");
+    options.add_options()
+        ("slaves", po::value<std::string>()->default_value("1,4,16"),
+            "Comma-separated list of slave counts.")
+        ("variables", po::value<std::string>()->default_value("1,10,100"),
+            "Comma-separated list of numbers of output variables per slave.")
+        ("density", po::value<std::string>()->default_value("0,1"),
+            "Comma-separated list of connection densities, i.e., the fraction "
+            "of each slave's inputs which are connected to outputs of other "
+            "slaves.")
+        ("inputs", po::value<std::size_t>()->default_value(0),
+            "The number of input variables per slave.  The default, 0, means "
+            "the same as the number of output variables.")
+        ("type", po::value<std::string>()->default_value("real"),
+            "The data type of all variables: real, integer, boolean or string.")
+        ("compute", po::value<std::uint64_t>()->default_value(0),
+            "The number of iterations of a busy loop performed by each slave "
+            "in each time step.  With --fmu, the value of the FMU's "
+            "\"iterations\" parameter.")
+        ("steps", po::value<std::size_t>()->default_value(1000),
+            "The number of measured time steps per case.")
+        ("warmup", po::value<std::size_t>()->default_value(100),
+            "The number of unmeasured time steps before the measured ones.")
+        ("step-size", po::value<double>()->default_value(0.01),
+            "The simulated duration of each time step, used for the real-time "
+            "index (RTI).")
+        ("step-threads", po::value<std::size_t>()->default_value(0),
+            "The maximum number of slaves which may perform a time step at the "
+            "same time.  The default, 0, means the number of hardware threads.")
+        ("multiplex",
+            "Control all slaves through a single socket "
+            "(ExecutionOptions::multiplexSlaveControl).")
+        ("seed", po::value<unsigned int>()->default_value(1),
+            "The seed used for choosing connections.")
+        ("format", po::value<std::string>()->default_value("text"),
+            "The output format: text, csv or json.")
+        ("fmu", po::value<std::string>(),
+            "Use instances of an FMI co-simulation FMU as slaves instead of "
+            "synthetic slaves, e.g. one of the synthetic test FMUs built "
+            "with Coral.  The FMU's inputs and outputs of the type given "
+            "by --type are connected, and --variables and --inputs are "
+            "ignored.")
+        ("micro", po::value<std::string>(), MicroBenchmarkHelp().c_str());
+    coral::util::AddLoggingOptions(options);
+
+    const auto args = coral::util::CommandLine(argc-1, argv+1);
+    const auto optionValues = coral::util::ParseArguments(
+        args, options, po::options_description(), po::positional_options_description(),
+        std::cerr,
+        MY_NAME,
+        "Benchmark suite (" CORAL_PROGRAM_NAME_VERSION ")\n\n"
+        "Runs executions with synthetic slaves (or instances of an FMU) in "
+        "the same process as the master, for every combination of the given "
+        "slave counts, variable counts and connection densities.  For each case, it reports the "
+        "number of steps per second, the real-time index (RTI), the 50th and "
+        "99th percentile and max. step latency, and the number of memory "
+        "allocations per step.  Alternatively, it runs micro-benchmarks of "
+        "individual components (see --micro).");
+    if (!optionValues) return 0;
+    coral::util::UseLoggingArguments(*optionValues, MY_NAME);
+
+    if (optionValues->count("micro")) {
+        RunMicroBenchmarks((*optionValues)["micro"].as<std::string>(), std::cout);
+        return 0;
+    }
+
+    Settings settings;
+    settings.dataType = ParseDataType((*optionValues)["type"].as<std::string>());
+    settings.inputsPerSlave = (*optionValues)["inputs"].as<std::size_t>();
+    settings.computeCost = (*optionValues)["compute"].as<std::uint64_t>();
+    settings.warmupSteps = (*optionValues)["warmup"].as<std::size_t>();
+    settings.steps = (*optionValues)["steps"].as<std::size_t>();
+    settings.stepSize = (*optionValues)["step-size"].as<double>();
+    settings.stepThreads = (*optionValues)["step-threads"].as<std::size_t>();
+    settings.multiplex = !!optionValues->count("multiplex");
+    settings.seed = (*optionValues)["seed"].as<unsigned int>();
+    if (settings.steps == 0) throw std::runtime_error("Invalid value for --steps");
+    if (!(settings.stepSize > 0.0)) throw std::runtime_error("Invalid value for --step-size");
+
+    const auto format = (*optionValues)["format"].as<std::string>();
+    if (format != "text" && format != "csv" && format != "json") {
+        throw std::runtime_error("Invalid value for --format: " + format);
+    }
+
+    // The importer must outlive the FMU's slave instances.
+    std::shared_ptr<coral::fmi::Importer> importer;
+    if (optionValues->count("fmu")) {
+        // Generic format, so that it can be written to JSON unescaped.
+        settings.fmuPath = boost::filesystem::path(
+            (*optionValues)["fmu"].as<std::string>()).generic_string();
+        importer = coral::fmi::Importer::Create();
+        const auto t0 = std::chrono::steady_clock::now();
+        settings.fmu = importer->Import(settings.fmuPath);
+        const auto t1 = std::chrono::steady_clock::now();
+        coral::log::Log(coral::log::info,
+            "Imported " + settings.fmuPath + " in "
+            + std::to_string(std::chrono::duration<double, std::milli>(t1 - t0).count())
+            + " ms");
+    }
+
+    // With an FMU, the number of variables is given by the model.
+    const auto variableCounts = settings.fmu
+        ? std::vector<std::size_t>{0}
+        : ParseList<std::size_t>("variables", (*optionValues)["variables"].as<std::string>());
+
+    std::vector<Case> cases;
+    for (const auto s : ParseList<std::size_t>("slaves", (*optionValues)["slaves"].as<std::string>())) {
+        for (const auto v : variableCounts) {
+            for (const auto d : ParseList<double>("density", (*optionValues)["density"].as<std::string>())) {
+                if (s == 0) throw std::runtime_error("Invalid value for --slaves");
+                if (d < 0.0 || d > 1.0) throw std::runtime_error("Invalid value for --density");
+                cases.push_back(Case{s, v, d});
+            }
+        }
+    }
+
+    if (format == "text") PrintTextHeader(std::cout);
+    else if (format == "csv") PrintCSVHeader(std::cout);
+    std::vector<Result> results;
+    for (const auto& c : cases) {
+        results.push_back(RunCase(c, settings));
+        if (format == "text") PrintTextRow(std::cout, results.back());
+        else if (format == "csv") PrintCSVRow(std::cout, results.back());
+    }
+    if (format == "json") PrintJSON(std::cout, settings, results);
+
+} catch (const std::runtime_error& e) {
+    coral::log::Log(coral::log::error, e.what());
+    return 1;
+} catch (const std::exception& e) {
+    coral::log::Log(coral::log::error, std::string("Internal error (") + e.what() + ')');
+    return 2;
+}
+return 0;
+}
@@ -0,0 +1,430 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include "micro_benchmarks.hpp"
+
+#ifndef _WIN32
+#   include <sys/resource.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include <boost/variant/get.hpp>
+#include <zmq.hpp>
+
+#include <coral/bus/slave_control_messenger.hpp>
+#include <coral/bus/slave_control_router.hpp>
+#include <coral/bus/slave_setup.hpp>
+#include <coral/net.hpp>
+#include <coral/net/reactor.hpp>
+#include <coral/net/zmqx.hpp>
+#include <coral/protocol/exe_data.hpp>
+#include <coral/protocol/execution.hpp>
+#include <coral/util.hpp>
+
+#include <execution.pb.h>
+
+
+namespace
+{
+    // Every ZMQ socket uses at least one file descriptor, so the benchmarks
+    // with thousands of sockets need more than the usual default of 1024.
+    void RaiseFileLimit()
+    {
+#ifndef _WIN32
+        rlimit limit;
+        if (getrlimit(RLIMIT_NOFILE, &limit) == 0
+                && limit.rlim_cur < limit.rlim_max) {
+            limit.rlim_cur = limit.rlim_max;
+            setrlimit(RLIMIT_NOFILE, &limit);
+        }
+#endif
+    }
+
+// =============================================================================
+// exe_data encoding
+// =============================================================================
+
+    // Measures the cost of encoding and decoding a single real value in each
+    // of the supported formats.
+    void EncodingBenchmark(std::ostream& out)
+    {
+        namespace ed = coral::protocol::exe_data;
+        const int valueCount = 1000000;
+
+        for (const auto format : { ed::Format::protobuf, ed::Format::binary }) {
+            ed::Message msg;
+            msg.variable = coral::model::Variable(1, 1);
+            std::vector<zmq::message_t> raw;
+            double sum = 0.0;
+
+            std::chrono::steady_clock::duration encodeTime{}, decodeTime{};
+            for (int i = 0; i < valueCount; ++i) {
+                msg.timestepID = i;
+                msg.value = i * 0.5;
+                const auto t0 = std::chrono::steady_clock::now();
+                ed::CreateMessage(msg, raw, format);
+                const auto t1 = std::chrono::steady_clock::now();
+                const auto parsed = ed::ParseMessage(raw);
+                const auto t2 = std::chrono::steady_clock::now();
+                encodeTime += t1 - t0;
+                decodeTime += t2 - t1;
+                sum += boost::get<double>(parsed.value);
+            }
+            if (sum != 0.25 * valueCount * (valueCount - 1.0)) {
+                throw std::logic_error("Values were not decoded correctly");
+            }
+
+            const auto perValue = [valueCount] (std::chrono::steady_clock::duration d) {
+                return std::chrono::duration<double, std::nano>(d).count() / valueCount;
+            };
+            out << (format == ed::Format::protobuf ? "protobuf" : "binary  ")
+                << " format: encode " << perValue(encodeTime) << " ns/value"
+                << ", decode " << perValue(decodeTime) << " ns/value"
+                << std::endl;
+        }
+    }
+
+
+// =============================================================================
+// Reactor
+// =============================================================================
+
+    // Measures the cost of one messaging loop iteration with many sockets and
+    // timers.  A single message is passed around a ring of socket pairs, and
+    // every time it is received, one of the timers is restarted and another
+    // is replaced by a new one.
+    void ReactorBenchmark(std::ostream& out)
+    {
+        RaiseFileLimit();
+        const std::size_t socketCount = 1000;
+        const std::size_t timerCount = 1000;
+        const int iterations = 100000;
+
+        // Two sockets per pair, which exceeds ZMQ's default limit of 1023.
+        zmq::context_t ctx;
+#if ZMQ_VERSION >= ZMQ_MAKE_VERSION(4, 1, 0)
+        zmq_ctx_set(ctx, ZMQ_MAX_SOCKETS, zmq_ctx_get(ctx, ZMQ_SOCKET_LIMIT));
+#endif
+        std::vector<zmq::socket_t> receivers;
+        std::vector<zmq::socket_t> senders;
+        for (std::size_t i = 0; i < socketCount; ++i) {
+            const auto endpoint = "inproc://coral_bench_reactor_" + std::to_string(i);
+            receivers.emplace_back(ctx, ZMQ_PULL);
+            receivers.back().bind(endpoint);
+            senders.emplace_back(ctx, ZMQ_PUSH);
+            senders.back().connect(endpoint);
+        }
+
+        coral::net::Reactor reactor;
+        const auto neverFires = [] (coral::net::Reactor&, int) {
+            throw std::logic_error("Timer fired unexpectedly");
+        };
+        std::vector<int> timers;
+        for (std::size_t i = 0; i < timerCount; ++i) {
+            timers.push_back(reactor.AddTimer(std::chrono::hours(1), -1, neverFires));
+        }
+
+        int count = 0;
+        for (std::size_t i = 0; i < socketCount; ++i) {
+            reactor.AddSocket(
+                receivers[i],
+                [&, i] (coral::net::Reactor& r, zmq::socket_t& s) {
+                    char buf[1];
+                    s.recv(buf, 1);
+                    const auto t = count % timerCount;
+                    r.RestartTimerInterval(timers[t]);
+                    const auto u = (count + timerCount / 2) % timerCount;
+                    r.RemoveTimer(timers[u]);
+                    timers[u] = r.AddTimer(std::chrono::hours(1), -1, neverFires);
+                    if (++count == iterations) {
+                        r.Stop();
+                    } else {
+                        senders[(i + 1) % socketCount].send(buf, 1);
+                    }
+                });
+        }
+
+        senders.front().send("x", 1);
+        const auto startTime = std::chrono::steady_clock::now();
+        reactor.Run();
+        const auto elapsed = std::chrono::steady_clock::now() - startTime;
+
+        out << socketCount << " sockets and " << timerCount << " timers: "
+            << std::chrono::duration<double, std::nano>(elapsed).count() / iterations
+            << " ns/iteration" << std::endl;
+    }
+
+
+    // Measures how late timer events are dispatched, for a few combinations
+    // of timer interval and spin duration (see Reactor::SetSpinDuration()).
+    void TimerBenchmark(std::ostream& out)
+    {
+        const int eventCount = 1000;
+        for (const auto spin : { 0, 200 }) {
+            for (const auto intervalUS : { 250, 1000, 10000 }) {
+                const auto interval = std::chrono::microseconds(intervalUS);
+                coral::net::Reactor reactor;
+                reactor.SetSpinDuration(std::chrono::microseconds(spin));
+                reactor.AddTimer(interval, eventCount, [] (coral::net::Reactor&, int) { });
+                reactor.Run();
+
+                const auto jitter = reactor.TimerJitter();
+                const auto us = [] (std::chrono::nanoseconds d) {
+                    return std::chrono::duration<double, std::micro>(d).count();
+                };
+                out << intervalUS << " us interval, " << spin << " us spin: "
+                    << "lateness mean " << us(jitter.meanLateness) << " us"
+                    << ", std. dev. " << us(jitter.stdDevLateness) << " us"
+                    << ", max " << us(jitter.maxLateness) << " us"
+                    << std::endl;
+            }
+        }
+    }
+
+
+// =============================================================================
+// Slave control
+// =============================================================================
+
+    namespace cp = coral::protocol::execution;
+    namespace ce = coralproto::execution;
+
+    const auto controlTimeout = std::chrono::seconds(10);
+
+    // Throws if `ec` is an error code.
+    void CheckControlResult(const std::error_code& ec)
+    {
+        if (ec) throw std::system_error(ec, "Slave control command failed");
+    }
+
+    // A set of fake slaves, served by a background thread, which reply
+    // immediately to every command.
+    class FakeSlaves
+    {
+    public:
+        explicit FakeSlaves(std::size_t count)
+            : m_sockets(count)
+            , m_stop(false)
+        {
+            for (auto& s : m_sockets) {
+                s.Bind(coral::net::Endpoint("inproc", coral::util::RandomUUID()));
+            }
+            m_thread = std::thread([this] () { Run(); });
+        }
+
+        ~FakeSlaves()
+        {
+            m_stop = true;
+            m_thread.join();
+        }
+
+        coral::net::SlaveLocator Locator(std::size_t index) const
+        {
+            return coral::net::SlaveLocator(m_sockets[index].BoundEndpoint());
+        }
+
+    private:
+        void Run()
+        {
+            coral::net::Reactor reactor;
+            for (std::size_t i = 0; i < m_sockets.size(); ++i) {
+                reactor.AddSocket(
+                    m_sockets[i].Socket(),
+                    [this, i] (coral::net::Reactor&, zmq::socket_t&) {
+                        HandleRequest(i);
+                    });
+            }
+            reactor.AddTimer(
+                std::chrono::milliseconds(10),
+                -1,
+                [this] (coral::net::Reactor& r, int) {
+                    if (m_stop) r.Stop();
+                });
+            reactor.Run();
+        }
+
+        void HandleRequest(std::size_t index)
+        {
+            std::vector<zmq::message_t> msg;
+            m_sockets[index].Receive(msg);
+            switch (cp::ParseMessageType(msg.front())) {
+                case ce::MSG_HELLO:
+                    cp::CreateHelloMessage(msg, 0);
+                    break;
+                case ce::MSG_STEP:
+                    cp::CreateMessage(msg, ce::MSG_STEP_OK);
+                    break;
+                case ce::MSG_TERMINATE:
+                    m_sockets[index].Ignore();
+                    return;
+                default:
+                    cp::CreateMessage(msg, ce::MSG_READY);
+            }
+            m_sockets[index].Send(msg);
+        }
+
+        std::vector<coral::net::zmqx::RepSocket> m_sockets;
+        std::atomic<bool> m_stop;
+        std::thread m_thread;
+    };
+
+
+    // Connects to all the slaves and returns when all messengers are ready.
+    std::vector<std::unique_ptr<coral::bus::ISlaveControlMessenger>> ConnectAll(
+        coral::net::Reactor& reactor,
+        const FakeSlaves& slaves,
+        std::size_t count,
+        coral::bus::SlaveControlRouter* router)
+    {
+        std::vector<std::unique_ptr<coral::bus::ISlaveControlMessenger>> messengers(count);
+        std::vector<coral::bus::PendingSlaveControlConnection> pending;
+        auto remaining = count;
+        for (std::size_t i = 0; i < count; ++i) {
+            pending.push_back(coral::bus::ConnectToSlave(
+                reactor,
+                slaves.Locator(i),
+                1,
+                controlTimeout,
+                [&, i] (const std::error_code& ec, coral::bus::SlaveControlConnection c) {
+                    CheckControlResult(ec);
+                    messengers[i] = coral::bus::MakeSlaveControlMessenger(
+                        std::move(c),
+                        static_cast<coral::model::SlaveID>(i + 1),
+                        "slave",
+                        coral::bus::SlaveSetup(),
+                        [&] (const std::error_code& ec) {
+                            CheckControlResult(ec);
+                            if (--remaining == 0) reactor.Stop();
+                        },
+                        router);
+                }));
+        }
+        reactor.Run();
+        return messengers;
+    }
+
+
+    // Performs `stepCount` time steps with `slaveCount` slaves, and returns
+    // the average duration of one step.  Each step consists of ACCEPT_STEP
+    // (except the first), SET_VARS and STEP.  With `multiplex`, these are
+    // pipelined; otherwise, each is sent when the previous one completes.
+    std::chrono::microseconds StepDuration(
+        std::size_t slaveCount,
+        bool multiplex,
+        int stepCount)
+    {
+        FakeSlaves slaves(slaveCount);
+        coral::net::Reactor reactor;
+        std::unique_ptr<coral::bus::SlaveControlRouter> router;
+        if (multiplex) {
+            router = std::make_unique<coral::bus::SlaveControlRouter>(reactor);
+        }
+        auto messengers = ConnectAll(reactor, slaves, slaveCount, router.get());
+
+        const auto settings = std::vector<coral::model::VariableSetting>{
+            coral::model::VariableSetting(0, 1.0)
+        };
+        std::size_t remaining = 0;
+        const auto onStepped = [&] (const std::error_code& ec) {
+            CheckControlResult(ec);
+            if (--remaining == 0) reactor.Stop();
+        };
+
+        const auto startTime = std::chrono::steady_clock::now();
+        for (int stepID = 0; stepID < stepCount; ++stepID) {
+            const auto t = stepID * 0.1;
+            remaining = slaveCount;
+            for (auto& m : messengers) {
+                const auto messenger = m.get();
+                const auto step = [=] () {
+                    messenger->Step(stepID, t, 0.1, controlTimeout, onStepped);
+                };
+                const auto setVarsAndStep = [=] () {
+                    if (multiplex) {
+                        messenger->SetVariables(
+                            settings, controlTimeout, &CheckControlResult);
+                        step();
+                    } else {
+                        messenger->SetVariables(settings, controlTimeout,
+                            [=] (const std::error_code& ec) {
+                                CheckControlResult(ec);
+                                step();
+                            });
+                    }
+                };
+                if (stepID == 0) {
+                    setVarsAndStep();
+                } else if (multiplex) {
+                    messenger->AcceptStep(controlTimeout, &CheckControlResult);
+                    setVarsAndStep();
+                } else {
+                    messenger->AcceptStep(controlTimeout,
+                        [=] (const std::error_code& ec) {
+                            CheckControlResult(ec);
+                            setVarsAndStep();
+                        });
+                }
+            }
+            reactor.Run();
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - startTime;
+
+        for (auto& m : messengers) m->Terminate();
+        return std::chrono::duration_cast<std::chrono::microseconds>(elapsed / stepCount);
+    }
+
+
+    // Compares the per-step control overhead with one socket per slave and
+    // with all commands multiplexed over a SlaveControlRouter.
+    void ControlBenchmark(std::ostream& out)
+    {
+        RaiseFileLimit();
+        const int stepCount = 20;
+        for (const std::size_t slaveCount : {10, 100, 1000}) {
+            const auto separate = StepDuration(slaveCount, false, stepCount);
+            const auto multiplexed = StepDuration(slaveCount, true, stepCount);
+            out << slaveCount << " slaves: "
+                << separate.count() << " us/step with one socket per slave, "
+                << multiplexed.count() << " us/step multiplexed"
+                << std::endl;
+        }
+    }
+}
+
+
+const std::vector<MicroBenchmark>& MicroBenchmarks()
+{
+    static const std::vector<MicroBenchmark> benchmarks = {
+        {
+            "encoding",
+            "Encoding and decoding of variable values, per data format.",
+            &EncodingBenchmark
+        },
+        {
+            "reactor",
+            "Messaging loop overhead of coral::net::Reactor with many sockets and timers.",
+            &ReactorBenchmark
+        },
+        {
+            "timers",
+            "Lateness of coral::net::Reactor timer events.",
+            &TimerBenchmark
+        },
+        {
+            "control",
+            "Per-step slave control overhead, with and without multiplexing.",
+            &ControlBenchmark
+        },
+    };
+    return benchmarks;
+}
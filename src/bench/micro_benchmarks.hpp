@@ -0,0 +1,31 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#ifndef CORAL_BENCH_MICRO_BENCHMARKS_HPP_INCLUDED
+#define CORAL_BENCH_MICRO_BENCHMARKS_HPP_INCLUDED
+
+#include <ostream>
+#include <vector>
+
+
+/*
+Benchmarks of individual components of the library, as opposed to the
+executions which coral_bench runs by default.  They are selected with the
+--micro option, and each of them prints its results as text.
+*/
+struct MicroBenchmark
+{
+    const char* name;
+    const char* description;
+    void (*run)(std::ostream& out);
+};
+
+
+// The available micro-benchmarks.
+const std::vector<MicroBenchmark>& MicroBenchmarks();
+
+
+#endif // header guard
@@ -21,6 +21,7 @@
 
 #include <coral/config.h>
 #include <coral/master/execution_options.hpp>
+#include <coral/master/statistics.hpp>
 #include <coral/model.hpp>
 #include <coral/net.hpp>
 
@@ -181,10 +182,18 @@ public:
     typedef std::function<void(const std::error_code&, coral::model::SlaveID)>
         SlaveStepHandler;
 
-    /// Steps the simulation forward.
+    /**
+    \brief  Steps the simulation forward.
+
+    If the `multiplexSlaveControl` option is enabled, this may be called
+    before a Reconfigure() operation which does not change any connections
+    has completed.  The STEP commands are then pipelined behind the SET_VARS
+    commands, and the step is performed as soon as each slave has applied
+    its new settings.
+    */
     void Step(
         coral::model::TimeDuration stepSize,
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         StepHandler onComplete,
         SlaveStepHandler onSlaveStepComplete = nullptr);
 
@@ -200,13 +209,33 @@ public:
 
     /// Informs the slaves that the step is accepted.
     void AcceptStep(
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         AcceptStepHandler onComplete,
         SlaveAcceptStepHandler onSlaveAcceptStepComplete = nullptr);
 
+    /**
+    \brief  Accepts the current step and steps the simulation forward again.
+
+    This has the same effect as AcceptStep() followed by Step(), but takes
+    one round trip to each slave instead of two, for slaves which support it.
+    The handlers are called as they would be for Step().
+    */
+    void AcceptStepAndStep(
+        coral::model::TimeDuration stepSize,
+        std::chrono::microseconds timeout,
+        StepHandler onComplete,
+        SlaveStepHandler onSlaveStepComplete = nullptr);
+
     /// Terminates the entire execution and all associated slaves.
     void Terminate();
 
+    /**
+    \brief  Returns statistics about the time steps of each slave.
+
+    See coral::master::ExecutionOptions::statisticsWindow.
+    */
+    coral::master::ExecutionStatistics Statistics() const;
+
 private:
     std::unique_ptr<ExecutionManagerPrivate> m_private;
 };
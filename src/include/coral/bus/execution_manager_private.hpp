@@ -16,6 +16,7 @@
 #include <functional>
 #include <map>
 #include <memory>
+#include <set>
 #include <system_error>
 
 #include <boost/noncopyable.hpp>
@@ -27,6 +28,7 @@
 #include <coral/bus/execution_manager.hpp>
 #include <coral/bus/slave_controller.hpp>
 #include <coral/bus/slave_setup.hpp>
+#include <coral/bus/step_statistics.hpp>
 
 
 namespace coral
@@ -73,17 +75,25 @@ public:
 
     void Step(
         coral::model::TimeDuration stepSize,
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         ExecutionManager::StepHandler onComplete,
         ExecutionManager::SlaveStepHandler onSlaveStepComplete);
 
     void AcceptStep(
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         ExecutionManager::AcceptStepHandler onComplete,
         ExecutionManager::SlaveAcceptStepHandler onSlaveAcceptStepComplete);
 
+    void AcceptStepAndStep(
+        coral::model::TimeDuration stepSize,
+        std::chrono::microseconds timeout,
+        ExecutionManager::StepHandler onComplete,
+        ExecutionManager::SlaveStepHandler onSlaveStepComplete);
+
     void Terminate();
 
+    coral::master::ExecutionStatistics Statistics() const;
+
     // Internal methods, i.e. those that are used by the state-specific objects.
     // =========================================================================
 
@@ -100,6 +110,10 @@ public:
     coral::model::TimePoint CurrentSimTime() const;
     void AdvanceSimTime(coral::model::TimeDuration delta);
 
+    // Adds the timing information for the slave's last command to its step
+    // statistics.  To be called when a step-related command has succeeded.
+    void RecordCommandTiming(coral::model::SlaveID slaveID);
+
     // To be called when a per-slave operation has started and completed,
     // respectively.
     void SlaveOpStarted() noexcept;
@@ -141,16 +155,32 @@ public:
         Slave(const Slave&) = delete;
         Slave& operator=(const Slave&) = delete;
 
-        CORAL_DEFINE_DEFAULT_MOVE(Slave, slave, locator, description)
+        CORAL_DEFINE_DEFAULT_MOVE(Slave, slave, locator, description, inputSources, peers)
+
+        // Returns the set of slaves whose outputs are connected to this
+        // slave's inputs, according to `inputSources`.
+        std::set<coral::model::SlaveID> ConnectedPeers() const;
 
         std::unique_ptr<coral::bus::SlaveController> slave;
         coral::net::SlaveLocator locator;
         coral::model::SlaveDescription description;
+
+        // For each connected input variable, the slave it is connected to.
+        std::map<coral::model::VariableID, coral::model::SlaveID> inputSources;
+
+        // The slaves whose data endpoints were last sent to this slave in a
+        // SET_PEERS message.
+        std::set<coral::model::SlaveID> peers;
     };
 
     // Data which is available to the state objects
     coral::net::Reactor& reactor;
     coral::bus::SlaveSetup slaveSetup;
+
+    // The socket through which all slaves are controlled, if the
+    // multiplexSlaveControl option is enabled.  It must outlive `slaves`.
+    std::unique_ptr<coral::bus::SlaveControlRouter> controlRouter;
+
     coral::model::SlaveID lastSlaveID;
     std::map<coral::model::SlaveID, Slave> slaves;
 
@@ -179,6 +209,10 @@ private:
 
     // Whether a RESEND_VARS is needed before the next STEP.
     bool m_resendVarsNeeded;
+
+    // The step statistics of each slave, with the given number of samples.
+    std::size_t m_statisticsWindow;
+    std::map<coral::model::SlaveID, StepTimingCollector> m_stepStatistics;
 };
 
 
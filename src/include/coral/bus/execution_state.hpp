@@ -17,6 +17,7 @@
 #include <coral/bus/execution_manager.hpp>
 #include <coral/config.h>
 #include <coral/error.hpp>
+#include <coral/trace.hpp>
 
 
 namespace coral
@@ -58,25 +59,33 @@ public:
     virtual void ResendVars(
         ExecutionManagerPrivate& self,
         int maxAttempts,
-        std::chrono::milliseconds commTimeout,
+        std::chrono::microseconds commTimeout,
         std::function<void(const std::error_code&)> onComplete)
     { NotAllowed(__FUNCTION__); }
 
     virtual void Step(
         ExecutionManagerPrivate& self,
         coral::model::TimeDuration stepSize,
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         ExecutionManager::StepHandler onComplete,
         ExecutionManager::SlaveStepHandler onSlaveStepComplete)
     { NotAllowed(__FUNCTION__); }
 
     virtual void AcceptStep(
         ExecutionManagerPrivate& self,
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         ExecutionManager::AcceptStepHandler onComplete,
         ExecutionManager::SlaveAcceptStepHandler onSlaveAcceptStepComplete)
     { NotAllowed(__FUNCTION__); }
 
+    virtual void AcceptStepAndStep(
+        ExecutionManagerPrivate& self,
+        coral::model::TimeDuration stepSize,
+        std::chrono::microseconds timeout,
+        ExecutionManager::StepHandler onComplete,
+        ExecutionManager::SlaveStepHandler onSlaveStepComplete)
+    { NotAllowed(__FUNCTION__); }
+
     virtual void Terminate(ExecutionManagerPrivate& self)
     { NotAllowed(__FUNCTION__); }
 
@@ -110,13 +119,13 @@ class ReadyExecutionState : public ExecutionState
     void ResendVars(
         ExecutionManagerPrivate& self,
         int maxAttempts,
-        std::chrono::milliseconds commTimeout,
+        std::chrono::microseconds commTimeout,
         std::function<void(const std::error_code&)> onComplete) override;
 
     void Step(
         ExecutionManagerPrivate& self,
         coral::model::TimeDuration stepSize,
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         ExecutionManager::StepHandler onComplete,
         ExecutionManager::SlaveStepHandler onSlaveStepComplete) override;
 
@@ -150,6 +159,9 @@ private:
 };
 
 
+class SteppingExecutionState;
+
+
 class ReconfiguringExecutionState : public ExecutionState
 {
 public:
@@ -159,14 +171,32 @@ public:
         ExecutionManager::ReconfigureHandler onComplete,
         ExecutionManager::SlaveReconfigureHandler onSlaveComplete);
 
+    ~ReconfiguringExecutionState() noexcept;
+
 private:
     void StateEntered(ExecutionManagerPrivate& self) override;
 
+    // Only allowed when the slaves are controlled through a
+    // SlaveControlRouter.  The STEP commands are then queued behind the
+    // SET_VARS commands, and the state changes directly to STEPPING when
+    // the reconfiguration is complete.
+    void Step(
+        ExecutionManagerPrivate& self,
+        coral::model::TimeDuration stepSize,
+        std::chrono::microseconds timeout,
+        ExecutionManager::StepHandler onComplete,
+        ExecutionManager::SlaveStepHandler onSlaveStepComplete) override;
+
+    void Completed(ExecutionManagerPrivate& self, bool failed);
+
     // Input parameters to this state
     const std::vector<SlaveConfig> m_slaveConfigs;
     const std::chrono::milliseconds m_commTimeout;
     const ExecutionManager::ReconfigureHandler m_onComplete;
     const ExecutionManager::SlaveReconfigureHandler m_onSlaveComplete;
+
+    // Local variables of this state
+    std::unique_ptr<SteppingExecutionState> m_pendingStep;
 };
 
 
@@ -175,7 +205,7 @@ class PrimingExecutionState: public ExecutionState
 public:
     PrimingExecutionState(
         int maxAttempts,
-        std::chrono::milliseconds commTimeout,
+        std::chrono::microseconds commTimeout,
         std::function<void(const std::error_code&)> onComplete);
 
 private:
@@ -188,7 +218,7 @@ private:
 
     // Input parameters to this state
     const int m_maxAttempts;
-    const std::chrono::milliseconds m_commTimeout;
+    const std::chrono::microseconds m_commTimeout;
     const std::function<void(const std::error_code&)> m_onComplete;
 };
 
@@ -196,17 +226,29 @@ private:
 class SteppingExecutionState : public ExecutionState
 {
 public:
+    // If `acceptPrevious` is true, the slaves are in the STEP_OK state, and
+    // the previous step is accepted along with the new one being performed.
     SteppingExecutionState(
         coral::model::TimeDuration stepSize,
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         ExecutionManager::StepHandler onComplete,
-        ExecutionManager::SlaveStepHandler onSlaveStepComplete);
+        ExecutionManager::SlaveStepHandler onSlaveStepComplete,
+        bool acceptPrevious = false);
+
+    // Sends the step commands to the slaves.  This is normally done when the
+    // state is entered, but it may be done in advance (and then only once)
+    // if the commands can be pipelined behind those of the current state.
+    void IssueCommands(ExecutionManagerPrivate& self);
 
 private:
     void StateEntered(ExecutionManagerPrivate& self) override;
 
     const coral::model::TimeDuration m_stepSize;
-    std::chrono::milliseconds m_timeout;
+    const bool m_acceptPrevious;
+    bool m_issued = false;
+    coral::model::StepID m_stepID = coral::model::INVALID_STEP_ID;
+    coral::trace::Clock::time_point m_start;
+    std::chrono::microseconds m_timeout;
     ExecutionManager::StepHandler m_onComplete;
     ExecutionManager::SlaveStepHandler m_onSlaveStepComplete;
 };
@@ -222,11 +264,18 @@ private:
 
     void AcceptStep(
         ExecutionManagerPrivate& self,
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         ExecutionManager::AcceptStepHandler onComplete,
         ExecutionManager::SlaveAcceptStepHandler onSlaveAcceptStepComplete)
             override;
 
+    void AcceptStepAndStep(
+        ExecutionManagerPrivate& self,
+        coral::model::TimeDuration stepSize,
+        std::chrono::microseconds timeout,
+        ExecutionManager::StepHandler onComplete,
+        ExecutionManager::SlaveStepHandler onSlaveStepComplete) override;
+
     const coral::model::TimeDuration m_stepSize;
 };
 
@@ -235,14 +284,14 @@ class AcceptingExecutionState : public ExecutionState
 {
 public:
     AcceptingExecutionState(
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         ExecutionManager::AcceptStepHandler onComplete,
         ExecutionManager::SlaveAcceptStepHandler onSlaveAcceptStepComplete);
 
 private:
     void StateEntered(ExecutionManagerPrivate& self) override;
 
-    std::chrono::milliseconds m_timeout;
+    std::chrono::microseconds m_timeout;
     ExecutionManager::AcceptStepHandler m_onComplete;
     ExecutionManager::SlaveAcceptStepHandler m_onSlaveAcceptStepComplete;
 };
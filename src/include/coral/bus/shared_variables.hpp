@@ -0,0 +1,192 @@
+/**
+\file
+\brief  Defines the coral::bus::SharedVariableWriter and
+        coral::bus::SharedVariableReader classes, a shared-memory transport
+        for variable values.
+\copyright
+    Copyright 2013-present, SINTEF Ocean.
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#ifndef CORAL_BUS_SHARED_VARIABLES_HPP
+#define CORAL_BUS_SHARED_VARIABLES_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <coral/model.hpp>
+#include <coral/net.hpp>
+
+
+namespace coral
+{
+namespace bus
+{
+
+
+/**
+\brief  Returns the name of the shared-memory region which belongs to the
+        variable publisher bound to the given endpoint.
+
+The name is derived from the endpoint alone, so a publisher and a subscriber
+on the same host arrive at the same name without any extra communication.
+
+\returns
+    The region name, or an empty string if shared memory is not supported
+    for this kind of endpoint or on this platform.
+*/
+std::string SharedVariableRegionName(const coral::net::Endpoint& endpoint);
+
+
+/**
+\brief  Returns whether the given endpoint refers to this host.
+
+This is the case for "inproc" and "ipc" endpoints, and for "tcp" endpoints
+whose address is "localhost", a loopback address or the address of one of
+the host's network interfaces.
+*/
+bool IsLocalEndpoint(const coral::net::Endpoint& endpoint);
+
+
+/**
+\brief  The writing end of a shared-memory region which holds the output
+        values of one slave.
+
+The region has a directory with one entry per variable, each of which holds
+the two most recently written values along with their time step IDs.  Each
+entry is protected by a sequence lock, so there is a single writer and any
+number of readers, none of which ever block each other.  The region also
+holds the ID of the last time step for which values were written, so a reader
+can tell that a variable which was not written in that step is unchanged.
+
+Values are written by the same Publish() calls as the ones which publish
+them on the network, so this class only covers local readers.  The directory
+is created from the values passed to the first Publish() call, and variables
+which are not in it, as well as string variables, are never written to the
+region.  Readers must receive those over the network.
+*/
+class SharedVariableWriter
+{
+public:
+    /**
+    \brief  Creates the region with the given name.
+
+    Any existing region with the same name is assumed to be left behind by a
+    process which has ended, and is replaced.  The region is not ready for
+    readers until the first Publish() call.
+
+    \throws std::runtime_error  If the region could not be created.
+    */
+    explicit SharedVariableWriter(const std::string& name);
+
+    /// Destructor.  Removes the region.
+    ~SharedVariableWriter() noexcept;
+
+    SharedVariableWriter(const SharedVariableWriter&) = delete;
+    SharedVariableWriter& operator=(const SharedVariableWriter&) = delete;
+
+    /**
+    \brief  Writes the values of several variables for the given time step.
+
+    \throws std::runtime_error  If the region could not be resized on the
+                                first call.
+    */
+    void Publish(
+        coral::model::StepID stepID,
+        coral::model::SlaveID slaveID,
+        const std::pair<coral::model::VariableID, coral::model::ScalarValue>* values,
+        std::size_t count);
+
+private:
+    void InitializeDirectory(
+        coral::model::SlaveID slaveID,
+        const std::pair<coral::model::VariableID, coral::model::ScalarValue>* values,
+        std::size_t count);
+
+    std::string m_name;
+    int m_fd;
+    void* m_data;
+    std::size_t m_size;
+    std::unordered_map<coral::model::VariableID, std::size_t> m_entries;
+};
+
+
+/**
+\brief  The reading end of a shared-memory region created by a
+        SharedVariableWriter.
+*/
+class SharedVariableReader
+{
+public:
+    /**
+    \brief  Opens the region with the given name, if it exists.
+
+    \returns
+        The reader, or null if there is no such region (or it could not be
+        opened for some other reason).
+    */
+    static std::unique_ptr<SharedVariableReader> Open(const std::string& name);
+
+    /// Destructor.
+    ~SharedVariableReader() noexcept;
+
+    SharedVariableReader(const SharedVariableReader&) = delete;
+    SharedVariableReader& operator=(const SharedVariableReader&) = delete;
+
+    /**
+    \brief  Returns whether the writer has created the directory, so that the
+            other functions may be called.
+
+    Once this has returned `true`, it keeps doing so.
+    */
+    bool Ready();
+
+    /**
+    \brief  The slave whose values are stored in the region.
+    \pre Ready() has returned `true`.
+    */
+    coral::model::SlaveID Slave() const;
+
+    /**
+    \brief  Returns the index of the directory entry for the given variable,
+            or `NO_ENTRY` if the variable's values are not stored in the
+            region.
+    \pre Ready() has returned `true`.
+    */
+    std::size_t Find(coral::model::VariableID variable) const;
+
+    /**
+    \brief  Reads the value which a variable has in the given time step.
+
+    \param [in] entry   A directory entry index returned by Find().
+    \param [in] stepID  The time step ID.
+    \param [out] value  The value, if the function returns `true`.
+
+    \returns
+        `true` if the writer has written the values for time step `stepID`,
+        `false` if it has not done so yet.
+    \pre Ready() has returned `true`.
+    */
+    bool Read(
+        std::size_t entry,
+        coral::model::StepID stepID,
+        coral::model::ScalarValue& value) const;
+
+    static const std::size_t NO_ENTRY = static_cast<std::size_t>(-1);
+
+private:
+    SharedVariableReader(int fd, void* header);
+
+    int m_fd;
+    void* m_header;
+    void* m_data;
+    std::size_t m_size;
+};
+
+
+}} // namespace
+#endif // header guard
@@ -11,8 +11,12 @@
 #define CORAL_BUS_SLAVE_AGENT_HPP
 
 #include <chrono>
+#include <cstdint>
 #include <exception>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <boost/bimap.hpp>
@@ -26,6 +30,7 @@
 #include <coral/net/reactor.hpp>
 #include <coral/net/zmqx.hpp>
 #include <coral/slave/instance.hpp>
+#include <coral/slave/publishing.hpp>
 
 #ifdef _MSC_VER
 #   pragma warning(push, 0)
@@ -67,13 +72,17 @@ public:
         the connection is broken.  If the timeout is reached, a
         coral::slave::TimeoutException will be thrown (and propagate out
         through coral::net::Reactor::Run()).
+    \param [in] publishOptions
+        When the values of output variables should be published.
     */
     SlaveAgent(
         coral::net::Reactor& reactor,
         coral::slave::Instance& slaveInstance,
         const coral::net::Endpoint& controlEndpoint,
         const coral::net::Endpoint& dataPubEndpoint,
-        std::chrono::milliseconds masterInactivityTimeout);
+        std::chrono::milliseconds masterInactivityTimeout,
+        const coral::slave::PublishOptions& publishOptions =
+            coral::slave::PublishOptions{});
 
     // Class can't be copied or moved because it leaks references to `this`
     // through Reactor event handlers.
@@ -138,11 +147,29 @@ private:
     // filling `msg` with a reply message.
     void HandleResendVars(std::vector<zmq::message_t>& msg);
 
-    // Performs the time step for ReadyHandler()
+    // Performs the "step" operation for ReadyHandler() and PublishedHandler(),
+    // including filling `msg` with a reply message and switching to the
+    // appropriate state.
+    void HandleStep(std::vector<zmq::message_t>& msg);
+
+    // Updates the input variables with the values received from other slaves
+    // in the current time step.
+    void UpdateInputs();
+
+    // Performs the time step for HandleStep()
     bool Step(const coralproto::execution::StepData& stepData);
 
-    // Publishes all variable values (used by HandleResendVars() and Step()).
-    void PublishAll();
+    // Fills `msg` with a reply of the given type which, with protocol
+    // version 2 and up, carries m_stepTiming.
+    void CreateTimedReply(
+        std::vector<zmq::message_t>& msg,
+        coralproto::execution::MessageType type);
+
+    // Publishes the values of output variables (used by HandleResendVars()
+    // and Step()).  If `all` is false, only the values which should be
+    // published according to their publish policies are included, unless
+    // a keyframe is due.
+    void PublishOutputs(bool all);
 
     // A pointer to the handler function for the current state.
     void (SlaveAgent::* m_stateHandler)(std::vector<zmq::message_t>&);
@@ -166,6 +193,130 @@ private:
         int m_timerID;
     };
 
+    class TypedVariables;
+
+    // Keeps track of the last published values of a set of output variables,
+    // and decides which of them need to be published in a time step
+    // according to their publish policies.  The change detection for
+    // numeric and boolean variables is done in branch-free loops over
+    // contiguous arrays, which the compiler can vectorise.
+    class OutputFilter
+    {
+    public:
+        // Prepares for filtering the values of `outputs`.  `policies` must
+        // contain the policy of every variable in `outputs`.
+        void Reset(
+            const TypedVariables& outputs,
+            const std::unordered_map<coral::model::VariableID, coral::slave::PublishPolicy>&
+                policies);
+
+        // Appends (ID, value) pairs for the values in `outputs` which should
+        // be published to `out`, and records them as published.  If `all`
+        // is true, all values are included.
+        void Select(
+            const TypedVariables& outputs,
+            bool all,
+            std::vector<std::pair<coral::model::VariableID, coral::model::ScalarValue>>& out);
+
+    private:
+        // For each variable, whether it should always be published (1) or
+        // only when changed (0).
+        std::vector<char> m_realAlways;
+        std::vector<char> m_integerAlways;
+        std::vector<char> m_booleanAlways;
+        std::vector<char> m_stringAlways;
+
+        // The per-variable thresholds for real values.  A value which is not
+        // always published is published if it differs from the last
+        // published one by more than max(absolute, relative*|last|).
+        std::vector<double> m_realAbsolute;
+        std::vector<double> m_realRelative;
+
+        // The last published values.
+        std::vector<double> m_lastReals;
+        std::vector<int> m_lastIntegers;
+        std::vector<char> m_lastBooleans;
+        std::vector<std::string> m_lastStrings;
+
+        // Scratch space for the result of the change detection.
+        std::vector<char> m_publish;
+
+        // Whether Select() has been called since Reset().
+        bool m_hasPublished = false;
+    };
+
+    // Indexes into the value slots of a VariableSubscriber, partitioned by
+    // data type.
+    struct SubscriberSlots
+    {
+        std::vector<std::size_t> real;
+        std::vector<std::size_t> integer;
+        std::vector<std::size_t> boolean;
+        std::vector<std::size_t> string;
+    };
+
+    // A set of variables along with storage for their values, partitioned by
+    // data type so the values can be transferred with the slave instance's
+    // functions for getting/setting several variables at once.  The storage
+    // is reused when the object is cleared and refilled.
+    class TypedVariables
+    {
+    public:
+        // Removes all variables.
+        void Clear();
+
+        // Returns whether there are no variables.
+        bool Empty() const;
+
+        // Adds a variable whose value is to be retrieved with GetValues().
+        void Add(coral::model::VariableID id, coral::model::DataType dataType);
+
+        // Adds a variable along with a value, to be set with SetValues().
+        void Add(coral::model::VariableID id, const coral::model::ScalarValue& value);
+
+        // Prepares the variables for bulk access with the slave instance's
+        // functions.  Must be called after the variables have been added,
+        // and before GetValues() or SetValues().
+        void Prepare(const coral::slave::Instance& slaveInstance);
+
+        // Retrieves the values of all variables from the slave instance.
+        void GetValues(const coral::slave::Instance& slaveInstance);
+
+        // Sets the values of all variables in the slave instance, returning
+        // whether all of them were set successfully.
+        bool SetValues(coral::slave::Instance& slaveInstance);
+
+        // Replaces the values of all variables with the current values of
+        // the given subscriber slots, where `slots` lists one slot per
+        // variable, in the same order as the variables.
+        void ReceiveValues(
+            const coral::bus::VariableSubscriber& subscriber,
+            const SubscriberSlots& slots);
+
+    private:
+        friend class OutputFilter;
+
+        // Makes sure m_booleanValues has room for all boolean variables.
+        void ReserveBooleanValues();
+
+        std::vector<coral::model::VariableID> m_realIDs;
+        std::vector<double> m_realValues;
+        std::vector<coral::model::VariableID> m_integerIDs;
+        std::vector<int> m_integerValues;
+        std::vector<coral::model::VariableID> m_booleanIDs;
+        std::unique_ptr<bool[]> m_booleanValues; // std::vector<bool> has no data()
+        std::size_t m_booleanCapacity = 0;
+        std::vector<coral::model::VariableID> m_stringIDs;
+        std::vector<std::string> m_stringValues;
+
+        // The variable lists created by Prepare(), or null if variables
+        // have been added since it was last called.
+        std::unique_ptr<coral::slave::VariableList> m_realList;
+        std::unique_ptr<coral::slave::VariableList> m_integerList;
+        std::unique_ptr<coral::slave::VariableList> m_booleanList;
+        std::unique_ptr<coral::slave::VariableList> m_stringList;
+    };
+
     // A less-than comparison functor for Variable objects, so we can put
     // them in a std::map.
     struct VariableLess
@@ -197,12 +348,17 @@ private:
         bool Update(
             coral::slave::Instance& slaveInstance,
             coral::model::StepID stepID,
-            std::chrono::milliseconds timeout);
+            std::chrono::microseconds timeout);
 
     private:
         // Breaks a connection to a local input variable, if any.
         void Decouple(coral::model::VariableID localInput);
 
+        // Builds m_inputValues and m_inputSlots from m_connections.  The
+        // data types are those of the values received in the last
+        // successful m_subscriber.Update() call.
+        void Compile(const coral::slave::Instance& slaveInstance);
+
         // A bidirectional mapping between output variables and input variables.
         typedef boost::bimap<
             boost::bimaps::multiset_of<coral::model::Variable, VariableLess>,
@@ -211,18 +367,48 @@ private:
 
         ConnectionBimap m_connections;
         coral::bus::VariableSubscriber m_subscriber;
+
+        // The connections compiled into a flat table, so that Update() only
+        // has to sweep over arrays.  m_inputValues contains the connected
+        // input variables, and m_inputSlots the subscriber slots of the
+        // outputs they are connected to.  The table is rebuilt when the
+        // connections have changed, as signified by m_compiled being false.
+        bool m_compiled = false;
+        TypedVariables m_inputValues;
+        SubscriberSlots m_inputSlots;
     };
 
     coral::slave::Instance& m_slaveInstance;
     Timeout m_masterInactivityTimeout;
-    std::chrono::milliseconds m_variableRecvTimeout;
+    std::chrono::microseconds m_variableRecvTimeout;
 
     coral::net::zmqx::RepSocket m_control;
     coral::bus::VariablePublisher m_publisher;
     Connections m_connections;
+    std::uint16_t m_protocol; // The protocol version negotiated with the master
     coral::model::SlaveID m_id; // The slave's ID number in the current execution
 
     coral::model::StepID m_currentStepID; // ID of ongoing or just completed step
+
+    // When the request currently being handled was received, and how long
+    // the different phases of handling it took.
+    std::chrono::steady_clock::time_point m_requestTime;
+    coralproto::execution::StepTiming m_stepTiming;
+
+    // Whether this agent enabled tracing in the process at the master's
+    // request, in which case it is responsible for aligning the trace
+    // clock with the master's.
+    bool m_syncTraceClock;
+
+    // The slave's output variables, determined once after setup, along with
+    // storage for their values which is reused by PublishOutputs().
+    TypedVariables m_outputs;
+    OutputFilter m_outputFilter;
+    std::vector<std::pair<coral::model::VariableID, coral::model::ScalarValue>>
+        m_outputValues;
+
+    coral::slave::PublishOptions m_publishOptions;
+    int m_stepsSinceKeyframe;
 };
 
 
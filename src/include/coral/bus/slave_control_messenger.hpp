@@ -22,6 +22,7 @@ stuff in this header.
 #include <vector>
 
 #include <boost/noncopyable.hpp>
+#include <zmq.hpp>
 
 #include <coral/config.h>
 
@@ -53,6 +54,9 @@ enum SlaveState
 class PendingSlaveControlConnectionPrivate;
 struct SlaveControlConnectionPrivate;
 
+// Defined in slave_control_router.hpp
+class SlaveControlRouter;
+
 
 /**
 \brief  A handle for a pending connection to a slave.
@@ -131,6 +135,33 @@ private:
 };
 
 
+/**
+\brief  Timing information about a command sent to a slave.
+
+All durations are negative if unknown.  The round trip time is measured by
+the master, while the remaining durations are reported by the slave, which
+only happens with protocol version 2 and up, and only for the commands
+that involve the phases in question.
+*/
+struct SlaveCommandTiming
+{
+    /// The time from the command was sent until the reply was received.
+    std::chrono::microseconds roundTrip = std::chrono::microseconds(-1);
+
+    /// The time the slave spent handling the command.
+    std::chrono::microseconds busy = std::chrono::microseconds(-1);
+
+    /// The time the slave spent performing a time step.
+    std::chrono::microseconds doStep = std::chrono::microseconds(-1);
+
+    /// The time the slave spent getting and publishing output values.
+    std::chrono::microseconds publish = std::chrono::microseconds(-1);
+
+    /// The time the slave spent receiving and setting input values.
+    std::chrono::microseconds inputWait = std::chrono::microseconds(-1);
+};
+
+
 /**
 \brief  An interface for classes that implement various versions of the
         master/slave communication protocol.
@@ -163,6 +194,14 @@ public:
     */
     virtual SlaveState State() const noexcept = 0;
 
+    /**
+    \brief  Returns timing information about the last command whose reply
+            has been received.
+
+    This is updated before the command's completion handler is called.
+    */
+    virtual SlaveCommandTiming LastCommandTiming() const noexcept = 0;
+
     /**
     \brief  Ends all communication with the slave.
 
@@ -225,7 +264,7 @@ public:
     \post `State() == SLAVE_BUSY`.
     */
     virtual void GetDescription(
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         GetDescriptionHandler onComplete) = 0;
 
 
@@ -276,7 +315,7 @@ public:
     */
     virtual void SetVariables(
         const std::vector<coral::model::VariableSetting>& settings,
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         SetVariablesHandler onComplete) = 0;
 
 
@@ -327,7 +366,7 @@ public:
     */
     virtual void SetPeers(
         const std::vector<coral::net::Endpoint>& peer,
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         SetPeersHandler onComplete) = 0;
 
 
@@ -373,7 +412,7 @@ public:
     \post `State() == SLAVE_BUSY`.
     */
     virtual void ResendVars(
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         ResendVarsHandler onComplete) = 0;
 
 
@@ -425,7 +464,7 @@ public:
         coral::model::StepID stepID,
         coral::model::TimePoint currentT,
         coral::model::TimeDuration deltaT,
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         StepHandler onComplete) = 0;
 
 
@@ -467,9 +506,42 @@ public:
     \post `State() == SLAVE_BUSY`.
     */
     virtual void AcceptStep(
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         AcceptStepHandler onComplete) = 0;
 
+
+    /// Completion handler type for AcceptStepAndStep()
+    typedef VoidHandler AcceptStepAndStepHandler;
+
+    /**
+    \brief  Tells the slave that the time step is accepted and makes it perform
+            the next one.
+
+    This has the same effect as AcceptStep() followed by Step(), and
+    `onComplete` is called as it would be for Step().  If the slave supports
+    protocol version 1 or later, it only takes a single round trip.
+    Otherwise, the two commands are sent one after the other.
+
+    \param [in] stepID          The ID of the time step to be performed
+    \param [in] currentT        The current time point
+    \param [in] deltaT          The step size
+    \param [in] timeout         Max. allowed time for the operation to complete.
+                                A negative value means no time limit.
+    \param [in] onComplete      Completion handler
+
+    \throws std::invalid_argument if `timeout` is less than 1 ms or
+        if `onComplete` is empty.
+
+    \pre  `State() == SLAVE_STEP_OK`
+    \post `State() == SLAVE_BUSY`.
+    */
+    virtual void AcceptStepAndStep(
+        coral::model::StepID stepID,
+        coral::model::TimePoint currentT,
+        coral::model::TimeDuration deltaT,
+        std::chrono::microseconds timeout,
+        AcceptStepAndStepHandler onComplete) = 0;
+
     /**
     \brief  Instructs the slave to terminate, then closes the connection.
 
@@ -562,7 +634,7 @@ PendingSlaveControlConnection ConnectToSlave(
     coral::net::Reactor& reactor,
     const coral::net::SlaveLocator& slaveLocator,
     int maxAttempts,
-    std::chrono::milliseconds timeout,
+    std::chrono::microseconds timeout,
     ConnectToSlaveHandler onComplete);
 
 
@@ -613,6 +685,12 @@ throws an exception.
 \param [in] slaveName       The name given to the slave.
 \param [in] setup           Slave configuration parameters
 \param [in] onComplete      Completion handler. May not be null.
+\param [in] router          If not null, the connection established by
+                            ConnectToSlave() is closed, and the returned
+                            messenger communicates with the slave through
+                            `router` instead.  It then supports pipelining
+                            of commands, as described for
+                            SlaveControlMessengerRouted.
 
 \throws coral::error::ProtocolNotSupported if the slave requested an unsupported
     protocol version.
@@ -623,7 +701,16 @@ std::unique_ptr<ISlaveControlMessenger> MakeSlaveControlMessenger(
     coral::model::SlaveID slaveID,
     const std::string& slaveName,
     const SlaveSetup& setup,
-    MakeSlaveControlMessengerHandler onComplete);
+    MakeSlaveControlMessengerHandler onComplete,
+    SlaveControlRouter* router = nullptr);
+
+
+// For internal use by the ISlaveControlMessenger implementations.
+// Sets the slave-reported durations in `timing` from the body of a
+// STEP_OK or READY reply, if it has a timing record.
+void ReadSlaveCommandTiming(
+    const std::vector<zmq::message_t>& reply,
+    SlaveCommandTiming& timing);
 
 
 }} // namespace
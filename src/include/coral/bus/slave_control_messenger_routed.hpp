@@ -0,0 +1,184 @@
+/**
+\file
+\brief  Defines the coral::bus::SlaveControlMessengerRouted class
+\copyright
+    Copyright 2013-present, SINTEF Ocean.
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#ifndef CORAL_BUS_SLAVE_CONTROL_MESSENGER_ROUTED_HPP
+#define CORAL_BUS_SLAVE_CONTROL_MESSENGER_ROUTED_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <coral/config.h>
+#include <coral/bus/slave_control_messenger.hpp>
+#include <coral/bus/slave_control_router.hpp>
+#include <coral/bus/slave_setup.hpp>
+#include <coral/model.hpp>
+#include <coral/net.hpp>
+
+#include <boost/variant.hpp>
+
+
+// Forward declaration to avoid header dependency
+namespace google { namespace protobuf { class MessageLite; } }
+
+
+namespace coral
+{
+namespace bus
+{
+
+
+/**
+\brief  An implementation of ISlaveControlMessenger which communicates with
+        the slave through a SlaveControlRouter, and which supports
+        pipelining.
+
+It speaks the same protocol versions as SlaveControlMessengerV0, but
+commands may be issued while others are still in progress.  They are sent
+immediately, and their completion handlers are called in order as the
+replies arrive.  The preconditions of each function therefore refer to the
+state the slave *will* be in when all previously issued commands have
+completed successfully, rather than the current state, and `State()` is
+`SLAVE_BUSY` as long as any command is in progress.  For example, it is
+valid to call SetVariables() and then immediately Step().
+
+If a command fails while other commands are queued behind it, the slave may
+not be in the state the queued commands were issued for.  The connection is
+then closed, and the completion handlers of the queued commands are called
+with error code `std::errc::operation_canceled`.  A command which fails in
+a non-fatal manner (e.g. a failed time step) when nothing is queued behind
+it leaves the connection open, just as with SlaveControlMessengerV0.
+
+With protocol version 0, AcceptStepAndStep() sends ACCEPT_STEP and STEP
+back to back, so it only takes a single round trip here too.
+
+The timeout of a command counts from the time when the slave is expected to
+start working on it, i.e., when the reply to the previous command arrives.
+*/
+class SlaveControlMessengerRouted : public ISlaveControlMessenger
+{
+public:
+    SlaveControlMessengerRouted(
+        SlaveControlRouter& router,
+        const coral::net::Endpoint& endpoint,
+        int protocol,
+        coral::model::SlaveID slaveID,
+        const std::string& slaveName,
+        const SlaveSetup& setup,
+        std::chrono::microseconds timeout,
+        MakeSlaveControlMessengerHandler onComplete);
+
+    ~SlaveControlMessengerRouted() noexcept;
+
+    SlaveState State() const noexcept override;
+
+    SlaveCommandTiming LastCommandTiming() const noexcept override;
+
+    void Close() override;
+
+    void GetDescription(
+        std::chrono::microseconds timeout,
+        GetDescriptionHandler onComplete) override;
+
+    void SetVariables(
+        const std::vector<coral::model::VariableSetting>& settings,
+        std::chrono::microseconds timeout,
+        SetVariablesHandler onComplete) override;
+
+    void SetPeers(
+        const std::vector<coral::net::Endpoint>& peers,
+        std::chrono::microseconds timeout,
+        SetPeersHandler onComplete) override;
+
+    void ResendVars(
+        std::chrono::microseconds timeout,
+        ResendVarsHandler onComplete) override;
+
+    void Step(
+        coral::model::StepID stepID,
+        coral::model::TimePoint currentT,
+        coral::model::TimeDuration deltaT,
+        std::chrono::microseconds timeout,
+        StepHandler onComplete) override;
+
+    void AcceptStep(
+        std::chrono::microseconds timeout,
+        AcceptStepHandler onComplete) override;
+
+    void AcceptStepAndStep(
+        coral::model::StepID stepID,
+        coral::model::TimePoint currentT,
+        coral::model::TimeDuration deltaT,
+        std::chrono::microseconds timeout,
+        AcceptStepAndStepHandler onComplete) override;
+
+    void Terminate() override;
+
+private:
+    typedef boost::variant<VoidHandler, GetDescriptionHandler> AnyHandler;
+
+    // A command which has been sent, and whose reply we are waiting for.
+    struct Request
+    {
+        std::uint32_t id;
+        int command;
+        std::chrono::microseconds timeout;
+        AnyHandler onComplete;
+        std::chrono::steady_clock::time_point sent;
+    };
+
+    // Sends a command and adds it to the queue.  `nextState` is the state
+    // the slave will be in if the command succeeds.
+    void SendCommand(
+        int command,
+        const google::protobuf::MessageLite* data,
+        std::chrono::microseconds timeout,
+        AnyHandler onComplete,
+        SlaveState nextState);
+
+    // Event handlers
+    void OnReply(std::uint32_t requestID, std::vector<zmq::message_t>& msg);
+    void OnReplyTimeout();
+
+    // Starts the reply timer for the command at the front of the queue.
+    void StartTimer();
+    void StopTimer() noexcept;
+
+    // Closes the connection and calls the completion handlers of all
+    // commands in the queue, the first one with `firstError` and the rest
+    // with std::errc::operation_canceled.
+    void Fail(const std::error_code& firstError);
+
+    coral::net::Reactor& m_reactor;
+    SlaveControlRouter& m_router;
+    SlaveControlRouter::PeerID m_peer;
+    const int m_protocol;
+
+    // The state of the slave after the last completed command, and the state
+    // it will be in after all queued commands have completed successfully.
+    SlaveState m_state;
+    SlaveState m_expectedState;
+
+    std::deque<Request> m_requests;
+    int m_replyTimeoutTimerId;
+
+    // When the last reply was received, and the timing of its command.
+    // A pipelined command's round trip is counted from when the reply to
+    // the command before it arrived, since that is roughly when the slave
+    // started handling it.
+    std::chrono::steady_clock::time_point m_lastReply;
+    SlaveCommandTiming m_lastCommandTiming;
+};
+
+
+}} // namespace
+#endif // header guard
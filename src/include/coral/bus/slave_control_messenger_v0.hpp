@@ -35,8 +35,12 @@ namespace bus
 
 
 /**
-\brief  An implementation of ISlaveControlMessenger for version 0 of the
-        master/slave communication protocol.
+\brief  An implementation of ISlaveControlMessenger for versions 0 to 2 of
+        the master/slave communication protocol.
+
+Version 1 only adds the ACCEPT_STEP_AND_STEP command.  With a version 0
+slave, AcceptStepAndStep() sends ACCEPT_STEP and STEP in turn instead.
+Version 2 only adds timing records to some replies.
 */
 class SlaveControlMessengerV0 : public ISlaveControlMessenger
 {
@@ -47,44 +51,54 @@ public:
         coral::model::SlaveID slaveID,
         const std::string& slaveName,
         const SlaveSetup& setup,
-        std::chrono::milliseconds timeout,
-        MakeSlaveControlMessengerHandler onComplete);
+        std::chrono::microseconds timeout,
+        MakeSlaveControlMessengerHandler onComplete,
+        int protocol = 0);
 
     ~SlaveControlMessengerV0() noexcept;
 
     SlaveState State() const noexcept override;
 
+    SlaveCommandTiming LastCommandTiming() const noexcept override;
+
     void Close() override;
 
     void GetDescription(
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         GetDescriptionHandler onComplete) override;
 
     void SetVariables(
         const std::vector<coral::model::VariableSetting>& settings,
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         SetVariablesHandler onComplete) override;
 
     void SetPeers(
         const std::vector<coral::net::Endpoint>& peers,
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         SetPeersHandler onComplete) override;
 
     void ResendVars(
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         ResendVarsHandler onComplete) override;
 
     void Step(
         coral::model::StepID stepID,
         coral::model::TimePoint currentT,
         coral::model::TimeDuration deltaT,
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         StepHandler onComplete) override;
 
     void AcceptStep(
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         AcceptStepHandler onComplete) override;
 
+    void AcceptStepAndStep(
+        coral::model::StepID stepID,
+        coral::model::TimePoint currentT,
+        coral::model::TimeDuration deltaT,
+        std::chrono::microseconds timeout,
+        AcceptStepAndStepHandler onComplete) override;
+
     void Terminate() override;
 
 private:
@@ -94,7 +108,7 @@ private:
         coral::model::SlaveID slaveID,
         const std::string& slaveName,
         const SlaveSetup& setup,
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         VoidHandler onComplete);
 
     // Helper functions
@@ -102,13 +116,13 @@ private:
     void SendCommand(
         int command,
         const google::protobuf::MessageLite* data,
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         AnyHandler onComplete);
     void PostSendCommand(
         int command,
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         AnyHandler onComplete);
-    void RegisterTimeout(std::chrono::milliseconds timeout);
+    void RegisterTimeout(std::chrono::microseconds timeout);
     void UnregisterTimeout();
 
     // Event handlers
@@ -150,6 +164,7 @@ private:
 
     coral::net::Reactor& m_reactor;
     coral::net::zmqx::ReqSocket m_socket;
+    const int m_protocol;
 
     // State information
     SlaveState m_state;
@@ -157,6 +172,10 @@ private:
     int m_currentCommand;
     AnyHandler m_onComplete;
     int m_replyTimeoutTimerId;
+
+    // When the current command was sent, and the timing of the last one.
+    std::chrono::steady_clock::time_point m_commandSent;
+    SlaveCommandTiming m_lastCommandTiming;
 };
 
 
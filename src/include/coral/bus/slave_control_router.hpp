@@ -0,0 +1,138 @@
+/**
+\file
+\brief  Defines the coral::bus::SlaveControlRouter class
+\copyright
+    Copyright 2013-present, SINTEF Ocean.
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#ifndef CORAL_BUS_SLAVE_CONTROL_ROUTER_HPP
+#define CORAL_BUS_SLAVE_CONTROL_ROUTER_HPP
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <zmq.hpp>
+
+#include <coral/net.hpp>
+#include <coral/net/reactor.hpp>
+
+
+namespace coral
+{
+namespace bus
+{
+
+
+/**
+\brief  Multiplexes the control connections to any number of slaves over a
+        single ROUTER socket.
+
+The socket connects to the slaves' control endpoints, and is given a routing
+ID for each of them, so that requests can be addressed to individual slaves.
+Every request is also tagged with a request ID, which the slave returns
+unchanged in its reply.  The slave side needs no changes for this, as it
+already echoes the full message envelope.
+
+Since a slave handles its requests one at a time, in the order they arrive,
+several requests may be sent to the same slave without waiting for the
+replies in between.  The replies arrive in the same order.
+
+Only a single socket is registered with the reactor, regardless of the
+number of slaves.
+*/
+class SlaveControlRouter
+{
+public:
+    /// Identifies a slave connection.
+    typedef int PeerID;
+
+    /**
+    \brief  Handler type for replies from a slave.
+
+    The first argument is the ID of the request, as returned by Send(), and
+    the second is the reply message, without the envelope.  The handler
+    may call any of this object's functions, including Disconnect() for
+    its own peer.
+    */
+    typedef std::function<void(std::uint32_t, std::vector<zmq::message_t>&)>
+        ReplyHandler;
+
+    /// Constructor.  Creates the socket and registers it with `reactor`.
+    explicit SlaveControlRouter(coral::net::Reactor& reactor);
+
+    /// Destructor.  Unregisters the socket from the reactor.
+    ~SlaveControlRouter() noexcept;
+
+    SlaveControlRouter(const SlaveControlRouter&) = delete;
+    SlaveControlRouter& operator=(const SlaveControlRouter&) = delete;
+    SlaveControlRouter(SlaveControlRouter&&) = delete;
+    SlaveControlRouter& operator=(SlaveControlRouter&&) = delete;
+
+    /// The reactor with which the socket is registered.
+    coral::net::Reactor& Reactor() noexcept;
+
+    /**
+    \brief  Connects to a slave's control endpoint.
+
+    Requests may be sent as soon as the function returns; they will be
+    queued until the connection is established.
+
+    \param [in] endpoint    The slave's control endpoint.
+    \param [in] onReply     The handler for replies from the slave.
+                            May not be empty.
+
+    \returns An ID which is used to refer to the connection.
+    */
+    PeerID Connect(const coral::net::Endpoint& endpoint, ReplyHandler onReply);
+
+    /**
+    \brief  Breaks a connection made with Connect().
+
+    Replies which arrive later are ignored.  If there is no such connection,
+    this function does nothing.
+    */
+    void Disconnect(PeerID peer) noexcept;
+
+    /**
+    \brief  Sends a request to a slave.
+
+    The contents of `msg` will be cleared on return.
+
+    \returns The ID of the request, which is passed to the reply handler
+        along with the reply.
+
+    \throws std::invalid_argument if `msg` is empty or `peer` is not
+        connected.
+    \throws zmq::error_t on failure to send the message.
+    */
+    std::uint32_t Send(PeerID peer, std::vector<zmq::message_t>& msg);
+
+    /// The number of connected slaves.
+    std::size_t PeerCount() const noexcept;
+
+private:
+    void OnIncoming();
+    void HandleMessage(std::vector<zmq::message_t>& msg);
+
+    struct Peer
+    {
+        std::string endpoint;
+        ReplyHandler onReply;
+    };
+
+    coral::net::Reactor& m_reactor;
+    std::unique_ptr<zmq::socket_t> m_socket;
+    std::unordered_map<PeerID, Peer> m_peers;
+    PeerID m_nextPeerID;
+    std::uint32_t m_nextRequestID;
+};
+
+
+}} // namespace
+#endif // header guard
@@ -18,6 +18,7 @@
 
 #include <coral/config.h>
 #include <coral/bus/slave_control_messenger.hpp>
+#include <coral/bus/slave_control_router.hpp>
 #include <coral/bus/slave_setup.hpp>
 #include <coral/net/reactor.hpp>
 #include <coral/model.hpp>
@@ -77,6 +78,10 @@ public:
     \param [in] maxConnectionAttempts
         How many times to try the connection if it fails.  This includes the
         first one, so the value must be at least 1. The default is 3.
+    \param [in] router
+        If not null, all communication with the slave after the initial
+        handshake goes through this router, and commands may be pipelined.
+        See MakeSlaveControlMessenger().
 
     \throws std::invalid_argument if `slaveLocator` is empty, if `slaveID` is
         invalid, if `onComplete` is empty, or if `maxConnectionAttempts < 1`.
@@ -87,9 +92,10 @@ public:
         coral::model::SlaveID slaveID,
         const std::string& slaveName,
         const SlaveSetup& setup,
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         ConnectHandler onComplete,
-        int maxConnectionAttempts = 3);
+        int maxConnectionAttempts = 3,
+        SlaveControlRouter* router = nullptr);
 
     /**
     \brief  Destructor
@@ -117,6 +123,15 @@ public:
     /// Returns the current state of the slave.
     SlaveState State() const noexcept;
 
+    /**
+    \brief  Returns timing information about the last command whose reply
+            has been received.
+
+    See ISlaveControlMessenger::LastCommandTiming().  If the slave is not
+    connected yet, all the durations are unknown.
+    */
+    SlaveCommandTiming LastCommandTiming() const noexcept;
+
     /// Completion handler type for GetDescription()
     typedef std::function<void(const std::error_code&, const coral::model::SlaveDescription&)>
         GetDescriptionHandler;
@@ -131,7 +146,7 @@ public:
         Completion handler. May not be empty.
     */
     void GetDescription(
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         GetDescriptionHandler onComplete);
 
     /// Completion handler type for SetVariables()
@@ -151,7 +166,7 @@ public:
     */
     void SetVariables(
         const std::vector<coral::model::VariableSetting>& settings,
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         SetVariablesHandler onComplete);
 
     /// Completion handler type for SetPeers()
@@ -171,7 +186,7 @@ public:
     */
     void SetPeers(
         const std::vector<coral::net::Endpoint>& peers,
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         SetPeersHandler onComplete);
 
     /// Completion handler type for ResendVars()
@@ -194,7 +209,7 @@ public:
     \post `State() == SLAVE_BUSY`.
     */
     void ResendVars(
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         ResendVarsHandler onComplete);
 
     /// Completion handler type for Step()
@@ -219,7 +234,7 @@ public:
         coral::model::StepID stepID,
         coral::model::TimePoint currentT,
         coral::model::TimeDuration deltaT,
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         StepHandler onComplete);
 
     /// Completion handler type for AcceptStep()
@@ -236,9 +251,38 @@ public:
         Completion handler.
     */
     void AcceptStep(
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         AcceptStepHandler onComplete);
 
+    /// Completion handler type for AcceptStepAndStep()
+    typedef VoidHandler AcceptStepAndStepHandler;
+
+    /**
+    \brief  Tells the slave that the time step is accepted and makes it
+            perform the next one.
+
+    This has the same effect as AcceptStep() followed by Step(), but only
+    takes a single round trip if the slave supports it.
+
+    \param [in] stepID
+        The ID number of the time step to be performed
+    \param [in] currentT
+        The current time point.
+    \param [in] deltaT
+        The step size. Must be positive.
+    \param [in] timeout
+        Max. allowed time for the operation to complete.
+        A negative value means no time limit.
+    \param [in] onComplete
+        Completion handler.
+    */
+    void AcceptStepAndStep(
+        coral::model::StepID stepID,
+        coral::model::TimePoint currentT,
+        coral::model::TimeDuration deltaT,
+        std::chrono::microseconds timeout,
+        AcceptStepAndStepHandler onComplete);
+
     /**
     \brief  Terminates the slave and cancels all pending operations.
 
@@ -137,6 +137,25 @@ public:
         const std::string& slaveTypeUUID,
         std::chrono::milliseconds timeout) = 0;
 
+    /// Completion handler type for InstantiateSlaveAsync().
+    typedef SlaveProviderClient::InstantiateSlaveHandler InstantiateSlaveHandler;
+
+    /**
+    \brief  Instantiates a slave without blocking the server.
+
+    `onComplete` must be called exactly once, in the thread which runs the
+    server's reactor, either before the function returns or later.  In case
+    of failure, it must be called with an error code and a description of
+    the problem.
+
+    The default implementation calls InstantiateSlave() and then
+    `onComplete`.
+    */
+    virtual void InstantiateSlaveAsync(
+        const std::string& slaveTypeUUID,
+        std::chrono::milliseconds timeout,
+        InstantiateSlaveHandler onComplete);
+
     virtual ~SlaveProviderOps() noexcept { }
 };
 
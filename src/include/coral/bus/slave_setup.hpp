@@ -31,7 +31,7 @@ struct SlaveSetup
         coral::model::TimePoint startTime,
         coral::model::TimePoint stopTime,
         const std::string& executionName,
-        std::chrono::milliseconds variableRecvTimeout);
+        std::chrono::microseconds variableRecvTimeout);
     coral::model::TimePoint startTime;
     coral::model::TimePoint stopTime;
     std::string executionName;
@@ -41,7 +41,7 @@ struct SlaveSetup
             other slaves before assuming that the connection is broken or
             that a subscription has failed to take effect.
     */
-    std::chrono::milliseconds variableRecvTimeout;
+    std::chrono::microseconds variableRecvTimeout;
 };
 
 
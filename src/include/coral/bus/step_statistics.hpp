@@ -0,0 +1,89 @@
+/**
+\file
+\brief  Defines classes for collecting statistics about slaves' time steps.
+\copyright
+    Copyright 2013-present, SINTEF Ocean.
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#ifndef CORAL_BUS_STEP_STATISTICS_HPP
+#define CORAL_BUS_STEP_STATISTICS_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <coral/bus/slave_control_messenger.hpp>
+#include <coral/master/statistics.hpp>
+
+
+namespace coral
+{
+namespace bus
+{
+
+
+/**
+\brief  A histogram of the most recent samples in a series of durations.
+
+The histogram has the exponential bin layout described for
+coral::master::LatencyStatistics::histogram.  Adding a sample is a
+constant-time operation, as the sample which falls out of the window is
+removed from its bin at the same time.
+*/
+class RollingLatencyHistogram
+{
+public:
+    /// The number of bins.
+    static const std::size_t binCount = 32;
+
+    /// Constructor.  `window` is the max. number of samples, and must be positive.
+    explicit RollingLatencyHistogram(std::size_t window);
+
+    /// Adds a sample, and removes the oldest one if the window is full.
+    void Add(std::chrono::microseconds sample);
+
+    /// Returns statistics about the samples currently in the window.
+    coral::master::LatencyStatistics Statistics() const;
+
+private:
+    std::vector<std::chrono::microseconds> m_samples; // ring buffer
+    std::size_t m_window;
+    std::size_t m_next;
+    std::chrono::microseconds m_sum;
+    std::vector<std::uint64_t> m_bins;
+};
+
+
+/**
+\brief  Collects the timing information for one slave's step-related
+        commands into rolling histograms.
+*/
+class StepTimingCollector
+{
+public:
+    /// Constructor.  `window` is passed on to each of the histograms.
+    explicit StepTimingCollector(std::size_t window);
+
+    /// Adds the known durations in `timing` to the histograms.
+    void Add(const SlaveCommandTiming& timing);
+
+    /**
+    \brief  Fills the duration fields of `stats` (i.e., all but the slave
+            ID and name) with the statistics collected so far.
+    */
+    void Statistics(coral::master::SlaveStepStatistics& stats) const;
+
+private:
+    RollingLatencyHistogram m_doStep;
+    RollingLatencyHistogram m_publish;
+    RollingLatencyHistogram m_inputWait;
+    RollingLatencyHistogram m_network;
+    RollingLatencyHistogram m_roundTrip;
+};
+
+
+}} // namespace
+#endif // header guard
@@ -0,0 +1,118 @@
+/**
+\file
+\brief Variable lists with precomputed FMI value references, shared by the
+       FMI 1.0 and FMI 2.0 slave instances.
+\copyright
+    Copyright 2013-present, SINTEF Ocean.
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#ifndef CORAL_FMI_VALUE_REFERENCE_LIST_HPP
+#define CORAL_FMI_VALUE_REFERENCE_LIST_HPP
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <coral/model.hpp>
+#include <coral/slave/instance.hpp>
+
+
+namespace coral
+{
+namespace fmi
+{
+
+
+/**
+\brief  A coral::slave::VariableList which also holds the FMI value
+        references of the variables.
+
+`ValueReference` is `fmi1_value_reference_t` or `fmi2_value_reference_t`.
+*/
+template<typename ValueReference>
+class ValueReferenceList : public coral::slave::VariableList
+{
+public:
+    ValueReferenceList(
+        coral::model::DataType dataType,
+        std::vector<coral::model::VariableID> variables,
+        std::vector<ValueReference> valueReferences)
+        : VariableList(dataType, std::move(variables))
+        , m_valueReferences(std::move(valueReferences))
+    {
+    }
+
+    /// The value references, in the same order as Variables().
+    const ValueReference* ValueReferences() const noexcept
+    {
+        return m_valueReferences.data();
+    }
+
+private:
+    std::vector<ValueReference> m_valueReferences;
+};
+
+
+/**
+\brief  Implements coral::slave::Instance::PrepareVariables() for FMI slave
+        instances.
+
+`FMUType` is FMU1 or FMU2.  The data types of the variables are checked
+against `fmu.Description()`.
+
+\throws std::logic_error
+    If one of the IDs does not refer to a variable of type `dataType`.
+*/
+template<typename FMUType>
+std::unique_ptr<coral::slave::VariableList> PrepareValueReferences(
+    const FMUType& fmu,
+    coral::model::DataType dataType,
+    std::vector<coral::model::VariableID> variables)
+{
+    using ValueReference = decltype(fmu.FMIValueReference(0));
+    std::vector<ValueReference> valueReferences;
+    valueReferences.reserve(variables.size());
+    for (const auto id : variables) {
+        if (fmu.Description().Variable(id).DataType() != dataType) {
+            throw std::logic_error(
+                "Variable " + std::to_string(id) + " has wrong data type");
+        }
+        valueReferences.push_back(fmu.FMIValueReference(id));
+    }
+    return std::make_unique<ValueReferenceList<ValueReference>>(
+        dataType, std::move(variables), std::move(valueReferences));
+}
+
+
+/**
+\brief  Returns the value references in a list which was created by
+        PrepareValueReferences().
+
+\throws std::logic_error
+    If `variables` was not created by PrepareValueReferences() for the same
+    FMI version, or if it does not have data type `dataType`.
+*/
+template<typename ValueReference>
+const ValueReference* ValueReferences(
+    const coral::slave::VariableList& variables,
+    coral::model::DataType dataType)
+{
+    const auto list =
+        dynamic_cast<const ValueReferenceList<ValueReference>*>(&variables);
+    if (!list) {
+        throw std::logic_error(
+            "Variable list was not prepared by an FMI slave instance");
+    }
+    if (list->DataType() != dataType) {
+        throw std::logic_error("Variable list has wrong data type");
+    }
+    return list->ValueReferences();
+}
+
+
+}}      // namespace
+#endif  // header guard
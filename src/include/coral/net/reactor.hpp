@@ -11,8 +11,10 @@
 #define CORAL_NET_REACTOR_HPP
 
 #include <chrono>
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 #include <utility>
 
@@ -26,6 +28,23 @@ namespace net
 {
 
 
+/// Statistics about the lateness of timer events, as measured by a Reactor.
+struct TimerJitter
+{
+    /// The number of timer events which have been measured.
+    std::uint64_t eventCount = 0;
+
+    /// The mean time from an event was due until its handler was called.
+    std::chrono::nanoseconds meanLateness = std::chrono::nanoseconds(0);
+
+    /// The maximum time from an event was due until its handler was called.
+    std::chrono::nanoseconds maxLateness = std::chrono::nanoseconds(0);
+
+    /// The standard deviation of the lateness.
+    std::chrono::nanoseconds stdDevLateness = std::chrono::nanoseconds(0);
+};
+
+
 /**
 \brief  An implementation of the reactor pattern.
 
@@ -37,6 +56,24 @@ one socket, the functions are called in the order they were added.
 It also supports timed events, where a handler function is called a certain
 number of times (or indefinitely) with a fixed time interval.  Timers are only
 active when the messaging loop is running, i.e. between Run() and Stop().
+Timers are kept in an indexed heap, so adding, removing and restarting a
+timer takes logarithmic time in the number of timers.
+
+Timers are scheduled with a monotonic clock (`std::chrono::steady_clock`) at
+microsecond resolution.  Since the underlying polling mechanisms only support
+millisecond timeouts, the reactor blocks until shortly before the next timer
+is due, and then polls the sockets without blocking until the deadline is
+reached.  The length of this "spin" period can be adjusted with
+SetSpinDuration(); it is always at least the sub-millisecond remainder.
+How late timer events are dispatched can be measured with TimerJitter().
+
+On Linux, sockets are polled with `epoll`, using the file descriptors that
+ZMQ exposes through the `ZMQ_FD` socket option.  Only sockets whose file
+descriptors have been signalled, which had incoming messages in the
+previous iteration, or which have been sent on since then, are checked for
+new messages.  (Sent-on sockets must be checked because ZMQ may consume the
+signal when a message is sent, see SocketSent().)  On other platforms,
+`zmq::poll()` is used.
 */
 class Reactor
 {
@@ -47,13 +84,18 @@ public:
     typedef int NativeSocket;
 #endif
 
-    typedef std::chrono::system_clock::time_point TimePoint;
+    typedef std::chrono::steady_clock::time_point TimePoint;
     typedef std::function<void(Reactor&, zmq::socket_t&)> SocketHandler;
     typedef std::function<void(Reactor&, NativeSocket)> NativeSocketHandler;
     typedef std::function<void(Reactor&, int)> TimerHandler;
 
     Reactor();
 
+    ~Reactor() noexcept;
+
+    Reactor(const Reactor&) = delete;
+    Reactor& operator=(const Reactor&) = delete;
+
     /// Adds a handler for the given socket.
     void AddSocket(zmq::socket_t& socket, SocketHandler handler);
 
@@ -103,7 +145,7 @@ public:
     \throws std::invalid_argument if `count` is zero or `interval` is negative.
     */
     int AddTimer(
-        std::chrono::milliseconds interval,
+        std::chrono::microseconds interval,
         int count,
         TimerHandler handler);
 
@@ -123,6 +165,27 @@ public:
     */
     void RestartTimerInterval(int id);
 
+    /**
+    \brief  Sets how long before a timer event is due the reactor stops
+            blocking and starts polling continuously.
+
+    A longer spin period improves the timing accuracy of timer events at the
+    expense of CPU usage.  The default is zero, which means that the reactor
+    only spins for the sub-millisecond remainder of the waiting time.
+
+    \throws std::invalid_argument if `duration` is negative.
+    */
+    void SetSpinDuration(std::chrono::microseconds duration);
+
+    /**
+    \brief  Returns statistics about the lateness of timer events, measured
+            since the reactor was created or ResetTimerJitter() was called.
+    */
+    coral::net::TimerJitter TimerJitter() const noexcept;
+
+    /// Resets the statistics returned by TimerJitter().
+    void ResetTimerJitter() noexcept;
+
     /**
     \brief  Runs the messaging loop.
 
@@ -145,13 +208,26 @@ public:
     */
     void Stop();
 
+    /**
+    \brief  Informs the reactors whose messaging loops are running in the
+            current thread that a message has been sent on `socket`.
+
+    When a message is sent on a ZMQ socket, the notification that the socket
+    has incoming messages may be consumed, so a reactor needs to know which
+    of its sockets have been sent on.  coral::net::zmqx::Send(), and hence
+    the socket classes in coral::net::zmqx, call this function
+    automatically.  Code which sends on a socket that is registered with a
+    running reactor by other means must call it after sending.
+    */
+    static void SocketSent(zmq::socket_t& socket) noexcept;
+
 private:
     struct Timer
     {
         Timer(
             int id,
             TimePoint nextEventTime,
-            std::chrono::milliseconds interval,
+            std::chrono::microseconds interval,
             int remaining,
             std::unique_ptr<TimerHandler> handler);
 
@@ -159,31 +235,55 @@ private:
 
         int id;
         TimePoint nextEventTime;
-        std::chrono::milliseconds interval;
+        std::chrono::microseconds interval;
         int remaining;
         std::unique_ptr<TimerHandler> handler;
     };
 
-    void RestartTimerIntervals(
-        std::vector<Timer>::iterator begin,
-        std::vector<Timer>::iterator end);
+    // Indexed heap operations.  m_timerPositions maps each timer ID to
+    // the timer's position in m_timers.
+    void PushTimer(Timer timer);
+    void EraseTimer(std::size_t pos);
+    void UpdateTimer(std::size_t pos);
+    void SiftUp(std::size_t pos);
+    void SiftDown(std::size_t pos);
+    void SwapTimers(std::size_t a, std::size_t b);
+    std::size_t TimerPosition(int id) const;
+
+    void RestartAllTimerIntervals();
+    // The time to block before the next timer event, rounded down.
     std::chrono::milliseconds TimeToNextEvent() const;
     void PerformNextEvent();
 
-    // Rebuilds the list of poll items.
+    // Removes null sockets and updates the poller accordingly.
     void Rebuild();
 
+    // The platform-specific socket polling mechanism.
+    class Poller;
+
     typedef std::pair<zmq::socket_t*, std::unique_ptr<SocketHandler>> SocketHandlerPair;
     typedef std::pair<NativeSocket, std::unique_ptr<NativeSocketHandler>> NativeSocketHandlerPair;
     std::vector<SocketHandlerPair> m_sockets;
     std::vector<NativeSocketHandlerPair> m_nativeSockets;
-    std::vector<zmq::pollitem_t> m_pollItems;
+    std::unique_ptr<Poller> m_poller;
 
     int m_nextTimerID;
     std::vector<Timer> m_timers;
+    std::unordered_map<int, std::size_t> m_timerPositions;
 
     bool m_needsRebuild;
     bool m_running;
+
+    // The reactor which was running in this thread when Run() was called.
+    Reactor* m_enclosingReactor;
+
+    std::chrono::microseconds m_spinDuration;
+
+    // Timer lateness statistics, in nanoseconds
+    std::uint64_t m_lateEventCount;
+    double m_latenessSum;
+    double m_latenessSquareSum;
+    std::chrono::nanoseconds m_maxLateness;
 };
 
 
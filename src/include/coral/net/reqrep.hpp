@@ -12,6 +12,7 @@
 
 #include <chrono>
 #include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
 #include <stdexcept>
@@ -301,6 +302,39 @@ public:
         const char*& replyHeader, size_t& replyHeaderSize,
         const char*& replyBody, size_t& replyBodySize) = 0;
 
+    /**
+    \brief  A function which sends the reply to one particular request.
+
+    The arguments have the same meaning as the output parameters of
+    HandleRequest(), except that the buffers only need to remain valid for
+    the duration of the call.  The function may be called at most once.
+    If the Server has been destroyed in the meantime, it does nothing.
+    */
+    typedef std::function<void(
+            const char* replyHeader, size_t replyHeaderSize,
+            const char* replyBody, size_t replyBodySize)>
+        ReplySender;
+
+    /**
+    \brief  Handles an incoming request whose reply may be sent later.
+
+    This is the function which Server calls.  It allows a handler to start
+    a lengthy operation and return immediately, so that the server can
+    handle other requests in the meantime, and then send the reply with
+    `sendReply` when the operation is complete.  `sendReply` must be called
+    in the thread which runs the server's reactor.  If it is never called,
+    the request is ignored.
+
+    The default implementation calls HandleRequest() and sends the reply
+    immediately, if there is one.
+    */
+    virtual void HandleRequestAsync(
+        const std::string& protocolIdentifier,
+        std::uint16_t protocolVersion,
+        const char* requestHeader, size_t requestHeaderSize,
+        const char* requestBody, size_t requestBodySize,
+        ReplySender sendReply);
+
     virtual ~ServerProtocolHandler() = default;
 };
 
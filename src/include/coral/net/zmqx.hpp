@@ -115,7 +115,9 @@ CORAL_DEFINE_BITWISE_ENUM_OPERATORS(SendFlag)
 /**
 \brief Sends a message.
 
-The message content will be cleared on return.
+The message content will be cleared on return, and any coral::net::Reactor
+which is running in the current thread is notified that the socket has been
+sent on (see coral::net::Reactor::SocketSent()).
 
 \throws std::invalid_argument if `message` is empty.
 \throws zmq::error_t on failure to send a message frame.
@@ -297,6 +299,25 @@ public:
     */
     void Ignore();
 
+    /**
+    \brief  Takes the identity of the sender of the last received request,
+            so that the reply can be sent later with SendTo().
+
+    After calling this function, Receive() may be called again, but Send()
+    may not be called before a new request has been received.
+    */
+    std::vector<zmq::message_t> TakeClientEnvelope();
+
+    /**
+    \brief  Sends a reply to the client identified by `clientEnvelope`,
+            which must have been obtained with TakeClientEnvelope().
+
+    The contents of both `clientEnvelope` and `msg` are consumed.
+    */
+    void SendTo(
+        std::vector<zmq::message_t>& clientEnvelope,
+        std::vector<zmq::message_t>& msg);
+
     /**
     \brief  The underlying ZMQ socket.
 
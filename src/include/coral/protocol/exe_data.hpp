@@ -10,6 +10,8 @@
 #ifndef CORAL_PROTOCOL_EXE_DATA_HPP
 #define CORAL_PROTOCOL_EXE_DATA_HPP
 
+#include <cstdint>
+#include <utility>
 #include <vector>
 #include <zmq.hpp>
 #include <coral/model.hpp>
@@ -26,8 +28,39 @@ namespace protocol
 */
 namespace exe_data
 {
+/**
+\brief  The size of the part of the header frame which identifies the variable.
+
+This is also the size of the prefix used for subscriptions.
+*/
 const size_t HEADER_SIZE = 6;
 
+/**
+\brief  The size of a header frame which includes a format version byte.
+
+Header frames of size `HEADER_SIZE` have no version byte, and the body is then
+always in the `Format::protobuf` format.
+*/
+const size_t VERSIONED_HEADER_SIZE = HEADER_SIZE + 1;
+
+/// The formats which may be used for the body of an ordinary message.
+enum class Format : std::uint8_t
+{
+    /// A `coralproto::exe_data::TimestampedValue` protocol buffer.
+    protobuf = 0,
+
+    /**
+    \brief  A fixed-layout binary structure.
+
+    The step ID is encoded as 4 bytes, followed by a 1-byte type tag (a
+    coral::model::DataType value) and the value itself.  Real, integer and
+    boolean values are encoded as 8 bytes, while strings are encoded as
+    a 4-byte length followed by the characters.  All integers use
+    little-endian byte order.
+    */
+    binary = 1,
+};
+
 struct Message
 {
     coral::model::Variable variable;
@@ -35,13 +68,100 @@ struct Message
     coral::model::ScalarValue value;
 };
 
+/**
+\brief  Parses an ordinary message, in any of the supported formats.
+
+\throws coral::error::ProtocolViolationException
+    If `rawMsg` is not a well-formed message.
+\throws coral::error::ProtocolNotSupported
+    If the message has an unknown format version.
+*/
 Message ParseMessage(const std::vector<zmq::message_t>& rawMsg);
 
-void CreateMessage(const Message& message, std::vector<zmq::message_t>& rawOut);
+/**
+\brief  Creates an ordinary message.
+
+For `Format::protobuf`, which is the default, the header frame has no version
+byte, so the message can be parsed by peers which do not support the other
+formats.  `Format::binary` should only be used when all subscribers are known
+to support it.
+*/
+void CreateMessage(
+    const Message& message,
+    std::vector<zmq::message_t>& rawOut,
+    Format format = Format::protobuf);
 
 void Subscribe(zmq::socket_t& socket, const coral::model::Variable& variable);
 
 void Unsubscribe(zmq::socket_t& socket, const coral::model::Variable& variable);
 
+
+/**
+\brief  The variable ID used in the header of batch messages.
+
+This is reserved, and cannot be used for an actual variable.  (It corresponds
+to the "undefined" value reference in FMI 2.0.)
+*/
+const coral::model::VariableID BATCH_VARIABLE_ID = 0xFFFFFFFFu;
+
+/**
+\brief  A message which contains the values of several variables belonging to
+        the same slave, for the same time step.
+
+A batch message has a header which is identical to that of an ordinary
+message for the variable `BATCH_VARIABLE_ID`, without a version byte.  The
+body consists of the step ID and the number of values, followed by the
+values, each of which is encoded as a variable ID followed by the type tag
+and value, as for `Format::binary`.
+
+A slave sends at most one batch message per time step, and the variables
+which are not included in it are taken to be unchanged since the last time
+they were sent.
+*/
+struct BatchMessage
+{
+    coral::model::SlaveID slave;
+    coral::model::StepID timestepID;
+    std::vector<std::pair<coral::model::VariableID, coral::model::ScalarValue>> values;
+};
+
+/// Returns whether `rawMsg` is a batch message (as opposed to an ordinary one).
+bool IsBatchMessage(const std::vector<zmq::message_t>& rawMsg);
+
+/**
+\brief  Parses a batch message.
+
+Existing contents of `message.values` will be replaced, but its capacity is
+reused.
+
+\throws coral::error::ProtocolViolationException
+    If `rawMsg` is not a well-formed batch message.
+*/
+void ParseBatchMessage(
+    const std::vector<zmq::message_t>& rawMsg,
+    BatchMessage& message);
+
+/**
+\brief  Creates a batch message.
+
+\param [in] slave       The ID of the slave which owns the variables.
+\param [in] timestepID  The time step ID.
+\param [in] values      An array of (variable ID, value) pairs.
+\param [in] count       The size of the `values` array.
+\param [out] rawOut     The message frames.  Existing content is replaced.
+*/
+void CreateBatchMessage(
+    coral::model::SlaveID slave,
+    coral::model::StepID timestepID,
+    const std::pair<coral::model::VariableID, coral::model::ScalarValue>* values,
+    std::size_t count,
+    std::vector<zmq::message_t>& rawOut);
+
+/// Subscribes to batch messages from the given slave.
+void SubscribeBatch(zmq::socket_t& socket, coral::model::SlaveID slave);
+
+/// Unsubscribes from batch messages from the given slave.
+void UnsubscribeBatch(zmq::socket_t& socket, coral::model::SlaveID slave);
+
 }}} // namespace
 #endif // header guard
@@ -38,6 +38,18 @@ namespace execution
 {
 
 
+/**
+\brief  The highest version of the master/slave protocol supported by this
+        implementation.
+
+Version 1 adds the ACCEPT_STEP_AND_STEP command to version 0, and version 2
+adds a `StepTiming` body to STEP_OK and to the READY reply to ACCEPT_STEP.
+The version is negotiated in the HELLO handshake, as described for
+`HelloData` in execution.proto.
+*/
+const uint16_t MAX_PROTOCOL_VERSION = 2;
+
+
 /**
 \brief  Fills `message` with a body-less HELLO message that requests the
         given protocol version.
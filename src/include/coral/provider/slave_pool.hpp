@@ -0,0 +1,143 @@
+/**
+\file
+\brief  Defines the coral::provider::SlavePool class.
+\copyright
+    Copyright 2013-present, SINTEF Ocean.
+    This Source Code Form is subject to the terms of the Mozilla Public
+    License, v. 2.0. If a copy of the MPL was not distributed with this
+    file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#ifndef CORAL_PROVIDER_SLAVE_POOL_HPP
+#define CORAL_PROVIDER_SLAVE_POOL_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+
+#include <zmq.hpp>
+
+
+namespace coral
+{
+namespace provider
+{
+
+
+/**
+\brief  A pool of idle slaves which have been started in advance and which
+        wait to be claimed.
+
+Each pooled slave has its own status socket, a ZMQ_DEALER socket bound to an
+ephemeral loopback TCP port.  The slave connects to it and takes part in the
+following handshake:
+
+  1. When the slave is ready, it sends "READY".  (If it fails to start, it
+     sends "ERROR" followed by a frame with a description of the error.)
+  2. The pool answers with "CLAIM" when the slave is handed out, or with
+     "RELEASE" when it is no longer wanted, whereupon the slave shuts down.
+  3. A claimed slave reports its endpoints on the same socket, in the same
+     format as a slave which was not pooled.
+
+Update() must be called regularly to receive "READY" messages and to get rid
+of slaves which have been idle for too long.
+*/
+class SlavePool
+{
+public:
+    /**
+    \brief  A function which starts a new slave process.
+
+    The slave must connect to `statusEndpoint` and follow the handshake
+    described above.  The function may throw if the slave could not be
+    started.
+    */
+    typedef std::function<void(const std::string& statusEndpoint)> SpawnSlave;
+
+    /**
+    \brief  Constructor.
+
+    No slaves are started until Fill() is called.
+
+    \param [in] size
+        The number of slaves to keep in the pool.
+    \param [in] maxIdleTime
+        How long a slave may stay in the pool, counting from when it was
+        started.  Older slaves are released by Update().  A negative value
+        means that slaves are kept indefinitely.
+    \param [in] spawnSlave
+        The function used to start new slaves.
+    */
+    SlavePool(
+        std::size_t size,
+        std::chrono::milliseconds maxIdleTime,
+        SpawnSlave spawnSlave);
+
+    SlavePool(const SlavePool&) = delete;
+    SlavePool& operator=(const SlavePool&) = delete;
+
+    /// Releases all slaves which are ready, as if by `ReleaseAll(0ms)`.
+    ~SlavePool() noexcept;
+
+    /**
+    \brief  Receives status messages from the slaves, and releases those
+            which have been idle for too long.
+
+    Slaves which have failed to start are removed from the pool, and the
+    failure is logged.  This function does not block.
+    */
+    void Update();
+
+    /**
+    \brief  Starts new slaves until the pool is full.
+
+    \throws std::runtime_error, or whatever the spawn function throws, if a
+        slave could not be started.  Slaves started before the failure are
+        kept in the pool.
+    */
+    void Fill();
+
+    /**
+    \brief  Claims a slave which is ready, if there is one.
+
+    The slave is removed from the pool and told that it has been claimed.
+    Its locator can then be received on the returned socket.
+
+    \returns the slave's status socket, or `nullptr` if no slave is ready.
+    */
+    std::unique_ptr<zmq::socket_t> Claim();
+
+    /**
+    \brief  Releases all slaves and empties the pool.
+
+    Slaves which have not yet reported that they are ready are given up to
+    `wait` to do so, so that they can be released too.  Those which are not
+    ready by then are left to shut themselves down.
+    */
+    void ReleaseAll(std::chrono::milliseconds wait);
+
+    /// The number of slaves in the pool, including those which are not ready.
+    std::size_t Size() const noexcept;
+
+    /// The number of slaves in the pool which are ready to be claimed.
+    std::size_t ReadyCount() const noexcept;
+
+private:
+    struct PooledSlave
+    {
+        zmq::socket_t statusSocket;
+        std::chrono::steady_clock::time_point startTime;
+        bool ready;
+    };
+
+    std::size_t m_size;
+    std::chrono::milliseconds m_maxIdleTime;
+    SpawnSlave m_spawnSlave;
+    std::list<PooledSlave> m_slaves;
+};
+
+
+}} // namespace
+#endif // header guard
@@ -62,6 +62,15 @@ arrays (`stringz`) to be null-terminated.
 int ArrayStringCmp(const char* array, size_t length, const char* stringz);
 
 
+/**
+\brief  Matches a string against a wildcard pattern.
+
+In the pattern, `*` matches any sequence of characters (including none), and
+`?` matches any single character.  All other characters match themselves.
+*/
+bool GlobMatch(const std::string& pattern, const std::string& text);
+
+
 /// Returns a string that contains a random UUID.
 std::string RandomUUID();
 
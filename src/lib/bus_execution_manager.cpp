@@ -59,7 +59,7 @@ void ExecutionManager::Reconfigure(
 
 void ExecutionManager::Step(
     coral::model::TimeDuration stepSize,
-    std::chrono::milliseconds timeout,
+    std::chrono::microseconds timeout,
     StepHandler onComplete,
     ExecutionManager::SlaveStepHandler onSlaveStepComplete)
 {
@@ -72,7 +72,7 @@ void ExecutionManager::Step(
 
 
 void ExecutionManager::AcceptStep(
-    std::chrono::milliseconds timeout,
+    std::chrono::microseconds timeout,
     AcceptStepHandler onComplete,
     SlaveAcceptStepHandler onSlaveAcceptStepComplete)
 {
@@ -83,10 +83,30 @@ void ExecutionManager::AcceptStep(
 }
 
 
+void ExecutionManager::AcceptStepAndStep(
+    coral::model::TimeDuration stepSize,
+    std::chrono::microseconds timeout,
+    StepHandler onComplete,
+    SlaveStepHandler onSlaveStepComplete)
+{
+    m_private->AcceptStepAndStep(
+        stepSize,
+        timeout,
+        std::move(onComplete),
+        std::move(onSlaveStepComplete));
+}
+
+
 void ExecutionManager::Terminate()
 {
     m_private->Terminate();
 }
 
 
+coral::master::ExecutionStatistics ExecutionManager::Statistics() const
+{
+    return m_private->Statistics();
+}
+
+
 }} // namespace
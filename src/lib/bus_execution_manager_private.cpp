@@ -34,13 +34,18 @@ ExecutionManagerPrivate::ExecutionManagerPrivate(
         options.maxTime,
         executionName,
         options.slaveVariableRecvTimeout),
+      controlRouter(options.multiplexSlaveControl
+        ? std::make_unique<coral::bus::SlaveControlRouter>(reactor_)
+        : nullptr),
       lastSlaveID(0),
       slaves(),
       m_state(), // created below
       m_operationCount(0),
       m_allSlaveOpsCompleteHandler(),
       m_currentStepID(-1),
-      m_resendVarsNeeded(false)
+      m_resendVarsNeeded(false),
+      m_statisticsWindow(options.statisticsWindow),
+      m_stepStatistics()
 {
     SwapState(std::make_unique<ReadyExecutionState>());
 }
@@ -81,26 +86,33 @@ void ExecutionManagerPrivate::Reconfigure(
     m_state->Reconfigure(
         *this, slaveConfigs, commTimeout,
         std::move(onComplete), std::move(onSlaveComplete));
-    m_resendVarsNeeded = true;
+
+    // The slaves only need to resend their variables if there are new data
+    // connections.  Otherwise, the values they already have are current.
+    for (const auto& sc : slaveConfigs) {
+        for (const auto& setting : sc.variableSettings) {
+            if (setting.IsConnectionChange()) m_resendVarsNeeded = true;
+        }
+    }
 }
 
 
 void ExecutionManagerPrivate::Step(
     coral::model::TimeDuration stepSize,
-    std::chrono::milliseconds timeout,
+    std::chrono::microseconds timeout,
     ExecutionManager::StepHandler onComplete,
     ExecutionManager::SlaveStepHandler onSlaveStepComplete)
 {
     if (m_resendVarsNeeded) {
         auto resendTimeout = 2*slaveSetup.variableRecvTimeout;
-        if (resendTimeout < std::chrono::milliseconds(0)) {
+        if (resendTimeout < std::chrono::microseconds(0)) {
             coral::master::ExecutionOptions defaults;
             resendTimeout = 2*defaults.slaveVariableRecvTimeout;
             CORAL_LOG_DEBUG(boost::format(
                 "Slave-to-slave variable receive timeout is negative "
                 "(aka. infinite), and we cannot use that to detect when "
                 "slaves are all reconnected to each other. Using default "
-                "value (%d ms).")
+                "value (%d us).")
                 % resendTimeout.count());
         }
         m_state->ResendVars(
@@ -140,7 +152,7 @@ void ExecutionManagerPrivate::Step(
 
 
 void ExecutionManagerPrivate::AcceptStep(
-    std::chrono::milliseconds timeout,
+    std::chrono::microseconds timeout,
     ExecutionManager::AcceptStepHandler onComplete,
     ExecutionManager::SlaveAcceptStepHandler onSlaveStepComplete)
 {
@@ -152,12 +164,44 @@ void ExecutionManagerPrivate::AcceptStep(
 }
 
 
+void ExecutionManagerPrivate::AcceptStepAndStep(
+    coral::model::TimeDuration stepSize,
+    std::chrono::microseconds timeout,
+    ExecutionManager::StepHandler onComplete,
+    ExecutionManager::SlaveStepHandler onSlaveStepComplete)
+{
+    m_state->AcceptStepAndStep(
+        *this,
+        stepSize,
+        timeout,
+        std::move(onComplete),
+        std::move(onSlaveStepComplete));
+}
+
+
 void ExecutionManagerPrivate::Terminate()
 {
     m_state->Terminate(*this);
 }
 
 
+coral::master::ExecutionStatistics ExecutionManagerPrivate::Statistics() const
+{
+    coral::master::ExecutionStatistics stats;
+    for (const auto& slave : slaves) {
+        stats.slaves.emplace_back();
+        auto& slaveStats = stats.slaves.back();
+        slaveStats.slaveID = slave.first;
+        slaveStats.slaveName = slave.second.description.Name();
+        const auto collector = m_stepStatistics.find(slave.first);
+        if (collector != m_stepStatistics.end()) {
+            collector->second.Statistics(slaveStats);
+        }
+    }
+    return stats;
+}
+
+
 void ExecutionManagerPrivate::DoTerminate()
 {
     for (auto it = begin(slaves); it != end(slaves); ++it) {
@@ -190,6 +234,21 @@ void ExecutionManagerPrivate::AdvanceSimTime(coral::model::TimeDuration delta)
 }
 
 
+void ExecutionManagerPrivate::RecordCommandTiming(coral::model::SlaveID slaveID)
+{
+    if (m_statisticsWindow == 0) return;
+    const auto slave = slaves.find(slaveID);
+    if (slave == slaves.end()) return;
+    auto stats = m_stepStatistics.find(slaveID);
+    if (stats == m_stepStatistics.end()) {
+        stats = m_stepStatistics.emplace(
+            slaveID,
+            StepTimingCollector(m_statisticsWindow)).first;
+    }
+    stats->second.Add(slave->second.slave->LastCommandTiming());
+}
+
+
 void ExecutionManagerPrivate::SlaveOpStarted() noexcept
 {
     assert(m_operationCount >= 0);
@@ -257,4 +316,14 @@ ExecutionManagerPrivate::Slave::Slave(
 { }
 
 
+std::set<coral::model::SlaveID> ExecutionManagerPrivate::Slave::ConnectedPeers() const
+{
+    std::set<coral::model::SlaveID> connectedPeers;
+    for (const auto& source : inputSources) {
+        connectedPeers.insert(source.second);
+    }
+    return connectedPeers;
+}
+
+
 }} // namespace
@@ -19,6 +19,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include <coral/bus/slave_control_messenger.hpp>
 #include <coral/bus/slave_controller.hpp>
 #include <coral/log.hpp>
+#include <coral/trace.hpp>
 #include <coral/util.hpp>
 
 
@@ -201,7 +202,7 @@ void ReadyExecutionState::Reconfigure(
 void ReadyExecutionState::ResendVars(
     ExecutionManagerPrivate& self,
     int maxAttempts,
-    std::chrono::milliseconds commTimeout,
+    std::chrono::microseconds commTimeout,
     std::function<void(const std::error_code&)> onComplete)
 {
     self.SwapState(std::make_unique<PrimingExecutionState>(
@@ -212,7 +213,7 @@ void ReadyExecutionState::ResendVars(
 void ReadyExecutionState::Step(
     ExecutionManagerPrivate& self,
     coral::model::TimeDuration stepSize,
-    std::chrono::milliseconds timeout,
+    std::chrono::microseconds timeout,
     ExecutionManager::StepHandler onComplete,
     ExecutionManager::SlaveStepHandler onSlaveStepComplete)
 {
@@ -319,7 +320,9 @@ namespace
             realName,
             self.slaveSetup,
             commTimeout,
-            std::move(onConnected));
+            std::move(onConnected),
+            3,
+            self.controlRouter.get());
         self.slaves.insert(std::make_pair(
             id,
             ExecutionManagerPrivate::Slave(
@@ -394,28 +397,26 @@ void ReconstitutingExecutionState::StateEntered(
 void ReconstitutingExecutionState::AllSlavesAdded(
     ExecutionManagerPrivate& self)
 {
-    // Build a list that contains the endpoints on which the slaves
-    // publish their variable values.
-    std::vector<coral::net::Endpoint> peers;
-    for (const auto& slave : self.slaves) {
-        if (slave.second.slave->State() != SLAVE_NOT_CONNECTED) {
-            peers.push_back(slave.second.locator.DataPubEndpoint());
-        }
-    }
-
-    // Send that list to all the slaves.  We use opTally to keep track of
-    // the number of ongoing operations as well as the number of failed
-    // operations.  The latter is needed because any failure should be
-    // counted as fatal -- the simulation is not likely to run if one of
-    // the slaves is not in contact with the others.
+    // Slaves are only connected to the peers whose outputs they actually
+    // consume (see ReconfiguringExecutionState), and the newly added slaves
+    // don't have any connections yet.  We still send them an empty peer
+    // list, so they are ready to receive connections.  The existing slaves
+    // are not affected by the addition.
+    //
+    // We use opTally to keep track of the number of ongoing operations as
+    // well as the number of failed operations.  The latter is needed because
+    // any failure should be counted as fatal -- the simulation is not likely
+    // to run if one of the slaves is not in contact with the others.
     //
     // When all per-slave operations are done, we move to the final stage
     // by calling Completed() if all went well, otherwise we call Failed().
     const auto opTally = std::make_shared<OpTally>();
-    for (auto& slave : self.slaves) {
-        const auto slaveName = slave.second.description.Name();
-        slave.second.slave->SetPeers(
-            peers,
+    for (const auto id : m_addedSlaves) {
+        auto& slave = self.slaves.at(id);
+        assert(slave.peers.empty());
+        const auto slaveName = slave.description.Name();
+        slave.slave->SetPeers(
+            std::vector<coral::net::Endpoint>{},
             m_commTimeout,
             [&self, opTally, slaveName, this] (const std::error_code& ec)
             {
@@ -496,17 +497,25 @@ ReconfiguringExecutionState::ReconfiguringExecutionState(
 }
 
 
+ReconfiguringExecutionState::~ReconfiguringExecutionState() noexcept
+{
+}
+
+
 void ReconfiguringExecutionState::StateEntered(
     ExecutionManagerPrivate& self)
 {
     const auto opTally = std::make_shared<OpTally>();
+    const auto start = coral::trace::Clock::now();
     for (std::size_t index = 0; index < m_slaveConfigs.size(); ++index) {
         const auto slaveID = m_slaveConfigs[index].slaveID;
-        self.slaves.at(slaveID).slave->SetVariables(
-            m_slaveConfigs[index].variableSettings,
-            m_commTimeout,
-            [&self, opTally, index, slaveID, this] (const std::error_code& ec)
+        auto& slave = self.slaves.at(slaveID);
+
+        const auto onSetVarsComplete =
+            [&self, opTally, index, slaveID, start, this] (const std::error_code& ec)
             {
+                const auto end = coral::trace::Clock::now();
+                coral::trace::RecordAsyncEvent("master.slave", "set_vars", slaveID, start, end);
                 --(opTally->ongoing);
                 if (ec) {
                     ++(opTally->failed);
@@ -514,18 +523,117 @@ void ReconfiguringExecutionState::StateEntered(
                 m_onSlaveComplete(ec, slaveID, index);
                 if (opTally->ongoing == 0) {
                     // All per-slave calls complete
-                    if (opTally->failed == 0) {
-                        // No errors
-                        m_onComplete(std::error_code{});
-                        self.SwapState(std::make_unique<ReadyExecutionState>());
-                    } else {
-                        m_onComplete(make_error_code(
-                            coral::error::generic_error::operation_failed));
-                        self.SwapState(std::make_unique<FatalErrorExecutionState>());
+                    coral::trace::RecordAsyncEvent("master", "reconfigure", 0, start, end);
+                    Completed(self, opTally->failed > 0);
+                }
+            };
+        ++(opTally->ongoing);
+
+        // Update our record of which slaves this slave consumes data from.
+        // If that changes, we send it a new, targeted list of peers to
+        // connect to before setting its variables, so that the number of
+        // data connections grows with the number of slave-to-slave couplings
+        // rather than with the square of the number of slaves.
+        for (const auto& setting : m_slaveConfigs[index].variableSettings) {
+            if (!setting.IsConnectionChange()) continue;
+            const auto& output = setting.ConnectedOutput();
+            if (output.Empty()) {
+                slave.inputSources.erase(setting.Variable());
+            } else {
+                slave.inputSources[setting.Variable()] = output.Slave();
+            }
+        }
+        auto connectedPeers = slave.ConnectedPeers();
+        if (connectedPeers == slave.peers) {
+            slave.slave->SetVariables(
+                m_slaveConfigs[index].variableSettings,
+                m_commTimeout,
+                onSetVarsComplete);
+            continue;
+        }
+
+        std::vector<coral::net::Endpoint> peerEndpoints;
+        for (const auto peerID : connectedPeers) {
+            peerEndpoints.push_back(self.slaves.at(peerID).locator.DataPubEndpoint());
+        }
+        CORAL_LOG_TRACE(boost::format("Connecting slave %d to %d peers")
+            % slaveID % peerEndpoints.size());
+        slave.peers = std::move(connectedPeers);
+        if (self.controlRouter) {
+            // The SET_VARS command can be queued right behind SET_PEERS.  If
+            // the latter fails, the former is canceled.
+            slave.slave->SetPeers(
+                peerEndpoints,
+                m_commTimeout,
+                [&self, slaveID] (const std::error_code& ec)
+                {
+                    if (ec) {
+                        coral::log::Log(coral::log::error,
+                            boost::format("Failed to send SET_PEERS command to slave '%s': %s")
+                            % self.slaves.at(slaveID).description.Name()
+                            % ec.message());
                     }
+                });
+            slave.slave->SetVariables(
+                m_slaveConfigs[index].variableSettings,
+                m_commTimeout,
+                onSetVarsComplete);
+            continue;
+        }
+        slave.slave->SetPeers(
+            peerEndpoints,
+            m_commTimeout,
+            [&self, index, slaveID, onSetVarsComplete, this]
+                (const std::error_code& ec)
+            {
+                if (ec) {
+                    coral::log::Log(coral::log::error,
+                        boost::format("Failed to send SET_PEERS command to slave '%s': %s")
+                        % self.slaves.at(slaveID).description.Name()
+                        % ec.message());
+                    onSetVarsComplete(ec);
+                    return;
                 }
+                self.slaves.at(slaveID).slave->SetVariables(
+                    m_slaveConfigs[index].variableSettings,
+                    m_commTimeout,
+                    onSetVarsComplete);
             });
-        ++(opTally->ongoing);
+    }
+}
+
+
+void ReconfiguringExecutionState::Step(
+    ExecutionManagerPrivate& self,
+    coral::model::TimeDuration stepSize,
+    std::chrono::microseconds timeout,
+    ExecutionManager::StepHandler onComplete,
+    ExecutionManager::SlaveStepHandler onSlaveStepComplete)
+{
+    CORAL_PRECONDITION_CHECK(self.controlRouter);
+    CORAL_PRECONDITION_CHECK(!m_pendingStep);
+    m_pendingStep = std::make_unique<SteppingExecutionState>(
+        stepSize, timeout, std::move(onComplete), std::move(onSlaveStepComplete));
+    m_pendingStep->IssueCommands(self);
+}
+
+
+void ReconfiguringExecutionState::Completed(
+    ExecutionManagerPrivate& self,
+    bool failed)
+{
+    m_onComplete(failed
+        ? make_error_code(coral::error::generic_error::operation_failed)
+        : std::error_code{});
+    if (m_pendingStep) {
+        // The slaves whose SET_VARS failed have been disconnected, so the
+        // step will fail, and the STEPPING state takes care of the rest.
+        const auto keepMeAlive = self.SwapState(std::move(m_pendingStep));
+        assert(keepMeAlive.get() == this);
+    } else if (failed) {
+        self.SwapState(std::make_unique<FatalErrorExecutionState>());
+    } else {
+        self.SwapState(std::make_unique<ReadyExecutionState>());
     }
 }
 
@@ -546,7 +654,7 @@ namespace
 
 PrimingExecutionState::PrimingExecutionState(
     int maxAttempts,
-    std::chrono::milliseconds commTimeout,
+    std::chrono::microseconds commTimeout,
     std::function<void(const std::error_code&)> onComplete)
     : m_maxAttempts{maxAttempts}
     , m_commTimeout{commTimeout}
@@ -624,10 +732,12 @@ void PrimingExecutionState::Succeed(ExecutionManagerPrivate& self)
 
 SteppingExecutionState::SteppingExecutionState(
     coral::model::TimeDuration stepSize,
-    std::chrono::milliseconds timeout,
+    std::chrono::microseconds timeout,
     ExecutionManager::StepHandler onComplete,
-    ExecutionManager::SlaveStepHandler onSlaveStepComplete)
+    ExecutionManager::SlaveStepHandler onSlaveStepComplete,
+    bool acceptPrevious)
     : m_stepSize(stepSize),
+      m_acceptPrevious(acceptPrevious),
       m_timeout(timeout),
       m_onComplete(std::move(onComplete)),
       m_onSlaveStepComplete(std::move(onSlaveStepComplete))
@@ -635,26 +745,60 @@ SteppingExecutionState::SteppingExecutionState(
 }
 
 
-void SteppingExecutionState::StateEntered(ExecutionManagerPrivate& self)
+void SteppingExecutionState::IssueCommands(ExecutionManagerPrivate& self)
 {
-    const auto stepID = self.NextStepID();
+    assert(!m_issued);
+    m_issued = true;
+    m_stepID = self.NextStepID();
+    m_start = coral::trace::Clock::now();
+    const auto stepID = m_stepID;
+    const auto start = m_start;
+    const auto eventName = m_acceptPrevious ? "accept_and_step" : "step";
     for (auto it = begin(self.slaves); it != end(self.slaves); ++it) {
         const auto slaveID = it->first;
-        it->second.slave->Step(
-            stepID,
-            self.CurrentSimTime(),
-            m_stepSize,
-            m_timeout,
-            [&self, slaveID, this] (const std::error_code& ec) {
-                const auto onExit = coral::util::OnScopeExit([&self]() {
-                    self.SlaveOpComplete();
-                });
-                if (m_onSlaveStepComplete) m_onSlaveStepComplete(ec, slaveID);
+        auto onSlaveComplete = [&self, slaveID, stepID, start, eventName, this]
+            (const std::error_code& ec)
+        {
+            const auto onExit = coral::util::OnScopeExit([&self]() {
+                self.SlaveOpComplete();
             });
+            coral::trace::RecordAsyncEvent("master.slave", eventName, slaveID,
+                start, coral::trace::Clock::now(), "step", stepID);
+            if (!ec) self.RecordCommandTiming(slaveID);
+            if (m_onSlaveStepComplete) m_onSlaveStepComplete(ec, slaveID);
+        };
+        if (m_acceptPrevious) {
+            it->second.slave->AcceptStepAndStep(
+                stepID,
+                self.CurrentSimTime(),
+                m_stepSize,
+                m_timeout,
+                std::move(onSlaveComplete));
+        } else {
+            it->second.slave->Step(
+                stepID,
+                self.CurrentSimTime(),
+                m_stepSize,
+                m_timeout,
+                std::move(onSlaveComplete));
+        }
         self.SlaveOpStarted();
     }
-    self.WhenAllSlaveOpsComplete([&self, this] (const std::error_code& ec) {
+}
+
+
+void SteppingExecutionState::StateEntered(ExecutionManagerPrivate& self)
+{
+    if (!m_issued) IssueCommands(self);
+    const auto stepID = m_stepID;
+    const auto start = m_start;
+    const auto eventName = m_acceptPrevious ? "accept_and_step" : "step";
+    self.WhenAllSlaveOpsComplete([&self, stepID, start, eventName, this]
+        (const std::error_code& ec)
+    {
         assert(!ec);
+        coral::trace::RecordAsyncEvent("master", eventName, 0,
+            start, coral::trace::Clock::now(), "step", stepID);
         bool stepFailed = false;
         bool fatalError = false;
         for (auto it = begin(self.slaves); it != end(self.slaves); ++it) {
@@ -705,7 +849,7 @@ void StepOkExecutionState::Terminate(ExecutionManagerPrivate& self)
 
 void StepOkExecutionState::AcceptStep(
     ExecutionManagerPrivate& self,
-    std::chrono::milliseconds timeout,
+    std::chrono::microseconds timeout,
     ExecutionManager::AcceptStepHandler onComplete,
     ExecutionManager::SlaveAcceptStepHandler onSlaveAcceptStepComplete)
 {
@@ -715,11 +859,28 @@ void StepOkExecutionState::AcceptStep(
 }
 
 
+void StepOkExecutionState::AcceptStepAndStep(
+    ExecutionManagerPrivate& self,
+    coral::model::TimeDuration stepSize,
+    std::chrono::microseconds timeout,
+    ExecutionManager::StepHandler onComplete,
+    ExecutionManager::SlaveStepHandler onSlaveStepComplete)
+{
+    self.AdvanceSimTime(m_stepSize);
+    self.SwapState(std::make_unique<SteppingExecutionState>(
+        stepSize,
+        timeout,
+        std::move(onComplete),
+        std::move(onSlaveStepComplete),
+        true));
+}
+
+
 // =============================================================================
 
 
 AcceptingExecutionState::AcceptingExecutionState(
-    std::chrono::milliseconds timeout,
+    std::chrono::microseconds timeout,
     ExecutionManager::AcceptStepHandler onComplete,
     ExecutionManager::SlaveAcceptStepHandler onSlaveAcceptStepComplete)
     : m_timeout(timeout),
@@ -731,22 +892,28 @@ AcceptingExecutionState::AcceptingExecutionState(
 
 void AcceptingExecutionState::StateEntered(ExecutionManagerPrivate& self)
 {
+    const auto start = coral::trace::Clock::now();
     for (auto it = begin(self.slaves); it != end(self.slaves); ++it) {
         const auto slaveID = it->first;
         it->second.slave->AcceptStep(
             m_timeout,
-            [&self, slaveID, this] (const std::error_code& ec) {
+            [&self, slaveID, start, this] (const std::error_code& ec) {
                 const auto onExit = coral::util::OnScopeExit([&self]() {
                     self.SlaveOpComplete();
                 });
+                coral::trace::RecordAsyncEvent("master.slave", "accept", slaveID,
+                    start, coral::trace::Clock::now());
+                if (!ec) self.RecordCommandTiming(slaveID);
                 if (m_onSlaveAcceptStepComplete) {
                     m_onSlaveAcceptStepComplete(ec, slaveID);
                 }
             });
         self.SlaveOpStarted();
     }
-    self.WhenAllSlaveOpsComplete([&self, this] (const std::error_code& ec) {
+    self.WhenAllSlaveOpsComplete([&self, start, this] (const std::error_code& ec) {
         assert(!ec);
+        coral::trace::RecordAsyncEvent("master", "accept", 0,
+            start, coral::trace::Clock::now());
         bool error = false;
         for (auto it = begin(self.slaves); it != end(self.slaves); ++it) {
             if (it->second.slave->State() != SLAVE_READY) {
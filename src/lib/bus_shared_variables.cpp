@@ -0,0 +1,530 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include <coral/bus/shared_variables.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+#include <coral/net/ip.hpp>
+
+
+namespace coral
+{
+namespace bus
+{
+
+namespace
+{
+    // The header of a region.  The writer sets `magic` last of all, when the
+    // directory has been created.
+    struct RegionHeader
+    {
+        std::atomic<std::uint32_t> magic;
+        std::uint32_t version;
+        std::uint64_t size;
+        std::uint32_t slaveID;
+        std::uint32_t entryCount;
+        std::atomic<std::int64_t> lastStepID;
+    };
+
+    // A value, with its type and time step ID packed into `tag` so that both
+    // can be updated with one atomic store.
+    struct ValueVersion
+    {
+        std::atomic<std::uint64_t> tag;
+        std::atomic<std::uint64_t> bits;
+    };
+
+    // A directory entry.  Entries are sorted by variable ID.
+    struct RegionEntry
+    {
+        std::uint32_t variableID;
+        std::atomic<std::uint32_t> sequence;
+        ValueVersion versions[2];
+    };
+
+    static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2,
+        "Shared-memory variable regions require lock-free atomics");
+
+    const std::uint32_t REGION_MAGIC = 0x4C524F43; // "CORL"
+    const std::uint32_t REGION_VERSION = 1;
+    const std::size_t ENTRIES_OFFSET = (sizeof(RegionHeader) + 63) & ~std::size_t(63);
+
+    // How many times a reader retries a read which overlaps with a write
+    // before giving up (until the next call).
+    const int MAX_READ_ATTEMPTS = 1000;
+
+    enum ValueType : std::uint32_t
+    {
+        NO_VALUE = 0,
+        REAL_VALUE = 1,
+        INTEGER_VALUE = 2,
+        BOOLEAN_VALUE = 3,
+    };
+
+    std::uint64_t MakeTag(coral::model::StepID stepID, ValueType type)
+    {
+        return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(stepID)) << 32)
+            | type;
+    }
+
+    coral::model::StepID TagStepID(std::uint64_t tag)
+    {
+        return static_cast<coral::model::StepID>(static_cast<std::uint32_t>(tag >> 32));
+    }
+
+    ValueType TagType(std::uint64_t tag)
+    {
+        return static_cast<ValueType>(tag & 0xFFFFFFFFu);
+    }
+
+    // Encodes a non-string value as a type and a bit pattern.
+    class EncodeVisitor : public boost::static_visitor<ValueType>
+    {
+    public:
+        explicit EncodeVisitor(std::uint64_t& bits) : m_bits(bits) { }
+
+        ValueType operator()(double value) const
+        {
+            std::memcpy(&m_bits, &value, sizeof(value));
+            return REAL_VALUE;
+        }
+
+        ValueType operator()(int value) const
+        {
+            m_bits = static_cast<std::uint64_t>(static_cast<std::int64_t>(value));
+            return INTEGER_VALUE;
+        }
+
+        ValueType operator()(bool value) const
+        {
+            m_bits = value ? 1 : 0;
+            return BOOLEAN_VALUE;
+        }
+
+        ValueType operator()(const std::string&) const
+        {
+            return NO_VALUE;
+        }
+
+    private:
+        std::uint64_t& m_bits;
+    };
+
+    coral::model::ScalarValue Decode(ValueType type, std::uint64_t bits)
+    {
+        switch (type) {
+            case REAL_VALUE: {
+                double d;
+                std::memcpy(&d, &bits, sizeof(d));
+                return d;
+            }
+            case INTEGER_VALUE:
+                return static_cast<int>(static_cast<std::int64_t>(bits));
+            case BOOLEAN_VALUE:
+                return bits != 0;
+            default:
+                assert(false);
+                return coral::model::ScalarValue();
+        }
+    }
+
+    RegionEntry* Entries(void* region)
+    {
+        return reinterpret_cast<RegionEntry*>(
+            static_cast<char*>(region) + ENTRIES_OFFSET);
+    }
+
+    // Replaces any character which may not appear in a region name.
+    std::string SanitizeName(const std::string& s)
+    {
+        auto r = s;
+        for (auto& c : r) {
+            if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-') c = '_';
+        }
+        return r;
+    }
+}
+
+
+std::string SharedVariableRegionName(const coral::net::Endpoint& endpoint)
+{
+#ifdef _WIN32
+    return std::string();
+#else
+    // Names are limited to NAME_MAX characters, including the leading slash.
+    const std::size_t maxAddressLength = 200;
+    const auto transport = endpoint.Transport();
+    if (transport == "tcp") {
+        try {
+            const auto port = coral::net::ip::Endpoint{endpoint.Address()}.Port();
+            if (!port.IsNumber() || port.ToNumber() == 0) return std::string();
+            return "/coral-data-tcp-" + port.ToString();
+        } catch (const std::exception&) {
+            return std::string();
+        }
+    } else if (transport == "ipc" || transport == "inproc") {
+        const auto address = SanitizeName(endpoint.Address());
+        if (address.empty() || address.size() > maxAddressLength) return std::string();
+        return "/coral-data-" + transport + "-" + address;
+    }
+    return std::string();
+#endif
+}
+
+
+bool IsLocalEndpoint(const coral::net::Endpoint& endpoint)
+{
+    const auto transport = endpoint.Transport();
+    if (transport == "ipc" || transport == "inproc") return true;
+    if (transport != "tcp") return false;
+    try {
+        const auto address = coral::net::ip::Endpoint{endpoint.Address()}.Address();
+        if (address.ToString() == "localhost") return true;
+        if (address.IsName() || address.IsAnyAddress()) return false;
+        const auto inAddr = address.ToInAddr();
+        if ((ntohl(inAddr.s_addr) >> 24) == 127) return true;
+        for (const auto& iface : coral::net::ip::GetNetworkInterfaces()) {
+            if (iface.address.s_addr == inAddr.s_addr) return true;
+        }
+    } catch (const std::exception&) {
+    }
+    return false;
+}
+
+
+const std::size_t SharedVariableReader::NO_ENTRY;
+
+
+#ifdef _WIN32
+
+SharedVariableWriter::SharedVariableWriter(const std::string&)
+    : m_fd(-1), m_data(nullptr), m_size(0)
+{
+    throw std::runtime_error("Shared-memory variable regions are not supported on Windows");
+}
+
+SharedVariableWriter::~SharedVariableWriter() noexcept { }
+
+void SharedVariableWriter::Publish(
+    coral::model::StepID,
+    coral::model::SlaveID,
+    const std::pair<coral::model::VariableID, coral::model::ScalarValue>*,
+    std::size_t)
+{ }
+
+void SharedVariableWriter::InitializeDirectory(
+    coral::model::SlaveID,
+    const std::pair<coral::model::VariableID, coral::model::ScalarValue>*,
+    std::size_t)
+{ }
+
+std::unique_ptr<SharedVariableReader> SharedVariableReader::Open(const std::string&)
+{
+    return nullptr;
+}
+
+SharedVariableReader::SharedVariableReader(int fd, void* header)
+    : m_fd(fd), m_header(header), m_data(nullptr), m_size(0)
+{ }
+
+SharedVariableReader::~SharedVariableReader() noexcept { }
+
+bool SharedVariableReader::Ready() { return false; }
+
+coral::model::SlaveID SharedVariableReader::Slave() const
+{
+    return coral::model::INVALID_SLAVE_ID;
+}
+
+std::size_t SharedVariableReader::Find(coral::model::VariableID) const
+{
+    return NO_ENTRY;
+}
+
+bool SharedVariableReader::Read(
+    std::size_t,
+    coral::model::StepID,
+    coral::model::ScalarValue&) const
+{
+    return false;
+}
+
+#else // POSIX
+
+// =============================================================================
+// class SharedVariableWriter
+// =============================================================================
+
+SharedVariableWriter::SharedVariableWriter(const std::string& name)
+    : m_name(name)
+    , m_fd(-1)
+    , m_data(nullptr)
+    , m_size(sizeof(RegionHeader))
+{
+    shm_unlink(m_name.c_str());
+    m_fd = shm_open(m_name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+    if (m_fd == -1) {
+        throw std::runtime_error(
+            "Failed to create shared memory region " + m_name + ": "
+            + std::strerror(errno));
+    }
+    if (ftruncate(m_fd, m_size) == -1
+            || (m_data = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0))
+                == MAP_FAILED) {
+        const auto error = errno;
+        close(m_fd);
+        shm_unlink(m_name.c_str());
+        throw std::runtime_error(
+            "Failed to map shared memory region " + m_name + ": "
+            + std::strerror(error));
+    }
+    const auto header = new (m_data) RegionHeader;
+    header->version = REGION_VERSION;
+    header->size = m_size;
+    header->slaveID = coral::model::INVALID_SLAVE_ID;
+    header->entryCount = 0;
+    header->lastStepID.store(coral::model::INVALID_STEP_ID, std::memory_order_relaxed);
+    header->magic.store(0, std::memory_order_release);
+}
+
+
+SharedVariableWriter::~SharedVariableWriter() noexcept
+{
+    munmap(m_data, m_size);
+    close(m_fd);
+    shm_unlink(m_name.c_str());
+}
+
+
+void SharedVariableWriter::Publish(
+    coral::model::StepID stepID,
+    coral::model::SlaveID slaveID,
+    const std::pair<coral::model::VariableID, coral::model::ScalarValue>* values,
+    std::size_t count)
+{
+    auto header = static_cast<RegionHeader*>(m_data);
+    if (header->magic.load(std::memory_order_relaxed) != REGION_MAGIC) {
+        InitializeDirectory(slaveID, values, count);
+        header = static_cast<RegionHeader*>(m_data);
+    }
+    const auto entries = Entries(m_data);
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto it = m_entries.find(values[i].first);
+        if (it == m_entries.end()) continue;
+        std::uint64_t bits = 0;
+        const auto type = boost::apply_visitor(EncodeVisitor{bits}, values[i].second);
+        if (type == NO_VALUE) continue;
+
+        // Overwrite the value for this step if there is one, otherwise the
+        // older of the two.
+        auto& entry = entries[it->second];
+        const auto tag0 = entry.versions[0].tag.load(std::memory_order_relaxed);
+        const auto tag1 = entry.versions[1].tag.load(std::memory_order_relaxed);
+        int target;
+        if (TagType(tag0) != NO_VALUE && TagStepID(tag0) == stepID) target = 0;
+        else if (TagType(tag1) != NO_VALUE && TagStepID(tag1) == stepID) target = 1;
+        else if (TagType(tag0) == NO_VALUE) target = 0;
+        else if (TagType(tag1) == NO_VALUE) target = 1;
+        else target = TagStepID(tag0) < TagStepID(tag1) ? 0 : 1;
+
+        const auto seq = entry.sequence.load(std::memory_order_relaxed);
+        entry.sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        entry.versions[target].tag.store(MakeTag(stepID, type), std::memory_order_relaxed);
+        entry.versions[target].bits.store(bits, std::memory_order_relaxed);
+        entry.sequence.store(seq + 2, std::memory_order_release);
+    }
+    if (stepID > header->lastStepID.load(std::memory_order_relaxed)) {
+        header->lastStepID.store(stepID, std::memory_order_release);
+    }
+}
+
+
+void SharedVariableWriter::InitializeDirectory(
+    coral::model::SlaveID slaveID,
+    const std::pair<coral::model::VariableID, coral::model::ScalarValue>* values,
+    std::size_t count)
+{
+    std::vector<coral::model::VariableID> ids;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (!boost::get<std::string>(&values[i].second)) ids.push_back(values[i].first);
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+    const auto newSize = ENTRIES_OFFSET + ids.size() * sizeof(RegionEntry);
+    if (ftruncate(m_fd, newSize) == -1) {
+        throw std::runtime_error(
+            "Failed to resize shared memory region " + m_name + ": "
+            + std::strerror(errno));
+    }
+    const auto newData = mmap(nullptr, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (newData == MAP_FAILED) {
+        throw std::runtime_error(
+            "Failed to map shared memory region " + m_name + ": "
+            + std::strerror(errno));
+    }
+    munmap(m_data, m_size);
+    m_data = newData;
+    m_size = newSize;
+
+    const auto entries = Entries(m_data);
+    m_entries.clear();
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        const auto entry = new (&entries[i]) RegionEntry;
+        entry->variableID = ids[i];
+        entry->sequence.store(0, std::memory_order_relaxed);
+        for (auto& v : entry->versions) {
+            v.tag.store(MakeTag(coral::model::INVALID_STEP_ID, NO_VALUE), std::memory_order_relaxed);
+            v.bits.store(0, std::memory_order_relaxed);
+        }
+        m_entries[ids[i]] = i;
+    }
+    const auto header = static_cast<RegionHeader*>(m_data);
+    header->size = m_size;
+    header->slaveID = slaveID;
+    header->entryCount = static_cast<std::uint32_t>(ids.size());
+    header->magic.store(REGION_MAGIC, std::memory_order_release);
+}
+
+
+// =============================================================================
+// class SharedVariableReader
+// =============================================================================
+
+std::unique_ptr<SharedVariableReader> SharedVariableReader::Open(const std::string& name)
+{
+    if (name.empty()) return nullptr;
+    const auto fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd == -1) return nullptr;
+    struct stat st;
+    void* header = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) >= sizeof(RegionHeader)) {
+        header = mmap(nullptr, sizeof(RegionHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (header == MAP_FAILED) {
+        close(fd);
+        return nullptr;
+    }
+    return std::unique_ptr<SharedVariableReader>(new SharedVariableReader(fd, header));
+}
+
+
+SharedVariableReader::SharedVariableReader(int fd, void* header)
+    : m_fd(fd), m_header(header), m_data(nullptr), m_size(0)
+{
+}
+
+
+SharedVariableReader::~SharedVariableReader() noexcept
+{
+    if (m_data) munmap(m_data, m_size);
+    munmap(m_header, sizeof(RegionHeader));
+    close(m_fd);
+}
+
+
+bool SharedVariableReader::Ready()
+{
+    if (m_data) return true;
+    const auto header = static_cast<RegionHeader*>(m_header);
+    if (header->magic.load(std::memory_order_acquire) != REGION_MAGIC
+            || header->version != REGION_VERSION) {
+        return false;
+    }
+    const auto size = static_cast<std::size_t>(header->size);
+    const auto data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (data == MAP_FAILED) return false;
+    m_data = data;
+    m_size = size;
+    return true;
+}
+
+
+coral::model::SlaveID SharedVariableReader::Slave() const
+{
+    assert(m_data);
+    return static_cast<coral::model::SlaveID>(
+        static_cast<const RegionHeader*>(m_data)->slaveID);
+}
+
+
+std::size_t SharedVariableReader::Find(coral::model::VariableID variable) const
+{
+    assert(m_data);
+    const auto header = static_cast<const RegionHeader*>(m_data);
+    const auto begin = Entries(m_data);
+    const auto end = begin + header->entryCount;
+    const auto it = std::lower_bound(begin, end, variable,
+        [] (const RegionEntry& e, coral::model::VariableID id) {
+            return e.variableID < id;
+        });
+    if (it == end || it->variableID != variable) return NO_ENTRY;
+    return static_cast<std::size_t>(it - begin);
+}
+
+
+bool SharedVariableReader::Read(
+    std::size_t entryIndex,
+    coral::model::StepID stepID,
+    coral::model::ScalarValue& value) const
+{
+    assert(m_data);
+    const auto header = static_cast<RegionHeader*>(m_data);
+    assert(entryIndex < header->entryCount);
+    if (header->lastStepID.load(std::memory_order_acquire) < stepID) return false;
+
+    auto& entry = Entries(m_data)[entryIndex];
+    for (int attempt = 0; attempt < MAX_READ_ATTEMPTS; ++attempt) {
+        const auto seq1 = entry.sequence.load(std::memory_order_acquire);
+        if (seq1 & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+        std::uint64_t tags[2], bits[2];
+        for (int i = 0; i < 2; ++i) {
+            tags[i] = entry.versions[i].tag.load(std::memory_order_relaxed);
+            bits[i] = entry.versions[i].bits.load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (entry.sequence.load(std::memory_order_relaxed) != seq1) continue;
+
+        // Since the writer has finished step `stepID`, the newest value from
+        // that step or earlier is the one the variable had in that step.
+        int best = -1;
+        for (int i = 0; i < 2; ++i) {
+            if (TagType(tags[i]) == NO_VALUE || TagStepID(tags[i]) > stepID) continue;
+            if (best < 0 || TagStepID(tags[i]) > TagStepID(tags[best])) best = i;
+        }
+        if (best < 0) return false;
+        value = Decode(TagType(tags[best]), bits[best]);
+        return true;
+    }
+    return false;
+}
+
+#endif // _WIN32
+
+
+}} // namespace
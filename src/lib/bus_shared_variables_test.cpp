@@ -0,0 +1,98 @@
+#include <string>
+#include <utility>
+
+#include <gtest/gtest.h>
+
+#include <coral/bus/shared_variables.hpp>
+
+
+using namespace coral::bus;
+typedef std::pair<coral::model::VariableID, coral::model::ScalarValue> Value;
+
+
+TEST(coral_bus, SharedVariableRegionName)
+{
+#ifdef _WIN32
+    EXPECT_TRUE(SharedVariableRegionName(coral::net::Endpoint{"tcp://*:1234"}).empty());
+#else
+    EXPECT_EQ("/coral-data-tcp-1234",
+        SharedVariableRegionName(coral::net::Endpoint{"tcp://*:1234"}));
+    EXPECT_EQ("/coral-data-inproc-foo_bar",
+        SharedVariableRegionName(coral::net::Endpoint{"inproc://foo.bar"}));
+#endif
+    EXPECT_TRUE(SharedVariableRegionName(coral::net::Endpoint{"tcp://*:*"}).empty());
+    EXPECT_TRUE(SharedVariableRegionName(coral::net::Endpoint{"pgm://foo"}).empty());
+}
+
+
+TEST(coral_bus, IsLocalEndpoint)
+{
+    EXPECT_TRUE(IsLocalEndpoint(coral::net::Endpoint{"tcp://localhost:1234"}));
+    EXPECT_TRUE(IsLocalEndpoint(coral::net::Endpoint{"tcp://127.0.0.1:1234"}));
+    EXPECT_TRUE(IsLocalEndpoint(coral::net::Endpoint{"inproc://foo"}));
+    EXPECT_FALSE(IsLocalEndpoint(coral::net::Endpoint{"tcp://192.0.2.1:1234"}));
+}
+
+
+#ifndef _WIN32
+TEST(coral_bus, SharedVariableWriterReader)
+{
+    const auto name = std::string("/coral-test-shared-variables");
+    EXPECT_FALSE(SharedVariableReader::Open(name));
+    SharedVariableWriter writer(name);
+    auto reader = SharedVariableReader::Open(name);
+    ASSERT_TRUE(reader);
+    EXPECT_FALSE(reader->Ready());
+
+    // The directory is created from the first values, minus strings.
+    const Value values0[] = {
+        { 3, 1.5 }, { 1, 7 }, { 2, true }, { 4, std::string("foo") }
+    };
+    writer.Publish(0, 5, values0, 4);
+    ASSERT_TRUE(reader->Ready());
+    EXPECT_EQ(5, reader->Slave());
+    EXPECT_EQ(SharedVariableReader::NO_ENTRY, reader->Find(4));
+    EXPECT_EQ(SharedVariableReader::NO_ENTRY, reader->Find(9));
+    const auto entry1 = reader->Find(1);
+    const auto entry2 = reader->Find(2);
+    const auto entry3 = reader->Find(3);
+    ASSERT_NE(SharedVariableReader::NO_ENTRY, entry1);
+    ASSERT_NE(SharedVariableReader::NO_ENTRY, entry2);
+    ASSERT_NE(SharedVariableReader::NO_ENTRY, entry3);
+
+    coral::model::ScalarValue value;
+    ASSERT_TRUE(reader->Read(entry1, 0, value));
+    EXPECT_EQ(7, boost::get<int>(value));
+    ASSERT_TRUE(reader->Read(entry2, 0, value));
+    EXPECT_TRUE(boost::get<bool>(value));
+    ASSERT_TRUE(reader->Read(entry3, 0, value));
+    EXPECT_EQ(1.5, boost::get<double>(value));
+    EXPECT_FALSE(reader->Read(entry1, 1, value));
+
+    // Values which are not written are unchanged.
+    const Value values1[] = { { 3, 2.5 } };
+    writer.Publish(1, 5, values1, 1);
+    ASSERT_TRUE(reader->Read(entry1, 1, value));
+    EXPECT_EQ(7, boost::get<int>(value));
+    ASSERT_TRUE(reader->Read(entry3, 1, value));
+    EXPECT_EQ(2.5, boost::get<double>(value));
+
+    // The reader may be one step behind the writer.
+    const Value values2[] = { { 3, 3.5 }, { 1, -8 } };
+    writer.Publish(2, 5, values2, 2);
+    ASSERT_TRUE(reader->Read(entry3, 1, value));
+    EXPECT_EQ(2.5, boost::get<double>(value));
+    ASSERT_TRUE(reader->Read(entry1, 1, value));
+    EXPECT_EQ(7, boost::get<int>(value));
+    ASSERT_TRUE(reader->Read(entry1, 2, value));
+    EXPECT_EQ(-8, boost::get<int>(value));
+
+    // Values which are republished for the same step are replaced.
+    const Value values2b[] = { { 1, -9 } };
+    writer.Publish(2, 5, values2b, 1);
+    ASSERT_TRUE(reader->Read(entry1, 1, value));
+    EXPECT_EQ(7, boost::get<int>(value));
+    ASSERT_TRUE(reader->Read(entry1, 2, value));
+    EXPECT_EQ(-9, boost::get<int>(value));
+}
+#endif
@@ -6,7 +6,10 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 */
 #include <coral/bus/slave_agent.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
 #include <limits>
 #include <utility>
 
@@ -17,6 +20,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include <coral/protocol/execution.hpp>
 #include <coral/protocol/glue.hpp>
 #include <coral/slave/exception.hpp>
+#include <coral/trace.hpp>
 #include <coral/util.hpp>
 
 
@@ -45,6 +49,13 @@ namespace
     }
 
     const size_t DATA_HEADER_SIZE = 4;
+
+    std::uint64_t MicrosecondsSince(std::chrono::steady_clock::time_point t)
+    {
+        return static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - t).count());
+    }
 }
 
 
@@ -59,13 +70,18 @@ SlaveAgent::SlaveAgent(
     coral::slave::Instance& slaveInstance,
     const coral::net::Endpoint& controlEndpoint,
     const coral::net::Endpoint& dataPubEndpoint,
-    std::chrono::milliseconds masterInactivityTimeout)
+    std::chrono::milliseconds masterInactivityTimeout,
+    const coral::slave::PublishOptions& publishOptions)
     : m_stateHandler(&SlaveAgent::NotConnectedHandler),
       m_slaveInstance(slaveInstance),
       m_masterInactivityTimeout(reactor, masterInactivityTimeout),
       m_variableRecvTimeout(std::chrono::seconds(1)),
+      m_protocol(0),
       m_id(coral::model::INVALID_SLAVE_ID),
-      m_currentStepID(coral::model::INVALID_STEP_ID)
+      m_currentStepID(coral::model::INVALID_STEP_ID),
+      m_syncTraceClock(false),
+      m_publishOptions(publishOptions),
+      m_stepsSinceKeyframe(0)
 {
     m_control.Bind(controlEndpoint);
     CORAL_LOG_TRACE("Slave bound to control endpoint: " + BoundControlEndpoint().URL());
@@ -120,6 +136,8 @@ coral::net::Endpoint SlaveAgent::BoundDataPubEndpoint() const
 
 void SlaveAgent::RequestReply(std::vector<zmq::message_t>& msg)
 {
+    m_requestTime = std::chrono::steady_clock::now();
+    m_stepTiming.Clear();
     (this->*m_stateHandler)(msg);
 }
 
@@ -127,11 +145,25 @@ void SlaveAgent::RequestReply(std::vector<zmq::message_t>& msg)
 void SlaveAgent::NotConnectedHandler(std::vector<zmq::message_t>& msg)
 {
     CORAL_LOG_TRACE("NOT CONNECTED state: incoming message");
-    if (coral::protocol::execution::ParseHelloMessage(msg) != 0) {
+    const auto requestedProtocol = coral::protocol::execution::ParseHelloMessage(msg);
+    if (requestedProtocol > coral::protocol::execution::MAX_PROTOCOL_VERSION) {
         throw std::runtime_error("Master required unsupported protocol");
     }
-    CORAL_LOG_TRACE("Received HELLO");
-    coral::protocol::execution::CreateHelloMessage(msg, 0);
+    // A master which supports newer protocol versions lists the highest one
+    // in the message body, while still requesting version 0 in the header.
+    m_protocol = requestedProtocol;
+    if (msg.size() > 1) {
+        coralproto::execution::HelloData data;
+        coral::protobuf::ParseFromFrame(msg[1], data);
+        if (data.has_max_protocol() && data.max_protocol() > m_protocol) {
+            m_protocol = static_cast<std::uint16_t>(std::min<std::uint32_t>(
+                data.max_protocol(),
+                coral::protocol::execution::MAX_PROTOCOL_VERSION));
+        }
+    }
+    CORAL_LOG_TRACE(boost::format("Received HELLO, using protocol version %d")
+        % m_protocol);
+    coral::protocol::execution::CreateHelloMessage(msg, m_protocol);
     m_stateHandler = &SlaveAgent::ConnectedHandler;
 }
 
@@ -150,6 +182,13 @@ void SlaveAgent::ConnectedHandler(std::vector<zmq::message_t>& msg)
         % data.start_time()
         % (data.has_stop_time() ? data.stop_time() : std::numeric_limits<double>::infinity()));
     m_id = data.slave_id();
+    if (data.trace() && !coral::trace::Enabled()) {
+        // If tracing is already enabled, we share the process (and the
+        // trace clock) with the master.
+        coral::trace::Enable();
+        coral::trace::SetProcessName(data.slave_name());
+        m_syncTraceClock = true;
+    }
     m_slaveInstance.Setup(
         data.slave_name(),
         data.execution_name(),
@@ -158,7 +197,25 @@ void SlaveAgent::ConnectedHandler(std::vector<zmq::message_t>& msg)
         false,
         1.0 /* not used */);
 
-    if (data.has_variable_recv_timeout_ms()) {
+    // The set of output variables never changes, so we determine it (and
+    // the publish policies) once and for all here, rather than in every
+    // PublishOutputs() call.
+    const auto typeDescription = m_slaveInstance.TypeDescription();
+    std::unordered_map<coral::model::VariableID, coral::slave::PublishPolicy> policies;
+    m_outputs.Clear();
+    for (const auto& varInfo : typeDescription.Variables()) {
+        if (varInfo.Causality() == coral::model::OUTPUT_CAUSALITY) {
+            m_outputs.Add(varInfo.ID(), varInfo.DataType());
+            policies[varInfo.ID()] = m_publishOptions.PolicyFor(varInfo);
+        }
+    }
+    m_outputs.Prepare(m_slaveInstance);
+    m_outputFilter.Reset(m_outputs, policies);
+
+    if (data.has_variable_recv_timeout_us()) {
+        m_variableRecvTimeout =
+            std::chrono::microseconds(data.variable_recv_timeout_us());
+    } else if (data.has_variable_recv_timeout_ms()) {
         m_variableRecvTimeout =
             std::chrono::milliseconds(data.variable_recv_timeout_ms());
     }
@@ -172,21 +229,9 @@ void SlaveAgent::ReadyHandler(std::vector<zmq::message_t>& msg)
 {
     CORAL_LOG_TRACE("READY state: incoming message");
     switch (NormalMessageType(msg)) {
-        case coralproto::execution::MSG_STEP: {
-            if (msg.size() != 2) {
-                throw coral::error::ProtocolViolationException(
-                    "Wrong number of frames in STEP message");
-            }
-            coralproto::execution::StepData stepData;
-            coral::protobuf::ParseFromFrame(msg[1], stepData);
-            if (Step(stepData)) {
-                coral::protocol::execution::CreateMessage(msg, coralproto::execution::MSG_STEP_OK);
-                m_stateHandler = &SlaveAgent::PublishedHandler;
-            } else {
-                coral::protocol::execution::CreateMessage(msg, coralproto::execution::MSG_STEP_FAILED);
-                m_stateHandler = &SlaveAgent::StepFailedHandler;
-            }
-            break; }
+        case coralproto::execution::MSG_STEP:
+            HandleStep(msg);
+            break;
         case coralproto::execution::MSG_SET_VARS:
             HandleSetVars(msg);
             break;
@@ -208,13 +253,67 @@ void SlaveAgent::ReadyHandler(std::vector<zmq::message_t>& msg)
 void SlaveAgent::PublishedHandler(std::vector<zmq::message_t>& msg)
 {
     CORAL_LOG_TRACE("STEP OK state: incoming message");
-    EnforceMessageType(msg, coralproto::execution::MSG_ACCEPT_STEP);
+    switch (NormalMessageType(msg)) {
+        case coralproto::execution::MSG_ACCEPT_STEP:
+            UpdateInputs();
+            CreateTimedReply(msg, coralproto::execution::MSG_READY);
+            m_stateHandler = &SlaveAgent::ReadyHandler;
+            break;
+        case coralproto::execution::MSG_ACCEPT_STEP_AND_STEP:
+            if (m_protocol < 1) InvalidReplyFromMaster();
+            UpdateInputs();
+            HandleStep(msg);
+            break;
+        default:
+            InvalidReplyFromMaster();
+    }
+}
+
+
+void SlaveAgent::HandleStep(std::vector<zmq::message_t>& msg)
+{
+    if (msg.size() != 2) {
+        throw coral::error::ProtocolViolationException(
+            "Wrong number of frames in STEP message");
+    }
+    coralproto::execution::StepData stepData;
+    coral::protobuf::ParseFromFrame(msg[1], stepData);
+    if (m_syncTraceClock && stepData.has_trace_clock_ns()) {
+        coral::trace::AddClockOffsetSample(std::chrono::nanoseconds(
+            stepData.trace_clock_ns() - coral::trace::ClockNanoseconds(m_requestTime)));
+    }
+    if (Step(stepData)) {
+        CreateTimedReply(msg, coralproto::execution::MSG_STEP_OK);
+        m_stateHandler = &SlaveAgent::PublishedHandler;
+    } else {
+        coral::protocol::execution::CreateMessage(msg, coralproto::execution::MSG_STEP_FAILED);
+        m_stateHandler = &SlaveAgent::StepFailedHandler;
+    }
+}
+
+
+void SlaveAgent::UpdateInputs()
+{
+    CORAL_TRACE_SCOPE("slave", "receive", "step", m_currentStepID);
     // TODO: Use a different timeout here?
+    const auto start = std::chrono::steady_clock::now();
     if (!m_connections.Update(m_slaveInstance, m_currentStepID, m_variableRecvTimeout)) {
         throw std::runtime_error("Timeout waiting for variable values from other slaves");
     }
-    coral::protocol::execution::CreateMessage(msg, coralproto::execution::MSG_READY);
-    m_stateHandler = &SlaveAgent::ReadyHandler;
+    m_stepTiming.set_input_wait_us(MicrosecondsSince(start));
+}
+
+
+void SlaveAgent::CreateTimedReply(
+    std::vector<zmq::message_t>& msg,
+    coralproto::execution::MessageType type)
+{
+    if (m_protocol >= 2) {
+        m_stepTiming.set_busy_us(MicrosecondsSince(m_requestTime));
+        coral::protocol::execution::CreateMessage(msg, type, m_stepTiming);
+    } else {
+        coral::protocol::execution::CreateMessage(msg, type);
+    }
 }
 
 
@@ -279,6 +378,7 @@ void SlaveAgent::HandleSetVars(std::vector<zmq::message_t>& msg)
             "Wrong number of frames in SET_VARS message");
     }
     CORAL_LOG_DEBUG("Setting/connecting variables");
+    CORAL_TRACE_SCOPE("slave", "set_vars");
     coralproto::execution::SetVarsData data;
     coral::protobuf::ParseFromFrame(msg[1], data);
 
@@ -338,11 +438,11 @@ void SlaveAgent::HandleSetPeers(std::vector<zmq::message_t>& msg)
 void SlaveAgent::HandleResendVars(std::vector<zmq::message_t>& msg)
 {
     // Publish all own variable values
-    PublishAll();
+    PublishOutputs(true);
 
     // Wait for all values from others
     CORAL_LOG_TRACE(
-        boost::format("Waiting for variable values (timeout = %d ms)")
+        boost::format("Waiting for variable values (timeout = %d us)")
         % m_variableRecvTimeout.count());
     if (m_connections.Update(m_slaveInstance, m_currentStepID, m_variableRecvTimeout)) {
         coral::protocol::execution::CreateMessage(msg, coralproto::execution::MSG_READY);
@@ -357,54 +457,323 @@ void SlaveAgent::HandleResendVars(std::vector<zmq::message_t>& msg)
 }
 
 
-namespace
-{
-    coral::model::ScalarValue GetVariable(
-        const coral::slave::Instance& slave,
-        const coral::model::VariableDescription& variable)
-    {
-        switch (variable.DataType()) {
-            case coral::model::REAL_DATATYPE:
-                return slave.GetRealVariable(variable.ID());
-            case coral::model::INTEGER_DATATYPE:
-                return slave.GetIntegerVariable(variable.ID());
-            case coral::model::BOOLEAN_DATATYPE:
-                return slave.GetBooleanVariable(variable.ID());
-            case coral::model::STRING_DATATYPE:
-                return slave.GetStringVariable(variable.ID());
-            default:
-                assert (!"Variable has unknown data type");
-                return coral::model::ScalarValue();
-        }
-    }
-}
-
-
 bool SlaveAgent::Step(const coralproto::execution::StepData& stepInfo)
 {
     if (m_currentStepID == coral::model::INVALID_STEP_ID) {
         m_slaveInstance.StartSimulation();
     }
     m_currentStepID = stepInfo.step_id();
-    if (!m_slaveInstance.DoStep(stepInfo.timepoint(), stepInfo.stepsize())) {
-        return false;
+    CORAL_TRACE_SCOPE("slave", "step", "step", m_currentStepID);
+    auto start = std::chrono::steady_clock::now();
+    const auto stepOK =
+        m_slaveInstance.DoStep(stepInfo.timepoint(), stepInfo.stepsize());
+    if (coral::trace::Enabled()) {
+        coral::trace::RecordEvent("fmi", "DoStep", start, coral::trace::Clock::now());
     }
-    PublishAll();
+    if (!stepOK) return false;
+    m_stepTiming.set_do_step_us(MicrosecondsSince(start));
+    start = std::chrono::steady_clock::now();
+    PublishOutputs(false);
+    m_stepTiming.set_publish_us(MicrosecondsSince(start));
     return true;
 }
 
 
-void SlaveAgent::PublishAll()
+void SlaveAgent::PublishOutputs(bool all)
 {
     CORAL_LOG_TRACE("Publishing output variable values");
-    const auto typeDescription = m_slaveInstance.TypeDescription();
-    for (const auto& varInfo : typeDescription.Variables()) {
-        if (varInfo.Causality() != coral::model::OUTPUT_CAUSALITY) continue;
-        m_publisher.Publish(
-            m_currentStepID,
-            m_id,
-            varInfo.ID(),
-            GetVariable(m_slaveInstance, varInfo));
+    CORAL_TRACE_SCOPE("slave", "publish", "step", m_currentStepID);
+    if (m_publishOptions.keyframeInterval > 0
+            && ++m_stepsSinceKeyframe >= m_publishOptions.keyframeInterval) {
+        all = true;
+    }
+    if (all) m_stepsSinceKeyframe = 0;
+
+    m_outputs.GetValues(m_slaveInstance);
+    m_outputValues.clear();
+    m_outputFilter.Select(m_outputs, all, m_outputValues);
+    // Note: We publish a batch even if it is empty, unless there are no
+    // outputs at all, because it tells subscribers that our other outputs
+    // are unchanged.
+    if (m_outputs.Empty()) return;
+    m_publisher.Publish(
+        m_currentStepID,
+        m_id,
+        m_outputValues.data(),
+        m_outputValues.size());
+}
+
+
+// =============================================================================
+// class SlaveAgent::TypedVariables
+// =============================================================================
+
+void SlaveAgent::TypedVariables::Clear()
+{
+    m_realIDs.clear();
+    m_realValues.clear();
+    m_integerIDs.clear();
+    m_integerValues.clear();
+    m_booleanIDs.clear();
+    m_stringIDs.clear();
+    m_stringValues.clear();
+    m_realList.reset();
+    m_integerList.reset();
+    m_booleanList.reset();
+    m_stringList.reset();
+}
+
+
+bool SlaveAgent::TypedVariables::Empty() const
+{
+    return m_realIDs.empty() && m_integerIDs.empty()
+        && m_booleanIDs.empty() && m_stringIDs.empty();
+}
+
+
+void SlaveAgent::TypedVariables::Add(
+    coral::model::VariableID id,
+    coral::model::DataType dataType)
+{
+    switch (dataType) {
+        case coral::model::REAL_DATATYPE:
+            m_realIDs.push_back(id);
+            m_realList.reset();
+            break;
+        case coral::model::INTEGER_DATATYPE:
+            m_integerIDs.push_back(id);
+            m_integerList.reset();
+            break;
+        case coral::model::BOOLEAN_DATATYPE:
+            m_booleanIDs.push_back(id);
+            m_booleanList.reset();
+            break;
+        case coral::model::STRING_DATATYPE:
+            m_stringIDs.push_back(id);
+            m_stringList.reset();
+            break;
+        default:
+            assert (!"Variable has unknown data type");
+    }
+}
+
+
+void SlaveAgent::TypedVariables::Add(
+    coral::model::VariableID id,
+    const coral::model::ScalarValue& value)
+{
+    if (const auto r = boost::get<double>(&value)) {
+        m_realIDs.push_back(id);
+        m_realValues.push_back(*r);
+        m_realList.reset();
+    } else if (const auto i = boost::get<int>(&value)) {
+        m_integerIDs.push_back(id);
+        m_integerValues.push_back(*i);
+        m_integerList.reset();
+    } else if (const auto b = boost::get<bool>(&value)) {
+        m_booleanIDs.push_back(id);
+        ReserveBooleanValues();
+        m_booleanValues[m_booleanIDs.size() - 1] = *b;
+        m_booleanList.reset();
+    } else {
+        m_stringIDs.push_back(id);
+        m_stringValues.push_back(boost::get<std::string>(value));
+        m_stringList.reset();
+    }
+}
+
+
+void SlaveAgent::TypedVariables::Prepare(
+    const coral::slave::Instance& slaveInstance)
+{
+    m_realList = slaveInstance.PrepareVariables(
+        coral::model::REAL_DATATYPE, m_realIDs);
+    m_integerList = slaveInstance.PrepareVariables(
+        coral::model::INTEGER_DATATYPE, m_integerIDs);
+    m_booleanList = slaveInstance.PrepareVariables(
+        coral::model::BOOLEAN_DATATYPE, m_booleanIDs);
+    m_stringList = slaveInstance.PrepareVariables(
+        coral::model::STRING_DATATYPE, m_stringIDs);
+}
+
+
+void SlaveAgent::TypedVariables::GetValues(
+    const coral::slave::Instance& slaveInstance)
+{
+    CORAL_TRACE_SCOPE("fmi", "GetVariables");
+    assert(m_realList && m_integerList && m_booleanList && m_stringList);
+    m_realValues.resize(m_realIDs.size());
+    slaveInstance.GetRealVariables(*m_realList, m_realValues.data());
+    m_integerValues.resize(m_integerIDs.size());
+    slaveInstance.GetIntegerVariables(*m_integerList, m_integerValues.data());
+    ReserveBooleanValues();
+    slaveInstance.GetBooleanVariables(*m_booleanList, m_booleanValues.get());
+    m_stringValues.resize(m_stringIDs.size());
+    slaveInstance.GetStringVariables(*m_stringList, m_stringValues.data());
+}
+
+
+bool SlaveAgent::TypedVariables::SetValues(
+    coral::slave::Instance& slaveInstance)
+{
+    CORAL_TRACE_SCOPE("fmi", "SetVariables");
+    assert(m_realList && m_integerList && m_booleanList && m_stringList);
+    assert(m_realValues.size() == m_realIDs.size());
+    assert(m_integerValues.size() == m_integerIDs.size());
+    assert(m_booleanCapacity >= m_booleanIDs.size());
+    assert(m_stringValues.size() == m_stringIDs.size());
+    // Note: Bitwise "and" because we want all the functions to be called.
+    return slaveInstance.SetRealVariables(*m_realList, m_realValues.data())
+        & slaveInstance.SetIntegerVariables(*m_integerList, m_integerValues.data())
+        & slaveInstance.SetBooleanVariables(*m_booleanList, m_booleanValues.get())
+        & slaveInstance.SetStringVariables(*m_stringList, m_stringValues.data());
+}
+
+
+void SlaveAgent::TypedVariables::ReceiveValues(
+    const coral::bus::VariableSubscriber& subscriber,
+    const SubscriberSlots& slots)
+{
+    assert(slots.real.size() == m_realIDs.size());
+    assert(slots.integer.size() == m_integerIDs.size());
+    assert(slots.boolean.size() == m_booleanIDs.size());
+    assert(slots.string.size() == m_stringIDs.size());
+    for (std::size_t i = 0; i < slots.real.size(); ++i) {
+        m_realValues[i] = boost::get<double>(subscriber.Value(slots.real[i]));
+    }
+    for (std::size_t i = 0; i < slots.integer.size(); ++i) {
+        m_integerValues[i] = boost::get<int>(subscriber.Value(slots.integer[i]));
+    }
+    for (std::size_t i = 0; i < slots.boolean.size(); ++i) {
+        m_booleanValues[i] = boost::get<bool>(subscriber.Value(slots.boolean[i]));
+    }
+    for (std::size_t i = 0; i < slots.string.size(); ++i) {
+        m_stringValues[i] = boost::get<std::string>(subscriber.Value(slots.string[i]));
+    }
+}
+
+
+void SlaveAgent::TypedVariables::ReserveBooleanValues()
+{
+    if (m_booleanCapacity >= m_booleanIDs.size()) return;
+    const auto newCapacity = std::max(m_booleanIDs.size(), 2 * m_booleanCapacity);
+    auto newValues = std::make_unique<bool[]>(newCapacity);
+    std::copy_n(m_booleanValues.get(), m_booleanCapacity, newValues.get());
+    m_booleanValues = std::move(newValues);
+    m_booleanCapacity = newCapacity;
+}
+
+
+// =============================================================================
+// class SlaveAgent::OutputFilter
+// =============================================================================
+
+void SlaveAgent::OutputFilter::Reset(
+    const TypedVariables& outputs,
+    const std::unordered_map<coral::model::VariableID, coral::slave::PublishPolicy>&
+        policies)
+{
+    const auto always = [&policies] (coral::model::VariableID id) {
+        return static_cast<char>(!policies.at(id).onChange);
+    };
+    m_realAlways.clear();
+    m_realAbsolute.clear();
+    m_realRelative.clear();
+    for (const auto id : outputs.m_realIDs) {
+        const auto& policy = policies.at(id);
+        m_realAlways.push_back(always(id));
+        m_realAbsolute.push_back(policy.onChange ? policy.absoluteDeadband : 0.0);
+        m_realRelative.push_back(policy.onChange ? policy.relativeDeadband : 0.0);
+    }
+    m_integerAlways.clear();
+    for (const auto id : outputs.m_integerIDs) m_integerAlways.push_back(always(id));
+    m_booleanAlways.clear();
+    for (const auto id : outputs.m_booleanIDs) m_booleanAlways.push_back(always(id));
+    m_stringAlways.clear();
+    for (const auto id : outputs.m_stringIDs) m_stringAlways.push_back(always(id));
+
+    m_lastReals.assign(outputs.m_realIDs.size(), 0.0);
+    m_lastIntegers.assign(outputs.m_integerIDs.size(), 0);
+    m_lastBooleans.assign(outputs.m_booleanIDs.size(), 0);
+    m_lastStrings.assign(outputs.m_stringIDs.size(), std::string());
+    m_hasPublished = false;
+}
+
+
+void SlaveAgent::OutputFilter::Select(
+    const TypedVariables& outputs,
+    bool all,
+    std::vector<std::pair<coral::model::VariableID, coral::model::ScalarValue>>& out)
+{
+    // Nothing has been published yet, so there are no values to compare with.
+    if (!m_hasPublished) all = true;
+    m_hasPublished = true;
+
+    const auto realCount = outputs.m_realIDs.size();
+    assert(outputs.m_realValues.size() == realCount);
+    m_publish.resize(realCount);
+    {
+        const double* values = outputs.m_realValues.data();
+        const double* last = m_lastReals.data();
+        const char* always = m_realAlways.data();
+        const double* absolute = m_realAbsolute.data();
+        const double* relative = m_realRelative.data();
+        char* publish = m_publish.data();
+        for (std::size_t i = 0; i < realCount; ++i) {
+            const double threshold = std::max(absolute[i], relative[i] * std::abs(last[i]));
+            // Written so that a change to or from NaN counts as a change.
+            publish[i] = static_cast<char>(
+                all | always[i] | !(std::abs(values[i] - last[i]) <= threshold));
+        }
+    }
+    for (std::size_t i = 0; i < realCount; ++i) {
+        if (m_publish[i]) {
+            out.emplace_back(outputs.m_realIDs[i], outputs.m_realValues[i]);
+            m_lastReals[i] = outputs.m_realValues[i];
+        }
+    }
+
+    const auto integerCount = outputs.m_integerIDs.size();
+    m_publish.resize(integerCount);
+    {
+        const int* values = outputs.m_integerValues.data();
+        const int* last = m_lastIntegers.data();
+        const char* always = m_integerAlways.data();
+        char* publish = m_publish.data();
+        for (std::size_t i = 0; i < integerCount; ++i) {
+            publish[i] = static_cast<char>(all | always[i] | (values[i] != last[i]));
+        }
+    }
+    for (std::size_t i = 0; i < integerCount; ++i) {
+        if (m_publish[i]) {
+            out.emplace_back(outputs.m_integerIDs[i], outputs.m_integerValues[i]);
+            m_lastIntegers[i] = outputs.m_integerValues[i];
+        }
+    }
+
+    const auto booleanCount = outputs.m_booleanIDs.size();
+    m_publish.resize(booleanCount);
+    {
+        const bool* values = outputs.m_booleanValues.get();
+        const char* last = m_lastBooleans.data();
+        const char* always = m_booleanAlways.data();
+        char* publish = m_publish.data();
+        for (std::size_t i = 0; i < booleanCount; ++i) {
+            publish[i] = static_cast<char>(all | always[i] | (values[i] != (last[i] != 0)));
+        }
+    }
+    for (std::size_t i = 0; i < booleanCount; ++i) {
+        if (m_publish[i]) {
+            out.emplace_back(outputs.m_booleanIDs[i], outputs.m_booleanValues[i]);
+            m_lastBooleans[i] = static_cast<char>(outputs.m_booleanValues[i]);
+        }
+    }
+
+    for (std::size_t i = 0; i < outputs.m_stringIDs.size(); ++i) {
+        if (all || m_stringAlways[i] || outputs.m_stringValues[i] != m_lastStrings[i]) {
+            out.emplace_back(outputs.m_stringIDs[i], outputs.m_stringValues[i]);
+            m_lastStrings[i] = outputs.m_stringValues[i];
+        }
     }
 }
 
@@ -479,6 +848,7 @@ void SlaveAgent::Connections::Couple(
     if (!remoteOutput.Empty()) {
         m_subscriber.Subscribe(remoteOutput);
         m_connections.insert(ConnectionBimap::value_type(remoteOutput, localInput));
+        m_compiled = false;
     }
 }
 
@@ -486,13 +856,16 @@ void SlaveAgent::Connections::Couple(
 bool SlaveAgent::Connections::Update(
     coral::slave::Instance& slaveInstance,
     coral::model::StepID stepID,
-    std::chrono::milliseconds timeout)
+    std::chrono::microseconds timeout)
 {
     if (!m_subscriber.Update(stepID, timeout)) return false;
-    for (const auto& conn : m_connections.left) {
-        boost::apply_visitor(
-            SetVariable(slaveInstance, conn.second),
-            m_subscriber.Value(conn.first));
+    if (m_compiled) {
+        m_inputValues.ReceiveValues(m_subscriber, m_inputSlots);
+    } else {
+        Compile(slaveInstance);
+    }
+    if (!m_inputValues.SetValues(slaveInstance)) {
+        CORAL_LOG_DEBUG("Failed to set the value of one or more input variables");
     }
     return true;
 }
@@ -508,6 +881,41 @@ void SlaveAgent::Connections::Decouple(coral::model::VariableID localInput)
         m_subscriber.Unsubscribe(remoteOutput);
     }
     assert(m_connections.right.count(localInput) == 0);
+    m_compiled = false;
+}
+
+
+void SlaveAgent::Connections::Compile(
+    const coral::slave::Instance& slaveInstance)
+{
+    m_inputValues.Clear();
+    m_inputSlots.real.clear();
+    m_inputSlots.integer.clear();
+    m_inputSlots.boolean.clear();
+    m_inputSlots.string.clear();
+    for (const auto& conn : m_connections.left) {
+        const auto slot = m_subscriber.Slot(conn.first);
+        const auto& value = m_subscriber.Value(slot);
+        m_inputValues.Add(conn.second, value);
+        switch (coral::model::DataTypeOf(value)) {
+            case coral::model::REAL_DATATYPE:
+                m_inputSlots.real.push_back(slot);
+                break;
+            case coral::model::INTEGER_DATATYPE:
+                m_inputSlots.integer.push_back(slot);
+                break;
+            case coral::model::BOOLEAN_DATATYPE:
+                m_inputSlots.boolean.push_back(slot);
+                break;
+            case coral::model::STRING_DATATYPE:
+                m_inputSlots.string.push_back(slot);
+                break;
+            default:
+                assert (!"Variable has unknown data type");
+        }
+    }
+    m_inputValues.Prepare(slaveInstance);
+    m_compiled = true;
 }
 
 
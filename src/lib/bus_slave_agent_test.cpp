@@ -0,0 +1,275 @@
+#include <cassert>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <coral/master/execution.hpp>
+#include <coral/model.hpp>
+#include <coral/net.hpp>
+#include <coral/net/zmqx.hpp>
+#include <coral/protocol/exe_data.hpp>
+#include <coral/slave/instance.hpp>
+#include <coral/slave/runner.hpp>
+#include <coral/util.hpp>
+
+
+namespace
+{
+    // A slave with a large number of real-valued outputs, followed by one
+    // real-valued input.  If `changing` is true, output i is set to
+    // currentT + i in each DoStep() call, otherwise the outputs keep the
+    // value 0.
+    class ManyOutputs : public coral::slave::Instance
+    {
+    public:
+        ManyOutputs(std::size_t outputCount, bool changing = true)
+            : m_outputCount(outputCount)
+            , m_changing(changing)
+            , m_values(outputCount + 1, 0.0)
+            , m_stepCount(0)
+        {
+        }
+
+        coral::model::VariableID InputID() const
+        {
+            return static_cast<coral::model::VariableID>(m_outputCount);
+        }
+
+        int StepCount() const { return m_stepCount; }
+
+        // === coral::slave::Instance interface implementation ===
+
+        coral::model::SlaveTypeDescription TypeDescription() const override
+        {
+            std::vector<coral::model::VariableDescription> variableDescriptions;
+            for (std::size_t i = 0; i < m_outputCount; ++i) {
+                variableDescriptions.emplace_back(
+                    static_cast<coral::model::VariableID>(i),
+                    "output[" + std::to_string(i) + "]",
+                    coral::model::REAL_DATATYPE,
+                    coral::model::OUTPUT_CAUSALITY,
+                    coral::model::CONTINUOUS_VARIABILITY);
+            }
+            variableDescriptions.emplace_back(
+                InputID(),
+                "input",
+                coral::model::REAL_DATATYPE,
+                coral::model::INPUT_CAUSALITY,
+                coral::model::CONTINUOUS_VARIABILITY);
+            return coral::model::SlaveTypeDescription(
+                "coral.test.internal.ManyOutputs",
+                "2f0d8c55-3b0e-4a0c-9a4e-7c8e6f1d5b21",
+                "Slave type used internally in Coral test suite",
+                "Coral developers",
+                "0.1",
+                variableDescriptions);
+        }
+
+        void Setup(
+            const std::string& /*slaveName*/,
+            const std::string& /*executionName*/,
+            coral::model::TimePoint /*startTime*/,
+            coral::model::TimePoint /*stopTime*/,
+            bool /*adaptiveStepSize*/,
+            double /*relativeTolerance*/) override { }
+
+        void StartSimulation() override { }
+
+        void EndSimulation() override { }
+
+        bool DoStep(
+            coral::model::TimePoint currentT,
+            coral::model::TimeDuration /*deltaT*/) override
+        {
+            if (m_changing) {
+                for (std::size_t i = 0; i < m_outputCount; ++i) {
+                    m_values[i] = currentT + i;
+                }
+            }
+            ++m_stepCount;
+            return true;
+        }
+
+        double GetRealVariable(coral::model::VariableID variable) const override
+        {
+            return m_values[variable];
+        }
+
+        int GetIntegerVariable(coral::model::VariableID /*variable*/) const override { assert(false); return 0; }
+
+        bool GetBooleanVariable(coral::model::VariableID /*variable*/) const override { assert(false); return false; }
+
+        std::string GetStringVariable(coral::model::VariableID /*variable*/) const override { assert(false); return std::string(); }
+
+        bool SetRealVariable(coral::model::VariableID variable, double value) override
+        {
+            m_values[variable] = value;
+            return true;
+        }
+
+        bool SetIntegerVariable(coral::model::VariableID /*variable*/, int /*value*/) override { assert(false); return false; }
+
+        bool SetBooleanVariable(coral::model::VariableID /*variable*/, bool /*value*/) override { assert(false); return false; }
+
+        bool SetStringVariable(coral::model::VariableID /*variable*/, const std::string& /*value*/) override { assert(false); return false; }
+
+    private:
+        std::size_t m_outputCount;
+        bool m_changing;
+        std::vector<double> m_values;
+        int m_stepCount;
+    };
+
+
+    struct SpawnedSlave
+    {
+        coral::net::SlaveLocator locator;
+        std::thread thread;
+    };
+
+    SpawnedSlave SpawnSlave(std::shared_ptr<coral::slave::Instance> instance)
+    {
+        SpawnedSlave s;
+        s.locator = coral::net::SlaveLocator(
+            coral::net::Endpoint("inproc", coral::util::RandomUUID()),
+            coral::net::Endpoint("inproc", coral::util::RandomUUID()));
+        s.thread = std::thread([instance, locator = s.locator] () {
+            coral::slave::Runner(
+                instance,
+                locator.ControlEndpoint(),
+                locator.DataPubEndpoint(),
+                std::chrono::seconds(10)
+            ).Run();
+        });
+        return s;
+    }
+}
+
+
+// Checks that all the outputs of a slave with many outputs are published in
+// every time step, by connecting the last of them to the input of another
+// slave.
+TEST(coral_bus, SlaveAgentManyOutputs)
+{
+    using namespace coral::master;
+    const std::size_t outputCount = 1000;
+    const int stepCount = 10;
+    const double stepSize = 0.1;
+    const auto timeout = std::chrono::seconds(10);
+
+    auto source = std::make_shared<ManyOutputs>(outputCount);
+    auto sourceSlave = SpawnSlave(source);
+    auto joinSource = coral::util::OnScopeExit([&sourceSlave] () {
+        if (sourceSlave.thread.joinable()) sourceSlave.thread.join();
+    });
+    auto target = std::make_shared<ManyOutputs>(1);
+    auto targetSlave = SpawnSlave(target);
+    auto joinTarget = coral::util::OnScopeExit([&targetSlave] () {
+        if (targetSlave.thread.joinable()) targetSlave.thread.join();
+    });
+
+    auto execution = Execution("coral_test_slave_agent_many_outputs");
+    auto slaves = std::vector<AddedSlave>{
+        AddedSlave(sourceSlave.locator, "source"),
+        AddedSlave(targetSlave.locator, "target")
+    };
+    execution.Reconstitute(slaves, timeout);
+    const auto lastOutput = static_cast<coral::model::VariableID>(outputCount - 1);
+    auto config = std::vector<SlaveConfig>{
+        SlaveConfig(
+            slaves[1].info.ID(),
+            std::vector<coral::model::VariableSetting>{
+                coral::model::VariableSetting(
+                    target->InputID(),
+                    coral::model::Variable(slaves[0].info.ID(), lastOutput))
+            })
+    };
+    execution.Reconfigure(config, timeout);
+
+    double t = 0.0;
+    for (int i = 0; i < stepCount; ++i) {
+        ASSERT_EQ(StepResult::completed, execution.Step(stepSize, timeout));
+        execution.AcceptStep(timeout);
+        t += stepSize;
+    }
+    execution.Terminate();
+    sourceSlave.thread.join();
+    targetSlave.thread.join();
+
+    EXPECT_EQ(stepCount, source->StepCount());
+    EXPECT_EQ(stepCount, target->StepCount());
+    // The input receives the output value from the last step, which
+    // started at t - stepSize.
+    EXPECT_NEAR(
+        t - stepSize + lastOutput,
+        target->GetRealVariable(target->InputID()),
+        1e-9);
+}
+
+
+// Checks that, with the default publish policy, a real output is published
+// in every time step even if its value does not change.
+TEST(coral_bus, SlaveAgentPublishesUnchangedReals)
+{
+    using namespace coral::master;
+    namespace ed = coral::protocol::exe_data;
+    const int stepCount = 5;
+    const auto timeout = std::chrono::seconds(10);
+
+    auto instance = std::make_shared<ManyOutputs>(1, false);
+    auto slave = SpawnSlave(instance);
+    auto joinSlave = coral::util::OnScopeExit([&slave] () {
+        if (slave.thread.joinable()) slave.thread.join();
+    });
+
+    auto execution = Execution("coral_test_slave_agent_unchanged_reals");
+    auto slaves = std::vector<AddedSlave>{AddedSlave(slave.locator, "constant")};
+    execution.Reconstitute(slaves, timeout);
+
+    auto sub = zmq::socket_t(coral::net::zmqx::GlobalContext(), ZMQ_SUB);
+    sub.connect(slave.locator.DataPubEndpoint().URL().c_str());
+    sub.setsockopt(ZMQ_SUBSCRIBE, "", 0);
+
+    // Returns the IDs of the time steps in which the output was published
+    // among the messages which have arrived so far.
+    const auto receivedSteps = [&sub] () {
+        std::vector<coral::model::StepID> steps;
+        std::vector<zmq::message_t> msg;
+        ed::BatchMessage batch;
+        while (coral::net::zmqx::WaitForIncoming(sub, std::chrono::milliseconds(500))) {
+            coral::net::zmqx::Receive(sub, msg);
+            if (ed::IsBatchMessage(msg)) {
+                ed::ParseBatchMessage(msg, batch);
+                for (const auto& v : batch.values) {
+                    if (v.first == 0) steps.push_back(batch.timestepID);
+                }
+            } else {
+                const auto m = ed::ParseMessage(msg);
+                if (m.variable.ID() == 0) steps.push_back(m.timestepID);
+            }
+        }
+        return steps;
+    };
+
+    // The subscription takes effect asynchronously, so we step until we
+    // receive something before we start counting.
+    std::vector<coral::model::StepID> steps;
+    for (int i = 0; i < 10 && steps.empty(); ++i) {
+        ASSERT_EQ(StepResult::completed, execution.Step(0.1, timeout));
+        execution.AcceptStep(timeout);
+        steps = receivedSteps();
+    }
+    ASSERT_FALSE(steps.empty());
+
+    for (int i = 0; i < stepCount; ++i) {
+        ASSERT_EQ(StepResult::completed, execution.Step(0.1, timeout));
+        execution.AcceptStep(timeout);
+        steps = receivedSteps();
+        EXPECT_EQ(1u, steps.size());
+    }
+    execution.Terminate();
+}
@@ -7,14 +7,25 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include <coral/bus/slave_control_messenger.hpp>
 
 #include <cassert>
+#include <cstdint>
 #include <utility>
 
+#include <coral/bus/slave_control_messenger_routed.hpp>
 #include <coral/bus/slave_control_messenger_v0.hpp>
 #include <coral/error.hpp>
 #include <coral/log.hpp>
 #include <coral/net/zmqx.hpp>
+#include <coral/protobuf.hpp>
 #include <coral/protocol/execution.hpp>
 
+#ifdef _MSC_VER
+#   pragma warning(push, 0)
+#endif
+#include <execution.pb.h>
+#ifdef _MSC_VER
+#   pragma warning(pop)
+#endif
+
 
 namespace coral
 {
@@ -34,7 +45,7 @@ public:
         coral::net::Reactor& reactor,
         const coral::net::SlaveLocator& slaveLocator,
         int maxAttempts,
-        std::chrono::milliseconds timeout,
+        std::chrono::microseconds timeout,
         ConnectToSlaveHandler onComplete);
 
     ~PendingSlaveControlConnectionPrivate()
@@ -67,7 +78,7 @@ private:
 
     coral::net::Reactor& m_reactor;
     const coral::net::SlaveLocator m_slaveLocator;
-    const std::chrono::milliseconds m_timeout;
+    const std::chrono::microseconds m_timeout;
 
     ConnectToSlaveHandler m_onComplete;
     int m_timeoutTimer;
@@ -79,8 +90,9 @@ struct SlaveControlConnectionPrivate
 {
     coral::net::Reactor* reactor;
     coral::net::zmqx::ReqSocket socket;
-    std::chrono::milliseconds timeout;
+    std::chrono::microseconds timeout;
     int protocol;
+    coral::net::Endpoint endpoint;
 };
 
 
@@ -88,7 +100,7 @@ PendingSlaveControlConnectionPrivate::PendingSlaveControlConnectionPrivate(
     coral::net::Reactor& reactor,
     const coral::net::SlaveLocator& slaveLocator,
     int maxAttempts,
-    std::chrono::milliseconds timeout,
+    std::chrono::microseconds timeout,
     ConnectToSlaveHandler onComplete)
     : m_reactor(reactor),
       m_slaveLocator(slaveLocator),
@@ -140,7 +152,9 @@ void PendingSlaveControlConnectionPrivate::TryConnect(int remainingAttempts)
         % this % m_slaveLocator.ControlEndpoint().URL());
 
     std::vector<zmq::message_t> msg;
-    coral::protocol::execution::CreateHelloMessage(msg, 0);
+    coralproto::execution::HelloData helloData;
+    helloData.set_max_protocol(coral::protocol::execution::MAX_PROTOCOL_VERSION);
+    coral::protocol::execution::CreateHelloMessage(msg, 0, helloData);
     m_socket.Send(msg);
     CORAL_LOG_TRACE(
         boost::format("PendingSlaveControlConnectionPrivate  %x: Sent HELLO")
@@ -155,7 +169,7 @@ void PendingSlaveControlConnectionPrivate::TryConnect(int remainingAttempts)
         timeout = std::chrono::seconds(1);
         CORAL_LOG_DEBUG(boost::format(
             "PendingSlaveControlConnectionPrivate %x: Using default timeout "
-            "(%d ms) for initial connection attempts.")
+            "(%d us) for initial connection attempts.")
             % this % timeout.count());
     }
     if (timeout >= std::chrono::milliseconds(0)) {
@@ -198,6 +212,7 @@ void PendingSlaveControlConnectionPrivate::HandleHelloReply()
         p->socket = std::move(m_socket);
         p->timeout = m_timeout;
         p->protocol = coral::protocol::execution::ParseHelloMessage(msg);
+        p->endpoint = m_slaveLocator.ControlEndpoint();
         OnComplete(std::error_code(), SlaveControlConnection(std::move(p)));
     } else {
         m_socket.Close();
@@ -323,7 +338,7 @@ PendingSlaveControlConnection ConnectToSlave(
     coral::net::Reactor& reactor,
     const coral::net::SlaveLocator& slaveLocator,
     int maxAttempts,
-    std::chrono::milliseconds timeout,
+    std::chrono::microseconds timeout,
     ConnectToSlaveHandler onComplete)
 {
     CORAL_INPUT_CHECK(maxAttempts > 0);
@@ -344,12 +359,29 @@ std::unique_ptr<ISlaveControlMessenger> MakeSlaveControlMessenger(
     coral::model::SlaveID slaveID,
     const std::string& slaveName,
     const SlaveSetup& setup,
-    MakeSlaveControlMessengerHandler onComplete)
+    MakeSlaveControlMessengerHandler onComplete,
+    SlaveControlRouter* router)
 {
     CORAL_INPUT_CHECK(connection);
     CORAL_INPUT_CHECK(slaveID != coral::model::INVALID_SLAVE_ID);
     CORAL_INPUT_CHECK(onComplete);
-    if (connection.Private().protocol == 0) {
+    const auto protocol = connection.Private().protocol;
+    if (protocol < 0 || protocol > coral::protocol::execution::MAX_PROTOCOL_VERSION) {
+        return nullptr;
+    } else if (router) {
+        // The handshake is done, and from now on the slave is reached
+        // through the router.
+        connection.Private().socket.Close();
+        return std::make_unique<coral::bus::SlaveControlMessengerRouted>(
+            *router,
+            connection.Private().endpoint,
+            protocol,
+            slaveID,
+            slaveName,
+            setup,
+            connection.Private().timeout,
+            std::move(onComplete));
+    } else {
         return std::make_unique<coral::bus::SlaveControlMessengerV0>(
             *connection.Private().reactor,
             std::move(connection.Private().socket),
@@ -357,10 +389,27 @@ std::unique_ptr<ISlaveControlMessenger> MakeSlaveControlMessenger(
             slaveName,
             setup,
             connection.Private().timeout,
-            std::move(onComplete));
-    } else {
-        return nullptr;
+            std::move(onComplete),
+            protocol);
     }
 }
 
+
+void ReadSlaveCommandTiming(
+    const std::vector<zmq::message_t>& reply,
+    SlaveCommandTiming& timing)
+{
+    if (reply.size() < 2) return;
+    coralproto::execution::StepTiming data;
+    coral::protobuf::ParseFromFrame(reply[1], data);
+    const auto set = [] (std::chrono::microseconds& d, std::uint64_t us) {
+        d = std::chrono::microseconds(
+            static_cast<std::chrono::microseconds::rep>(us));
+    };
+    if (data.has_busy_us()) set(timing.busy, data.busy_us());
+    if (data.has_do_step_us()) set(timing.doStep, data.do_step_us());
+    if (data.has_publish_us()) set(timing.publish, data.publish_us());
+    if (data.has_input_wait_us()) set(timing.inputWait, data.input_wait_us());
+}
+
 }} // namespace
@@ -0,0 +1,518 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include <coral/bus/slave_control_messenger_routed.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+#include <boost/numeric/conversion/cast.hpp>
+
+#include <coral/error.hpp>
+#include <coral/log.hpp>
+#include <coral/protobuf.hpp>
+#include <coral/protocol/execution.hpp>
+#include <coral/protocol/glue.hpp>
+#include <coral/trace.hpp>
+
+#ifdef _MSC_VER
+#   pragma warning(push, 0)
+#endif
+#include <execution.pb.h>
+#ifdef _MSC_VER
+#   pragma warning(pop)
+#endif
+
+
+namespace coral
+{
+namespace bus
+{
+
+namespace
+{
+    const int NO_TIMER_ACTIVE = -1;
+
+    // boost::variant visitor class for calling a completion handler with an
+    // error code, regardless of operation/handler type.
+    class CallWithError : public boost::static_visitor<>
+    {
+    public:
+        CallWithError(const std::error_code& ec) : m_ec(ec) { }
+
+        void operator()(const ISlaveControlMessenger::VoidHandler& c) const
+        {
+            c(m_ec);
+        }
+
+        void operator()(const ISlaveControlMessenger::GetDescriptionHandler& c) const
+        {
+            c(m_ec, coral::model::SlaveDescription());
+        }
+
+    private:
+        std::error_code m_ec;
+    };
+
+    // Returns the error code which corresponds to an unexpected reply.
+    std::error_code UnexpectedReplyError(int reply)
+    {
+        if (reply == coralproto::execution::MSG_ERROR) {
+            return make_error_code(coral::error::generic_error::operation_failed);
+        } else if (reply == coralproto::execution::MSG_FATAL_ERROR) {
+            return make_error_code(coral::error::generic_error::fatal);
+        } else {
+            return make_error_code(std::errc::bad_message);
+        }
+    }
+}
+
+
+SlaveControlMessengerRouted::SlaveControlMessengerRouted(
+    SlaveControlRouter& router,
+    const coral::net::Endpoint& endpoint,
+    int protocol,
+    coral::model::SlaveID slaveID,
+    const std::string& slaveName,
+    const SlaveSetup& setup,
+    std::chrono::microseconds timeout,
+    MakeSlaveControlMessengerHandler onComplete)
+    : m_reactor(router.Reactor()),
+      m_router(router),
+      m_peer(),
+      m_protocol(protocol),
+      m_state(SLAVE_CONNECTED),
+      m_expectedState(SLAVE_CONNECTED),
+      m_requests(),
+      m_replyTimeoutTimerId(NO_TIMER_ACTIVE)
+{
+    m_peer = m_router.Connect(
+        endpoint,
+        [this] (std::uint32_t requestID, std::vector<zmq::message_t>& msg) {
+            OnReply(requestID, msg);
+        });
+    CORAL_LOG_TRACE(boost::format("SlaveControlMessengerRouted %x: connected to \"%s\" (ID = %d, protocol %d)")
+        % this % slaveName % slaveID % protocol);
+
+    coralproto::execution::SetupData data;
+    data.set_slave_id(slaveID);
+    data.set_start_time(setup.startTime);
+    if (setup.stopTime != coral::model::ETERNITY) {
+        data.set_stop_time(setup.stopTime);
+    }
+    data.set_execution_name(setup.executionName);
+    data.set_slave_name(slaveName);
+    if (coral::trace::Enabled()) data.set_trace(true);
+    if (setup.variableRecvTimeout >= std::chrono::microseconds(0)) {
+        // Slaves which only understand milliseconds get a rounded-up value,
+        // so that a sub-millisecond timeout does not become zero.
+        const auto us = setup.variableRecvTimeout.count();
+        data.set_variable_recv_timeout_ms(
+            boost::numeric_cast<google::protobuf::int32>((us + 999) / 1000));
+        data.set_variable_recv_timeout_us(us);
+    } else {
+        data.set_variable_recv_timeout_ms(-1);
+        data.set_variable_recv_timeout_us(-1);
+    }
+    SendCommand(
+        coralproto::execution::MSG_SETUP,
+        &data,
+        timeout,
+        VoidHandler(std::move(onComplete)),
+        SLAVE_READY);
+    assert(State() == SLAVE_BUSY);
+}
+
+
+SlaveControlMessengerRouted::~SlaveControlMessengerRouted() noexcept
+{
+    StopTimer();
+    if (m_state != SLAVE_NOT_CONNECTED) {
+        m_router.Disconnect(m_peer);
+    }
+}
+
+
+SlaveState SlaveControlMessengerRouted::State() const noexcept
+{
+    return m_requests.empty() ? m_state : SLAVE_BUSY;
+}
+
+
+SlaveCommandTiming SlaveControlMessengerRouted::LastCommandTiming() const noexcept
+{
+    return m_lastCommandTiming;
+}
+
+
+void SlaveControlMessengerRouted::Close()
+{
+    if (m_state != SLAVE_NOT_CONNECTED) {
+        Fail(make_error_code(std::errc::operation_canceled));
+    }
+}
+
+
+void SlaveControlMessengerRouted::GetDescription(
+    std::chrono::microseconds timeout,
+    GetDescriptionHandler onComplete)
+{
+    CORAL_PRECONDITION_CHECK(m_expectedState == SLAVE_READY);
+    CORAL_INPUT_CHECK(onComplete);
+    SendCommand(
+        coralproto::execution::MSG_DESCRIBE,
+        nullptr,
+        timeout,
+        std::move(onComplete),
+        SLAVE_READY);
+}
+
+
+void SlaveControlMessengerRouted::SetVariables(
+    const std::vector<coral::model::VariableSetting>& settings,
+    std::chrono::microseconds timeout,
+    SetVariablesHandler onComplete)
+{
+    CORAL_PRECONDITION_CHECK(m_expectedState == SLAVE_READY);
+    CORAL_INPUT_CHECK(onComplete);
+
+    coralproto::execution::SetVarsData data;
+    for (const auto& setting : settings) {
+        auto v = data.add_variable();
+        v->set_variable_id(setting.Variable());
+        if (setting.HasValue()) {
+            coral::protocol::ConvertToProto(setting.Value(), *v->mutable_value());
+        }
+        if (setting.IsConnectionChange()) {
+            coral::protocol::ConvertToProto(setting.ConnectedOutput(), *v->mutable_connected_output());
+        }
+    }
+    SendCommand(
+        coralproto::execution::MSG_SET_VARS,
+        &data,
+        timeout,
+        std::move(onComplete),
+        SLAVE_READY);
+}
+
+
+void SlaveControlMessengerRouted::SetPeers(
+    const std::vector<coral::net::Endpoint>& peers,
+    std::chrono::microseconds timeout,
+    SetPeersHandler onComplete)
+{
+    CORAL_PRECONDITION_CHECK(m_expectedState == SLAVE_READY);
+    CORAL_INPUT_CHECK(onComplete);
+
+    coralproto::execution::SetPeersData data;
+    for (const auto& peer : peers) data.add_peer(peer.URL());
+    SendCommand(
+        coralproto::execution::MSG_SET_PEERS,
+        &data,
+        timeout,
+        std::move(onComplete),
+        SLAVE_READY);
+}
+
+
+void SlaveControlMessengerRouted::ResendVars(
+    std::chrono::microseconds timeout,
+    ResendVarsHandler onComplete)
+{
+    CORAL_PRECONDITION_CHECK(m_expectedState == SLAVE_READY);
+    CORAL_INPUT_CHECK(onComplete);
+    SendCommand(
+        coralproto::execution::MSG_RESEND_VARS,
+        nullptr,
+        timeout,
+        std::move(onComplete),
+        SLAVE_READY);
+}
+
+
+void SlaveControlMessengerRouted::Step(
+    coral::model::StepID stepID,
+    coral::model::TimePoint currentT,
+    coral::model::TimeDuration deltaT,
+    std::chrono::microseconds timeout,
+    StepHandler onComplete)
+{
+    CORAL_PRECONDITION_CHECK(m_expectedState == SLAVE_READY);
+    CORAL_INPUT_CHECK(onComplete);
+
+    coralproto::execution::StepData data;
+    data.set_step_id(stepID);
+    data.set_timepoint(currentT);
+    data.set_stepsize(deltaT);
+    if (coral::trace::Enabled()) {
+        data.set_trace_clock_ns(coral::trace::ClockNanoseconds());
+    }
+    SendCommand(
+        coralproto::execution::MSG_STEP,
+        &data,
+        timeout,
+        std::move(onComplete),
+        SLAVE_STEP_OK);
+}
+
+
+void SlaveControlMessengerRouted::AcceptStep(
+    std::chrono::microseconds timeout,
+    AcceptStepHandler onComplete)
+{
+    CORAL_PRECONDITION_CHECK(m_expectedState == SLAVE_STEP_OK);
+    CORAL_INPUT_CHECK(onComplete);
+    SendCommand(
+        coralproto::execution::MSG_ACCEPT_STEP,
+        nullptr,
+        timeout,
+        std::move(onComplete),
+        SLAVE_READY);
+}
+
+
+void SlaveControlMessengerRouted::AcceptStepAndStep(
+    coral::model::StepID stepID,
+    coral::model::TimePoint currentT,
+    coral::model::TimeDuration deltaT,
+    std::chrono::microseconds timeout,
+    AcceptStepAndStepHandler onComplete)
+{
+    CORAL_PRECONDITION_CHECK(m_expectedState == SLAVE_STEP_OK);
+    CORAL_INPUT_CHECK(onComplete);
+
+    if (m_protocol >= 1) {
+        coralproto::execution::StepData data;
+        data.set_step_id(stepID);
+        data.set_timepoint(currentT);
+        data.set_stepsize(deltaT);
+        if (coral::trace::Enabled()) {
+            data.set_trace_clock_ns(coral::trace::ClockNanoseconds());
+        }
+        SendCommand(
+            coralproto::execution::MSG_ACCEPT_STEP_AND_STEP,
+            &data,
+            timeout,
+            std::move(onComplete),
+            SLAVE_STEP_OK);
+    } else {
+        // Pipeline the two commands.  If ACCEPT_STEP fails, the STEP command
+        // is canceled, and we report the original error instead.
+        auto acceptFailed = std::make_shared<bool>(false);
+        AcceptStep(
+            timeout,
+            [acceptFailed, onComplete] (const std::error_code& ec) {
+                if (ec) {
+                    *acceptFailed = true;
+                    onComplete(ec);
+                }
+            });
+        Step(
+            stepID,
+            currentT,
+            deltaT,
+            timeout,
+            [acceptFailed, onComplete] (const std::error_code& ec) {
+                if (!*acceptFailed) onComplete(ec);
+            });
+    }
+}
+
+
+void SlaveControlMessengerRouted::Terminate()
+{
+    CORAL_PRECONDITION_CHECK(m_state != SLAVE_NOT_CONNECTED);
+    CORAL_LOG_TRACE(
+        boost::format("SlaveControlMessengerRouted %x: Sending MSG_TERMINATE")
+        % this);
+    std::vector<zmq::message_t> msg;
+    coral::protocol::execution::CreateMessage(msg, coralproto::execution::MSG_TERMINATE);
+    m_router.Send(m_peer, msg);
+    Close();
+}
+
+
+void SlaveControlMessengerRouted::SendCommand(
+    int command,
+    const google::protobuf::MessageLite* data,
+    std::chrono::microseconds timeout,
+    AnyHandler onComplete,
+    SlaveState nextState)
+{
+    assert(m_state != SLAVE_NOT_CONNECTED);
+    std::vector<zmq::message_t> msg;
+    const auto msgType = static_cast<coralproto::execution::MessageType>(command);
+    CORAL_LOG_TRACE(boost::format("SlaveControlMessengerRouted %x: Sending %s")
+        % this % coralproto::execution::MessageType_Name(msgType));
+    if (data) coral::protocol::execution::CreateMessage(msg, msgType, *data);
+    else      coral::protocol::execution::CreateMessage(msg, msgType);
+    const auto requestID = m_router.Send(m_peer, msg);
+
+    m_requests.push_back(Request{
+        requestID,
+        command,
+        timeout,
+        std::move(onComplete),
+        std::chrono::steady_clock::now()});
+    m_expectedState = nextState;
+    if (m_requests.size() == 1) StartTimer();
+}
+
+
+void SlaveControlMessengerRouted::OnReply(
+    std::uint32_t requestID,
+    std::vector<zmq::message_t>& msg)
+{
+    if (m_requests.empty() || m_requests.front().id != requestID) {
+        // This may be the reply to a command which timed out.
+        CORAL_LOG_DEBUG(boost::format("SlaveControlMessengerRouted %x: "
+                "Ignoring reply to unknown request %d")
+            % this % requestID);
+        return;
+    }
+    StopTimer();
+    auto request = std::move(m_requests.front());
+    m_requests.pop_front();
+
+    const auto now = std::chrono::steady_clock::now();
+    m_lastCommandTiming = SlaveCommandTiming();
+    m_lastCommandTiming.roundTrip =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            now - std::max(request.sent, m_lastReply));
+    m_lastReply = now;
+
+    const auto reply = coral::protocol::execution::ParseMessageType(msg.front());
+    CORAL_LOG_TRACE(boost::format("SlaveControlMessengerRouted %x: Received %s")
+        % this
+        % coralproto::execution::MessageType_Name(
+            static_cast<coralproto::execution::MessageType>(reply)));
+
+    // Interpret the reply.  If it is not one of the expected ones, `ec` is
+    // set and `fatal` is true.
+    std::error_code ec;
+    bool fatal = false;
+    SlaveState newState = SLAVE_READY;
+    coral::model::SlaveDescription description;
+    switch (request.command) {
+        case coralproto::execution::MSG_DESCRIBE:
+            if (reply == coralproto::execution::MSG_READY && msg.size() > 1) {
+                coralproto::execution::SlaveDescription sd;
+                coral::protobuf::ParseFromFrame(msg[1], sd);
+                description = coral::model::SlaveDescription(
+                    coral::model::INVALID_SLAVE_ID,
+                    std::string(),
+                    coral::protocol::FromProto(sd.type_description()));
+            } else {
+                fatal = true;
+            }
+            break;
+        case coralproto::execution::MSG_RESEND_VARS:
+            if (reply == coralproto::execution::MSG_ERROR && msg.size() > 1) {
+                coralproto::execution::ErrorInfo errorInfo;
+                coral::protobuf::ParseFromFrame(msg[1], errorInfo);
+                if (errorInfo.code() == coralproto::execution::ErrorInfo::TIMED_OUT) {
+                    ec = make_error_code(coral::error::sim_error::data_timeout);
+                } else {
+                    fatal = true;
+                }
+            } else if (reply != coralproto::execution::MSG_READY) {
+                fatal = true;
+            }
+            break;
+        case coralproto::execution::MSG_STEP:
+        case coralproto::execution::MSG_ACCEPT_STEP_AND_STEP:
+            if (reply == coralproto::execution::MSG_STEP_OK) {
+                ReadSlaveCommandTiming(msg, m_lastCommandTiming);
+                newState = SLAVE_STEP_OK;
+            } else if (reply == coralproto::execution::MSG_STEP_FAILED) {
+                newState = SLAVE_STEP_FAILED;
+                ec = coral::error::sim_error::cannot_perform_timestep;
+            } else {
+                fatal = true;
+            }
+            break;
+        case coralproto::execution::MSG_ACCEPT_STEP:
+            if (reply == coralproto::execution::MSG_READY) {
+                ReadSlaveCommandTiming(msg, m_lastCommandTiming);
+            } else {
+                fatal = true;
+            }
+            break;
+        default:
+            if (reply != coralproto::execution::MSG_READY) fatal = true;
+    }
+    if (fatal) ec = UnexpectedReplyError(reply);
+
+    if (fatal || (ec && !m_requests.empty())) {
+        m_requests.push_front(std::move(request));
+        Fail(ec);
+        return;
+    }
+    m_state = newState;
+    if (m_requests.empty()) {
+        m_expectedState = newState;
+    } else {
+        StartTimer();
+    }
+    if (const auto onComplete = boost::get<GetDescriptionHandler>(&request.onComplete)) {
+        (*onComplete)(ec, description);
+    } else {
+        boost::get<VoidHandler>(request.onComplete)(ec);
+    }
+}
+
+
+void SlaveControlMessengerRouted::OnReplyTimeout()
+{
+    assert(!m_requests.empty());
+    m_replyTimeoutTimerId = NO_TIMER_ACTIVE;
+    Fail(make_error_code(std::errc::timed_out));
+}
+
+
+void SlaveControlMessengerRouted::StartTimer()
+{
+    assert(m_replyTimeoutTimerId == NO_TIMER_ACTIVE);
+    assert(!m_requests.empty());
+    const auto timeout = m_requests.front().timeout;
+    if (timeout < std::chrono::milliseconds(0)) return;
+    m_replyTimeoutTimerId = m_reactor.AddTimer(timeout, 1,
+        [this] (coral::net::Reactor&, int id) {
+            assert(id == m_replyTimeoutTimerId);
+            OnReplyTimeout();
+        });
+}
+
+
+void SlaveControlMessengerRouted::StopTimer() noexcept
+{
+    if (m_replyTimeoutTimerId == NO_TIMER_ACTIVE) return;
+    m_reactor.RemoveTimer(m_replyTimeoutTimerId);
+    m_replyTimeoutTimerId = NO_TIMER_ACTIVE;
+}
+
+
+void SlaveControlMessengerRouted::Fail(const std::error_code& firstError)
+{
+    // Do all cleanup before calling the callbacks, in case they throw or
+    // call other functions on this object.
+    StopTimer();
+    auto requests = std::move(m_requests);
+    m_requests.clear();
+    m_router.Disconnect(m_peer);
+    m_state = SLAVE_NOT_CONNECTED;
+    m_expectedState = SLAVE_NOT_CONNECTED;
+
+    auto ec = firstError;
+    for (const auto& request : requests) {
+        boost::apply_visitor(CallWithError(ec), request.onComplete);
+        ec = make_error_code(std::errc::operation_canceled);
+    }
+}
+
+
+}} // namespace
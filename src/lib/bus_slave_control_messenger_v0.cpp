@@ -16,6 +16,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include <coral/protobuf.hpp>
 #include <coral/protocol/execution.hpp>
 #include <coral/protocol/glue.hpp>
+#include <coral/trace.hpp>
 #include <coral/util.hpp>
 
 #ifdef _MSC_VER
@@ -79,18 +80,20 @@ SlaveControlMessengerV0::SlaveControlMessengerV0(
     coral::model::SlaveID slaveID,
     const std::string& slaveName,
     const SlaveSetup& setup,
-    std::chrono::milliseconds timeout,
-    MakeSlaveControlMessengerHandler onComplete)
+    std::chrono::microseconds timeout,
+    MakeSlaveControlMessengerHandler onComplete,
+    int protocol)
     : m_reactor(reactor),
       m_socket(std::move(socket)),
+      m_protocol(protocol),
       m_state(SLAVE_CONNECTED),
       m_attachedToReactor(false),
       m_currentCommand(NO_COMMAND_ACTIVE),
       m_onComplete(),
       m_replyTimeoutTimerId(NO_TIMER_ACTIVE)
 {
-    CORAL_LOG_TRACE(boost::format("SlaveControlMessengerV0 %x: connected to \"%s\" (ID = %d)")
-        % this % slaveName % slaveID);
+    CORAL_LOG_TRACE(boost::format("SlaveControlMessengerV0 %x: connected to \"%s\" (ID = %d, protocol %d)")
+        % this % slaveName % slaveID % protocol);
     reactor.AddSocket(m_socket.Socket(), [=](coral::net::Reactor& r, zmq::socket_t& s) {
         assert (&s == &m_socket.Socket());
         OnReply();
@@ -121,6 +124,12 @@ SlaveState SlaveControlMessengerV0::State() const noexcept
 }
 
 
+SlaveCommandTiming SlaveControlMessengerV0::LastCommandTiming() const noexcept
+{
+    return m_lastCommandTiming;
+}
+
+
 void SlaveControlMessengerV0::Close()
 {
     CheckInvariant();
@@ -139,7 +148,7 @@ void SlaveControlMessengerV0::Close()
 
 
 void SlaveControlMessengerV0::GetDescription(
-    std::chrono::milliseconds timeout,
+    std::chrono::microseconds timeout,
     GetDescriptionHandler onComplete)
 {
     CORAL_PRECONDITION_CHECK(State() == SLAVE_READY);
@@ -157,7 +166,7 @@ void SlaveControlMessengerV0::GetDescription(
 
 void SlaveControlMessengerV0::SetVariables(
     const std::vector<coral::model::VariableSetting>& settings,
-    std::chrono::milliseconds timeout,
+    std::chrono::microseconds timeout,
     SetVariablesHandler onComplete)
 {
     CORAL_PRECONDITION_CHECK(State() == SLAVE_READY);
@@ -182,7 +191,7 @@ void SlaveControlMessengerV0::SetVariables(
 
 void SlaveControlMessengerV0::SetPeers(
     const std::vector<coral::net::Endpoint>& peers,
-    std::chrono::milliseconds timeout,
+    std::chrono::microseconds timeout,
     SetPeersHandler onComplete)
 {
     CORAL_PRECONDITION_CHECK(State() == SLAVE_READY);
@@ -197,7 +206,7 @@ void SlaveControlMessengerV0::SetPeers(
 
 
 void SlaveControlMessengerV0::ResendVars(
-    std::chrono::milliseconds timeout,
+    std::chrono::microseconds timeout,
     ResendVarsHandler onComplete)
 {
     CORAL_PRECONDITION_CHECK(State() == SLAVE_READY);
@@ -213,7 +222,7 @@ void SlaveControlMessengerV0::Step(
     coral::model::StepID stepID,
     coral::model::TimePoint currentT,
     coral::model::TimeDuration deltaT,
-    std::chrono::milliseconds timeout,
+    std::chrono::microseconds timeout,
     StepHandler onComplete)
 {
     CORAL_PRECONDITION_CHECK(State() == SLAVE_READY);
@@ -224,6 +233,9 @@ void SlaveControlMessengerV0::Step(
     data.set_step_id(stepID);
     data.set_timepoint(currentT);
     data.set_stepsize(deltaT);
+    if (coral::trace::Enabled()) {
+        data.set_trace_clock_ns(coral::trace::ClockNanoseconds());
+    }
 
     SendCommand(coralproto::execution::MSG_STEP, &data, timeout, std::move(onComplete));
     assert(State() == SLAVE_BUSY);
@@ -231,7 +243,7 @@ void SlaveControlMessengerV0::Step(
 
 
 void SlaveControlMessengerV0::AcceptStep(
-    std::chrono::milliseconds timeout,
+    std::chrono::microseconds timeout,
     AcceptStepHandler onComplete)
 {
     CORAL_PRECONDITION_CHECK(m_state == SLAVE_STEP_OK);
@@ -243,6 +255,47 @@ void SlaveControlMessengerV0::AcceptStep(
 }
 
 
+void SlaveControlMessengerV0::AcceptStepAndStep(
+    coral::model::StepID stepID,
+    coral::model::TimePoint currentT,
+    coral::model::TimeDuration deltaT,
+    std::chrono::microseconds timeout,
+    AcceptStepAndStepHandler onComplete)
+{
+    CORAL_PRECONDITION_CHECK(m_state == SLAVE_STEP_OK);
+    CORAL_INPUT_CHECK(onComplete);
+    CheckInvariant();
+
+    if (m_protocol >= 1) {
+        coralproto::execution::StepData data;
+        data.set_step_id(stepID);
+        data.set_timepoint(currentT);
+        data.set_stepsize(deltaT);
+        if (coral::trace::Enabled()) {
+            data.set_trace_clock_ns(coral::trace::ClockNanoseconds());
+        }
+        SendCommand(
+            coralproto::execution::MSG_ACCEPT_STEP_AND_STEP,
+            &data,
+            timeout,
+            std::move(onComplete));
+    } else {
+        // The slave doesn't know the merged command, so we fall back to
+        // sending the two commands separately.
+        AcceptStep(
+            timeout,
+            [=] (const std::error_code& ec) {
+                if (ec) {
+                    onComplete(ec);
+                } else {
+                    Step(stepID, currentT, deltaT, timeout, std::move(onComplete));
+                }
+            });
+    }
+    assert(State() == SLAVE_BUSY);
+}
+
+
 void SlaveControlMessengerV0::Terminate()
 {
     CORAL_PRECONDITION_CHECK(m_state != SLAVE_NOT_CONNECTED);
@@ -263,7 +316,7 @@ void SlaveControlMessengerV0::Setup(
     coral::model::SlaveID slaveID,
     const std::string& slaveName,
     const SlaveSetup& setup,
-    std::chrono::milliseconds timeout,
+    std::chrono::microseconds timeout,
     VoidHandler onComplete)
 {
     assert(State() == SLAVE_CONNECTED);
@@ -277,10 +330,18 @@ void SlaveControlMessengerV0::Setup(
     }
     data.set_execution_name(setup.executionName);
     data.set_slave_name(slaveName);
-    data.set_variable_recv_timeout_ms(
-        setup.variableRecvTimeout >= std::chrono::milliseconds(0)
-            ? boost::numeric_cast<google::protobuf::int32>(setup.variableRecvTimeout.count())
-            : -1);
+    if (coral::trace::Enabled()) data.set_trace(true);
+    if (setup.variableRecvTimeout >= std::chrono::microseconds(0)) {
+        // Slaves which only understand milliseconds get a rounded-up value,
+        // so that a sub-millisecond timeout does not become zero.
+        const auto us = setup.variableRecvTimeout.count();
+        data.set_variable_recv_timeout_ms(
+            boost::numeric_cast<google::protobuf::int32>((us + 999) / 1000));
+        data.set_variable_recv_timeout_us(us);
+    } else {
+        data.set_variable_recv_timeout_ms(-1);
+        data.set_variable_recv_timeout_us(-1);
+    }
     SendCommand(coralproto::execution::MSG_SETUP, &data, timeout, std::move(onComplete));
     assert(State() == SLAVE_BUSY);
 }
@@ -302,7 +363,7 @@ void SlaveControlMessengerV0::Reset()
 void SlaveControlMessengerV0::SendCommand(
     int command,
     const google::protobuf::MessageLite* data,
-    std::chrono::milliseconds timeout,
+    std::chrono::microseconds timeout,
     AnyHandler onComplete)
 {
     std::vector<zmq::message_t> msg;
@@ -319,17 +380,18 @@ void SlaveControlMessengerV0::SendCommand(
 
 void SlaveControlMessengerV0::PostSendCommand(
     int command,
-    std::chrono::milliseconds timeout,
+    std::chrono::microseconds timeout,
     AnyHandler onComplete)
 {
     if (timeout >= std::chrono::milliseconds(0)) RegisterTimeout(timeout);
     m_state = SLAVE_BUSY;
     m_currentCommand = command;
     m_onComplete = std::move(onComplete);
+    m_commandSent = std::chrono::steady_clock::now();
 }
 
 
-void SlaveControlMessengerV0::RegisterTimeout(std::chrono::milliseconds timeout)
+void SlaveControlMessengerV0::RegisterTimeout(std::chrono::microseconds timeout)
 {
     assert (m_replyTimeoutTimerId == NO_TIMER_ACTIVE);
     assert (timeout >= std::chrono::milliseconds(0));
@@ -377,6 +439,10 @@ void SlaveControlMessengerV0::OnReply()
     // Delegate different replies to different functions.
     std::vector<zmq::message_t> msg;
     m_socket.Receive(msg);
+    m_lastCommandTiming = SlaveCommandTiming();
+    m_lastCommandTiming.roundTrip =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - m_commandSent);
     CORAL_LOG_TRACE(boost::format("SlaveControlMessengerV0 %x: Received %s")
         % this
         % coralproto::execution::MessageType_Name(
@@ -409,6 +475,7 @@ void SlaveControlMessengerV0::OnReply()
                 std::move(boost::get<VoidHandler>(onComplete)));
             break;
         case coralproto::execution::MSG_STEP:
+        case coralproto::execution::MSG_ACCEPT_STEP_AND_STEP:
             StepReplyReceived(
                 msg,
                 std::move(boost::get<VoidHandler>(onComplete)));
@@ -519,6 +586,7 @@ void SlaveControlMessengerV0::StepReplyReceived(
     assert (m_state = SLAVE_BUSY);
     const auto msgType = coral::protocol::execution::ParseMessageType(msg.front());
     if (msgType == coralproto::execution::MSG_STEP_OK) {
+        ReadSlaveCommandTiming(msg, m_lastCommandTiming);
         m_state = SLAVE_STEP_OK;
         onComplete(std::error_code());
     } else if (msgType == coralproto::execution::MSG_STEP_FAILED) {
@@ -535,6 +603,10 @@ void SlaveControlMessengerV0::AcceptStepReplyReceived(
     VoidHandler onComplete)
 {
     assert(m_state == SLAVE_BUSY);
+    if (coral::protocol::execution::ParseMessageType(msg.front())
+            == coralproto::execution::MSG_READY) {
+        ReadSlaveCommandTiming(msg, m_lastCommandTiming);
+    }
     HandleExpectedReadyReply(msg, std::move(onComplete));
 }
 
@@ -0,0 +1,187 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include <coral/bus/slave_control_router.hpp>
+
+#include <cassert>
+#include <utility>
+
+#include <coral/error.hpp>
+#include <coral/log.hpp>
+#include <coral/net/zmqx.hpp>
+#include <coral/util.hpp>
+
+// ZMQ_CONNECT_RID was renamed in ZeroMQ 4.3, but the old name is kept for
+// backwards compatibility.  We also accept the new name, in case the old one
+// is removed some day.
+#if !defined(ZMQ_CONNECT_RID) && defined(ZMQ_CONNECT_ROUTING_ID)
+#   define ZMQ_CONNECT_RID ZMQ_CONNECT_ROUTING_ID
+#endif
+
+
+namespace coral
+{
+namespace bus
+{
+
+namespace
+{
+    const int ROUTER_LINGER_MSEC = 1000;
+
+    // Routing IDs consist of a fixed first byte (they may not start with a
+    // zero byte) followed by the peer ID.
+    const char ROUTING_ID_PREFIX = 'P';
+    const std::size_t ROUTING_ID_SIZE = 5;
+    const std::size_t REQUEST_ID_SIZE = 4;
+
+    void EncodeRoutingID(SlaveControlRouter::PeerID peer, char target[ROUTING_ID_SIZE])
+    {
+        target[0] = ROUTING_ID_PREFIX;
+        coral::util::EncodeUint32(static_cast<std::uint32_t>(peer), target + 1);
+    }
+
+    bool DecodeRoutingID(const zmq::message_t& frame, SlaveControlRouter::PeerID& peer)
+    {
+        if (frame.size() != ROUTING_ID_SIZE) return false;
+        const auto data = static_cast<const char*>(frame.data());
+        if (data[0] != ROUTING_ID_PREFIX) return false;
+        peer = static_cast<SlaveControlRouter::PeerID>(coral::util::DecodeUint32(data + 1));
+        return true;
+    }
+}
+
+
+SlaveControlRouter::SlaveControlRouter(coral::net::Reactor& reactor)
+    : m_reactor(reactor),
+      m_socket(std::make_unique<zmq::socket_t>(
+        coral::net::zmqx::GlobalContext(),
+        ZMQ_ROUTER)),
+      m_nextPeerID(0),
+      m_nextRequestID(0)
+{
+    m_socket->setsockopt(ZMQ_LINGER, ROUTER_LINGER_MSEC);
+    // Fail loudly rather than silently dropping requests to unknown peers.
+    m_socket->setsockopt(ZMQ_ROUTER_MANDATORY, 1);
+    m_reactor.AddSocket(
+        *m_socket,
+        [this] (coral::net::Reactor&, zmq::socket_t&) { OnIncoming(); });
+}
+
+
+SlaveControlRouter::~SlaveControlRouter() noexcept
+{
+    m_reactor.RemoveSocket(*m_socket);
+}
+
+
+coral::net::Reactor& SlaveControlRouter::Reactor() noexcept
+{
+    return m_reactor;
+}
+
+
+SlaveControlRouter::PeerID SlaveControlRouter::Connect(
+    const coral::net::Endpoint& endpoint,
+    ReplyHandler onReply)
+{
+    CORAL_INPUT_CHECK(onReply);
+    const auto peer = m_nextPeerID;
+    char routingID[ROUTING_ID_SIZE];
+    EncodeRoutingID(peer, routingID);
+    // The routing ID option only applies to the next connect() call.
+    m_socket->setsockopt(ZMQ_CONNECT_RID, routingID, ROUTING_ID_SIZE);
+    m_socket->connect(endpoint.URL());
+    // ---- No exceptions below this line ----
+    ++m_nextPeerID;
+    m_peers[peer] = Peer{endpoint.URL(), std::move(onReply)};
+    CORAL_LOG_TRACE(boost::format("SlaveControlRouter %x: Connected to %s (peer %d)")
+        % this % endpoint.URL() % peer);
+    return peer;
+}
+
+
+void SlaveControlRouter::Disconnect(PeerID peer) noexcept
+{
+    const auto it = m_peers.find(peer);
+    if (it == m_peers.end()) return;
+    try {
+        m_socket->disconnect(it->second.endpoint);
+    } catch (const zmq::error_t& e) {
+        CORAL_LOG_DEBUG(boost::format("SlaveControlRouter %x: Failed to disconnect from %s (%s)")
+            % this % it->second.endpoint % e.what());
+    }
+    m_peers.erase(it);
+}
+
+
+std::uint32_t SlaveControlRouter::Send(PeerID peer, std::vector<zmq::message_t>& msg)
+{
+    CORAL_INPUT_CHECK(!msg.empty());
+    CORAL_INPUT_CHECK(m_peers.count(peer));
+    const auto requestID = m_nextRequestID++;
+
+    std::vector<zmq::message_t> envelope;
+    envelope.reserve(3);
+    envelope.emplace_back(ROUTING_ID_SIZE);
+    EncodeRoutingID(peer, static_cast<char*>(envelope.back().data()));
+    envelope.emplace_back(REQUEST_ID_SIZE);
+    coral::util::EncodeUint32(requestID, static_cast<char*>(envelope.back().data()));
+    envelope.emplace_back();
+    coral::net::zmqx::Send(*m_socket, envelope, coral::net::zmqx::SendFlag::more);
+    coral::net::zmqx::Send(*m_socket, msg);
+    return requestID;
+}
+
+
+std::size_t SlaveControlRouter::PeerCount() const noexcept
+{
+    return m_peers.size();
+}
+
+
+void SlaveControlRouter::OnIncoming()
+{
+    // With many slaves, several replies are typically waiting, so we handle
+    // all of them rather than returning to the reactor between each.
+    std::vector<zmq::message_t> msg;
+    do {
+        coral::net::zmqx::Receive(*m_socket, msg);
+        HandleMessage(msg);
+    } while (m_socket->getsockopt<int>(ZMQ_EVENTS) & ZMQ_POLLIN);
+}
+
+
+void SlaveControlRouter::HandleMessage(std::vector<zmq::message_t>& msg)
+{
+    // Expected format: routing ID, request ID, empty delimiter, reply body.
+    PeerID peer;
+    if (msg.size() < 4
+        || !DecodeRoutingID(msg[0], peer)
+        || msg[1].size() != REQUEST_ID_SIZE
+        || msg[2].size() != 0)
+    {
+        CORAL_LOG_DEBUG(boost::format("SlaveControlRouter %x: Ignoring invalid message")
+            % this);
+        return;
+    }
+    const auto it = m_peers.find(peer);
+    if (it == m_peers.end()) {
+        CORAL_LOG_TRACE(boost::format("SlaveControlRouter %x: Ignoring reply from disconnected peer %d")
+            % this % peer);
+        return;
+    }
+    const auto requestID =
+        coral::util::DecodeUint32(static_cast<const char*>(msg[1].data()));
+    msg.erase(msg.begin(), msg.begin() + 3);
+
+    // The handler may disconnect the peer, which would destroy the handler
+    // object while it is running, so we call a copy.
+    const auto onReply = it->second.onReply;
+    onReply(requestID, msg);
+}
+
+
+}} // namespace
@@ -0,0 +1,222 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <coral/bus/slave_control_messenger.hpp>
+#include <coral/bus/slave_control_router.hpp>
+#include <coral/bus/slave_setup.hpp>
+#include <coral/error.hpp>
+#include <coral/net.hpp>
+#include <coral/net/reactor.hpp>
+#include <coral/net/zmqx.hpp>
+#include <coral/protobuf.hpp>
+#include <coral/protocol/execution.hpp>
+#include <coral/util.hpp>
+
+#include <execution.pb.h>
+
+
+using namespace coral::bus;
+namespace cp = coral::protocol::execution;
+namespace ce = coralproto::execution;
+
+
+namespace
+{
+    const auto timeout = std::chrono::seconds(10);
+
+    // A set of fake slaves, served by a background thread, which reply
+    // immediately to every command and record the ones they receive.
+    // A STEP with a negative step size fails.
+    class FakeSlaves
+    {
+    public:
+        explicit FakeSlaves(std::size_t count)
+            : m_sockets(count)
+            , m_received(count)
+            , m_stop(false)
+        {
+            for (auto& s : m_sockets) {
+                s.Bind(coral::net::Endpoint("inproc", coral::util::RandomUUID()));
+            }
+            m_thread = std::thread([this] () { Run(); });
+        }
+
+        ~FakeSlaves() { Stop(); }
+
+        coral::net::SlaveLocator Locator(std::size_t index) const
+        {
+            return coral::net::SlaveLocator(m_sockets[index].BoundEndpoint());
+        }
+
+        // May only be called after the object has been stopped.
+        const std::vector<int>& Received(std::size_t index) const
+        {
+            return m_received[index];
+        }
+
+        void Stop()
+        {
+            m_stop = true;
+            if (m_thread.joinable()) m_thread.join();
+        }
+
+    private:
+        void Run()
+        {
+            coral::net::Reactor reactor;
+            for (std::size_t i = 0; i < m_sockets.size(); ++i) {
+                reactor.AddSocket(
+                    m_sockets[i].Socket(),
+                    [this, i] (coral::net::Reactor&, zmq::socket_t&) {
+                        HandleRequest(i);
+                    });
+            }
+            reactor.AddTimer(
+                std::chrono::milliseconds(10),
+                -1,
+                [this] (coral::net::Reactor& r, int) {
+                    if (m_stop) r.Stop();
+                });
+            reactor.Run();
+        }
+
+        void HandleRequest(std::size_t index)
+        {
+            std::vector<zmq::message_t> msg;
+            m_sockets[index].Receive(msg);
+            const auto type = cp::ParseMessageType(msg.front());
+            m_received[index].push_back(type);
+            switch (type) {
+                case ce::MSG_HELLO:
+                    cp::CreateHelloMessage(msg, 0);
+                    break;
+                case ce::MSG_STEP: {
+                    ce::StepData data;
+                    coral::protobuf::ParseFromFrame(msg.at(1), data);
+                    cp::CreateMessage(
+                        msg,
+                        data.stepsize() < 0.0 ? ce::MSG_STEP_FAILED : ce::MSG_STEP_OK);
+                    break;
+                }
+                case ce::MSG_TERMINATE:
+                    m_sockets[index].Ignore();
+                    return;
+                default:
+                    cp::CreateMessage(msg, ce::MSG_READY);
+            }
+            m_sockets[index].Send(msg);
+        }
+
+        std::vector<coral::net::zmqx::RepSocket> m_sockets;
+        std::vector<std::vector<int>> m_received;
+        std::atomic<bool> m_stop;
+        std::thread m_thread;
+    };
+
+
+    // Connects to all the slaves and returns when all messengers are ready.
+    std::vector<std::unique_ptr<ISlaveControlMessenger>> ConnectAll(
+        coral::net::Reactor& reactor,
+        const FakeSlaves& slaves,
+        std::size_t count,
+        SlaveControlRouter* router)
+    {
+        std::vector<std::unique_ptr<ISlaveControlMessenger>> messengers(count);
+        std::vector<PendingSlaveControlConnection> pending;
+        auto remaining = count;
+        for (std::size_t i = 0; i < count; ++i) {
+            pending.push_back(ConnectToSlave(
+                reactor,
+                slaves.Locator(i),
+                1,
+                timeout,
+                [&, i] (const std::error_code& ec, SlaveControlConnection c) {
+                    EXPECT_FALSE(ec);
+                    messengers[i] = MakeSlaveControlMessenger(
+                        std::move(c),
+                        static_cast<coral::model::SlaveID>(i + 1),
+                        "slave",
+                        SlaveSetup(),
+                        [&] (const std::error_code& ec) {
+                            EXPECT_FALSE(ec);
+                            if (--remaining == 0) reactor.Stop();
+                        },
+                        router);
+                }));
+        }
+        reactor.Run();
+        return messengers;
+    }
+}
+
+
+TEST(coral_bus, SlaveControlRouter_pipelining)
+{
+    const std::size_t slaveCount = 3;
+    FakeSlaves slaves(slaveCount);
+    coral::net::Reactor reactor;
+    SlaveControlRouter router(reactor);
+    auto messengers = ConnectAll(reactor, slaves, slaveCount, &router);
+    EXPECT_EQ(slaveCount, router.PeerCount());
+    for (const auto& m : messengers) {
+        EXPECT_EQ(SLAVE_READY, m->State());
+    }
+
+    // Slave 0 and 1 succeed, slave 2 fails to perform its time step, so the
+    // command queued behind it is canceled.
+    std::vector<std::error_code> results;
+    const auto record = [&] (const std::error_code& ec) {
+        results.push_back(ec);
+        if (results.size() == 3 * slaveCount) reactor.Stop();
+    };
+    for (std::size_t i = 0; i < slaveCount; ++i) {
+        const auto& m = messengers[i];
+        m->SetVariables({}, timeout, record);
+        EXPECT_EQ(SLAVE_BUSY, m->State());
+        m->Step(0, 0.0, i < 2 ? 1.0 : -1.0, timeout, record);
+        m->AcceptStep(timeout, record);
+    }
+    reactor.Run();
+
+    ASSERT_EQ(3 * slaveCount, results.size());
+    EXPECT_EQ(SLAVE_READY, messengers[0]->State());
+    EXPECT_EQ(SLAVE_READY, messengers[1]->State());
+    EXPECT_EQ(SLAVE_NOT_CONNECTED, messengers[2]->State());
+    EXPECT_EQ(2u, router.PeerCount());
+    int succeeded = 0, failedSteps = 0, canceled = 0;
+    for (const auto& ec : results) {
+        if (!ec) ++succeeded;
+        else if (ec == coral::error::sim_error::cannot_perform_timestep) ++failedSteps;
+        else if (ec == std::errc::operation_canceled) ++canceled;
+    }
+    EXPECT_EQ(7, succeeded);
+    EXPECT_EQ(1, failedSteps);
+    EXPECT_EQ(1, canceled);
+
+    messengers[0]->Terminate();
+    messengers[1]->Terminate();
+    EXPECT_EQ(0u, router.PeerCount());
+    slaves.Stop();
+
+    const auto expected = std::vector<int>{
+        ce::MSG_HELLO,
+        ce::MSG_SETUP,
+        ce::MSG_SET_VARS,
+        ce::MSG_STEP,
+        ce::MSG_ACCEPT_STEP,
+    };
+    for (std::size_t i = 0; i < 2; ++i) {
+        auto received = slaves.Received(i);
+        // TERMINATE may or may not have arrived before the slaves stopped.
+        if (received.back() == ce::MSG_TERMINATE) received.pop_back();
+        EXPECT_EQ(expected, received);
+    }
+    // The slave may or may not have received the canceled ACCEPT_STEP.
+    EXPECT_LE(4u, slaves.Received(2).size());
+}
+
@@ -23,9 +23,10 @@ SlaveController::SlaveController(
     coral::model::SlaveID slaveID,
     const std::string& slaveName,
     const SlaveSetup& setup,
-    std::chrono::milliseconds timeout,
+    std::chrono::microseconds timeout,
     ConnectHandler onComplete,
-    int maxConnectionAttempts)
+    int maxConnectionAttempts,
+    SlaveControlRouter* router)
 {
     CORAL_INPUT_CHECK(slaveID != coral::model::INVALID_SLAVE_ID);
     m_pendingConnection = ConnectToSlave(
@@ -40,7 +41,8 @@ SlaveController::SlaveController(
                     slaveID,
                     slaveName,
                     setup,
-                    onComplete);
+                    onComplete,
+                    router);
             } else {
                 onComplete(ec);
             }
@@ -71,8 +73,15 @@ SlaveState SlaveController::State() const noexcept
 }
 
 
+SlaveCommandTiming SlaveController::LastCommandTiming() const noexcept
+{
+    if (m_messenger) return m_messenger->LastCommandTiming();
+    else return SlaveCommandTiming();
+}
+
+
 void SlaveController::GetDescription(
-    std::chrono::milliseconds timeout,
+    std::chrono::microseconds timeout,
     GetDescriptionHandler onComplete)
 {
     if (m_messenger) {
@@ -87,7 +96,7 @@ void SlaveController::GetDescription(
 
 void SlaveController::SetVariables(
     const std::vector<coral::model::VariableSetting>& settings,
-    std::chrono::milliseconds timeout,
+    std::chrono::microseconds timeout,
     SetVariablesHandler onComplete)
 {
     CORAL_INPUT_CHECK(!settings.empty());
@@ -101,7 +110,7 @@ void SlaveController::SetVariables(
 
 void SlaveController::SetPeers(
     const std::vector<coral::net::Endpoint>& peers,
-    std::chrono::milliseconds timeout,
+    std::chrono::microseconds timeout,
     SetPeersHandler onComplete)
 {
     if (m_messenger) {
@@ -113,7 +122,7 @@ void SlaveController::SetPeers(
 
 
 void SlaveController::ResendVars(
-    std::chrono::milliseconds timeout,
+    std::chrono::microseconds timeout,
     ResendVarsHandler onComplete)
 {
     if (m_messenger) {
@@ -128,7 +137,7 @@ void SlaveController::Step(
     coral::model::StepID stepID,
     coral::model::TimePoint currentT,
     coral::model::TimeDuration deltaT,
-    std::chrono::milliseconds timeout,
+    std::chrono::microseconds timeout,
     StepHandler onComplete)
 {
     CORAL_INPUT_CHECK(deltaT >= 0.0);
@@ -140,7 +149,7 @@ void SlaveController::Step(
 }
 
 void SlaveController::AcceptStep(
-    std::chrono::milliseconds timeout,
+    std::chrono::microseconds timeout,
     AcceptStepHandler onComplete)
 {
     if (m_messenger) {
@@ -151,6 +160,23 @@ void SlaveController::AcceptStep(
 }
 
 
+void SlaveController::AcceptStepAndStep(
+    coral::model::StepID stepID,
+    coral::model::TimePoint currentT,
+    coral::model::TimeDuration deltaT,
+    std::chrono::microseconds timeout,
+    AcceptStepAndStepHandler onComplete)
+{
+    CORAL_INPUT_CHECK(deltaT >= 0.0);
+    if (m_messenger) {
+        m_messenger->AcceptStepAndStep(
+            stepID, currentT, deltaT, timeout, std::move(onComplete));
+    } else {
+        onComplete(std::make_error_code(std::errc::not_connected));
+    }
+}
+
+
 void SlaveController::Terminate()
 {
     m_pendingConnection.Close();
@@ -312,7 +312,14 @@ public:
         const char* requestHeader, size_t requestHeaderSize,
         const char* requestBody, size_t requestBodySize,
         const char*& replyHeader, size_t& replyHeaderSize,
-        const char*& replyBody, size_t& replyBodySize);
+        const char*& replyBody, size_t& replyBodySize) override;
+
+    void HandleRequestAsync(
+        const std::string& protocolIdentifier,
+        std::uint16_t protocolVersion,
+        const char* requestHeader, size_t requestHeaderSize,
+        const char* requestBody, size_t requestBodySize,
+        ReplySender sendReply) override;
 
 private:
     class Private;
@@ -320,6 +327,47 @@ private:
 };
 
 
+namespace
+{
+    // Parses the body of an INSTANTIATE_SLAVE request.
+    bool ParseInstantiateSlaveRequest(
+        const char* requestBody, size_t requestBodySize,
+        coralproto::domain::InstantiateSlaveData& args)
+    {
+        if (requestBody == nullptr) {
+            CORAL_LOG_TRACE("SlaveProviderServerHandler: Ignoring request due to missing request body");
+            return false;
+        }
+        if (!args.ParseFromArray(requestBody, boost::numeric_cast<int>(requestBodySize))) {
+            CORAL_LOG_TRACE("SlaveProviderServerHandler: Ignoring request due to malformed request body");
+            return false;
+        }
+        return true;
+    }
+
+    // Builds the reply to an INSTANTIATE_SLAVE request.  Returns the reply
+    // header and stores the reply body in `replyBody`.
+    const std::string& MakeInstantiateSlaveReply(
+        const std::error_code& ec,
+        const coral::net::SlaveLocator& slaveLocator,
+        const std::string& errorMessage,
+        std::string& replyBody)
+    {
+        if (ec) {
+            replyBody = errorMessage.empty() ? ec.message() : errorMessage;
+            return ERROR_REPLY;
+        }
+        coralproto::domain::InstantiateSlaveReply data;
+        data.mutable_slave_locator()->set_control_endpoint(
+            slaveLocator.ControlEndpoint().URL());
+        data.mutable_slave_locator()->set_data_pub_endpoint(
+            slaveLocator.DataPubEndpoint().URL());
+        replyBody = data.SerializeAsString();
+        return OK_REPLY;
+    }
+}
+
+
 class SlaveProviderServerHandler::Private
 {
 public:
@@ -360,6 +408,54 @@ public:
         }
     }
 
+    void HandleRequestAsync(
+        const std::string& protocolIdentifier,
+        std::uint16_t protocolVersion,
+        const char* requestHeader, size_t requestHeaderSize,
+        const char* requestBody, size_t requestBodySize,
+        coral::net::reqrep::ServerProtocolHandler::ReplySender sendReply)
+    {
+        const auto request = std::string{requestHeader, requestHeaderSize};
+        if (request != INSTANTIATE_SLAVE_REQUEST) {
+            // Other requests are quick, so they are handled synchronously.
+            const char* replyHeader = nullptr;
+            size_t replyHeaderSize = 0u;
+            const char* replyBody = nullptr;
+            size_t replyBodySize = 0u;
+            if (HandleRequest(
+                    protocolIdentifier, protocolVersion,
+                    requestHeader, requestHeaderSize,
+                    requestBody, requestBodySize,
+                    replyHeader, replyHeaderSize,
+                    replyBody, replyBodySize))
+            {
+                sendReply(replyHeader, replyHeaderSize, replyBody, replyBodySize);
+            }
+            return;
+        }
+
+        coralproto::domain::InstantiateSlaveData args;
+        if (!ParseInstantiateSlaveRequest(requestBody, requestBodySize, args)) {
+            return;
+        }
+        m_slaveProvider->InstantiateSlaveAsync(
+            args.slave_type_uuid(),
+            std::chrono::milliseconds(args.timeout_ms()),
+            [sendReply] (
+                const std::error_code& ec,
+                const coral::net::SlaveLocator& slaveLocator,
+                const std::string& errorMessage)
+            {
+                std::string replyBody;
+                const auto& replyHeader = MakeInstantiateSlaveReply(
+                    ec, slaveLocator, errorMessage, replyBody);
+                assert(!replyBody.empty());
+                sendReply(
+                    replyHeader.data(), replyHeader.size(),
+                    replyBody.data(), replyBody.size());
+            });
+    }
+
 private:
     bool HandleGetSlaveTypesRequest(
         const char* requestBody, size_t requestBodySize,
@@ -390,32 +486,26 @@ private:
         const char*& replyHeader, size_t& replyHeaderSize,
         const char*& replyBody, size_t& replyBodySize)
     {
-        if (requestBody == nullptr) {
-            CORAL_LOG_TRACE("SlaveProviderServerHandler: Ignoring request due to missing request body");
-            return false;
-        }
         coralproto::domain::InstantiateSlaveData args;
-        if (!args.ParseFromArray(requestBody, boost::numeric_cast<int>(requestBodySize))) {
-            CORAL_LOG_TRACE("SlaveProviderServerHandler: Ignoring request due to malformed request body");
+        if (!ParseInstantiateSlaveRequest(requestBody, requestBodySize, args)) {
             return false;
         }
+        const std::string* header = nullptr;
         try {
             const auto slaveLocator = m_slaveProvider->InstantiateSlave(
                 args.slave_type_uuid(),
                 std::chrono::milliseconds(args.timeout_ms()));
-            replyHeader = OK_REPLY.data();
-            replyHeaderSize = OK_REPLY.size();
-            coralproto::domain::InstantiateSlaveReply data;
-            data.mutable_slave_locator()->set_control_endpoint(
-                slaveLocator.ControlEndpoint().URL());
-            data.mutable_slave_locator()->set_data_pub_endpoint(
-                slaveLocator.DataPubEndpoint().URL());
-            m_replyBodyBuffer = data.SerializeAsString();
+            header = &MakeInstantiateSlaveReply(
+                std::error_code{}, slaveLocator, std::string{}, m_replyBodyBuffer);
         } catch (const std::runtime_error& e) {
-             replyHeader = ERROR_REPLY.data();
-             replyHeaderSize = ERROR_REPLY.size();
-             m_replyBodyBuffer = e.what();
+            header = &MakeInstantiateSlaveReply(
+                make_error_code(coral::error::generic_error::operation_failed),
+                coral::net::SlaveLocator{},
+                e.what(),
+                m_replyBodyBuffer);
         }
+        replyHeader = header->data();
+        replyHeaderSize = header->size();
         assert(replyHeader != nullptr);
         assert(replyHeaderSize > 0);
         assert(!m_replyBodyBuffer.empty());
@@ -475,6 +565,45 @@ bool SlaveProviderServerHandler::HandleRequest(
 }
 
 
+void SlaveProviderServerHandler::HandleRequestAsync(
+    const std::string& protocolIdentifier,
+    std::uint16_t protocolVersion,
+    const char* requestHeader, size_t requestHeaderSize,
+    const char* requestBody, size_t requestBodySize,
+    ReplySender sendReply)
+{
+    m_private->HandleRequestAsync(
+        protocolIdentifier,
+        protocolVersion,
+        requestHeader, requestHeaderSize,
+        requestBody, requestBodySize,
+        std::move(sendReply));
+}
+
+
+// =============================================================================
+// SlaveProviderOps
+// =============================================================================
+
+void SlaveProviderOps::InstantiateSlaveAsync(
+    const std::string& slaveTypeUUID,
+    std::chrono::milliseconds timeout,
+    InstantiateSlaveHandler onComplete)
+{
+    coral::net::SlaveLocator slaveLocator;
+    try {
+        slaveLocator = InstantiateSlave(slaveTypeUUID, timeout);
+    } catch (const std::runtime_error& e) {
+        onComplete(
+            make_error_code(coral::error::generic_error::operation_failed),
+            coral::net::SlaveLocator{},
+            e.what());
+        return;
+    }
+    onComplete(std::error_code{}, slaveLocator, std::string{});
+}
+
+
 // =============================================================================
 // MakeSlaveProviderServer
 // =============================================================================
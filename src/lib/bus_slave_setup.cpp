@@ -27,7 +27,7 @@ SlaveSetup::SlaveSetup(
     coral::model::TimePoint startTime_,
     coral::model::TimePoint stopTime_,
     const std::string& executionName_,
-    std::chrono::milliseconds variableRecvTimeout_)
+    std::chrono::microseconds variableRecvTimeout_)
     : startTime(startTime_),
       stopTime(stopTime_),
       executionName(executionName_),
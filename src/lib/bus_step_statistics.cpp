@@ -0,0 +1,116 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include <coral/bus/step_statistics.hpp>
+
+#include <algorithm>
+
+#include <coral/error.hpp>
+
+
+namespace coral
+{
+namespace bus
+{
+
+namespace
+{
+    // Returns the index of the bin for `sample`, i.e., the number of
+    // significant bits in its microsecond count.
+    std::size_t BinIndex(std::chrono::microseconds sample)
+    {
+        auto us = static_cast<std::uint64_t>(
+            std::max(sample.count(), std::chrono::microseconds::rep(0)));
+        std::size_t bin = 0;
+        while (us > 0 && bin < RollingLatencyHistogram::binCount - 1) {
+            us >>= 1;
+            ++bin;
+        }
+        return bin;
+    }
+}
+
+
+const std::size_t RollingLatencyHistogram::binCount;
+
+
+RollingLatencyHistogram::RollingLatencyHistogram(std::size_t window)
+    : m_window(window)
+    , m_next(0)
+    , m_sum(0)
+    , m_bins(binCount, 0)
+{
+    CORAL_INPUT_CHECK(window > 0);
+}
+
+
+void RollingLatencyHistogram::Add(std::chrono::microseconds sample)
+{
+    if (m_samples.size() < m_window) {
+        m_samples.push_back(sample);
+    } else {
+        auto& oldest = m_samples[m_next];
+        --m_bins[BinIndex(oldest)];
+        m_sum -= oldest;
+        oldest = sample;
+        m_next = (m_next + 1) % m_window;
+    }
+    ++m_bins[BinIndex(sample)];
+    m_sum += sample;
+}
+
+
+coral::master::LatencyStatistics RollingLatencyHistogram::Statistics() const
+{
+    coral::master::LatencyStatistics stats;
+    if (m_samples.empty()) return stats;
+    stats.sampleCount = m_samples.size();
+    stats.mean = m_sum / static_cast<std::chrono::microseconds::rep>(m_samples.size());
+    stats.max = *std::max_element(m_samples.begin(), m_samples.end());
+    stats.histogram = m_bins;
+    return stats;
+}
+
+
+// =============================================================================
+
+
+StepTimingCollector::StepTimingCollector(std::size_t window)
+    : m_doStep(window)
+    , m_publish(window)
+    , m_inputWait(window)
+    , m_network(window)
+    , m_roundTrip(window)
+{
+}
+
+
+void StepTimingCollector::Add(const SlaveCommandTiming& timing)
+{
+    const auto zero = std::chrono::microseconds(0);
+    if (timing.doStep >= zero) m_doStep.Add(timing.doStep);
+    if (timing.publish >= zero) m_publish.Add(timing.publish);
+    if (timing.inputWait >= zero) m_inputWait.Add(timing.inputWait);
+    if (timing.roundTrip >= zero) {
+        m_roundTrip.Add(timing.roundTrip);
+        if (timing.busy >= zero) {
+            m_network.Add(std::max(timing.roundTrip - timing.busy, zero));
+        }
+    }
+}
+
+
+void StepTimingCollector::Statistics(coral::master::SlaveStepStatistics& stats) const
+{
+    stats.doStep = m_doStep.Statistics();
+    stats.publish = m_publish.Statistics();
+    stats.inputWait = m_inputWait.Statistics();
+    stats.network = m_network.Statistics();
+    stats.roundTrip = m_roundTrip.Statistics();
+}
+
+
+}} // namespace
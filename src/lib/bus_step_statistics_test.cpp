@@ -0,0 +1,84 @@
+#include <chrono>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include <coral/bus/step_statistics.hpp>
+
+
+using namespace coral::bus;
+using std::chrono::microseconds;
+
+
+TEST(coral_bus, RollingLatencyHistogram)
+{
+    EXPECT_THROW(RollingLatencyHistogram(0), std::invalid_argument);
+
+    RollingLatencyHistogram h(3);
+    auto stats = h.Statistics();
+    EXPECT_EQ(0u, stats.sampleCount);
+    EXPECT_TRUE(stats.histogram.empty());
+
+    h.Add(microseconds(0));
+    h.Add(microseconds(1));
+    h.Add(microseconds(100));
+    stats = h.Statistics();
+    EXPECT_EQ(3u, stats.sampleCount);
+    EXPECT_EQ(microseconds(33), stats.mean);
+    EXPECT_EQ(microseconds(100), stats.max);
+    ASSERT_EQ(RollingLatencyHistogram::binCount, stats.histogram.size());
+    EXPECT_EQ(1u, stats.histogram[0]); // < 1 us
+    EXPECT_EQ(1u, stats.histogram[1]); // [1, 2) us
+    EXPECT_EQ(1u, stats.histogram[7]); // [64, 128) us
+
+    // The oldest samples fall out of the window.
+    h.Add(microseconds(6));
+    h.Add(microseconds(std::chrono::hours(24 * 365)));
+    stats = h.Statistics();
+    EXPECT_EQ(3u, stats.sampleCount);
+    EXPECT_EQ(microseconds(std::chrono::hours(24 * 365)), stats.max);
+    EXPECT_EQ(0u, stats.histogram[0]);
+    EXPECT_EQ(0u, stats.histogram[1]);
+    EXPECT_EQ(1u, stats.histogram[3]); // [4, 8) us
+    EXPECT_EQ(1u, stats.histogram[7]);
+    EXPECT_EQ(1u, stats.histogram.back());
+}
+
+
+TEST(coral_bus, StepTimingCollector)
+{
+    StepTimingCollector collector(10);
+
+    // A STEP reply from a slave which reports its timing
+    coral::bus::SlaveCommandTiming timing;
+    timing.roundTrip = microseconds(500);
+    timing.busy = microseconds(350);
+    timing.doStep = microseconds(300);
+    timing.publish = microseconds(50);
+    collector.Add(timing);
+
+    // An ACCEPT_STEP reply from the same slave
+    timing = coral::bus::SlaveCommandTiming();
+    timing.roundTrip = microseconds(200);
+    timing.busy = microseconds(120);
+    timing.inputWait = microseconds(120);
+    collector.Add(timing);
+
+    // A reply from a slave which doesn't report its timing
+    timing = coral::bus::SlaveCommandTiming();
+    timing.roundTrip = microseconds(800);
+    collector.Add(timing);
+
+    coral::master::SlaveStepStatistics stats;
+    collector.Statistics(stats);
+    EXPECT_EQ(1u, stats.doStep.sampleCount);
+    EXPECT_EQ(microseconds(300), stats.doStep.mean);
+    EXPECT_EQ(1u, stats.publish.sampleCount);
+    EXPECT_EQ(1u, stats.inputWait.sampleCount);
+    EXPECT_EQ(microseconds(120), stats.inputWait.max);
+    EXPECT_EQ(2u, stats.network.sampleCount);
+    EXPECT_EQ(microseconds(115), stats.network.mean);
+    EXPECT_EQ(microseconds(150), stats.network.max);
+    EXPECT_EQ(3u, stats.roundTrip.sampleCount);
+    EXPECT_EQ(microseconds(500), stats.roundTrip.mean);
+}
@@ -6,9 +6,14 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 */
 #include <coral/bus/variable_io.hpp>
 
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
 #include <utility>
 #include <zmq.hpp>
 
+#include <coral/bus/shared_variables.hpp>
 #include <coral/error.hpp>
 #include <coral/log.hpp>
 #include <coral/net/zmqx.hpp>
@@ -29,6 +34,18 @@ namespace
                 state ? "Not connected" : "Already connected");
         }
     }
+
+    // Fibonacci hashing of a (slave, variable) pair, for the slot table of
+    // VariableSubscriber.  `tableSize` must be a power of two.
+    std::size_t SlotTablePosition(
+        const coral::model::Variable& variable,
+        std::size_t tableSize)
+    {
+        const auto key = (static_cast<std::uint64_t>(variable.Slave()) << 32)
+            | variable.ID();
+        const auto hash = key * 0x9E3779B97F4A7C15ull;
+        return static_cast<std::size_t>(hash >> 32) & (tableSize - 1);
+    }
 }
 
 
@@ -40,6 +57,11 @@ VariablePublisher::VariablePublisher()
 { }
 
 
+VariablePublisher::~VariablePublisher() noexcept = default;
+VariablePublisher::VariablePublisher(VariablePublisher&&) noexcept = default;
+VariablePublisher& VariablePublisher::operator=(VariablePublisher&&) noexcept = default;
+
+
 void VariablePublisher::Bind(const coral::net::Endpoint& endpoint)
 {
     EnforceConnected(m_socket, false);
@@ -53,6 +75,15 @@ void VariablePublisher::Bind(const coral::net::Endpoint& endpoint)
         m_socket.reset();
         throw;
     }
+
+    const auto regionName = SharedVariableRegionName(BoundEndpoint());
+    if (!regionName.empty()) {
+        try {
+            m_sharedWriter = std::make_unique<SharedVariableWriter>(regionName);
+        } catch (const std::runtime_error& e) {
+            CORAL_LOG_DEBUG(boost::format("Not using shared memory: %s") % e.what());
+        }
+    }
 }
 
 
@@ -81,6 +112,29 @@ void VariablePublisher::Publish(
 }
 
 
+void VariablePublisher::Publish(
+    coral::model::StepID stepID,
+    coral::model::SlaveID slaveID,
+    const std::pair<coral::model::VariableID, coral::model::ScalarValue>* values,
+    std::size_t count)
+{
+    EnforceConnected(m_socket, true);
+    if (m_sharedWriter) {
+        try {
+            m_sharedWriter->Publish(stepID, slaveID, values, count);
+        } catch (const std::runtime_error& e) {
+            // The region is removed, so local subscribers fall back to the
+            // network.
+            CORAL_LOG_DEBUG(boost::format("Not using shared memory: %s") % e.what());
+            m_sharedWriter.reset();
+        }
+    }
+    std::vector<zmq::message_t> d;
+    coral::protocol::exe_data::CreateBatchMessage(slaveID, stepID, values, count, d);
+    coral::net::zmqx::Send(*m_socket, d);
+}
+
+
 // =============================================================================
 // class VariableSubscriber
 // =============================================================================
@@ -88,13 +142,31 @@ void VariablePublisher::Publish(
 
 VariableSubscriber::VariableSubscriber()
     : m_currentStepID(coral::model::INVALID_STEP_ID)
+    , m_activeSlots(0)
+    , m_missingValues(0)
+    , m_unresolvedRegions(0)
 { }
 
 
+VariableSubscriber::~VariableSubscriber() noexcept = default;
+VariableSubscriber::VariableSubscriber(VariableSubscriber&&) noexcept = default;
+VariableSubscriber& VariableSubscriber::operator=(VariableSubscriber&&) noexcept = default;
+
+
 void VariableSubscriber::Connect(
     const coral::net::Endpoint* endpoints,
     std::size_t endpointsSize)
 {
+    // Start out receiving everything over the network, and switch to
+    // shared memory as the local publishers' regions become ready.
+    for (auto& slot : m_slots) {
+        slot.sharedReader = nullptr;
+        slot.sharedEntry = NO_SLOT;
+    }
+    for (auto& slave : m_slaves) slave.second.sharedReader = nullptr;
+    m_sharedRegions.clear();
+    m_unresolvedRegions = 0;
+
     m_socket = std::make_unique<zmq::socket_t>(coral::net::zmqx::GlobalContext(), ZMQ_SUB);
     try {
         m_socket->setsockopt(ZMQ_SNDHWM, 0);
@@ -103,80 +175,442 @@ void VariableSubscriber::Connect(
         for (std::size_t i = 0; i < endpointsSize; ++i) {
             m_socket->connect(endpoints[i].URL().c_str());
         }
-        for (const auto& variable : m_values) {
-            coral::protocol::exe_data::Subscribe(*m_socket, variable.first);
+        for (const auto& slot : m_slots) {
+            if (slot.active) {
+                coral::protocol::exe_data::Subscribe(*m_socket, slot.variable);
+            }
+        }
+        for (const auto& slave : m_slaves) {
+            coral::protocol::exe_data::SubscribeBatch(*m_socket, slave.first);
         }
     } catch (...) {
         m_socket.reset();
         throw;
     }
+
+    for (std::size_t i = 0; i < endpointsSize; ++i) {
+        if (!IsLocalEndpoint(endpoints[i])) continue;
+        auto name = SharedVariableRegionName(endpoints[i]);
+        if (name.empty()) continue;
+        m_sharedRegions.emplace_back();
+        m_sharedRegions.back().name = std::move(name);
+        ++m_unresolvedRegions;
+    }
+    ResolveSharedRegions();
 }
 
 
-void VariableSubscriber::Subscribe(const coral::model::Variable& variable)
+std::size_t VariableSubscriber::Subscribe(const coral::model::Variable& variable)
 {
     EnforceConnected(m_socket, true);
+    CORAL_INPUT_CHECK(
+        variable.ID() != coral::protocol::exe_data::BATCH_VARIABLE_ID);
+    const auto existing = FindSlot(variable);
+    if (existing != NO_SLOT) return existing;
+
+    std::size_t slot;
+    if (m_freeSlots.empty()) {
+        slot = m_slots.size();
+        m_slots.emplace_back();
+        m_slots.back().ring.resize(2);
+    } else {
+        slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    }
+    auto& slotData = m_slots[slot];
+    slotData.variable = variable;
+    slotData.head = 0;
+    slotData.size = 0;
+    slotData.missing = false;
+    slotData.sharedReader = nullptr;
+    slotData.sharedEntry = NO_SLOT;
+    InsertSlotTableEntry(slot);
+    slotData.active = true;
+
+    auto& slave = m_slaves[variable.Slave()];
+    const auto reader = ++slave.subscriptions == 1
+        ? SharedReaderFor(variable.Slave())
+        : slave.sharedReader;
+    if (reader) {
+        const auto entry = reader->Find(variable.ID());
+        if (entry != SharedVariableReader::NO_ENTRY) {
+            slotData.sharedReader = reader;
+            slotData.sharedEntry = entry;
+            slave.sharedReader = reader;
+            return slot;
+        } else if (slave.sharedReader) {
+            UseNetwork(variable.Slave());
+            return slot;
+        }
+    }
     coral::protocol::exe_data::Subscribe(*m_socket, variable);
-    m_values.insert(std::make_pair(variable, ValueQueue()));
+    if (slave.subscriptions == 1) {
+        coral::protocol::exe_data::SubscribeBatch(*m_socket, variable.Slave());
+    }
+    return slot;
 }
 
 
 void VariableSubscriber::Unsubscribe(const coral::model::Variable& variable)
 {
     EnforceConnected(m_socket, true);
-    if (m_values.erase(variable)) {
+    const auto slot = FindSlot(variable);
+    if (slot == NO_SLOT) return;
+
+    EraseSlotTableEntry(slot);
+    auto& slotData = m_slots[slot];
+    slotData.active = false;
+    for (auto& entry : slotData.ring) entry.second = coral::model::ScalarValue();
+    slotData.size = 0;
+    m_freeSlots.push_back(slot);
+
+    const auto slave = m_slaves.find(variable.Slave());
+    assert(slave != m_slaves.end() && slave->second.subscriptions > 0);
+    if (!slotData.sharedReader) {
         coral::protocol::exe_data::Unsubscribe(*m_socket, variable);
     }
+    slotData.sharedReader = nullptr;
+    slotData.sharedEntry = NO_SLOT;
+    if (--slave->second.subscriptions == 0) {
+        if (!slave->second.sharedReader) {
+            coral::protocol::exe_data::UnsubscribeBatch(*m_socket, variable.Slave());
+        }
+        m_slaves.erase(slave);
+    }
 }
 
 
 bool VariableSubscriber::Update(
     coral::model::StepID stepID,
-    std::chrono::milliseconds timeout)
+    std::chrono::microseconds timeout)
 {
     CORAL_PRECONDITION_CHECK(stepID >= m_currentStepID);
     m_currentStepID = stepID;
 
+    // Pop off old data, but keep the last known value of each variable, and
+    // count the variables we still need values for.
+    m_missingValues = 0;
+    for (auto& slave : m_slaves) slave.second.heldSlots.clear();
+    for (std::size_t i = 0; i < m_slots.size(); ++i) {
+        auto& slot = m_slots[i];
+        if (!slot.active) continue;
+        const auto mask = slot.ring.size() - 1;
+        while (slot.size > 1
+                && slot.ring[(slot.head + 1) & mask].first <= m_currentStepID) {
+            slot.head = (slot.head + 1) & mask;
+            --slot.size;
+        }
+        slot.missing = slot.size == 0 || slot.ring[slot.head].first < m_currentStepID;
+        if (slot.missing && slot.size > 0 && !slot.sharedReader) {
+            // The held value is still current if the slave has already sent
+            // a batch for this (or a later) step, which may have arrived
+            // during an earlier Update() call.
+            auto& slave = m_slaves[slot.variable.Slave()];
+            if (slave.newestBatchStep >= m_currentStepID) {
+                slot.missing = false;
+            } else {
+                slave.heldSlots.push_back(i);
+            }
+        }
+        if (slot.missing) ++m_missingValues;
+    }
+
+    // If necessary, wait for new data
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
     std::vector<zmq::message_t> rawMsg;
-    for (auto& entry : m_values) {
-        auto& valQueue = entry.second;
-        // Pop off old data
-        while (!valQueue.empty() && valQueue.front().first < m_currentStepID) {
-            valQueue.pop();
-        }
-        // If necessary, wait for new data
-        while (valQueue.empty()) {
-            if (!coral::net::zmqx::WaitForIncoming(*m_socket, timeout)) {
-                CORAL_LOG_DEBUG(
-                    boost::format("Timeout waiting for variable %d from slave %d")
-                    % entry.first.ID() % entry.first.Slave());
-                return false;
+    coral::protocol::exe_data::BatchMessage batch;
+    std::size_t missingShared = 1; // unknown
+    while (m_missingValues > 0) {
+        // Values in shared memory are normally there already, but if they
+        // aren't, we have to poll for them while waiting for network data.
+        if (m_unresolvedRegions > 0) {
+            ResolveSharedRegions();
+            missingShared = 1;
+        }
+        if (missingShared > 0) missingShared = ReadSharedValues();
+        if (m_missingValues == 0) break;
+        const bool pollShared = missingShared > 0 || m_unresolvedRegions > 0;
+
+        auto remaining = timeout;
+        if (timeout >= std::chrono::microseconds(0)) {
+            remaining = std::max(
+                std::chrono::microseconds(0),
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    deadline - std::chrono::steady_clock::now()));
+        }
+        const auto pollInterval = std::chrono::milliseconds(1);
+        const bool poll = pollShared
+            && (remaining < std::chrono::microseconds(0) || remaining > pollInterval);
+        // WaitForIncoming() has millisecond resolution, so we round the
+        // waiting time down and poll for the sub-millisecond remainder.
+        const auto wait = poll ? pollInterval
+            : remaining < std::chrono::microseconds(0) ? std::chrono::milliseconds(-1)
+            : std::chrono::duration_cast<std::chrono::milliseconds>(remaining);
+        if (!coral::net::zmqx::WaitForIncoming(*m_socket, wait)) {
+            if (poll || remaining > wait) continue;
+            CORAL_LOG_DEBUG(
+                boost::format("Timeout waiting for %d variable values for step %d")
+                % m_missingValues % m_currentStepID);
+            return false;
+        }
+        coral::net::zmqx::Receive(*m_socket, rawMsg);
+        if (coral::protocol::exe_data::IsBatchMessage(rawMsg)) {
+            coral::protocol::exe_data::ParseBatchMessage(rawMsg, batch);
+            if (batch.timestepID < m_currentStepID) continue;
+            for (auto& value : batch.values) {
+                Enqueue(
+                    coral::model::Variable(batch.slave, value.first),
+                    batch.timestepID,
+                    std::move(value.second));
             }
-            coral::net::zmqx::Receive(*m_socket, rawMsg);
-            const auto msg = coral::protocol::exe_data::ParseMessage(rawMsg);
-            // Queue the variable value iff it is from the current (or a newer)
-            // timestep and it is one we're listening for. (Wrt. the latter,
-            // unsubscriptions may take time to come into effect.)
-            if (msg.timestepID >= m_currentStepID) {
-                auto it = m_values.find(msg.variable);
-                if (it != m_values.end()) {
-                    it->second.emplace(msg.timestepID, msg.value);
+            // The variables which were left out are unchanged.
+            const auto slave = m_slaves.find(batch.slave);
+            if (slave == m_slaves.end()) continue;
+            slave->second.newestBatchStep =
+                std::max(slave->second.newestBatchStep, batch.timestepID);
+            for (const auto slotIndex : slave->second.heldSlots) {
+                auto& slot = m_slots[slotIndex];
+                if (slot.missing) {
+                    slot.missing = false;
+                    --m_missingValues;
                 }
             }
+            slave->second.heldSlots.clear();
+        } else {
+            auto msg = coral::protocol::exe_data::ParseMessage(rawMsg);
+            Enqueue(msg.variable, msg.timestepID, std::move(msg.value));
         }
     }
     return true;
 }
 
 
+void VariableSubscriber::Enqueue(
+    const coral::model::Variable& variable,
+    coral::model::StepID stepID,
+    coral::model::ScalarValue&& value)
+{
+    if (stepID < m_currentStepID) return;
+    const auto slotIndex = FindSlot(variable);
+    if (slotIndex == NO_SLOT) return;
+    auto& slot = m_slots[slotIndex];
+    if (slot.size > 0 && slot.ring[slot.head].first < m_currentStepID) {
+        // Replace the held value.
+        slot.head = (slot.head + 1) & (slot.ring.size() - 1);
+        --slot.size;
+    }
+    const auto capacity = slot.ring.size();
+    if (slot.size == capacity) {
+        // Unroll the ring into a buffer twice the size.
+        std::vector<std::pair<coral::model::StepID, coral::model::ScalarValue>>
+            newRing(2 * capacity);
+        for (std::size_t i = 0; i < slot.size; ++i) {
+            newRing[i] = std::move(slot.ring[(slot.head + i) & (capacity - 1)]);
+        }
+        slot.ring.swap(newRing);
+        slot.head = 0;
+    }
+    auto& entry = slot.ring[(slot.head + slot.size) & (slot.ring.size() - 1)];
+    entry.first = stepID;
+    entry.second = std::move(value);
+    ++slot.size;
+    if (slot.missing) {
+        slot.missing = false;
+        --m_missingValues;
+    }
+}
+
+
+void VariableSubscriber::ResolveSharedRegions()
+{
+    for (auto& region : m_sharedRegions) {
+        if (region.resolved) continue;
+        if (!region.reader) {
+            region.reader = SharedVariableReader::Open(region.name);
+            if (!region.reader) continue;
+        }
+        if (!region.reader->Ready()) continue;
+        region.resolved = true;
+        --m_unresolvedRegions;
+        CORAL_LOG_TRACE(
+            boost::format("Shared memory region %s belongs to slave %d")
+            % region.name % region.reader->Slave());
+        if (m_slaves.count(region.reader->Slave())) {
+            UseSharedMemory(region.reader->Slave(), *region.reader);
+        }
+    }
+}
+
+
+SharedVariableReader* VariableSubscriber::SharedReaderFor(
+    coral::model::SlaveID slave) const
+{
+    for (const auto& region : m_sharedRegions) {
+        if (region.resolved && region.reader->Slave() == slave) {
+            return region.reader.get();
+        }
+    }
+    return nullptr;
+}
+
+
+void VariableSubscriber::UseSharedMemory(
+    coral::model::SlaveID slave,
+    SharedVariableReader& reader)
+{
+    auto& slaveData = m_slaves.at(slave);
+    if (slaveData.sharedReader) return;
+    for (const auto& slot : m_slots) {
+        if (slot.active && slot.variable.Slave() == slave
+                && reader.Find(slot.variable.ID()) == SharedVariableReader::NO_ENTRY) {
+            return;
+        }
+    }
+    for (auto& slot : m_slots) {
+        if (!slot.active || slot.variable.Slave() != slave) continue;
+        slot.sharedReader = &reader;
+        slot.sharedEntry = reader.Find(slot.variable.ID());
+        coral::protocol::exe_data::Unsubscribe(*m_socket, slot.variable);
+    }
+    coral::protocol::exe_data::UnsubscribeBatch(*m_socket, slave);
+    slaveData.sharedReader = &reader;
+    CORAL_LOG_DEBUG(boost::format("Reading values from slave %d through shared memory")
+        % slave);
+}
+
+
+void VariableSubscriber::UseNetwork(coral::model::SlaveID slave)
+{
+    auto& slaveData = m_slaves.at(slave);
+    if (!slaveData.sharedReader) return;
+    for (auto& slot : m_slots) {
+        if (!slot.active || slot.variable.Slave() != slave) continue;
+        slot.sharedReader = nullptr;
+        slot.sharedEntry = NO_SLOT;
+        coral::protocol::exe_data::Subscribe(*m_socket, slot.variable);
+    }
+    coral::protocol::exe_data::SubscribeBatch(*m_socket, slave);
+    slaveData.sharedReader = nullptr;
+    CORAL_LOG_DEBUG(boost::format("Receiving values from slave %d over the network")
+        % slave);
+}
+
+
+std::size_t VariableSubscriber::ReadSharedValues()
+{
+    std::size_t stillMissing = 0;
+    coral::model::ScalarValue value;
+    for (auto& slot : m_slots) {
+        if (!slot.missing || !slot.sharedReader) continue;
+        if (slot.sharedReader->Read(slot.sharedEntry, m_currentStepID, value)) {
+            Enqueue(slot.variable, m_currentStepID, std::move(value));
+        } else {
+            ++stillMissing;
+        }
+    }
+    return stillMissing;
+}
+
+
 const coral::model::ScalarValue& VariableSubscriber::Value(
    const coral::model::Variable& variable) const
 {
-    const auto& valQueue = m_values.at(variable);
-    if (valQueue.empty()) {
+    return Value(Slot(variable));
+}
+
+
+const coral::model::ScalarValue& VariableSubscriber::Value(std::size_t slot) const
+{
+    const auto& slotData = m_slots.at(slot);
+    if (!slotData.active || slotData.size == 0) {
         throw std::logic_error("Variable not updated yet");
     }
-    return valQueue.front().second;
+    return slotData.ring[slotData.head].second;
 }
 
-}} // header guard
+
+std::size_t VariableSubscriber::Slot(const coral::model::Variable& variable) const
+{
+    const auto slot = FindSlot(variable);
+    if (slot == NO_SLOT) {
+        throw std::out_of_range("Variable not subscribed to");
+    }
+    return slot;
+}
+
+
+std::size_t VariableSubscriber::FindSlot(const coral::model::Variable& variable)
+    const noexcept
+{
+    if (m_slotTable.empty()) return NO_SLOT;
+    const auto mask = m_slotTable.size() - 1;
+    for (auto pos = SlotTablePosition(variable, m_slotTable.size());
+         m_slotTable[pos] != 0;
+         pos = (pos + 1) & mask)
+    {
+        const auto slot = m_slotTable[pos] - 1;
+        if (m_slots[slot].variable == variable) return slot;
+    }
+    return NO_SLOT;
+}
+
+
+void VariableSubscriber::InsertSlotTableEntry(std::size_t slot)
+{
+    assert(!m_slots[slot].active);
+    // Keep the load factor at or below 1/2.
+    if (2 * (m_activeSlots + 1) > m_slotTable.size()) {
+        RebuildSlotTable(m_activeSlots + 1);
+    }
+    const auto mask = m_slotTable.size() - 1;
+    auto pos = SlotTablePosition(m_slots[slot].variable, m_slotTable.size());
+    while (m_slotTable[pos] != 0) pos = (pos + 1) & mask;
+    m_slotTable[pos] = slot + 1;
+    ++m_activeSlots;
+}
+
+
+void VariableSubscriber::EraseSlotTableEntry(std::size_t slot) noexcept
+{
+    const auto mask = m_slotTable.size() - 1;
+    auto pos = SlotTablePosition(m_slots[slot].variable, m_slotTable.size());
+    while (m_slotTable[pos] != slot + 1) pos = (pos + 1) & mask;
+
+    // Backward-shift deletion: Move subsequent entries in the same probe
+    // sequence into the hole, so lookups never need tombstones.
+    auto hole = pos;
+    for (auto next = (hole + 1) & mask; m_slotTable[next] != 0; next = (next + 1) & mask) {
+        const auto home = SlotTablePosition(
+            m_slots[m_slotTable[next] - 1].variable,
+            m_slotTable.size());
+        // The entry at `next` may be moved into the hole unless its home
+        // position lies cyclically in (hole, next].
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            m_slotTable[hole] = m_slotTable[next];
+            hole = next;
+        }
+    }
+    m_slotTable[hole] = 0;
+    --m_activeSlots;
+}
+
+
+void VariableSubscriber::RebuildSlotTable(std::size_t slotCount)
+{
+    std::size_t tableSize = 8;
+    while (tableSize < 2 * slotCount) tableSize *= 2;
+    m_slotTable.assign(tableSize, 0);
+    m_activeSlots = 0;
+    for (std::size_t slot = 0; slot < m_slots.size(); ++slot) {
+        if (m_slots[slot].active) {
+            const auto mask = tableSize - 1;
+            auto pos = SlotTablePosition(m_slots[slot].variable, tableSize);
+            while (m_slotTable[pos] != 0) pos = (pos + 1) & mask;
+            m_slotTable[pos] = slot + 1;
+            ++m_activeSlots;
+        }
+    }
+}
+
+
+}} // namespace
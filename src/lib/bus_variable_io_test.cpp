@@ -100,6 +100,226 @@ TEST(coral_bus, VariablePublishSubscribe)
 }
 
 
+TEST(coral_bus, VariablePublishSubscribeBatch)
+{
+    const coral::model::SlaveID slaveID = 1;
+    const coral::model::VariableID varXID = 100;
+    const coral::model::VariableID varYID = 200;
+    const coral::model::VariableID varZID = 300;
+    const auto varX = coral::model::Variable(slaveID, varXID);
+    const auto varY = coral::model::Variable(slaveID, varYID);
+    const auto varZ = coral::model::Variable(slaveID, varZID);
+
+    auto pub = coral::bus::VariablePublisher();
+    pub.Bind(coral::net::Endpoint{"tcp://*:*"});
+
+    auto inetEndpoint = coral::net::ip::Endpoint{pub.BoundEndpoint().Address()};
+    inetEndpoint.SetAddress(coral::net::ip::Address{"localhost"});
+    const auto endpoint = inetEndpoint.ToEndpoint("tcp");
+
+    auto sub = coral::bus::VariableSubscriber();
+    sub.Connect(&endpoint, 1);
+    const auto slotX = sub.Subscribe(varX);
+    const auto slotY = sub.Subscribe(varY);
+    EXPECT_NE(slotX, slotY);
+    EXPECT_EQ(slotX, sub.Subscribe(varX));
+    EXPECT_EQ(slotY, sub.Slot(varY));
+    EXPECT_THROW(sub.Slot(varZ), std::out_of_range);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    typedef std::pair<coral::model::VariableID, coral::model::ScalarValue> Value;
+    coral::model::StepID t = 0;
+
+    // All values in one message, including one we don't subscribe to
+    const Value values0[] = {
+        { varXID, 123 },
+        { varYID, std::string("Hello World") },
+        { varZID, 1.0 },
+    };
+    pub.Publish(t, slaveID, values0, 3);
+    ASSERT_TRUE(sub.Update(t, std::chrono::seconds(1)));
+    EXPECT_EQ(123, boost::get<int>(sub.Value(varX)));
+    EXPECT_EQ("Hello World", boost::get<std::string>(sub.Value(varY)));
+    EXPECT_THROW(sub.Value(varZ), std::logic_error);
+    EXPECT_EQ(123, boost::get<int>(sub.Value(slotX)));
+    EXPECT_EQ("Hello World", boost::get<std::string>(sub.Value(slotY)));
+
+    // Mixed batch and single-variable messages, old values are discarded,
+    // future values are queued.
+    ++t;
+    const Value values1[] = { { varXID, 1.0 }, { varYID, true } };
+    const Value values2[] = { { varXID, 3.0 }, { varYID, false } };
+    pub.Publish(t-1, slaveID, values1, 2);
+    pub.Publish(t,   slaveID, varXID, 2.0);
+    pub.Publish(t,   slaveID, values1 + 1, 1);
+    pub.Publish(t+1, slaveID, values2, 2);
+    ASSERT_TRUE(sub.Update(t, std::chrono::seconds(1)));
+    EXPECT_EQ(2.0, boost::get<double>(sub.Value(varX)));
+    EXPECT_TRUE(boost::get<bool>(sub.Value(varY)));
+    ++t;
+    ASSERT_TRUE(sub.Update(t, std::chrono::seconds(1)));
+    EXPECT_EQ(3.0, boost::get<double>(sub.Value(varX)));
+    EXPECT_FALSE(boost::get<bool>(sub.Value(varY)));
+
+    // A batch which lacks one of the subscribed-to variables, which is then
+    // taken to be unchanged.
+    ++t;
+    pub.Publish(t, slaveID, values0, 1);
+    ASSERT_TRUE(sub.Update(t, std::chrono::seconds(1)));
+    EXPECT_EQ(123, boost::get<int>(sub.Value(varX)));
+    EXPECT_FALSE(boost::get<bool>(sub.Value(varY)));
+
+    // Last known values are only held when a batch has been received.
+    ++t;
+    EXPECT_FALSE(sub.Update(t, std::chrono::milliseconds(1)));
+
+    // Batches are still received after unsubscribing from one variable, but
+    // not after unsubscribing from all of the slave's variables.
+    ++t;
+    sub.Unsubscribe(varX);
+    pub.Publish(t, slaveID, values0, 2);
+    ASSERT_TRUE(sub.Update(t, std::chrono::seconds(1)));
+    EXPECT_THROW(sub.Value(varX), std::logic_error);
+    EXPECT_EQ("Hello World", boost::get<std::string>(sub.Value(varY)));
+    EXPECT_EQ(slotX, sub.Subscribe(varZ)); // slots are reused
+    sub.Unsubscribe(varZ);
+    sub.Unsubscribe(varY);
+    EXPECT_THROW(sub.Subscribe(
+            coral::model::Variable(slaveID, coral::model::VariableID(-1))),
+        std::invalid_argument);
+}
+
+
+TEST(coral_bus, VariablePublishSubscribeBatchAhead)
+{
+    // A slave which runs ahead may publish its batch for the next time step
+    // while the subscriber is still waiting for another slave's values for
+    // the current one.  Held values must then be treated as current in the
+    // next Update().
+    const coral::model::SlaveID slaveAID = 1;
+    const coral::model::SlaveID slaveBID = 2;
+    const coral::model::VariableID varXID = 100;
+    const coral::model::VariableID varYID = 200;
+    const auto varAX = coral::model::Variable(slaveAID, varXID);
+    const auto varAY = coral::model::Variable(slaveAID, varYID);
+    const auto varBX = coral::model::Variable(slaveBID, varXID);
+
+    auto pub = coral::bus::VariablePublisher();
+    pub.Bind(coral::net::Endpoint{"tcp://*:*"});
+
+    auto inetEndpoint = coral::net::ip::Endpoint{pub.BoundEndpoint().Address()};
+    inetEndpoint.SetAddress(coral::net::ip::Address{"localhost"});
+    const auto endpoint = inetEndpoint.ToEndpoint("tcp");
+
+    auto sub = coral::bus::VariableSubscriber();
+    sub.Connect(&endpoint, 1);
+    sub.Subscribe(varAX);
+    sub.Subscribe(varAY);
+    sub.Subscribe(varBX);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    typedef std::pair<coral::model::VariableID, coral::model::ScalarValue> Value;
+    coral::model::StepID t = 0;
+    const Value valuesA0[] = { { varXID, 1.0 }, { varYID, 2.0 } };
+    const Value valuesB0[] = { { varXID, 10.0 } };
+    pub.Publish(t, slaveAID, valuesA0, 2);
+    pub.Publish(t, slaveBID, valuesB0, 1);
+    ASSERT_TRUE(sub.Update(t, std::chrono::seconds(1)));
+
+    // A's batch for step t+1 only contains X, and it arrives before B's
+    // batch for step t, i.e., while Update(t) is still waiting.
+    ++t;
+    const Value valuesA1[] = { { varXID, 3.0 }, { varYID, 4.0 } };
+    const Value valuesA2[] = { { varXID, 5.0 } };
+    const Value valuesB1[] = { { varXID, 11.0 } };
+    pub.Publish(t,   slaveAID, valuesA1, 2);
+    pub.Publish(t+1, slaveAID, valuesA2, 1);
+    pub.Publish(t,   slaveBID, valuesB1, 1);
+    ASSERT_TRUE(sub.Update(t, std::chrono::seconds(1)));
+    EXPECT_EQ(3.0, boost::get<double>(sub.Value(varAX)));
+    EXPECT_EQ(4.0, boost::get<double>(sub.Value(varAY)));
+    EXPECT_EQ(11.0, boost::get<double>(sub.Value(varBX)));
+
+    // Only B's value is still to come.  A's Y must be taken to be unchanged
+    // even though no new message from A arrives.
+    ++t;
+    const Value valuesB2[] = { { varXID, 12.0 } };
+    pub.Publish(t, slaveBID, valuesB2, 1);
+    ASSERT_TRUE(sub.Update(t, std::chrono::seconds(1)));
+    EXPECT_EQ(5.0, boost::get<double>(sub.Value(varAX)));
+    EXPECT_EQ(4.0, boost::get<double>(sub.Value(varAY)));
+    EXPECT_EQ(12.0, boost::get<double>(sub.Value(varBX)));
+
+    // Held values do not extend beyond the newest batch.
+    ++t;
+    EXPECT_FALSE(sub.Update(t, std::chrono::milliseconds(1)));
+}
+
+
+TEST(coral_bus, VariablePublishSubscribeSharedMemory)
+{
+    // The publishers are local, so numeric values are read from shared
+    // memory, while slave B's values are received over the network because
+    // one of them is a string.
+    const coral::model::SlaveID slaveA = 1;
+    const coral::model::SlaveID slaveB = 2;
+    const auto varAX = coral::model::Variable(slaveA, 100);
+    const auto varAY = coral::model::Variable(slaveA, 200);
+    const auto varBS = coral::model::Variable(slaveB, 100);
+    const auto varBR = coral::model::Variable(slaveB, 200);
+
+    const auto endpoints = EndpointPair();
+    auto pubA = coral::bus::VariablePublisher();
+    pubA.Bind(coral::net::Endpoint{endpoints.first});
+    auto pubB = coral::bus::VariablePublisher();
+    pubB.Bind(coral::net::Endpoint{endpoints.second});
+    const coral::net::Endpoint subEndpoints[] = {
+        pubA.BoundEndpoint(), pubB.BoundEndpoint()
+    };
+
+    auto sub = coral::bus::VariableSubscriber();
+    sub.Connect(subEndpoints, 2);
+    sub.Subscribe(varAX);
+    sub.Subscribe(varAY);
+    sub.Subscribe(varBS);
+    sub.Subscribe(varBR);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    typedef std::pair<coral::model::VariableID, coral::model::ScalarValue> Value;
+    coral::model::StepID t = 0;
+    const Value valuesA0[] = { { 100, 1.5 }, { 200, 7 } };
+    const Value valuesB0[] = { { 100, std::string("foo") }, { 200, true } };
+    pubA.Publish(t, slaveA, valuesA0, 2);
+    pubB.Publish(t, slaveB, valuesB0, 2);
+    ASSERT_TRUE(sub.Update(t, std::chrono::seconds(1)));
+    EXPECT_EQ(1.5, boost::get<double>(sub.Value(varAX)));
+    EXPECT_EQ(7, boost::get<int>(sub.Value(varAY)));
+    EXPECT_EQ("foo", boost::get<std::string>(sub.Value(varBS)));
+    EXPECT_TRUE(boost::get<bool>(sub.Value(varBR)));
+
+    // Values which are left out are unchanged, in both cases.
+    ++t;
+    const Value valuesA1[] = { { 100, 2.5 } };
+    const Value valuesB1[] = { { 100, std::string("bar") } };
+    pubA.Publish(t, slaveA, valuesA1, 1);
+    pubB.Publish(t, slaveB, valuesB1, 1);
+    ASSERT_TRUE(sub.Update(t, std::chrono::seconds(1)));
+    EXPECT_EQ(2.5, boost::get<double>(sub.Value(varAX)));
+    EXPECT_EQ(7, boost::get<int>(sub.Value(varAY)));
+    EXPECT_EQ("bar", boost::get<std::string>(sub.Value(varBS)));
+    EXPECT_TRUE(boost::get<bool>(sub.Value(varBR)));
+
+    // ...but only once the publisher has published the step.
+    ++t;
+    pubA.Publish(t, slaveA, valuesA1, 0);
+    EXPECT_FALSE(sub.Update(t, std::chrono::milliseconds(10)));
+    pubB.Publish(t, slaveB, valuesB1, 0);
+    ASSERT_TRUE(sub.Update(t, std::chrono::seconds(1)));
+    EXPECT_EQ(2.5, boost::get<double>(sub.Value(varAX)));
+    EXPECT_EQ("bar", boost::get<std::string>(sub.Value(varBS)));
+}
+
+
 TEST(coral_bus, VariablePublishSubscribePerformance)
 {
     const int VAR_COUNT = 5000;
@@ -13,6 +13,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include <cstring>
 #include <mutex>
 #include <stdexcept>
+#include <type_traits>
 #include <unordered_map>
 
 #include <boost/numeric/conversion/cast.hpp>
@@ -20,6 +21,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
 #include <coral/fmi/glue.hpp>
 #include <coral/fmi/importer.hpp>
+#include <coral/fmi/value_reference_list.hpp>
 #include <coral/log.hpp>
 #include <coral/util.hpp>
 
@@ -518,6 +520,195 @@ bool SlaveInstance2::SetStringVariable(coral::model::VariableID varID, const std
 }
 
 
+namespace
+{
+    // Throws an exception if a function that gets several variables failed.
+    void CheckBulkGetStatus(
+        fmi2_status_t status,
+        std::size_t count,
+        const std::string& instanceName)
+    {
+        if (status != fmi2_status_ok && status != fmi2_status_warning) {
+            throw std::runtime_error(
+                "Failed to get values of " + std::to_string(count)
+                + " variables (" + LastLogRecord(instanceName).message + ")");
+        }
+    }
+
+    // Returns whether a function that sets several variables succeeded,
+    // or throws an exception if it failed with an error.
+    bool CheckBulkSetStatus(
+        fmi2_status_t status,
+        std::size_t count,
+        const std::string& instanceName)
+    {
+        if (status == fmi2_status_ok || status == fmi2_status_warning) {
+            return true;
+        } else if (status == fmi2_status_discard) {
+            return false;
+        } else {
+            throw std::runtime_error(
+                "Failed to set values of " + std::to_string(count)
+                + " variables (" + LastLogRecord(instanceName).message + ")");
+        }
+    }
+
+    static_assert(
+        std::is_same<fmi2_boolean_t, int>::value
+            && std::is_same<fmi2_string_t, const char*>::value,
+        "Buffer types in SlaveInstance2 do not match FMI Library types");
+}
+
+
+std::unique_ptr<coral::slave::VariableList> SlaveInstance2::PrepareVariables(
+    coral::model::DataType dataType,
+    std::vector<coral::model::VariableID> variables) const
+{
+    return PrepareValueReferences(*m_fmu, dataType, std::move(variables));
+}
+
+
+void SlaveInstance2::GetRealVariables(
+    const coral::slave::VariableList& variables,
+    double* values) const
+{
+    const auto valueRefs = ValueReferences<fmi2_value_reference_t>(
+        variables, coral::model::REAL_DATATYPE);
+    const auto count = variables.Size();
+    if (count == 0) return;
+    CheckBulkGetStatus(
+        fmi2_import_get_real(m_handle, valueRefs, count, values),
+        count,
+        m_instanceName);
+}
+
+
+void SlaveInstance2::GetIntegerVariables(
+    const coral::slave::VariableList& variables,
+    int* values) const
+{
+    const auto valueRefs = ValueReferences<fmi2_value_reference_t>(
+        variables, coral::model::INTEGER_DATATYPE);
+    const auto count = variables.Size();
+    if (count == 0) return;
+    CheckBulkGetStatus(
+        fmi2_import_get_integer(m_handle, valueRefs, count, values),
+        count,
+        m_instanceName);
+}
+
+
+void SlaveInstance2::GetBooleanVariables(
+    const coral::slave::VariableList& variables,
+    bool* values) const
+{
+    const auto valueRefs = ValueReferences<fmi2_value_reference_t>(
+        variables, coral::model::BOOLEAN_DATATYPE);
+    const auto count = variables.Size();
+    if (count == 0) return;
+    m_booleanBuffer.resize(count);
+    CheckBulkGetStatus(
+        fmi2_import_get_boolean(
+            m_handle, valueRefs, count, m_booleanBuffer.data()),
+        count,
+        m_instanceName);
+    for (std::size_t i = 0; i < count; ++i) {
+        values[i] = m_booleanBuffer[i] != fmi2_false;
+    }
+}
+
+
+void SlaveInstance2::GetStringVariables(
+    const coral::slave::VariableList& variables,
+    std::string* values) const
+{
+    const auto valueRefs = ValueReferences<fmi2_value_reference_t>(
+        variables, coral::model::STRING_DATATYPE);
+    const auto count = variables.Size();
+    if (count == 0) return;
+    m_stringBuffer.assign(count, nullptr);
+    CheckBulkGetStatus(
+        fmi2_import_get_string(
+            m_handle, valueRefs, count, m_stringBuffer.data()),
+        count,
+        m_instanceName);
+    for (std::size_t i = 0; i < count; ++i) {
+        if (m_stringBuffer[i]) values[i] = m_stringBuffer[i];
+        else values[i].clear();
+    }
+}
+
+
+bool SlaveInstance2::SetRealVariables(
+    const coral::slave::VariableList& variables,
+    const double* values)
+{
+    const auto valueRefs = ValueReferences<fmi2_value_reference_t>(
+        variables, coral::model::REAL_DATATYPE);
+    const auto count = variables.Size();
+    if (count == 0) return true;
+    return CheckBulkSetStatus(
+        fmi2_import_set_real(m_handle, valueRefs, count, values),
+        count,
+        m_instanceName);
+}
+
+
+bool SlaveInstance2::SetIntegerVariables(
+    const coral::slave::VariableList& variables,
+    const int* values)
+{
+    const auto valueRefs = ValueReferences<fmi2_value_reference_t>(
+        variables, coral::model::INTEGER_DATATYPE);
+    const auto count = variables.Size();
+    if (count == 0) return true;
+    return CheckBulkSetStatus(
+        fmi2_import_set_integer(m_handle, valueRefs, count, values),
+        count,
+        m_instanceName);
+}
+
+
+bool SlaveInstance2::SetBooleanVariables(
+    const coral::slave::VariableList& variables,
+    const bool* values)
+{
+    const auto valueRefs = ValueReferences<fmi2_value_reference_t>(
+        variables, coral::model::BOOLEAN_DATATYPE);
+    const auto count = variables.Size();
+    if (count == 0) return true;
+    m_booleanBuffer.resize(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        m_booleanBuffer[i] = values[i];
+    }
+    return CheckBulkSetStatus(
+        fmi2_import_set_boolean(
+            m_handle, valueRefs, count, m_booleanBuffer.data()),
+        count,
+        m_instanceName);
+}
+
+
+bool SlaveInstance2::SetStringVariables(
+    const coral::slave::VariableList& variables,
+    const std::string* values)
+{
+    const auto valueRefs = ValueReferences<fmi2_value_reference_t>(
+        variables, coral::model::STRING_DATATYPE);
+    const auto count = variables.Size();
+    if (count == 0) return true;
+    m_stringBuffer.resize(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        m_stringBuffer[i] = values[i].c_str();
+    }
+    return CheckBulkSetStatus(
+        fmi2_import_set_string(
+            m_handle, valueRefs, count, m_stringBuffer.data()),
+        count,
+        m_instanceName);
+}
+
+
 std::shared_ptr<coral::fmi::FMU> SlaveInstance2::FMU() const
 {
     return FMU2();
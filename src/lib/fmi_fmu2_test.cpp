@@ -1,3 +1,6 @@
+#include <stdexcept>
+#include <vector>
+
 #include <boost/filesystem.hpp>
 #include <gtest/gtest.h>
 
@@ -11,6 +14,7 @@
 namespace
 {
     const std::string fmuDir = STRINGIFY(CORAL_TEST_FMU_DIRECTORY);
+    const std::string syntheticFMUDir = STRINGIFY(CORAL_SYNTHETIC_FMU_DIRECTORY);
 }
 
 
@@ -51,3 +55,102 @@ TEST(coral_fmi, Fmu2)
     EXPECT_TRUE(foundValve);
     EXPECT_TRUE(foundMinlevel);
 }
+
+
+TEST(coral_fmi, Fmu2_bulkGetSet)
+{
+    auto importer = coral::fmi::Importer::Create();
+    auto fmu = importer->Import(
+        boost::filesystem::path(fmuDir) / "fmi2_cs" / "WaterTank_Control.fmu");
+    auto instance = fmu->InstantiateSlave();
+    instance->Setup("testSlave", "testExecution", 0.0, 1.0, false, 0.0);
+
+    std::vector<coral::model::VariableID> realVars;
+    coral::model::VariableID minlevel = 0;
+    for (const auto& v : fmu->Description().Variables()) {
+        if (v.DataType() != coral::model::REAL_DATATYPE) continue;
+        realVars.push_back(v.ID());
+        if (v.Name() == "minlevel") minlevel = v.ID();
+    }
+    ASSERT_FALSE(realVars.empty());
+
+    const auto realList =
+        instance->PrepareVariables(coral::model::REAL_DATATYPE, realVars);
+    ASSERT_EQ(realVars.size(), realList->Size());
+    std::vector<double> values(realVars.size());
+    instance->GetRealVariables(*realList, values.data());
+    for (std::size_t i = 0; i < realVars.size(); ++i) {
+        EXPECT_EQ(instance->GetRealVariable(realVars[i]), values[i]);
+    }
+
+    const auto minlevelList =
+        instance->PrepareVariables(coral::model::REAL_DATATYPE, {minlevel});
+    const double newMinlevel = 2.0;
+    EXPECT_TRUE(instance->SetRealVariables(*minlevelList, &newMinlevel));
+    double minlevelValue = 0.0;
+    instance->GetRealVariables(*minlevelList, &minlevelValue);
+    EXPECT_EQ(newMinlevel, minlevelValue);
+
+    // Empty lists are allowed
+    const auto emptyList =
+        instance->PrepareVariables(coral::model::REAL_DATATYPE, {});
+    instance->GetRealVariables(*emptyList, nullptr);
+    EXPECT_TRUE(instance->SetRealVariables(*emptyList, nullptr));
+
+    // Variables must have the right data type, and lists may only be used
+    // with the functions for their data type.
+    EXPECT_THROW(
+        instance->PrepareVariables(coral::model::INTEGER_DATATYPE, {minlevel}),
+        std::logic_error);
+    int intValue = 0;
+    EXPECT_THROW(
+        instance->GetIntegerVariables(*minlevelList, &intValue),
+        std::logic_error);
+    const coral::slave::VariableList foreignList(
+        coral::model::REAL_DATATYPE, {minlevel});
+    EXPECT_THROW(
+        instance->GetRealVariables(foreignList, &minlevelValue),
+        std::logic_error);
+}
+
+
+TEST(coral_fmi, Fmu2_synthetic)
+{
+    auto importer = coral::fmi::Importer::Create();
+    auto fmu = importer->Import(
+        boost::filesystem::path(syntheticFMUDir) / "synthetic_10.fmu");
+    const auto& d = fmu->Description();
+    EXPECT_EQ("coral.test.Synthetic10", d.Name());
+
+    // One parameter, five inputs and five outputs, with IDs in that order.
+    std::vector<coral::model::VariableDescription> vars;
+    for (const auto& v : d.Variables()) vars.push_back(v);
+    ASSERT_EQ(11u, vars.size());
+    EXPECT_EQ("iterations", vars[0].Name());
+    EXPECT_EQ(coral::model::INTEGER_DATATYPE, vars[0].DataType());
+    EXPECT_EQ(coral::model::PARAMETER_CAUSALITY, vars[0].Causality());
+    EXPECT_EQ("u[1]", vars[1].Name());
+    EXPECT_EQ(coral::model::INPUT_CAUSALITY, vars[1].Causality());
+    EXPECT_EQ("y[5]", vars[10].Name());
+    EXPECT_EQ(coral::model::OUTPUT_CAUSALITY, vars[10].Causality());
+    for (std::size_t i = 0; i < vars.size(); ++i) {
+        EXPECT_EQ(i, vars[i].ID());
+    }
+
+    auto instance = fmu->InstantiateSlave();
+    instance->Setup("testSlave", "testExecution", 0.0, 10.0, false, 0.0);
+    EXPECT_TRUE(instance->SetRealVariable(2, 3.0));
+    instance->StartSimulation();
+
+    // Without iterations, y[i] = u[i] + t.
+    ASSERT_TRUE(instance->DoStep(0.0, 1.0));
+    EXPECT_EQ(4.0, instance->GetRealVariable(7));
+    EXPECT_EQ(1.0, instance->GetRealVariable(6));
+
+    // With iterations, y[i] approaches u[i] + t from its previous value.
+    EXPECT_TRUE(instance->SetIntegerVariable(0, 2));
+    EXPECT_EQ(2, instance->GetIntegerVariable(0));
+    ASSERT_TRUE(instance->DoStep(1.0, 1.0));
+    EXPECT_DOUBLE_EQ(4.75, instance->GetRealVariable(7));
+    instance->EndSimulation();
+}
@@ -6,7 +6,9 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 */
 #include <coral/master/cluster.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <deque>
 #include <unordered_map>
 
 #include <zmq.hpp>
@@ -40,11 +42,45 @@ namespace
     // The period of silence before a slave provider is considered "lost".
     const auto SLAVEPROVIDER_TIMEOUT = std::chrono::minutes(10);
 
-    // Mapping from slave provider IDs to slave provider client objects.
-    typedef std::unordered_map<
-            std::string,
-            coral::bus::SlaveProviderClient>
-        SlaveProviderMap;
+    // An extra connection to a slave provider, used by InstantiateSlaves()
+    // to have several requests in progress at the same time.
+    struct InstantiationChannel
+    {
+        InstantiationChannel(
+            coral::net::Reactor& reactor,
+            const coral::net::ip::Endpoint& endpoint)
+            : client{reactor, endpoint}
+        { }
+
+        coral::bus::SlaveProviderClient client;
+
+        // Whether a request is in progress.
+        bool busy = false;
+
+        // Whether a request has timed out.  The reply may still arrive, and
+        // be mistaken for the reply to a later request, so the channel is
+        // not used again.
+        bool broken = false;
+    };
+
+    // A slave provider, with the client used for most requests and the
+    // channels used for concurrent instantiation.
+    struct SlaveProvider
+    {
+        SlaveProvider(
+            coral::net::Reactor& reactor,
+            const coral::net::ip::Endpoint& endpoint_)
+            : endpoint{endpoint_}
+            , client{reactor, endpoint_}
+        { }
+
+        coral::net::ip::Endpoint endpoint;
+        coral::bus::SlaveProviderClient client;
+        std::vector<std::unique_ptr<InstantiationChannel>> channels;
+    };
+
+    // Mapping from slave provider IDs to slave providers.
+    typedef std::unordered_map<std::string, SlaveProvider> SlaveProviderMap;
 
     // Forward declarations of internal functions, definitions are
     // further down.
@@ -65,6 +101,15 @@ namespace
         SlaveProviderMap& slaveProviders,
         std::promise<coral::net::SlaveLocator> promise)
         noexcept;
+    void HandleInstantiateSlaves(
+        std::vector<coral::master::ProviderCluster::SlaveInstantiation> slaves,
+        std::chrono::milliseconds instantiationTimeout,
+        std::chrono::milliseconds commTimeout,
+        std::size_t maxConcurrentPerProvider,
+        coral::net::Reactor& reactor,
+        SlaveProviderMap& slaveProviders,
+        std::promise<std::vector<coral::master::ProviderCluster::SlaveInstantiation>> promise)
+        noexcept;
 
 
 }
@@ -148,6 +193,41 @@ public:
         ).get();
     }
 
+    void InstantiateSlaves(
+        std::vector<SlaveInstantiation>& slaves,
+        std::chrono::milliseconds timeout,
+        std::size_t maxConcurrentPerProvider)
+    {
+        CORAL_INPUT_CHECK(maxConcurrentPerProvider > 0);
+        if (slaves.empty()) return;
+        slaves = m_thread.Execute<std::vector<SlaveInstantiation>>(
+            [&] (
+                coral::net::Reactor& reactor,
+                BgData& bgData,
+                std::promise<std::vector<SlaveInstantiation>> result)
+            {
+                HandleInstantiateSlaves(
+                    slaves,
+                    timeout,   // instantiation timeout
+                    2*timeout, // communication timeout
+                    maxConcurrentPerProvider,
+                    reactor,
+                    bgData.slaveProviders,
+                    std::move(result));
+            }
+        ).get();
+
+        std::size_t failures = 0;
+        for (const auto& slave : slaves) {
+            if (slave.error) ++failures;
+        }
+        if (failures > 0) {
+            throw std::runtime_error(
+                std::to_string(failures) + " of " + std::to_string(slaves.size())
+                + " slaves could not be instantiated");
+        }
+    }
+
 private:
     struct BgData
     {
@@ -207,6 +287,15 @@ coral::net::SlaveLocator ProviderCluster::InstantiateSlave(
 }
 
 
+void ProviderCluster::InstantiateSlaves(
+    std::vector<SlaveInstantiation>& slaves,
+    std::chrono::milliseconds timeout,
+    std::size_t maxConcurrentPerProvider)
+{
+    m_private->InstantiateSlaves(slaves, timeout, maxConcurrentPerProvider);
+}
+
+
 namespace // Internal functions
 {
 
@@ -236,11 +325,12 @@ void SetupSlaveProviderTracking(
                 return;
             }
             const auto port = coral::util::DecodeUint16(payload);
-            slaveProviderMapPtr->insert(std::make_pair(
-                serviceID,
-                coral::bus::SlaveProviderClient{
+            slaveProviderMapPtr->emplace(
+                std::piecewise_construct,
+                std::forward_as_tuple(serviceID),
+                std::forward_as_tuple(
                     *reactorPtr,
-                    coral::net::ip::Endpoint{address, port}}));
+                    coral::net::ip::Endpoint{address, port}));
             CORAL_LOG_TRACE(
                 boost::format("Slave provider discovered: %s @ %s:%d")
                 % serviceID % address.ToString() % port);
@@ -259,11 +349,12 @@ void SetupSlaveProviderTracking(
             }
             const auto port = coral::util::DecodeUint16(payload);
             slaveProviderMapPtr->erase(serviceID);
-            slaveProviderMapPtr->insert(std::make_pair(
-                serviceID,
-                coral::bus::SlaveProviderClient{
+            slaveProviderMapPtr->emplace(
+                std::piecewise_construct,
+                std::forward_as_tuple(serviceID),
+                std::forward_as_tuple(
                     *reactorPtr,
-                    coral::net::ip::Endpoint{address, port}}));
+                    coral::net::ip::Endpoint{address, port}));
             CORAL_LOG_TRACE(
                 boost::format("Slave provider updated: %s @ %s:%d")
                 % serviceID % address.ToString() % port);
@@ -314,7 +405,7 @@ void HandleGetSlaveTypes(
             ++(state->remainingReplies);
             try {
                 const auto slaveProviderID = slaveProvider.first;
-                slaveProvider.second.GetSlaveTypes(
+                slaveProvider.second.client.GetSlaveTypes(
                     [sharedPromise, state, slaveProviderID] (
                         const std::error_code& ec,
                         const coral::model::SlaveTypeDescription* slaveTypes,
@@ -393,11 +484,11 @@ void HandleInstantiateSlave(
     try {
         const auto slaveProvider = slaveProviders.find(slaveProviderID);
         if (slaveProvider == slaveProviders.end()) {
-            promise.set_exception(std::make_exception_ptr(
+            sharedPromise->set_exception(std::make_exception_ptr(
                 std::runtime_error("Unknown slave provider: " + slaveProviderID)));
             return;
         }
-        slaveProvider->second.InstantiateSlave(
+        slaveProvider->second.client.InstantiateSlave(
             slaveTypeUUID,
             instantiationTimeout,
             commTimeout,
@@ -419,5 +510,233 @@ void HandleInstantiateSlave(
 }
 
 
+
+// This struct contains the state of an ongoing InstantiateSlaves request.
+struct InstantiateSlavesRequest
+{
+    std::vector<coral::master::ProviderCluster::SlaveInstantiation> slaves;
+    std::vector<bool> completed;
+    std::size_t remaining = 0;
+    std::promise<std::vector<coral::master::ProviderCluster::SlaveInstantiation>> promise;
+
+    void Complete(
+        std::size_t index,
+        const std::error_code& ec,
+        const coral::net::SlaveLocator& locator,
+        const std::string& errorMessage);
+
+    // If the request is abandoned, e.g. because a slave provider has
+    // disappeared and taken the completion handlers for its requests with
+    // it, the remaining slaves fail.
+    ~InstantiateSlavesRequest() noexcept;
+};
+
+
+// The queue of slaves which are waiting to be instantiated by one slave
+// provider, shared between the channels that serve it.
+struct InstantiationQueue
+{
+    std::deque<std::size_t> pending;
+    std::size_t activeChannels = 0;
+};
+
+
+void InstantiateSlavesRequest::Complete(
+    std::size_t index,
+    const std::error_code& ec,
+    const coral::net::SlaveLocator& locator,
+    const std::string& errorMessage)
+{
+    assert(!completed[index]);
+    assert(remaining > 0);
+    auto& slave = slaves[index];
+    if (ec) {
+        slave.error = ec;
+        slave.errorMessage = errorMessage;
+    } else {
+        slave.locator = locator;
+    }
+    completed[index] = true;
+    if (--remaining == 0) {
+        promise.set_value(std::move(slaves));
+    }
+}
+
+
+InstantiateSlavesRequest::~InstantiateSlavesRequest() noexcept
+{
+    if (remaining == 0) return;
+    for (std::size_t i = 0; i < slaves.size(); ++i) {
+        if (!completed[i]) {
+            Complete(
+                i,
+                make_error_code(coral::error::generic_error::aborted),
+                coral::net::SlaveLocator{},
+                "Lost contact with slave provider");
+        }
+    }
+}
+
+
+// Sends the next request in `queue` over `channel`, or marks the channel as
+// idle if the queue is empty.  When the reply arrives, the function is
+// called again for the same channel.
+void SendNextInstantiateSlave(
+    std::shared_ptr<InstantiateSlavesRequest> state,
+    std::shared_ptr<InstantiationQueue> queue,
+    InstantiationChannel* channel,
+    std::chrono::milliseconds instantiationTimeout,
+    std::chrono::milliseconds commTimeout)
+{
+    while (!queue->pending.empty()) {
+        const auto index = queue->pending.front();
+        queue->pending.pop_front();
+        try {
+            channel->client.InstantiateSlave(
+                state->slaves[index].slaveTypeUUID,
+                instantiationTimeout,
+                commTimeout,
+                [=] (
+                    const std::error_code& ec,
+                    const coral::net::SlaveLocator& locator,
+                    const std::string& errorMessage)
+                {
+                    if (ec == std::errc::timed_out) {
+                        channel->broken = true;
+                    }
+                    state->Complete(index, ec, locator, errorMessage);
+                    if (!channel->broken) {
+                        SendNextInstantiateSlave(
+                            state, queue, channel,
+                            instantiationTimeout, commTimeout);
+                        return;
+                    }
+                    // The channel can't be used again.  If it was the last
+                    // one, nothing is going to serve the rest of the queue.
+                    channel->busy = false;
+                    if (--queue->activeChannels == 0) {
+                        while (!queue->pending.empty()) {
+                            state->Complete(
+                                queue->pending.front(),
+                                make_error_code(coral::error::generic_error::canceled),
+                                coral::net::SlaveLocator{},
+                                "Slave provider not responding");
+                            queue->pending.pop_front();
+                        }
+                    }
+                });
+            return;
+        } catch (const std::exception& e) {
+            state->Complete(
+                index,
+                make_error_code(coral::error::generic_error::operation_failed),
+                coral::net::SlaveLocator{},
+                e.what());
+        }
+    }
+    channel->busy = false;
+    --queue->activeChannels;
+}
+
+
+void HandleInstantiateSlaves(
+    std::vector<coral::master::ProviderCluster::SlaveInstantiation> slaves,
+    std::chrono::milliseconds instantiationTimeout,
+    std::chrono::milliseconds commTimeout,
+    std::size_t maxConcurrentPerProvider,
+    coral::net::Reactor& reactor,
+    SlaveProviderMap& slaveProviders,
+    std::promise<std::vector<coral::master::ProviderCluster::SlaveInstantiation>> promise)
+    noexcept
+{
+    assert(!slaves.empty());
+    assert(maxConcurrentPerProvider > 0);
+    std::shared_ptr<InstantiateSlavesRequest> state;
+    try {
+        state = std::make_shared<InstantiateSlavesRequest>();
+        state->completed.resize(slaves.size(), false);
+        state->remaining = slaves.size();
+        state->slaves = std::move(slaves);
+    } catch (...) {
+        promise.set_exception(std::current_exception());
+        return;
+    }
+    state->promise = std::move(promise);
+
+    // From here on, every slave must be completed, one way or another.
+    std::unordered_map<std::string, std::shared_ptr<InstantiationQueue>> queues;
+    try {
+        // Sort the requests into one queue per slave provider.
+        for (std::size_t i = 0; i < state->slaves.size(); ++i) {
+            const auto& providerID = state->slaves[i].slaveProviderID;
+            if (slaveProviders.count(providerID)) {
+                auto& queue = queues[providerID];
+                if (!queue) queue = std::make_shared<InstantiationQueue>();
+                queue->pending.push_back(i);
+            } else {
+                state->Complete(
+                    i,
+                    make_error_code(coral::error::generic_error::operation_failed),
+                    coral::net::SlaveLocator{},
+                    "Unknown slave provider: " + providerID);
+            }
+        }
+
+        for (const auto& q : queues) {
+            auto& provider = slaveProviders.at(q.first);
+            const auto& queue = q.second;
+
+            // Replace broken channels, and add new ones until there are
+            // enough idle ones for all the requests, within the limit.
+            auto& channels = provider.channels;
+            channels.erase(
+                std::remove_if(channels.begin(), channels.end(),
+                    [] (const std::unique_ptr<InstantiationChannel>& c) {
+                        return c->broken && !c->busy;
+                    }),
+                channels.end());
+            std::vector<InstantiationChannel*> idle;
+            for (const auto& c : channels) {
+                if (!c->busy && !c->broken) idle.push_back(c.get());
+            }
+            const auto wanted =
+                std::min(queue->pending.size(), maxConcurrentPerProvider);
+            while (idle.size() < wanted) {
+                channels.push_back(std::make_unique<InstantiationChannel>(
+                    reactor, provider.endpoint));
+                idle.push_back(channels.back().get());
+            }
+            idle.resize(wanted);
+
+            for (const auto channel : idle) {
+                channel->busy = true;
+                ++queue->activeChannels;
+            }
+            for (const auto channel : idle) {
+                SendNextInstantiateSlave(
+                    state, queue, channel, instantiationTimeout, commTimeout);
+            }
+            CORAL_LOG_TRACE(boost::format(
+                "Sent InstantiateSlave requests to slave provider %s over %d connections")
+                % q.first % wanted);
+        }
+    } catch (const std::exception& e) {
+        // Fail the requests which have not been sent.  Those which have
+        // will complete normally.
+        for (const auto& q : queues) {
+            auto& pending = q.second->pending;
+            while (!pending.empty()) {
+                state->Complete(
+                    pending.front(),
+                    make_error_code(coral::error::generic_error::operation_failed),
+                    coral::net::SlaveLocator{},
+                    e.what());
+                pending.pop_front();
+            }
+        }
+    }
+}
+
+
 } // anonymous namespace
 }} // namespace
@@ -16,6 +16,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include <coral/bus/execution_manager.hpp>
 #include <coral/net/reactor.hpp>
 #include <coral/log.hpp>
+#include <coral/trace.hpp>
 
 
 namespace
@@ -66,6 +67,7 @@ public:
                 std::promise<void> status)
             {
                 try {
+                    coral::trace::SetThreadName("master communication");
                     execMgr = std::make_unique<coral::bus::ExecutionManager>(
                         reactor,
                         executionName,
@@ -175,12 +177,13 @@ public:
 
     StepResult Step(
         coral::model::TimeDuration stepSize,
-        std::chrono::milliseconds timeout,
-        std::vector<std::pair<coral::model::SlaveID, StepResult>>* slaveResults)
+        std::chrono::microseconds timeout,
+        std::vector<std::pair<coral::model::SlaveID, StepResult>>* slaveResults,
+        bool acceptPrevious = false)
     {
         return m_thread.Execute<StepResult>(
             [=] (
-                coral::net::Reactor&,
+                coral::net::Reactor& reactor,
                 ExecMgr& execMgr,
                 std::promise<StepResult> promise)
             {
@@ -208,10 +211,7 @@ public:
 
                 auto sharedPromise =
                     std::make_shared<decltype(promise)>(std::move(promise));
-                execMgr->Step(
-                    stepSize,
-                    timeout,
-                    [sharedPromise] (const std::error_code& ec)
+                auto onComplete = [sharedPromise] (const std::error_code& ec)
                     {
                         if (!ec || ec == coral::error::sim_error::cannot_perform_timestep) {
                             sharedPromise->set_value(ec == coral::error::sim_error::cannot_perform_timestep
@@ -223,14 +223,53 @@ public:
                                 std::runtime_error(
                                     ErrMsg("Failed to perform time step", ec)));
                         }
-                    },
-                    std::move(perSlaveHandler));
+                    };
+                const auto start = [=, &execMgr] ()
+                    {
+                        try {
+                            if (m_pacer) m_pacer->StepStarted(stepSize);
+                            if (acceptPrevious) {
+                                execMgr->AcceptStepAndStep(
+                                    stepSize,
+                                    timeout,
+                                    onComplete,
+                                    perSlaveHandler);
+                            } else {
+                                execMgr->Step(
+                                    stepSize,
+                                    timeout,
+                                    onComplete,
+                                    perSlaveHandler);
+                            }
+                        } catch (...) {
+                            sharedPromise->set_exception(std::current_exception());
+                        }
+                    };
+
+                // In real-time mode, the step is started by a timer when it
+                // is due, so the wait happens here in the comm thread rather
+                // than in the user thread.
+                if (m_pacer) {
+                    const auto wait =
+                        m_pacer->NextStepTime() - RealTimePacer::Clock::now();
+                    if (wait > RealTimePacer::Clock::duration::zero()) {
+                        auto delay =
+                            std::chrono::duration_cast<std::chrono::microseconds>(wait);
+                        if (delay < wait) delay += std::chrono::microseconds(1);
+                        reactor.AddTimer(
+                            delay,
+                            1,
+                            [start] (coral::net::Reactor&, int) { start(); });
+                        return;
+                    }
+                }
+                start();
             }
         ).get();
     }
 
 
-    void AcceptStep(std::chrono::milliseconds timeout)
+    void AcceptStep(std::chrono::microseconds timeout)
     {
         m_thread.Execute<void>(
             [timeout] (
@@ -252,6 +291,70 @@ public:
     }
 
 
+    void EnableRealTime(const RealTimeOptions& options)
+    {
+        // Validates the options here, in the user thread.
+        auto pacer = std::make_unique<RealTimePacer>(options);
+        m_thread.Execute<void>(
+            [this, &pacer] (
+                coral::net::Reactor& reactor,
+                ExecMgr&,
+                std::promise<void> promise)
+            {
+                m_pacer = std::move(pacer);
+                reactor.SetSpinDuration(m_pacer->Options().spinDuration);
+                promise.set_value();
+            }
+        ).get();
+    }
+
+
+    void DisableRealTime()
+    {
+        m_thread.Execute<void>(
+            [this] (
+                coral::net::Reactor& reactor,
+                ExecMgr&,
+                std::promise<void> promise)
+            {
+                m_pacer.reset();
+                reactor.SetSpinDuration(std::chrono::microseconds(0));
+                promise.set_value();
+            }
+        ).get();
+    }
+
+
+    coral::master::RealTimeStatistics RealTimeStatistics()
+    {
+        return m_thread.Execute<coral::master::RealTimeStatistics>(
+            [this] (
+                coral::net::Reactor&,
+                ExecMgr&,
+                std::promise<coral::master::RealTimeStatistics> promise)
+            {
+                promise.set_value(m_pacer
+                    ? m_pacer->Statistics()
+                    : coral::master::RealTimeStatistics());
+            }
+        ).get();
+    }
+
+
+    ExecutionStatistics Statistics()
+    {
+        return m_thread.Execute<ExecutionStatistics>(
+            [] (
+                coral::net::Reactor&,
+                ExecMgr& execMgr,
+                std::promise<ExecutionStatistics> promise)
+            {
+                promise.set_value(execMgr->Statistics());
+            }
+        ).get();
+    }
+
+
     void Terminate()
     {
         m_thread.Execute<void>(
@@ -273,6 +376,11 @@ private:
     //       need to support Boost < 1.56) or std::optional (when all our
     //       compilers support it).
     using ExecMgr = std::unique_ptr<coral::bus::ExecutionManager>;
+
+    // Only accessed in the comm thread.  Declared before m_thread so that
+    // the thread is shut down before the pacer is destroyed.
+    std::unique_ptr<RealTimePacer> m_pacer;
+
     coral::async::CommThread<ExecMgr> m_thread;
 };
 
@@ -323,19 +431,53 @@ void coral::master::Execution::Reconfigure(
 
 coral::master::StepResult coral::master::Execution::Step(
     coral::model::TimeDuration stepSize,
-    std::chrono::milliseconds timeout,
+    std::chrono::microseconds timeout,
     std::vector<std::pair<coral::model::SlaveID, StepResult>>* slaveResults)
 {
     return m_private->Step(stepSize, timeout, slaveResults);
 }
 
 
-void coral::master::Execution::AcceptStep(std::chrono::milliseconds timeout)
+void coral::master::Execution::AcceptStep(std::chrono::microseconds timeout)
 {
     return m_private->AcceptStep(timeout);
 }
 
 
+coral::master::StepResult coral::master::Execution::AcceptStepAndStep(
+    coral::model::TimeDuration stepSize,
+    std::chrono::microseconds timeout,
+    std::vector<std::pair<coral::model::SlaveID, StepResult>>* slaveResults)
+{
+    return m_private->Step(stepSize, timeout, slaveResults, true);
+}
+
+
+void coral::master::Execution::EnableRealTime(const RealTimeOptions& options)
+{
+    m_private->EnableRealTime(options);
+}
+
+
+void coral::master::Execution::DisableRealTime()
+{
+    m_private->DisableRealTime();
+}
+
+
+coral::master::RealTimeStatistics coral::master::Execution::RealTimeStatistics()
+    const
+{
+    return m_private->RealTimeStatistics();
+}
+
+
+coral::master::ExecutionStatistics coral::master::Execution::Statistics() const
+{
+    return m_private->Statistics();
+}
+
+
 void coral::master::Execution::Terminate()
 {
     m_private->Terminate();
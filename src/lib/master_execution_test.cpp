@@ -1,4 +1,6 @@
 #include <algorithm>
+#include <atomic>
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
@@ -11,6 +13,7 @@
 #include <coral/fmi/importer.hpp>
 #include <coral/fmi/fmu.hpp>
 #include <coral/master/execution.hpp>
+#include <coral/master/in_process.hpp>
 #include <coral/model.hpp>
 #include <coral/net.hpp>
 #include <coral/slave/instance.hpp>
@@ -108,6 +111,78 @@ namespace
         std::map<coral::model::TimePoint, std::vector<double>> m_previousValues;
     };
 
+    // A slave without variables which takes some time to perform a time
+    // step, and which keeps track of how many slaves of this kind are
+    // stepping at the same time.
+    class Sleeper : public coral::slave::Instance
+    {
+    public:
+        Sleeper(std::atomic<int>& stepping, std::atomic<int>& maxStepping)
+            : m_stepping(stepping), m_maxStepping(maxStepping)
+        {
+        }
+
+        int StepCount() const { return m_stepCount; }
+
+        coral::model::SlaveTypeDescription TypeDescription() const override
+        {
+            return coral::model::SlaveTypeDescription(
+                "coral.test.internal.Sleeper",
+                "0b3e9c1e-6f2a-4d55-9d1b-51b3e0f2c8a7",
+                "Slave type used internally in Coral test suite",
+                "Coral developers",
+                "0.1",
+                std::vector<coral::model::VariableDescription>{});
+        }
+
+        void Setup(
+            const std::string& /*slaveName*/,
+            const std::string& /*executionName*/,
+            coral::model::TimePoint /*startTime*/,
+            coral::model::TimePoint /*stopTime*/,
+            bool /*adaptiveStepSize*/,
+            double /*relativeTolerance*/) override { }
+
+        void StartSimulation() override { }
+
+        void EndSimulation() override { }
+
+        bool DoStep(
+            coral::model::TimePoint /*currentT*/,
+            coral::model::TimeDuration /*deltaT*/) override
+        {
+            const int stepping = ++m_stepping;
+            int maxStepping = m_maxStepping;
+            while (stepping > maxStepping
+                && !m_maxStepping.compare_exchange_weak(maxStepping, stepping)) { }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            --m_stepping;
+            ++m_stepCount;
+            return true;
+        }
+
+        double GetRealVariable(coral::model::VariableID /*variable*/) const override { assert(false); return 0.0; }
+
+        int GetIntegerVariable(coral::model::VariableID /*variable*/) const override { assert(false); return 0; }
+
+        bool GetBooleanVariable(coral::model::VariableID /*variable*/) const override { assert(false); return false; }
+
+        std::string GetStringVariable(coral::model::VariableID /*variable*/) const override { assert(false); return std::string(); }
+
+        bool SetRealVariable(coral::model::VariableID /*variable*/, double /*value*/) override { assert(false); return false; }
+
+        bool SetIntegerVariable(coral::model::VariableID /*variable*/, int /*value*/) override { assert(false); return false; }
+
+        bool SetBooleanVariable(coral::model::VariableID /*variable*/, bool /*value*/) override { assert(false); return false; }
+
+        bool SetStringVariable(coral::model::VariableID /*variable*/, const std::string& /*value*/) override { assert(false); return false; }
+
+    private:
+        std::atomic<int>& m_stepping;
+        std::atomic<int>& m_maxStepping;
+        int m_stepCount = 0;
+    };
+
     struct Slave
     {
         std::shared_ptr<coral::slave::Instance> instance;
@@ -300,3 +375,144 @@ TEST(coral_master, Execution)
 
     execution.Terminate();
 }
+
+
+namespace
+{
+    // Runs an execution with two in-process slaves: an instance of
+    // identity.fmu whose "realIn" is set to 7.0, and `logger`, whose input
+    // is connected to the identity slave's "realOut".  `performSteps` is
+    // called once the execution has been configured.
+    void RunIdentityAndLogger(
+        const std::string& executionName,
+        std::shared_ptr<SimpleLogger> logger,
+        const std::function<void(coral::master::Execution&)>& performSteps)
+    {
+        using namespace coral::master;
+        using namespace coral::model;
+        const auto timeout = std::chrono::seconds(1);
+
+        const auto testDataDir = std::getenv("CORAL_TEST_DATA_DIR");
+        auto importer = coral::fmi::Importer::Create();
+        auto idFMU = importer->Import(
+            boost::filesystem::path(testDataDir) / "fmi1_cs" / "identity.fmu");
+        const auto variableDescriptions = idFMU->Description().Variables();
+        const auto idRealInIt = std::find_if(
+            variableDescriptions.begin(),
+            variableDescriptions.end(),
+            [] (const VariableDescription& v) { return v.Name() == "realIn"; });
+        ASSERT_FALSE(idRealInIt == variableDescriptions.end());
+        const auto idRealOutIt = std::find_if(
+            variableDescriptions.begin(),
+            variableDescriptions.end(),
+            [] (const VariableDescription& v) { return v.Name() == "realOut"; });
+        ASSERT_FALSE(idRealOutIt == variableDescriptions.end());
+
+        auto execution = Execution(executionName);
+        InProcessSlaves localSlaves;
+        auto slaves = std::vector<AddedSlave>{
+            AddedSlave(localSlaves.Add(idFMU->InstantiateSlave(), std::chrono::seconds(10)), "id"),
+            AddedSlave(localSlaves.Add(logger, std::chrono::seconds(10)), "log")
+        };
+        EXPECT_EQ(2U, localSlaves.Size());
+        execution.Reconstitute(slaves, timeout);
+
+        const auto idSlaveID = slaves[0].info.ID();
+        const auto logSlaveID = slaves[1].info.ID();
+        auto settings = std::vector<SlaveConfig>{
+            SlaveConfig(
+                idSlaveID,
+                std::vector<VariableSetting>{
+                    VariableSetting(idRealInIt->ID(), 7.0)
+                }),
+            SlaveConfig(
+                logSlaveID,
+                std::vector<VariableSetting>{
+                    VariableSetting(0, Variable(idSlaveID, idRealOutIt->ID()))
+                })
+        };
+        execution.Reconfigure(settings, timeout);
+
+        performSteps(execution);
+
+        // The slave threads end when localSlaves goes out of scope, so the
+        // execution must be terminated first.
+        execution.Terminate();
+    }
+}
+
+
+TEST(coral_master, InProcessSlaves)
+{
+    using namespace coral::master;
+    const auto timeout = std::chrono::seconds(1);
+
+    auto logger = std::make_shared<SimpleLogger>(1);
+    RunIdentityAndLogger("coral_test_in_process", logger, [&] (Execution& execution) {
+        for (int i = 0; i < 3; ++i) {
+            ASSERT_EQ(StepResult::completed, execution.Step(1.0, timeout));
+            execution.AcceptStep(timeout);
+        }
+    });
+
+    const auto log = logger->Log();
+    ASSERT_EQ(3U, log.size());
+    EXPECT_EQ(7.0, log.at(2.0).at(0));
+}
+
+
+TEST(coral_master, InProcessSlaves_acceptStepAndStep)
+{
+    using namespace coral::master;
+    const auto timeout = std::chrono::seconds(1);
+
+    auto logger = std::make_shared<SimpleLogger>(1);
+    RunIdentityAndLogger("coral_test_in_process_merged", logger, [&] (Execution& execution) {
+        ASSERT_EQ(StepResult::completed, execution.Step(1.0, timeout));
+        for (int i = 1; i < 3; ++i) {
+            ASSERT_EQ(StepResult::completed, execution.AcceptStepAndStep(1.0, timeout));
+        }
+        execution.AcceptStep(timeout);
+    });
+
+    const auto log = logger->Log();
+    ASSERT_EQ(3U, log.size());
+    EXPECT_EQ(7.0, log.at(1.0).at(0));
+    EXPECT_EQ(7.0, log.at(2.0).at(0));
+}
+
+
+TEST(coral_master, InProcessSlaves_maxConcurrentSteps)
+{
+    using namespace coral::master;
+    const auto timeout = std::chrono::seconds(1);
+    const int slaveCount = 4;
+    const int stepCount = 3;
+
+    std::atomic<int> stepping(0);
+    std::atomic<int> maxStepping(0);
+    std::vector<std::shared_ptr<Sleeper>> instances;
+    auto execution = Execution("coral_test_in_process_concurrency");
+    {
+        InProcessSlaves localSlaves(2);
+        EXPECT_EQ(2U, localSlaves.MaxConcurrentSteps());
+        std::vector<AddedSlave> slaves;
+        for (int i = 0; i < slaveCount; ++i) {
+            instances.push_back(std::make_shared<Sleeper>(stepping, maxStepping));
+            slaves.emplace_back(
+                localSlaves.Add(instances.back(), std::chrono::seconds(10)),
+                "sleeper" + std::to_string(i));
+        }
+        execution.Reconstitute(slaves, timeout);
+        for (int i = 0; i < stepCount; ++i) {
+            ASSERT_EQ(StepResult::completed, execution.Step(1.0, timeout));
+            execution.AcceptStep(timeout);
+        }
+        execution.Terminate();
+    }
+    for (const auto& instance : instances) {
+        EXPECT_EQ(stepCount, instance->StepCount());
+    }
+    EXPECT_GE(maxStepping, 1);
+    EXPECT_LE(maxStepping, 2);
+}
@@ -0,0 +1,375 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include <coral/master/in_process.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include <coral/log.hpp>
+#include <coral/slave/runner.hpp>
+#include <coral/util.hpp>
+
+
+namespace coral
+{
+namespace master
+{
+
+
+// A fixed pool of worker threads which perform the slaves' time steps.
+//
+// Each worker has its own queue of tasks, and each slave submits its steps
+// to the queue of a "home" worker, so that a model's data tends to stay in
+// the cache of one core.  A worker whose queue is empty steals tasks from
+// the front of the other workers' queues, so that steps which are queued
+// behind an unusually slow model are picked up by whichever worker is free.
+class InProcessSlaves::StepExecutor
+{
+public:
+    explicit StepExecutor(std::size_t workerCount)
+        : m_queues(workerCount)
+    {
+        m_workers.reserve(workerCount);
+        for (std::size_t i = 0; i < workerCount; ++i) {
+            m_workers.emplace_back([this, i] () { Work(i); });
+        }
+    }
+
+    ~StepExecutor() noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_stopping = true;
+        }
+        m_workAvailable.notify_all();
+        for (auto& w : m_workers) w.join();
+    }
+
+    StepExecutor(const StepExecutor&) = delete;
+    StepExecutor& operator=(const StepExecutor&) = delete;
+
+    std::size_t WorkerCount() const noexcept { return m_workers.size(); }
+
+    // Runs `task` on one of the workers, preferably `homeWorker`, and waits
+    // for it to complete.  Exceptions thrown by the task are rethrown here.
+    template<typename F>
+    auto Run(std::size_t homeWorker, F&& task) -> decltype(task())
+    {
+        auto packagedTask = std::make_shared<std::packaged_task<decltype(task())()>>(
+            std::forward<F>(task));
+        auto result = packagedTask->get_future();
+        auto& queue = m_queues[homeWorker % m_queues.size()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.emplace_back([packagedTask] () { (*packagedTask)(); });
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            ++m_pendingTasks;
+        }
+        m_workAvailable.notify_all();
+        return result.get();
+    }
+
+private:
+    struct TaskQueue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void Work(std::size_t self)
+    {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(m_sleepMutex);
+                m_workAvailable.wait(lock, [this] () {
+                    return m_pendingTasks > 0 || m_stopping;
+                });
+                if (m_stopping) return;
+            }
+            std::function<void()> task;
+            if (TakeTask(self, task)) {
+                {
+                    std::lock_guard<std::mutex> lock(m_sleepMutex);
+                    --m_pendingTasks;
+                }
+                task();
+            } else {
+                // Another worker took the task between our wakeup and our
+                // search; yield rather than spin on the pending count.
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // Takes a task from the back of our own queue, or failing that, from
+    // the front of another worker's queue.
+    bool TakeTask(std::size_t self, std::function<void()>& task)
+    {
+        {
+            auto& own = m_queues[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (std::size_t i = 1; i < m_queues.size(); ++i) {
+            auto& victim = m_queues[(self + i) % m_queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<TaskQueue> m_queues;
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_sleepMutex;
+    std::condition_variable m_workAvailable;
+    std::size_t m_pendingTasks = 0;
+    bool m_stopping = false;
+};
+
+
+// A slave instance wrapper which performs DoStep() on a StepExecutor worker.
+// Everything else is forwarded directly.
+class InProcessSlaves::ExecutorInstance : public coral::slave::Instance
+{
+public:
+    ExecutorInstance(
+        std::shared_ptr<coral::slave::Instance> instance,
+        std::shared_ptr<StepExecutor> stepExecutor,
+        std::size_t homeWorker)
+        : m_instance(std::move(instance))
+        , m_stepExecutor(std::move(stepExecutor))
+        , m_homeWorker(homeWorker)
+    {
+    }
+
+    coral::model::SlaveTypeDescription TypeDescription() const override
+    {
+        return m_instance->TypeDescription();
+    }
+
+    void Setup(
+        const std::string& slaveName,
+        const std::string& executionName,
+        coral::model::TimePoint startTime,
+        coral::model::TimePoint stopTime,
+        bool adaptiveStepSize,
+        double relativeTolerance) override
+    {
+        m_instance->Setup(slaveName, executionName, startTime, stopTime,
+            adaptiveStepSize, relativeTolerance);
+    }
+
+    void StartSimulation() override { m_instance->StartSimulation(); }
+
+    void EndSimulation() override { m_instance->EndSimulation(); }
+
+    bool DoStep(
+        coral::model::TimePoint currentT,
+        coral::model::TimeDuration deltaT) override
+    {
+        return m_stepExecutor->Run(m_homeWorker, [=] () {
+            return m_instance->DoStep(currentT, deltaT);
+        });
+    }
+
+    double GetRealVariable(coral::model::VariableID variable) const override
+    {
+        return m_instance->GetRealVariable(variable);
+    }
+
+    int GetIntegerVariable(coral::model::VariableID variable) const override
+    {
+        return m_instance->GetIntegerVariable(variable);
+    }
+
+    bool GetBooleanVariable(coral::model::VariableID variable) const override
+    {
+        return m_instance->GetBooleanVariable(variable);
+    }
+
+    std::string GetStringVariable(coral::model::VariableID variable) const override
+    {
+        return m_instance->GetStringVariable(variable);
+    }
+
+    bool SetRealVariable(coral::model::VariableID variable, double value) override
+    {
+        return m_instance->SetRealVariable(variable, value);
+    }
+
+    bool SetIntegerVariable(coral::model::VariableID variable, int value) override
+    {
+        return m_instance->SetIntegerVariable(variable, value);
+    }
+
+    bool SetBooleanVariable(coral::model::VariableID variable, bool value) override
+    {
+        return m_instance->SetBooleanVariable(variable, value);
+    }
+
+    bool SetStringVariable(coral::model::VariableID variable, const std::string& value) override
+    {
+        return m_instance->SetStringVariable(variable, value);
+    }
+
+    std::unique_ptr<coral::slave::VariableList> PrepareVariables(
+        coral::model::DataType dataType,
+        std::vector<coral::model::VariableID> variables) const override
+    {
+        return m_instance->PrepareVariables(dataType, std::move(variables));
+    }
+
+    void GetRealVariables(const coral::slave::VariableList& variables, double* values) const override
+    {
+        m_instance->GetRealVariables(variables, values);
+    }
+
+    void GetIntegerVariables(const coral::slave::VariableList& variables, int* values) const override
+    {
+        m_instance->GetIntegerVariables(variables, values);
+    }
+
+    void GetBooleanVariables(const coral::slave::VariableList& variables, bool* values) const override
+    {
+        m_instance->GetBooleanVariables(variables, values);
+    }
+
+    void GetStringVariables(const coral::slave::VariableList& variables, std::string* values) const override
+    {
+        m_instance->GetStringVariables(variables, values);
+    }
+
+    bool SetRealVariables(const coral::slave::VariableList& variables, const double* values) override
+    {
+        return m_instance->SetRealVariables(variables, values);
+    }
+
+    bool SetIntegerVariables(const coral::slave::VariableList& variables, const int* values) override
+    {
+        return m_instance->SetIntegerVariables(variables, values);
+    }
+
+    bool SetBooleanVariables(const coral::slave::VariableList& variables, const bool* values) override
+    {
+        return m_instance->SetBooleanVariables(variables, values);
+    }
+
+    bool SetStringVariables(const coral::slave::VariableList& variables, const std::string* values) override
+    {
+        return m_instance->SetStringVariables(variables, values);
+    }
+
+private:
+    std::shared_ptr<coral::slave::Instance> m_instance;
+    std::shared_ptr<StepExecutor> m_stepExecutor;
+    std::size_t m_homeWorker;
+};
+
+
+InProcessSlaves::InProcessSlaves(std::size_t maxConcurrentSteps)
+{
+    if (maxConcurrentSteps == 0) {
+        maxConcurrentSteps = std::max(1u, std::thread::hardware_concurrency());
+    }
+    m_stepExecutor = std::make_shared<StepExecutor>(maxConcurrentSteps);
+}
+
+
+InProcessSlaves::~InProcessSlaves() noexcept
+{
+    JoinAll();
+}
+
+
+InProcessSlaves::InProcessSlaves(InProcessSlaves&& other) noexcept
+    : m_stepExecutor(std::move(other.m_stepExecutor))
+    , m_threads(std::move(other.m_threads))
+{
+    other.m_threads.clear();
+}
+
+
+InProcessSlaves& InProcessSlaves::operator=(InProcessSlaves&& other) noexcept
+{
+    JoinAll();
+    m_stepExecutor = std::move(other.m_stepExecutor);
+    m_threads = std::move(other.m_threads);
+    other.m_threads.clear();
+    return *this;
+}
+
+
+coral::net::SlaveLocator InProcessSlaves::Add(
+    std::shared_ptr<coral::slave::Instance> instance,
+    std::chrono::seconds commTimeout)
+{
+    // The Runner is created here rather than in the new thread, so that its
+    // sockets are bound before the master tries to connect to them, and so
+    // that errors are reported to the caller.
+    auto runner = coral::slave::Runner(
+        std::make_shared<ExecutorInstance>(
+            instance, m_stepExecutor, m_threads.size()),
+        coral::net::Endpoint("inproc", coral::util::RandomUUID()),
+        coral::net::Endpoint("inproc", coral::util::RandomUUID()),
+        commTimeout);
+    const auto locator = coral::net::SlaveLocator(
+        runner.BoundControlEndpoint(),
+        runner.BoundDataPubEndpoint());
+
+    m_threads.emplace_back([r = std::move(runner)] () mutable {
+        try {
+            r.Run();
+        } catch (const std::exception& e) {
+            coral::log::Log(
+                coral::log::error,
+                std::string("In-process slave terminated with an error: ") + e.what());
+        }
+    });
+    return locator;
+}
+
+
+std::size_t InProcessSlaves::Size() const noexcept
+{
+    return m_threads.size();
+}
+
+
+std::size_t InProcessSlaves::MaxConcurrentSteps() const noexcept
+{
+    return m_stepExecutor ? m_stepExecutor->WorkerCount() : 0;
+}
+
+
+void InProcessSlaves::JoinAll() noexcept
+{
+    for (auto& t : m_threads) {
+        if (t.joinable()) t.join();
+    }
+    m_threads.clear();
+}
+
+
+}} // namespace
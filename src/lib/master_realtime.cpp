@@ -0,0 +1,105 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include <coral/master/realtime.hpp>
+
+#include <algorithm>
+
+#include <coral/error.hpp>
+
+
+namespace coral
+{
+namespace master
+{
+
+
+RealTimePacer::RealTimePacer(const RealTimeOptions& options)
+    : m_options(options)
+    , m_started(false)
+    , m_nextStepTime(Clock::time_point::min())
+    , m_stepCount(0)
+    , m_overrunCount(0)
+    , m_skippedPeriods(0)
+    , m_latenessSum(0.0)
+    , m_maxLateness(Clock::duration::zero())
+    , m_histogram(options.histogramBinCount, 0)
+{
+    CORAL_INPUT_CHECK(options.realTimeFactor > 0.0);
+    CORAL_INPUT_CHECK(options.spinDuration.count() >= 0);
+    CORAL_INPUT_CHECK(options.histogramBinWidth.count() > 0);
+    CORAL_INPUT_CHECK(options.histogramBinCount > 0);
+}
+
+
+const RealTimeOptions& RealTimePacer::Options() const noexcept
+{
+    return m_options;
+}
+
+
+RealTimePacer::Clock::time_point RealTimePacer::NextStepTime() const noexcept
+{
+    return m_nextStepTime;
+}
+
+
+void RealTimePacer::StepStarted(
+    coral::model::TimeDuration stepSize,
+    Clock::time_point now)
+{
+    CORAL_INPUT_CHECK(stepSize > 0.0);
+    const auto period = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(stepSize / m_options.realTimeFactor));
+
+    if (!m_started) {
+        m_nextStepTime = now;
+        m_started = true;
+    }
+    const auto lateness = std::max(now - m_nextStepTime, Clock::duration::zero());
+    if (period > Clock::duration::zero() && lateness >= period) {
+        ++m_overrunCount;
+        if (m_options.overrunPolicy == OverrunPolicy::skip) {
+            m_skippedPeriods += lateness / period;
+            m_nextStepTime = now;
+        }
+    }
+    m_nextStepTime += period;
+
+    ++m_stepCount;
+    m_latenessSum += std::chrono::duration<double, std::nano>(lateness).count();
+    m_maxLateness = std::max(m_maxLateness, lateness);
+    const auto bin = static_cast<std::size_t>(lateness / m_options.histogramBinWidth);
+    ++m_histogram[std::min(bin, m_histogram.size() - 1)];
+}
+
+
+void RealTimePacer::Reset() noexcept
+{
+    m_started = false;
+    m_nextStepTime = Clock::time_point::min();
+}
+
+
+RealTimeStatistics RealTimePacer::Statistics() const
+{
+    RealTimeStatistics stats;
+    stats.stepCount = m_stepCount;
+    stats.overrunCount = m_overrunCount;
+    stats.skippedPeriods = m_skippedPeriods;
+    if (m_stepCount > 0) {
+        stats.meanLateness = std::chrono::nanoseconds(
+            static_cast<std::chrono::nanoseconds::rep>(m_latenessSum / m_stepCount));
+    }
+    stats.maxLateness =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(m_maxLateness);
+    stats.histogramBinWidth = m_options.histogramBinWidth;
+    stats.latenessHistogram = m_histogram;
+    return stats;
+}
+
+
+}} // namespace
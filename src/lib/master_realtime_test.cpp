@@ -0,0 +1,88 @@
+#include <chrono>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include <coral/master/realtime.hpp>
+
+
+using namespace coral::master;
+using namespace std::chrono_literals;
+
+
+TEST(coral_master, RealTimePacer_catchUp)
+{
+    RealTimeOptions options;
+    options.realTimeFactor = 2.0;
+    options.histogramBinWidth = 1ms;
+    options.histogramBinCount = 10;
+    RealTimePacer pacer(options);
+    const auto t0 = RealTimePacer::Clock::now();
+    EXPECT_LT(pacer.NextStepTime(), t0);
+
+    // 0.2 s simulated time = 100 ms wall clock time per step.
+    pacer.StepStarted(0.2, t0);
+    EXPECT_EQ(t0 + 100ms, pacer.NextStepTime());
+    pacer.StepStarted(0.2, t0 + 102ms);
+    EXPECT_EQ(t0 + 200ms, pacer.NextStepTime());
+
+    // Overrun: the schedule is kept, so the next steps are due immediately.
+    pacer.StepStarted(0.2, t0 + 450ms);
+    EXPECT_EQ(t0 + 300ms, pacer.NextStepTime());
+    pacer.StepStarted(0.2, t0 + 451ms);
+    EXPECT_EQ(t0 + 400ms, pacer.NextStepTime());
+
+    const auto stats = pacer.Statistics();
+    EXPECT_EQ(4u, stats.stepCount);
+    EXPECT_EQ(2u, stats.overrunCount);
+    EXPECT_EQ(0u, stats.skippedPeriods);
+    EXPECT_EQ(250ms, stats.maxLateness);
+    EXPECT_EQ(100750us, stats.meanLateness);
+    EXPECT_EQ(1ms, stats.histogramBinWidth);
+    ASSERT_EQ(10u, stats.latenessHistogram.size());
+    EXPECT_EQ(1u, stats.latenessHistogram[0]);
+    EXPECT_EQ(1u, stats.latenessHistogram[2]);
+    EXPECT_EQ(2u, stats.latenessHistogram[9]);
+}
+
+
+TEST(coral_master, RealTimePacer_skip)
+{
+    RealTimeOptions options;
+    options.overrunPolicy = OverrunPolicy::skip;
+    RealTimePacer pacer(options);
+    const auto t0 = RealTimePacer::Clock::now();
+
+    pacer.StepStarted(0.1, t0);
+    pacer.StepStarted(0.1, t0 + 350ms);
+    EXPECT_EQ(t0 + 450ms, pacer.NextStepTime());
+    pacer.StepStarted(0.1, t0 + 450ms);
+    EXPECT_EQ(t0 + 550ms, pacer.NextStepTime());
+
+    auto stats = pacer.Statistics();
+    EXPECT_EQ(3u, stats.stepCount);
+    EXPECT_EQ(1u, stats.overrunCount);
+    EXPECT_EQ(2u, stats.skippedPeriods);
+
+    // After a reset, the next step becomes the new origin.
+    pacer.Reset();
+    EXPECT_LT(pacer.NextStepTime(), t0);
+    pacer.StepStarted(0.1, t0 + 10s);
+    EXPECT_EQ(t0 + 10s + 100ms, pacer.NextStepTime());
+    stats = pacer.Statistics();
+    EXPECT_EQ(4u, stats.stepCount);
+    EXPECT_EQ(1u, stats.overrunCount);
+}
+
+
+TEST(coral_master, RealTimePacer_invalidOptions)
+{
+    RealTimeOptions options;
+    options.realTimeFactor = 0.0;
+    EXPECT_THROW(RealTimePacer{options}, std::invalid_argument);
+    options = RealTimeOptions();
+    options.histogramBinCount = 0;
+    EXPECT_THROW(RealTimePacer{options}, std::invalid_argument);
+    RealTimePacer pacer{RealTimeOptions()};
+    EXPECT_THROW(pacer.StepStarted(0.0), std::invalid_argument);
+}
@@ -10,9 +10,21 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include <coral/net/reactor.hpp>
 
 #include <algorithm>
+#include <cassert>
+#include <cmath>
 #include <stdexcept>
+#include <system_error>
+#include <coral/error.hpp>
+#include <coral/trace.hpp>
 #include <coral/util.hpp>
 
+#ifdef __linux__
+#   define CORAL_REACTOR_USE_EPOLL
+#   include <cerrno>
+#   include <sys/epoll.h>
+#   include <unistd.h>
+#endif
+
 
 namespace coral
 {
@@ -20,18 +32,344 @@ namespace net
 {
 
 
+// =============================================================================
+// Reactor::Poller
+// =============================================================================
+
+namespace
+{
+#ifdef _WIN32
+    const SOCKET NULL_NATIVE_SOCKET = INVALID_SOCKET;
+#else
+    const int NULL_NATIVE_SOCKET = -1;
+#endif
+}
+
+
+#ifdef CORAL_REACTOR_USE_EPOLL
+
+/*
+The epoll-based poller.
+
+ZMQ sockets are not file descriptors, but each of them has an associated file
+descriptor (ZMQ_FD) which is signalled when the socket's internal state may
+have changed.  The actual state must then be checked with ZMQ_EVENTS.  This
+has two consequences:
+
+  - A signalled descriptor does not mean that the socket has incoming messages.
+  - A socket with incoming messages may *not* have a signalled descriptor,
+    either because the messages were already there when the signal was
+    consumed, or because some other operation on the socket (e.g. a send)
+    consumed it.
+
+We therefore keep a list of "candidate" sockets, those which had incoming
+messages in the last iteration or which have been sent on since then (see
+Reactor::SocketSent()), and check them along with the ones whose descriptors
+have been signalled.  All sockets are only checked when the messaging loop
+starts, since messages may have been sent before that.
+*/
+class Reactor::Poller
+{
+public:
+    Poller(
+        const std::vector<SocketHandlerPair>& sockets,
+        const std::vector<NativeSocketHandlerPair>& nativeSockets)
+        : m_sockets(sockets),
+          m_nativeSockets(nativeSockets),
+          m_epollFD(epoll_create1(EPOLL_CLOEXEC)),
+          m_events(MAX_EVENTS)
+    {
+        if (m_epollFD < 0) {
+            throw std::system_error(errno, std::system_category(), "epoll_create1");
+        }
+    }
+
+    ~Poller() noexcept
+    {
+        close(m_epollFD);
+    }
+
+    Poller(const Poller&) = delete;
+    Poller& operator=(const Poller&) = delete;
+
+    void AddSocket(std::size_t index)
+    {
+        const auto socket = m_sockets[index].first;
+        auto it = m_zmqFDs.find(socket);
+        if (it == m_zmqFDs.end()) {
+            const auto fd = socket->getsockopt<int>(ZMQ_FD);
+            Register(fd, socket);
+            it = m_zmqFDs.emplace(socket, fd).first;
+        }
+        m_fds.at(it->second).indices.push_back(index);
+        // The socket may already have messages waiting.
+        m_candidates.push_back(it->second);
+    }
+
+    void RemoveSocket(zmq::socket_t& socket) noexcept
+    {
+        const auto it = m_zmqFDs.find(&socket);
+        if (it == m_zmqFDs.end()) return;
+        Unregister(it->second);
+        m_zmqFDs.erase(it);
+    }
+
+    void AddNativeSocket(std::size_t index)
+    {
+        const auto fd = m_nativeSockets[index].first;
+        if (!m_fds.count(fd)) Register(fd, nullptr);
+        m_fds.at(fd).indices.push_back(index);
+    }
+
+    void RemoveNativeSocket(NativeSocket socket) noexcept
+    {
+        if (m_fds.count(socket)) Unregister(socket);
+    }
+
+    // Called when null sockets have been removed from the socket lists,
+    // thus changing the indices.
+    void Reset()
+    {
+        for (auto& fd : m_fds) fd.second.indices.clear();
+        for (std::size_t i = 0; i < m_sockets.size(); ++i) {
+            m_fds.at(m_zmqFDs.at(m_sockets[i].first)).indices.push_back(i);
+        }
+        for (std::size_t i = 0; i < m_nativeSockets.size(); ++i) {
+            m_fds.at(m_nativeSockets[i].first).indices.push_back(i);
+        }
+    }
+
+    // Makes the socket a candidate for the next Wait() call, if it is
+    // registered with this poller.
+    void SocketSent(const zmq::socket_t& socket)
+    {
+        const auto it = m_zmqFDs.find(&socket);
+        if (it != m_zmqFDs.end()) m_candidates.push_back(it->second);
+    }
+
+    // Waits until some sockets have incoming messages, or until the timeout
+    // is reached, and returns the indices of those sockets in ascending
+    // order.  A negative timeout means no time limit.  If `checkAll` is
+    // true, all sockets are checked, not just the candidates.
+    void Wait(
+        std::chrono::milliseconds timeout,
+        bool checkAll,
+        std::vector<std::size_t>& readySockets,
+        std::vector<std::size_t>& readyNativeSockets)
+    {
+        readySockets.clear();
+        readyNativeSockets.clear();
+
+        auto toCheck = std::move(m_candidates);
+        m_candidates.clear();
+        if (checkAll) {
+            for (const auto& fd : m_zmqFDs) toCheck.push_back(fd.second);
+        }
+        Poll(0, toCheck, readyNativeSockets);
+        Check(toCheck, readySockets);
+
+        if (readySockets.empty() && readyNativeSockets.empty()) {
+            if (timeout.count() != 0) {
+                toCheck.clear();
+                Poll(static_cast<int>(timeout.count()), toCheck, readyNativeSockets);
+                Check(toCheck, readySockets);
+            }
+        }
+        std::sort(readySockets.begin(), readySockets.end());
+        std::sort(readyNativeSockets.begin(), readyNativeSockets.end());
+    }
+
+private:
+    static const int MAX_EVENTS = 256;
+
+    struct FD
+    {
+        // The ZMQ socket, or null for native sockets.
+        zmq::socket_t* socket;
+        // The indices of the socket's handlers in the socket list.
+        std::vector<std::size_t> indices;
+    };
+
+    void Register(int fd, zmq::socket_t* socket)
+    {
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(m_epollFD, EPOLL_CTL_ADD, fd, &event) != 0
+            // The descriptor may be a new one with the same number as one
+            // which was closed without being unregistered.
+            && (errno != EEXIST
+                || epoll_ctl(m_epollFD, EPOLL_CTL_MOD, fd, &event) != 0))
+        {
+            throw std::system_error(errno, std::system_category(), "epoll_ctl");
+        }
+        m_fds[fd] = FD{socket, {}};
+    }
+
+    void Unregister(int fd) noexcept
+    {
+        // This fails if the descriptor has already been closed, in which
+        // case it has also been removed from the epoll set.
+        epoll_event event = {};
+        epoll_ctl(m_epollFD, EPOLL_CTL_DEL, fd, &event);
+        m_fds.erase(fd);
+    }
+
+    // Calls epoll_wait() and adds signalled ZMQ socket descriptors to
+    // `zmqFDs` and the indices of signalled native sockets to
+    // `readyNativeSockets`.
+    void Poll(
+        int timeoutMS,
+        std::vector<int>& zmqFDs,
+        std::vector<std::size_t>& readyNativeSockets)
+    {
+        const auto n = epoll_wait(m_epollFD, m_events.data(), MAX_EVENTS, timeoutMS);
+        if (n < 0) {
+            if (errno == EINTR) return;
+            throw std::system_error(errno, std::system_category(), "epoll_wait");
+        }
+        for (int i = 0; i < n; ++i) {
+            const auto it = m_fds.find(m_events[i].data.fd);
+            if (it == m_fds.end()) continue;
+            if (it->second.socket) {
+                zmqFDs.push_back(it->first);
+            } else {
+                readyNativeSockets.insert(
+                    readyNativeSockets.end(),
+                    it->second.indices.begin(),
+                    it->second.indices.end());
+            }
+        }
+    }
+
+    // Checks which of the ZMQ sockets with the given descriptors have
+    // incoming messages, and adds their indices to `readySockets`.
+    void Check(std::vector<int>& zmqFDs, std::vector<std::size_t>& readySockets)
+    {
+        std::sort(zmqFDs.begin(), zmqFDs.end());
+        zmqFDs.erase(std::unique(zmqFDs.begin(), zmqFDs.end()), zmqFDs.end());
+        for (const auto fd : zmqFDs) {
+            const auto it = m_fds.find(fd);
+            if (it == m_fds.end() || !it->second.socket) continue;
+            if (it->second.socket->getsockopt<int>(ZMQ_EVENTS) & ZMQ_POLLIN) {
+                readySockets.insert(
+                    readySockets.end(),
+                    it->second.indices.begin(),
+                    it->second.indices.end());
+                m_candidates.push_back(fd);
+            }
+        }
+    }
+
+    const std::vector<SocketHandlerPair>& m_sockets;
+    const std::vector<NativeSocketHandlerPair>& m_nativeSockets;
+    int m_epollFD;
+    std::vector<epoll_event> m_events;
+    std::unordered_map<int, FD> m_fds;
+    std::unordered_map<const zmq::socket_t*, int> m_zmqFDs;
+    std::vector<int> m_candidates;
+};
+
+#else // CORAL_REACTOR_USE_EPOLL
+
+// The zmq::poll()-based poller, which rebuilds the list of poll items
+// whenever a socket has been added or removed.
+class Reactor::Poller
+{
+public:
+    Poller(
+        const std::vector<SocketHandlerPair>& sockets,
+        const std::vector<NativeSocketHandlerPair>& nativeSockets)
+        : m_sockets(sockets),
+          m_nativeSockets(nativeSockets),
+          m_needsRebuild(false)
+    { }
+
+    void AddSocket(std::size_t) { m_needsRebuild = true; }
+    void RemoveSocket(zmq::socket_t&) noexcept { m_needsRebuild = true; }
+    void AddNativeSocket(std::size_t) { m_needsRebuild = true; }
+    void RemoveNativeSocket(NativeSocket) noexcept { m_needsRebuild = true; }
+    void Reset() { m_needsRebuild = true; }
+    void SocketSent(const zmq::socket_t&) { }
+
+    void Wait(
+        std::chrono::milliseconds timeout,
+        bool /*checkAll*/,
+        std::vector<std::size_t>& readySockets,
+        std::vector<std::size_t>& readyNativeSockets)
+    {
+        if (m_needsRebuild) Rebuild();
+        readySockets.clear();
+        readyNativeSockets.clear();
+        zmq::poll(m_pollItems.data(), m_pollItems.size(), static_cast<long>(timeout.count()));
+        std::size_t j = 0;
+        for (std::size_t i = 0; i < m_sockets.size(); ++i, ++j) {
+            if (m_pollItems[j].revents & ZMQ_POLLIN) readySockets.push_back(i);
+        }
+        for (std::size_t i = 0; i < m_nativeSockets.size(); ++i, ++j) {
+            if (m_pollItems[j].revents & ZMQ_POLLIN) readyNativeSockets.push_back(i);
+        }
+        assert(j == m_pollItems.size());
+    }
+
+private:
+    void Rebuild()
+    {
+        m_pollItems.clear();
+        for (const auto& s : m_sockets) {
+            zmq::pollitem_t pi = { static_cast<void*>(*s.first), 0, ZMQ_POLLIN, 0 };
+            m_pollItems.push_back(pi);
+        }
+        for (const auto& s : m_nativeSockets) {
+            zmq::pollitem_t pi = { nullptr, s.first, ZMQ_POLLIN, 0 };
+            m_pollItems.push_back(pi);
+        }
+        m_needsRebuild = false;
+    }
+
+    const std::vector<SocketHandlerPair>& m_sockets;
+    const std::vector<NativeSocketHandlerPair>& m_nativeSockets;
+    std::vector<zmq::pollitem_t> m_pollItems;
+    bool m_needsRebuild;
+};
+
+#endif // CORAL_REACTOR_USE_EPOLL
+
+
+// =============================================================================
+// Reactor
+// =============================================================================
+
+
 Reactor::Reactor()
-    : m_nextTimerID(0),
+    : m_poller(std::make_unique<Poller>(m_sockets, m_nativeSockets)),
+      m_nextTimerID(0),
       m_needsRebuild(false),
-      m_running(false)
+      m_running(false),
+      m_enclosingReactor(nullptr),
+      m_spinDuration(0),
+      m_lateEventCount(0),
+      m_latenessSum(0.0),
+      m_latenessSquareSum(0.0),
+      m_maxLateness(0)
 { }
 
 
+Reactor::~Reactor() noexcept
+{
+}
+
+
 void Reactor::AddSocket(zmq::socket_t& socket, SocketHandler handler)
 {
     m_sockets.push_back(
         std::make_pair(&socket, std::make_unique<SocketHandler>(std::move(handler))));
-    m_needsRebuild = true;
+    try {
+        m_poller->AddSocket(m_sockets.size() - 1);
+    } catch (...) {
+        m_sockets.pop_back();
+        throw;
+    }
 }
 
 
@@ -42,6 +380,7 @@ void Reactor::RemoveSocket(zmq::socket_t& socket) noexcept
     for (auto it = m_sockets.begin(); it != m_sockets.end(); ++it) {
         if (it->first == &socket) it->first = nullptr;
     }
+    m_poller->RemoveSocket(socket);
     m_needsRebuild = true;
 }
 
@@ -52,17 +391,12 @@ void Reactor::AddNativeSocket(NativeSocket socket, NativeSocketHandler handler)
         std::make_pair(
             socket,
             std::make_unique<NativeSocketHandler>(std::move(handler))));
-    m_needsRebuild = true;
-}
-
-
-namespace
-{
-#ifdef _WIN32
-    const SOCKET NULL_NATIVE_SOCKET = INVALID_SOCKET;
-#else
-    const int NULL_NATIVE_SOCKET = -1;
-#endif
+    try {
+        m_poller->AddNativeSocket(m_nativeSockets.size() - 1);
+    } catch (...) {
+        m_nativeSockets.pop_back();
+        throw;
+    }
 }
 
 
@@ -73,6 +407,7 @@ void Reactor::RemoveNativeSocket(NativeSocket socket) noexcept
     for (auto& s : m_nativeSockets) {
         if (s.first == socket) s.first = NULL_NATIVE_SOCKET;
     }
+    m_poller->RemoveNativeSocket(socket);
     m_needsRebuild = true;
 }
 
@@ -85,26 +420,6 @@ namespace
     {
         return a.nextEventTime > b.nextEventTime;
     }
-
-    template<typename T>
-    void PushTimer(std::vector<T>& v, T t)
-    {
-        v.push_back(std::move(t));
-        std::push_heap(std::begin(v), std::end(v), EventTimeGreater<T>);
-    }
-
-    template<typename T>
-    void PopTimer(std::vector<T>& v)
-    {
-        std::pop_heap(std::begin(v), std::end(v), EventTimeGreater<T>);
-        v.pop_back();
-    }
-
-    template<typename T>
-    void HeapifyTimers(std::vector<T>& v)
-    {
-        std::make_heap(std::begin(v), std::end(v), &EventTimeGreater<T>);
-    }
 }
 
 
@@ -112,20 +427,20 @@ const int Reactor::invalidTimerID = -1;
 
 
 int Reactor::AddTimer(
-    std::chrono::milliseconds interval,
+    std::chrono::microseconds interval,
     int count,
     TimerHandler handler)
 {
-    if (interval < std::chrono::milliseconds(0)) {
+    if (interval < std::chrono::microseconds(0)) {
         throw std::invalid_argument("Negative interval");
     }
     if (count == 0) {
         throw std::invalid_argument("Invalid timer count");
     }
     const auto id = ++m_nextTimerID;
-    PushTimer(m_timers, Timer(
+    PushTimer(Timer(
         id,
-        std::chrono::system_clock::now() + interval,
+        std::chrono::steady_clock::now() + interval,
         interval,
         count,
         std::make_unique<TimerHandler>(std::move(handler))));
@@ -135,62 +450,121 @@ int Reactor::AddTimer(
 
 void Reactor::RemoveTimer(int id)
 {
-    const auto it = std::find_if(m_timers.begin(), m_timers.end(),
-        [id](const Timer& t){ return t.id == id; });
-    if (it == m_timers.end()) {
-        throw std::invalid_argument("Invalid timer ID");
-    }
-    m_timers.erase(it);
-    HeapifyTimers(m_timers);
+    EraseTimer(TimerPosition(id));
 }
 
 
 void Reactor::RestartTimerInterval(int id)
 {
-    const auto it = std::find_if(m_timers.begin(), m_timers.end(),
-        [id](const Timer& t){ return t.id == id; });
-    if (it == m_timers.end()) {
-        throw std::invalid_argument("Invalid timer ID");
+    const auto pos = TimerPosition(id);
+    m_timers[pos].nextEventTime =
+        std::chrono::steady_clock::now() + m_timers[pos].interval;
+    UpdateTimer(pos);
+}
+
+
+void Reactor::SetSpinDuration(std::chrono::microseconds duration)
+{
+    CORAL_INPUT_CHECK(duration >= std::chrono::microseconds(0));
+    m_spinDuration = duration;
+}
+
+
+coral::net::TimerJitter Reactor::TimerJitter() const noexcept
+{
+    coral::net::TimerJitter jitter;
+    jitter.eventCount = m_lateEventCount;
+    if (m_lateEventCount > 0) {
+        const auto n = static_cast<double>(m_lateEventCount);
+        const auto mean = m_latenessSum / n;
+        const auto variance = std::max(0.0, m_latenessSquareSum / n - mean * mean);
+        jitter.meanLateness = std::chrono::nanoseconds(
+            static_cast<std::chrono::nanoseconds::rep>(mean));
+        jitter.maxLateness = m_maxLateness;
+        jitter.stdDevLateness = std::chrono::nanoseconds(
+            static_cast<std::chrono::nanoseconds::rep>(std::sqrt(variance)));
+    }
+    return jitter;
+}
+
+
+void Reactor::ResetTimerJitter() noexcept
+{
+    m_lateEventCount = 0;
+    m_latenessSum = 0.0;
+    m_latenessSquareSum = 0.0;
+    m_maxLateness = std::chrono::nanoseconds(0);
+}
+
+
+namespace
+{
+    // The innermost reactor whose messaging loop is running in this thread.
+    thread_local Reactor* t_runningReactor = nullptr;
+}
+
+
+void Reactor::SocketSent(zmq::socket_t& socket) noexcept
+{
+    for (auto r = t_runningReactor; r != nullptr; r = r->m_enclosingReactor) {
+        try {
+            r->m_poller->SocketSent(socket);
+        } catch (...) {
+            // Out of memory.  The reactor may then miss incoming messages
+            // on the socket, but there is nothing more we can do.
+        }
     }
-    RestartTimerIntervals(it, it+1);
 }
 
 
 void Reactor::Run()
 {
-    RestartTimerIntervals(begin(m_timers), end(m_timers));
+    RestartAllTimerIntervals();
     m_running = true;
+    m_enclosingReactor = t_runningReactor;
+    t_runningReactor = this;
+    const auto popReactor = coral::util::OnScopeExit([this] () {
+        t_runningReactor = m_enclosingReactor;
+        m_enclosingReactor = nullptr;
+    });
+    std::vector<std::size_t> readySockets;
+    std::vector<std::size_t> readyNativeSockets;
+    bool checkAll = true;
     for (;;) {
         if (m_needsRebuild) Rebuild();
-        if (m_pollItems.empty() && m_timers.empty()) break;
-
-        // More sockets may be added by the handler functions, so we
-        // need to store the current sizes for use in the loops below.
-        const auto socketCount = m_sockets.size();
-        const auto nativeSocketCount = m_nativeSockets.size();
-        assert(m_pollItems.size() == socketCount + nativeSocketCount);
-
-        zmq::poll(m_pollItems.data(), m_pollItems.size(),
-                  m_timers.empty() ? -1 : static_cast<long>(TimeToNextEvent().count()));
-        std::size_t j = 0;
-        for (std::size_t i = 0; i < socketCount; ++i, ++j) {
-            assert(j < m_pollItems.size());
-            if ((m_pollItems[j].revents & ZMQ_POLLIN) && m_sockets[i].first != nullptr) {
+        if (m_sockets.empty() && m_nativeSockets.empty() && m_timers.empty()) break;
+
+        {
+            CORAL_TRACE_SCOPE("reactor", "wait");
+            m_poller->Wait(
+                m_timers.empty() ? std::chrono::milliseconds(-1) : TimeToNextEvent(),
+                checkAll,
+                readySockets,
+                readyNativeSockets);
+        }
+        checkAll = false;
+
+        // More sockets may be added by the handler functions, but they will
+        // not be among the ready ones, and null sockets are not removed until
+        // the next rebuild, so the indices remain valid.
+        for (const auto i : readySockets) {
+            assert(i < m_sockets.size());
+            if (m_sockets[i].first != nullptr) {
                 (*m_sockets[i].second)(*this, *m_sockets[i].first);
                 if (!m_running) goto endLoop;
             }
         }
-        for (std::size_t i = 0; i < nativeSocketCount; ++i, ++j) {
-            assert(j < m_pollItems.size());
-            if ((m_pollItems[j].revents & ZMQ_POLLIN) && m_nativeSockets[i].first != NULL_NATIVE_SOCKET) {
+        for (const auto i : readyNativeSockets) {
+            assert(i < m_nativeSockets.size());
+            if (m_nativeSockets[i].first != NULL_NATIVE_SOCKET) {
                 (*m_nativeSockets[i].second)(*this, m_nativeSockets[i].first);
                 if (!m_running) goto endLoop;
             }
         }
-        assert(j == m_pollItems.size());
 
         while (!m_timers.empty()
-               && std::chrono::system_clock::now() >= m_timers.front().nextEventTime) {
+               && std::chrono::steady_clock::now() >= m_timers.front().nextEventTime) {
+            CORAL_TRACE_SCOPE("reactor", "timer");
             PerformNextEvent();
             if (!m_running) goto endLoop;
         }
@@ -205,30 +579,111 @@ void Reactor::Stop()
 }
 
 
-void Reactor::RestartTimerIntervals(
-    std::vector<Timer>::iterator begin,
-    std::vector<Timer>::iterator end)
+void Reactor::PushTimer(Timer timer)
 {
-    const auto t0 = std::chrono::system_clock::now();
-    for (auto it = begin; it != end; ++it) {
-        it->nextEventTime = t0 + it->interval;
+    const auto pos = m_timers.size();
+    m_timerPositions[timer.id] = pos;
+    m_timers.push_back(std::move(timer));
+    SiftUp(pos);
+}
+
+
+void Reactor::EraseTimer(std::size_t pos)
+{
+    assert(pos < m_timers.size());
+    m_timerPositions.erase(m_timers[pos].id);
+    const auto last = m_timers.size() - 1;
+    if (pos != last) {
+        m_timers[pos] = std::move(m_timers[last]);
+        m_timerPositions[m_timers[pos].id] = pos;
+    }
+    m_timers.pop_back();
+    if (pos < m_timers.size()) UpdateTimer(pos);
+}
+
+
+void Reactor::UpdateTimer(std::size_t pos)
+{
+    if (pos > 0 && EventTimeGreater(m_timers[(pos - 1) / 2], m_timers[pos])) {
+        SiftUp(pos);
+    } else {
+        SiftDown(pos);
+    }
+}
+
+
+void Reactor::SiftUp(std::size_t pos)
+{
+    while (pos > 0) {
+        const auto parent = (pos - 1) / 2;
+        if (!EventTimeGreater(m_timers[parent], m_timers[pos])) break;
+        SwapTimers(parent, pos);
+        pos = parent;
+    }
+}
+
+
+void Reactor::SiftDown(std::size_t pos)
+{
+    const auto n = m_timers.size();
+    for (;;) {
+        const auto left = 2 * pos + 1;
+        if (left >= n) break;
+        const auto right = left + 1;
+        const auto earliest =
+            (right < n && EventTimeGreater(m_timers[left], m_timers[right]))
+            ? right : left;
+        if (!EventTimeGreater(m_timers[pos], m_timers[earliest])) break;
+        SwapTimers(pos, earliest);
+        pos = earliest;
+    }
+}
+
+
+void Reactor::SwapTimers(std::size_t a, std::size_t b)
+{
+    std::swap(m_timers[a], m_timers[b]);
+    m_timerPositions[m_timers[a].id] = a;
+    m_timerPositions[m_timers[b].id] = b;
+}
+
+
+std::size_t Reactor::TimerPosition(int id) const
+{
+    const auto it = m_timerPositions.find(id);
+    if (it == m_timerPositions.end()) {
+        throw std::invalid_argument("Invalid timer ID");
+    }
+    return it->second;
+}
+
+
+void Reactor::RestartAllTimerIntervals()
+{
+    const auto t0 = std::chrono::steady_clock::now();
+    for (auto& t : m_timers) t.nextEventTime = t0 + t.interval;
+    std::make_heap(m_timers.begin(), m_timers.end(), &EventTimeGreater<Timer>);
+    for (std::size_t i = 0; i < m_timers.size(); ++i) {
+        m_timerPositions[m_timers[i].id] = i;
     }
-    HeapifyTimers(m_timers);
 }
 
 
 std::chrono::milliseconds Reactor::TimeToNextEvent() const
 {
+    // duration_cast rounds towards zero, so we wake up early and spin for
+    // the remainder.
     return std::max(
         std::chrono::duration_cast<std::chrono::milliseconds>(
-            m_timers.front().nextEventTime - std::chrono::system_clock::now()),
+            m_timers.front().nextEventTime - m_spinDuration
+                - std::chrono::steady_clock::now()),
         std::chrono::milliseconds(0));
 }
 
 
 void Reactor::PerformNextEvent()
 {
-    assert (m_timers.front().nextEventTime <= std::chrono::system_clock::now());
+    assert (m_timers.front().nextEventTime <= std::chrono::steady_clock::now());
     assert (m_timers.front().remaining != 0);
 
     // The handler may delete the timer, thus also deleting some information
@@ -238,19 +693,32 @@ void Reactor::PerformNextEvent()
     const auto id = m_timers.front().id;
     auto handler = std::move(m_timers.front().handler);
 
+    const auto lateness = std::chrono::steady_clock::now() - m_timers.front().nextEventTime;
+    const auto latenessNS = static_cast<double>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(lateness).count());
+    ++m_lateEventCount;
+    m_latenessSum += latenessNS;
+    m_latenessSquareSum += latenessNS * latenessNS;
+    m_maxLateness = std::max(
+        m_maxLateness,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(lateness));
+
     // We use a scope guard, since the handler may throw.
     auto updateTimer = coral::util::OnScopeExit([&] () {
         // The timer may already have been removed by the handler, in which case
-        // we do nothing.
-        if (m_timers.front().id == id) {
-            auto t = std::move(m_timers.front());
-            t.handler = std::move(handler);
-            PopTimer(m_timers);
-            if (t.remaining > 0) --t.remaining;
-            if (t.remaining != 0) {
-                t.nextEventTime += t.interval;
-                PushTimer(m_timers, std::move(t));
-            }
+        // we do nothing.  Other timers may have been added or removed, so it
+        // is not necessarily at the front anymore.
+        const auto it = m_timerPositions.find(id);
+        if (it == m_timerPositions.end()) return;
+        const auto pos = it->second;
+        auto& t = m_timers[pos];
+        t.handler = std::move(handler);
+        if (t.remaining > 0) --t.remaining;
+        if (t.remaining == 0) {
+            EraseTimer(pos);
+        } else {
+            t.nextEventTime += t.interval;
+            UpdateTimer(pos);
         }
     });
     (*handler)(*this, id);
@@ -269,16 +737,7 @@ void Reactor::Rebuild()
         [](const NativeSocketHandlerPair& a) { return a.first == NULL_NATIVE_SOCKET; });
     m_nativeSockets.erase(newEnd2, m_nativeSockets.end());
 
-    // Rebuild m_pollItems
-    m_pollItems.clear();
-    for (const auto& s : m_sockets) {
-        zmq::pollitem_t pi = { static_cast<void*>(*s.first), 0, ZMQ_POLLIN, 0 };
-        m_pollItems.push_back(pi);
-    }
-    for (const auto& s : m_nativeSockets) {
-        zmq::pollitem_t pi = { nullptr, s.first, ZMQ_POLLIN, 0 };
-        m_pollItems.push_back(pi);
-    }
+    m_poller->Reset();
     m_needsRebuild = false;
 }
 
@@ -286,7 +745,7 @@ void Reactor::Rebuild()
 Reactor::Timer::Timer(
     int id_,
     TimePoint nextEventTime_,
-    std::chrono::milliseconds interval_,
+    std::chrono::microseconds interval_,
     int remaining_,
     std::unique_ptr<TimerHandler> handler_)
     : id(id_),
@@ -1,6 +1,12 @@
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
 #include <thread>
+#include <vector>
 #include <gtest/gtest.h>
 #include <coral/net/reactor.hpp>
+#include <coral/net/zmqx.hpp>
 
 using namespace coral::net;
 
@@ -181,3 +187,71 @@ TEST(coral_net, Reactor_autostop)
     reactor.Run();
     EXPECT_EQ(2, count);
 }
+
+
+TEST(coral_net, Reactor_microsecondTimer)
+{
+    Reactor reactor;
+    reactor.SetSpinDuration(std::chrono::microseconds(200));
+    EXPECT_THROW(
+        reactor.SetSpinDuration(std::chrono::microseconds(-1)),
+        std::invalid_argument);
+
+    const int eventCount = 50;
+    const auto interval = std::chrono::microseconds(250);
+    int count = 0;
+    reactor.AddTimer(interval, eventCount, [&count] (Reactor&, int) { ++count; });
+    const auto startTime = std::chrono::steady_clock::now();
+    reactor.Run();
+    const auto elapsed = std::chrono::steady_clock::now() - startTime;
+
+    EXPECT_EQ(eventCount, count);
+    EXPECT_GE(elapsed, eventCount * interval);
+    const auto jitter = reactor.TimerJitter();
+    EXPECT_EQ(static_cast<std::uint64_t>(eventCount), jitter.eventCount);
+    EXPECT_GE(jitter.maxLateness, jitter.meanLateness);
+    EXPECT_GE(jitter.meanLateness.count(), 0);
+
+    reactor.ResetTimerJitter();
+    EXPECT_EQ(0u, reactor.TimerJitter().eventCount);
+}
+
+
+// Messages are passed back and forth between two sockets which are both
+// registered with the same reactor, so every handler sends on a socket whose
+// incoming messages are signalled through the same mechanism.
+TEST(coral_net, Reactor_sendOnRegisteredSocket)
+{
+    zmq::context_t ctx;
+    zmq::socket_t a(ctx, ZMQ_PAIR);
+    a.bind("inproc://coral_net_Reactor_sendOnRegisteredSocket");
+    zmq::socket_t b(ctx, ZMQ_PAIR);
+    b.connect("inproc://coral_net_Reactor_sendOnRegisteredSocket");
+
+    const int roundTrips = 1000;
+    int count = 0;
+    Reactor reactor;
+    const auto bounce = [&] (zmq::socket_t& from, zmq::socket_t& to) {
+        std::vector<zmq::message_t> msg;
+        coral::net::zmqx::Receive(from, msg);
+        if (++count == 2 * roundTrips) {
+            reactor.Stop();
+        } else {
+            coral::net::zmqx::Send(to, msg);
+        }
+    };
+    // Each handler also replies on the socket it received from, so that
+    // both sockets are always being sent on.
+    reactor.AddSocket(a, [&] (Reactor&, zmq::socket_t& s) { bounce(s, s); });
+    reactor.AddSocket(b, [&] (Reactor&, zmq::socket_t& s) { bounce(s, s); });
+    reactor.AddTimer(std::chrono::seconds(10), 1, [] (Reactor& r, int) {
+        ADD_FAILURE() << "Messages were lost";
+        r.Stop();
+    });
+
+    std::vector<zmq::message_t> msg;
+    msg.emplace_back(1);
+    coral::net::zmqx::Send(a, msg);
+    reactor.Run();
+    EXPECT_EQ(2 * roundTrips, count);
+}
@@ -262,6 +262,30 @@ namespace
 }
 
 
+void ServerProtocolHandler::HandleRequestAsync(
+    const std::string& protocolIdentifier,
+    std::uint16_t protocolVersion,
+    const char* requestHeader, size_t requestHeaderSize,
+    const char* requestBody, size_t requestBodySize,
+    ReplySender sendReply)
+{
+    const char* replyHeader = nullptr;
+    size_t replyHeaderSize = 0u;
+    const char* replyBody = nullptr;
+    size_t replyBodySize = 0u;
+    if (HandleRequest(
+            protocolIdentifier,
+            protocolVersion,
+            requestHeader, requestHeaderSize,
+            requestBody, requestBodySize,
+            replyHeader, replyHeaderSize,
+            replyBody, replyBodySize))
+    {
+        sendReply(replyHeader, replyHeaderSize, replyBody, replyBodySize);
+    }
+}
+
+
 class Server::Private
 {
 public:
@@ -269,10 +293,11 @@ public:
         coral::net::Reactor& reactor,
         const coral::net::Endpoint& endpoint)
         : m_reactor{reactor}
+        , m_socket{std::make_shared<coral::net::zmqx::RepSocket>()}
     {
-        m_socket.Bind(endpoint);
+        m_socket->Bind(endpoint);
         m_reactor.AddSocket(
-            m_socket.Socket(),
+            m_socket->Socket(),
             [this] (coral::net::Reactor&, zmq::socket_t&) {
                 HandleRequest();
             });
@@ -280,7 +305,7 @@ public:
 
     ~Private() noexcept
     {
-        m_reactor.RemoveSocket(m_socket.Socket());
+        m_reactor.RemoveSocket(m_socket->Socket());
     }
 
     Private(const Private&) = delete;
@@ -310,14 +335,14 @@ public:
 
     coral::net::Endpoint BoundEndpoint() const
     {
-        return m_socket.BoundEndpoint();
+        return m_socket->BoundEndpoint();
     }
 
 private:
     void HandleRequest()
     {
         std::vector<zmq::message_t> msg;
-        m_socket.Receive(msg);
+        m_socket->Receive(msg);
         if (msg.size() < 2 || msg[0].size() < 3) {
             // Ignore request
             return;
@@ -327,66 +352,70 @@ private:
             msg[0].size() - 2};
         const auto protocolVersion = coral::util::DecodeUint16(
             static_cast<const char*>(msg[0].data()) + protocolIdentifier.size());
+        const auto requestHeader = static_cast<const char*>(msg[1].data());
+        const auto requestHeaderSize = msg[1].size();
+        const auto requestBody =
+            msg.size() > 2 ? static_cast<const char*>(msg[2].data()) : nullptr;
+        const auto requestBodySize = msg.size() > 2 ? msg[2].size() : 0u;
 
-        const char* replyHeader = nullptr;
-        size_t replyHeaderSize = 0u;
-        const char* replyBody = nullptr;
-        size_t replyBodySize = 0u;
-
-        const auto hasReply = DispatchRequest(
-            protocolIdentifier,
-            protocolVersion,
-            static_cast<const char*>(msg[1].data()),
-            msg[1].size(),
-            msg.size() > 2 ? static_cast<const char*>(msg[2].data()) : nullptr,
-            msg.size() > 2 ? msg[2].size() : 0u,
-            replyHeader,
-            replyHeaderSize,
-            replyBody,
-            replyBodySize);
-        if (hasReply) {
-            assert(replyHeader != nullptr);
-            msg[1].rebuild(replyHeader, replyHeaderSize);
-            if (replyBody != nullptr) {
-                msg.resize(3);
-                msg[2].rebuild(replyBody, replyBodySize);
-            } else {
-                msg.resize(2);
-            }
-            m_socket.Send(msg);
-        } // else ignore request
-    }
-
-    bool DispatchRequest(
-        const std::string& protocolIdentifier,
-        std::uint16_t protocolVersion,
-        const char* requestHeader, size_t requestHeaderSize,
-        const char* requestBody, size_t requestBodySize,
-        const char*& replyHeader, size_t& replyHeaderSize,
-        const char*& replyBody, size_t& replyBodySize)
-    {
         if (protocolIdentifier == META_PROTOCOL_IDENTIFIER) {
-            return HandleMetaRequest(
-                protocolVersion,
-                requestHeader, requestHeaderSize,
-                requestBody, requestBodySize,
-                replyHeader, replyHeaderSize,
-                replyBody, replyBodySize);
+            const char* replyHeader = nullptr;
+            size_t replyHeaderSize = 0u;
+            const char* replyBody = nullptr;
+            size_t replyBodySize = 0u;
+            if (HandleMetaRequest(
+                    protocolVersion,
+                    requestHeader, requestHeaderSize,
+                    requestBody, requestBodySize,
+                    replyHeader, replyHeaderSize,
+                    replyBody, replyBodySize))
+            {
+                MakeReplySender(msg[0])(
+                    replyHeader, replyHeaderSize,
+                    replyBody, replyBodySize);
+            }
+            return;
         }
 
         const auto pi = m_handlers.find(protocolIdentifier);
-        if (pi == m_handlers.end()) return false;
+        if (pi == m_handlers.end()) return;
 
         const auto pv = pi->second.find(protocolVersion);
-        if (pv == pi->second.end()) return false;
+        if (pv == pi->second.end()) return;
 
-        return pv->second->HandleRequest(
+        pv->second->HandleRequestAsync(
             protocolIdentifier,
             protocolVersion,
             requestHeader, requestHeaderSize,
             requestBody, requestBodySize,
-            replyHeader, replyHeaderSize,
-            replyBody, replyBodySize);
+            MakeReplySender(msg[0]));
+    }
+
+    // Returns a function which sends a reply to the client which sent the
+    // last request.  `protocolFrame` is the first frame of the request,
+    // which is repeated in the reply.
+    ServerProtocolHandler::ReplySender MakeReplySender(
+        const zmq::message_t& protocolFrame)
+    {
+        const auto clientEnvelope = std::make_shared<std::vector<zmq::message_t>>(
+            m_socket->TakeClientEnvelope());
+        const auto protocol = std::make_shared<std::string>(
+            static_cast<const char*>(protocolFrame.data()),
+            protocolFrame.size());
+        const auto socket = std::weak_ptr<coral::net::zmqx::RepSocket>(m_socket);
+        return [clientEnvelope, protocol, socket] (
+            const char* replyHeader, size_t replyHeaderSize,
+            const char* replyBody, size_t replyBodySize)
+        {
+            assert(replyHeader != nullptr);
+            const auto s = socket.lock();
+            if (!s) return;
+            std::vector<zmq::message_t> reply;
+            reply.emplace_back(protocol->data(), protocol->size());
+            reply.emplace_back(replyHeader, replyHeaderSize);
+            if (replyBody != nullptr) reply.emplace_back(replyBody, replyBodySize);
+            s->SendTo(*clientEnvelope, reply);
+        };
     }
 
     bool HandleMetaRequest(
@@ -423,7 +452,8 @@ private:
     }
 
     coral::net::Reactor& m_reactor;
-    coral::net::zmqx::RepSocket m_socket;
+    // Reply senders hold weak references to it.
+    std::shared_ptr<coral::net::zmqx::RepSocket> m_socket;
     std::unordered_map<
             std::string,
             std::map<std::uint16_t, std::shared_ptr<ServerProtocolHandler>>>
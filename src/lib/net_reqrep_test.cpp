@@ -1,5 +1,7 @@
 #include <memory>
+#include <string>
 #include <thread>
+#include <vector>
 #include <gtest/gtest.h>
 #include <coral/net/reqrep.hpp>
 #include <coral/util.hpp>
@@ -289,3 +291,119 @@ TEST(coral_net_reqrep, ReqRepMoreErrors)
     runTest1();
     reactor.Run();
 }
+
+
+namespace
+{
+    // Replies to "SLOW" after a delay, and to "FAST" immediately, so that
+    // replies can be sent in a different order than the requests arrived.
+    class MyDeferringHandler : public dnr::ServerProtocolHandler
+    {
+    public:
+        MyDeferringHandler(coral::net::Reactor& reactor)
+            : m_reactor{reactor}
+        { }
+
+        bool HandleRequest(
+            const std::string&, std::uint16_t,
+            const char*, size_t,
+            const char*, size_t,
+            const char*&, size_t&,
+            const char*&, size_t&) override
+        {
+            ADD_FAILURE() << "HandleRequest() should not be called";
+            return false;
+        }
+
+        void HandleRequestAsync(
+            const std::string& protocolIdentifier,
+            std::uint16_t protocolVersion,
+            const char* requestHeader, size_t requestHeaderSize,
+            const char* requestBody, size_t requestBodySize,
+            ReplySender sendReply) override
+        {
+            const auto msg = std::string{requestHeader, requestHeaderSize};
+            if (msg == "SLOW") {
+                m_reactor.AddTimer(
+                    std::chrono::milliseconds(200),
+                    1,
+                    [sendReply] (coral::net::Reactor&, int) {
+                        sendReply("SLOW", 4, "zzz", 3);
+                    });
+            } else if (msg == "FAST") {
+                sendReply("FAST", 4, nullptr, 0);
+            } else if (msg == "KTHXBAI") {
+                sendReply("HUGZ", 4, nullptr, 0);
+                m_reactor.Stop();
+            }
+        }
+
+    private:
+        coral::net::Reactor& m_reactor;
+    };
+
+    void RunDeferringTestServer(const char* endpoint)
+    {
+        coral::net::Reactor reactor;
+        dnr::Server server{reactor, coral::net::Endpoint{endpoint}};
+        server.AddProtocolHandler(
+            MY_PROTOCOL_ID,
+            MY_PROTOCOL_VER,
+            std::make_shared<MyDeferringHandler>(reactor));
+        reactor.Run();
+    }
+}
+
+
+TEST(coral_net_reqrep, DeferredReply)
+{
+    const char* const endpoint = "inproc://coral_net_reqrep_deferred_reply_test";
+    auto serverThread = std::thread{&RunDeferringTestServer, endpoint};
+    auto joinServerThread = coral::util::OnScopeExit([&] () {
+        serverThread.join();
+    });
+
+    coral::net::Reactor reactor;
+    dnr::Client slowClient{reactor, MY_PROTOCOL_ID, coral::net::Endpoint{endpoint}};
+    dnr::Client fastClient{reactor, MY_PROTOCOL_ID, coral::net::Endpoint{endpoint}};
+    const auto timeout = std::chrono::seconds(5);
+
+    std::vector<std::string> replies;
+    slowClient.Request(
+        MY_PROTOCOL_VER, "SLOW", 4u, nullptr, 0u, timeout,
+        [&] (
+            const std::error_code& ec,
+            const char* replyHeader, size_t replyHeaderSize,
+            const char* replyBody, size_t replyBodySize)
+        {
+            EXPECT_TRUE(!ec);
+            replies.emplace_back(replyHeader, replyHeaderSize);
+            ASSERT_NE(nullptr, replyBody);
+            EXPECT_EQ("zzz", std::string(replyBody, replyBodySize));
+            slowClient.Request(
+                MY_PROTOCOL_VER, "KTHXBAI", 7u, nullptr, 0u, timeout,
+                [&] (const std::error_code& ec, const char*, size_t, const char*, size_t)
+                {
+                    EXPECT_TRUE(!ec);
+                    reactor.Stop();
+                });
+        });
+    // Give the slow request a head start.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    fastClient.Request(
+        MY_PROTOCOL_VER, "FAST", 4u, nullptr, 0u, timeout,
+        [&] (
+            const std::error_code& ec,
+            const char* replyHeader, size_t replyHeaderSize,
+            const char* replyBody, size_t)
+        {
+            EXPECT_TRUE(!ec);
+            replies.emplace_back(replyHeader, replyHeaderSize);
+            EXPECT_EQ(nullptr, replyBody);
+        });
+    reactor.Run();
+
+    ASSERT_EQ(2u, replies.size());
+    EXPECT_EQ("FAST", replies[0]);
+    EXPECT_EQ("SLOW", replies[1]);
+}
@@ -13,6 +13,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include <algorithm>
 #include <coral/config.h>
 #include <coral/error.hpp>
+#include <coral/net/reactor.hpp>
 
 
 namespace
@@ -75,6 +76,7 @@ void coral::net::zmqx::Send(
     CORAL_INPUT_CHECK(!message.empty());
     SendFrames(socket, message, flags);
     assert (message.empty());
+    coral::net::Reactor::SocketSent(socket);
 }
 
 
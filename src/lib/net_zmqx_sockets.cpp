@@ -269,6 +269,29 @@ void RepSocket::Send(std::vector<zmq::message_t>& msg)
 }
 
 
+std::vector<zmq::message_t> RepSocket::TakeClientEnvelope()
+{
+    CORAL_PRECONDITION_CHECK(!m_clientEnvelope.empty());
+    auto clientEnvelope = std::move(m_clientEnvelope);
+    m_clientEnvelope.clear();
+    return clientEnvelope;
+}
+
+
+void RepSocket::SendTo(
+    std::vector<zmq::message_t>& clientEnvelope,
+    std::vector<zmq::message_t>& msg)
+{
+    if (!m_socket) {
+        throw std::logic_error("Socket not bound/connected");
+    }
+    CORAL_INPUT_CHECK(!clientEnvelope.empty());
+    CORAL_INPUT_CHECK(!msg.empty());
+    coral::net::zmqx::Send(*m_socket, clientEnvelope, coral::net::zmqx::SendFlag::more);
+    coral::net::zmqx::Send(*m_socket, msg);
+}
+
+
 zmq::socket_t& RepSocket::Socket()
 {
     return *m_socket;
@@ -27,7 +27,16 @@ zmq::context_t& GlobalContext()
     //          problem has just shifted elsewhere)
     //      http://stackoverflow.com/q/19795245
     //
-    static auto globalContext = new zmq::context_t();
+    // The socket limit is raised to the maximum supported by libzmq, since
+    // the default (1023) is easily exceeded in executions with many slaves.
+    static auto globalContext = [] () {
+        const auto c = new zmq::context_t();
+#if ZMQ_VERSION >= ZMQ_MAKE_VERSION(4, 1, 0)
+        const auto socketLimit = zmq_ctx_get(*c, ZMQ_SOCKET_LIMIT);
+        if (socketLimit > 0) zmq_ctx_set(*c, ZMQ_MAX_SOCKETS, socketLimit);
+#endif
+        return c;
+    }();
     return *globalContext;
 }
 
@@ -6,6 +6,11 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 */
 #include <coral/protocol/exe_data.hpp>
 
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <string>
+
 #include <coral/error.hpp>
 #include <coral/protobuf.hpp>
 #include <coral/protocol/glue.hpp>
@@ -26,7 +31,7 @@ namespace ed = coral::protocol::exe_data;
 namespace {
     coral::model::Variable ParseHeader(const zmq::message_t& msg)
     {
-        if (msg.size() != ed::HEADER_SIZE) {
+        if (msg.size() != ed::HEADER_SIZE && msg.size() != ed::VERSIONED_HEADER_SIZE) {
             throw coral::error::ProtocolViolationException(
                 "Invalid header frame");
         }
@@ -35,6 +40,20 @@ namespace {
             coral::util::DecodeUint32(static_cast<const char*>(msg.data()) + 2));
     }
 
+    // Returns the body format specified in a header which has already been
+    // validated by ParseHeader().
+    ed::Format HeaderFormat(const zmq::message_t& msg)
+    {
+        if (msg.size() == ed::HEADER_SIZE) return ed::Format::protobuf;
+        const auto version =
+            static_cast<const unsigned char*>(msg.data())[ed::HEADER_SIZE];
+        if (version != static_cast<unsigned char>(ed::Format::binary)) {
+            throw coral::error::ProtocolNotSupported(
+                "Unknown variable value format: " + std::to_string(version));
+        }
+        return ed::Format::binary;
+    }
+
     void CreateRawHeader(
         const coral::model::Variable& var,
         char buf[ed::HEADER_SIZE])
@@ -43,11 +62,144 @@ namespace {
         coral::util::EncodeUint32(var.ID(), buf + 2);
     }
 
-    zmq::message_t CreateHeader(const coral::model::Variable& var)
+    zmq::message_t CreateHeader(
+        const coral::model::Variable& var,
+        ed::Format format = ed::Format::protobuf)
+    {
+        if (format == ed::Format::protobuf) {
+            auto msg = zmq::message_t(ed::HEADER_SIZE);
+            CreateRawHeader(var, static_cast<char*>(msg.data()));
+            return msg;
+        } else {
+            auto msg = zmq::message_t(ed::VERSIONED_HEADER_SIZE);
+            CreateRawHeader(var, static_cast<char*>(msg.data()));
+            static_cast<char*>(msg.data())[ed::HEADER_SIZE] =
+                static_cast<char>(format);
+            return msg;
+        }
+    }
+
+
+    // Sizes of the various fields in the binary formats.  See the
+    // documentation for ed::Format::binary and ed::BatchMessage.
+    const std::size_t STEP_ID_SIZE = 4;
+    const std::size_t VALUE_COUNT_SIZE = 4;
+    const std::size_t VARIABLE_ID_SIZE = 4;
+    const std::size_t TYPE_TAG_SIZE = 1;
+    const std::size_t FIXED_PAYLOAD_SIZE = 8;
+    const std::size_t STRING_LENGTH_SIZE = 4;
+
+    // The smallest possible batch message entry: an empty string.
+    const std::size_t MIN_BATCH_ENTRY_SIZE =
+        VARIABLE_ID_SIZE + TYPE_TAG_SIZE + STRING_LENGTH_SIZE;
+
+    // Returns the encoded size of a value, including the type tag.
+    class EncodedValueSize : public boost::static_visitor<std::size_t>
+    {
+    public:
+        std::size_t operator()(double) const { return TYPE_TAG_SIZE + FIXED_PAYLOAD_SIZE; }
+        std::size_t operator()(int) const { return TYPE_TAG_SIZE + FIXED_PAYLOAD_SIZE; }
+        std::size_t operator()(bool) const { return TYPE_TAG_SIZE + FIXED_PAYLOAD_SIZE; }
+        std::size_t operator()(const std::string& s) const
+        {
+            return TYPE_TAG_SIZE + STRING_LENGTH_SIZE + s.size();
+        }
+    };
+
+    // Encodes the type tag and payload of a value, and returns a pointer to
+    // one past the last byte written.
+    class EncodeValue : public boost::static_visitor<char*>
+    {
+    public:
+        explicit EncodeValue(char* target) : m_target(target) { }
+
+        char* operator()(double value) const
+        {
+            std::uint64_t bits;
+            std::memcpy(&bits, &value, sizeof bits);
+            return Fixed(coral::model::REAL_DATATYPE, bits);
+        }
+
+        char* operator()(int value) const
+        {
+            return Fixed(
+                coral::model::INTEGER_DATATYPE,
+                static_cast<std::uint64_t>(static_cast<std::int64_t>(value)));
+        }
+
+        char* operator()(bool value) const
+        {
+            return Fixed(coral::model::BOOLEAN_DATATYPE, value ? 1u : 0u);
+        }
+
+        char* operator()(const std::string& value) const
+        {
+            m_target[0] = static_cast<char>(coral::model::STRING_DATATYPE);
+            coral::util::EncodeUint32(
+                static_cast<std::uint32_t>(value.size()),
+                m_target + TYPE_TAG_SIZE);
+            const auto chars = m_target + TYPE_TAG_SIZE + STRING_LENGTH_SIZE;
+            std::memcpy(chars, value.data(), value.size());
+            return chars + value.size();
+        }
+
+    private:
+        char* Fixed(coral::model::DataType type, std::uint64_t payload) const
+        {
+            m_target[0] = static_cast<char>(type);
+            coral::util::EncodeUint64(payload, m_target + TYPE_TAG_SIZE);
+            return m_target + TYPE_TAG_SIZE + FIXED_PAYLOAD_SIZE;
+        }
+
+        char* m_target;
+    };
+
+    void EnforceAvailable(const char* pos, const char* end, std::size_t n)
+    {
+        if (static_cast<std::size_t>(end - pos) < n) {
+            throw coral::error::ProtocolViolationException(
+                "Truncated message body");
+        }
+    }
+
+    // Decodes the type tag and payload of a value, and returns a pointer to
+    // one past the last byte read.
+    const char* DecodeValue(
+        const char* pos,
+        const char* end,
+        coral::model::ScalarValue& value)
     {
-        auto msg = zmq::message_t(ed::HEADER_SIZE);
-        CreateRawHeader(var, static_cast<char*>(msg.data()));
-        return msg;
+        EnforceAvailable(pos, end, TYPE_TAG_SIZE);
+        const auto type = static_cast<coral::model::DataType>(
+            static_cast<unsigned char>(*pos));
+        pos += TYPE_TAG_SIZE;
+        if (type == coral::model::STRING_DATATYPE) {
+            EnforceAvailable(pos, end, STRING_LENGTH_SIZE);
+            const auto length = coral::util::DecodeUint32(pos);
+            pos += STRING_LENGTH_SIZE;
+            EnforceAvailable(pos, end, length);
+            value = std::string(pos, length);
+            return pos + length;
+        }
+        EnforceAvailable(pos, end, FIXED_PAYLOAD_SIZE);
+        const auto payload = coral::util::DecodeUint64(pos);
+        switch (type) {
+            case coral::model::REAL_DATATYPE: {
+                double d;
+                std::memcpy(&d, &payload, sizeof d);
+                value = d;
+                break; }
+            case coral::model::INTEGER_DATATYPE:
+                value = static_cast<int>(static_cast<std::int64_t>(payload));
+                break;
+            case coral::model::BOOLEAN_DATATYPE:
+                value = (payload != 0);
+                break;
+            default:
+                throw coral::error::ProtocolViolationException(
+                    "Invalid data type in message body");
+        }
+        return pos + FIXED_PAYLOAD_SIZE;
     }
 }
 
@@ -60,25 +212,51 @@ ed::Message ed::ParseMessage(const std::vector<zmq::message_t>& rawMsg)
     }
     Message m;
     m.variable = ParseHeader(rawMsg[0]);
-    coralproto::exe_data::TimestampedValue timestampedValue;
-    coral::protobuf::ParseFromFrame(rawMsg[1], timestampedValue);
-    m.timestepID = timestampedValue.timestep_id();
-    m.value = coral::protocol::FromProto(timestampedValue.value());
+    if (HeaderFormat(rawMsg[0]) == Format::binary) {
+        const auto begin = static_cast<const char*>(rawMsg[1].data());
+        const auto end = begin + rawMsg[1].size();
+        EnforceAvailable(begin, end, STEP_ID_SIZE);
+        m.timestepID =
+            static_cast<coral::model::StepID>(coral::util::DecodeUint32(begin));
+        if (DecodeValue(begin + STEP_ID_SIZE, end, m.value) != end) {
+            throw coral::error::ProtocolViolationException(
+                "Trailing data in message body");
+        }
+    } else {
+        coralproto::exe_data::TimestampedValue timestampedValue;
+        coral::protobuf::ParseFromFrame(rawMsg[1], timestampedValue);
+        m.timestepID = timestampedValue.timestep_id();
+        m.value = coral::protocol::FromProto(timestampedValue.value());
+    }
     return m;
 }
 
 
 void ed::CreateMessage(
     const ed::Message& message,
-    std::vector<zmq::message_t>& rawOut)
+    std::vector<zmq::message_t>& rawOut,
+    ed::Format format)
 {
     rawOut.clear();
-    rawOut.push_back(CreateHeader(message.variable));
-    coralproto::exe_data::TimestampedValue timestampedValue;
-    coral::protocol::ConvertToProto(message.value, *timestampedValue.mutable_value());
-    timestampedValue.set_timestep_id(message.timestepID);
-    rawOut.emplace_back();
-    coral::protobuf::SerializeToFrame(timestampedValue, rawOut[1]);
+    rawOut.push_back(CreateHeader(message.variable, format));
+    if (format == Format::binary) {
+        rawOut.emplace_back(
+            STEP_ID_SIZE + boost::apply_visitor(EncodedValueSize(), message.value));
+        const auto begin = static_cast<char*>(rawOut[1].data());
+        coral::util::EncodeUint32(
+            static_cast<std::uint32_t>(message.timestepID),
+            begin);
+        const auto end = boost::apply_visitor(
+            EncodeValue(begin + STEP_ID_SIZE),
+            message.value);
+        assert(end == begin + rawOut[1].size());
+    } else {
+        coralproto::exe_data::TimestampedValue timestampedValue;
+        coral::protocol::ConvertToProto(message.value, *timestampedValue.mutable_value());
+        timestampedValue.set_timestep_id(message.timestepID);
+        rawOut.emplace_back();
+        coral::protobuf::SerializeToFrame(timestampedValue, rawOut[1]);
+    }
 }
 
 
@@ -96,3 +274,98 @@ void ed::Unsubscribe(zmq::socket_t& socket, const coral::model::Variable& variab
     CreateRawHeader(variable, header);
     socket.setsockopt(ZMQ_UNSUBSCRIBE, header, HEADER_SIZE);
 }
+
+
+bool ed::IsBatchMessage(const std::vector<zmq::message_t>& rawMsg)
+{
+    return !rawMsg.empty()
+        && rawMsg[0].size() >= HEADER_SIZE
+        && coral::util::DecodeUint32(static_cast<const char*>(rawMsg[0].data()) + 2)
+            == BATCH_VARIABLE_ID;
+}
+
+
+void ed::ParseBatchMessage(
+    const std::vector<zmq::message_t>& rawMsg,
+    ed::BatchMessage& message)
+{
+    if (rawMsg.size() != 2) {
+        throw coral::error::ProtocolViolationException(
+            "Wrong number of frames");
+    }
+    const auto header = ParseHeader(rawMsg[0]);
+    if (header.ID() != BATCH_VARIABLE_ID) {
+        throw coral::error::ProtocolViolationException(
+            "Not a batch message");
+    }
+    message.slave = header.Slave();
+
+    const auto begin = static_cast<const char*>(rawMsg[1].data());
+    const auto end = begin + rawMsg[1].size();
+    EnforceAvailable(begin, end, STEP_ID_SIZE + VALUE_COUNT_SIZE);
+    message.timestepID =
+        static_cast<coral::model::StepID>(coral::util::DecodeUint32(begin));
+    const auto count = coral::util::DecodeUint32(begin + STEP_ID_SIZE);
+    auto pos = begin + STEP_ID_SIZE + VALUE_COUNT_SIZE;
+
+    // Check the count against the size of the message before allocating
+    // anything, so a bogus count can't make us allocate huge amounts of memory.
+    if (count > static_cast<std::size_t>(end - pos) / MIN_BATCH_ENTRY_SIZE) {
+        throw coral::error::ProtocolViolationException(
+            "Invalid value count in batch message");
+    }
+    message.values.resize(count);
+    for (auto& entry : message.values) {
+        EnforceAvailable(pos, end, VARIABLE_ID_SIZE);
+        entry.first = coral::util::DecodeUint32(pos);
+        pos = DecodeValue(pos + VARIABLE_ID_SIZE, end, entry.second);
+    }
+    if (pos != end) {
+        throw coral::error::ProtocolViolationException(
+            "Trailing data in batch message");
+    }
+}
+
+
+void ed::CreateBatchMessage(
+    coral::model::SlaveID slave,
+    coral::model::StepID timestepID,
+    const std::pair<coral::model::VariableID, coral::model::ScalarValue>* values,
+    std::size_t count,
+    std::vector<zmq::message_t>& rawOut)
+{
+    assert(count <= std::numeric_limits<std::uint32_t>::max());
+    std::size_t bodySize = STEP_ID_SIZE + VALUE_COUNT_SIZE;
+    for (std::size_t i = 0; i < count; ++i) {
+        bodySize += VARIABLE_ID_SIZE
+            + boost::apply_visitor(EncodedValueSize(), values[i].second);
+    }
+
+    rawOut.clear();
+    rawOut.push_back(CreateHeader(coral::model::Variable(slave, BATCH_VARIABLE_ID)));
+    rawOut.emplace_back(bodySize);
+    const auto begin = static_cast<char*>(rawOut[1].data());
+    coral::util::EncodeUint32(static_cast<std::uint32_t>(timestepID), begin);
+    coral::util::EncodeUint32(static_cast<std::uint32_t>(count), begin + STEP_ID_SIZE);
+    auto pos = begin + STEP_ID_SIZE + VALUE_COUNT_SIZE;
+    for (std::size_t i = 0; i < count; ++i) {
+        assert(values[i].first != BATCH_VARIABLE_ID);
+        coral::util::EncodeUint32(values[i].first, pos);
+        pos = boost::apply_visitor(
+            EncodeValue(pos + VARIABLE_ID_SIZE),
+            values[i].second);
+    }
+    assert(pos == begin + bodySize);
+}
+
+
+void ed::SubscribeBatch(zmq::socket_t& socket, coral::model::SlaveID slave)
+{
+    Subscribe(socket, coral::model::Variable(slave, BATCH_VARIABLE_ID));
+}
+
+
+void ed::UnsubscribeBatch(zmq::socket_t& socket, coral::model::SlaveID slave)
+{
+    Unsubscribe(socket, coral::model::Variable(slave, BATCH_VARIABLE_ID));
+}
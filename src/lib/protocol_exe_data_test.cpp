@@ -1,20 +1,101 @@
 #include <gtest/gtest.h>
+#include <coral/error.hpp>
 #include <coral/protocol/exe_data.hpp>
+#include <coral/util.hpp>
 
 namespace ed = coral::protocol::exe_data;
 
 TEST(coral_protocol_exe_data, CreateAndParse)
+{
+    const coral::model::ScalarValue values[] = {
+        3.14, -1e300, 0, -123, true, false, std::string(), std::string("Hello")
+    };
+    for (const auto format : { ed::Format::protobuf, ed::Format::binary }) {
+        for (const auto& value : values) {
+            ed::Message msg;
+            msg.variable = coral::model::Variable(123, 456);
+            msg.value = value;
+            msg.timestepID = 100;
+
+            std::vector<zmq::message_t> raw;
+            ed::CreateMessage(msg, raw, format);
+            EXPECT_EQ(
+                format == ed::Format::protobuf ? ed::HEADER_SIZE : ed::VERSIONED_HEADER_SIZE,
+                raw[0].size());
+
+            const auto msg2 = ed::ParseMessage(raw);
+            EXPECT_EQ(msg.variable,   msg2.variable);
+            EXPECT_EQ(msg.value,      msg2.value);
+            EXPECT_EQ(msg.timestepID, msg2.timestepID);
+        }
+    }
+}
+
+
+TEST(coral_protocol_exe_data, ParseInvalid)
 {
     ed::Message msg;
     msg.variable = coral::model::Variable(123, 456);
     msg.value = 3.14;
     msg.timestepID = 100;
+    std::vector<zmq::message_t> raw;
+
+    // Unknown format version
+    ed::CreateMessage(msg, raw, ed::Format::binary);
+    static_cast<char*>(raw[0].data())[ed::HEADER_SIZE] = 100;
+    EXPECT_THROW(ed::ParseMessage(raw), coral::error::ProtocolNotSupported);
+
+    // Truncated body
+    ed::CreateMessage(msg, raw, ed::Format::binary);
+    raw[1] = zmq::message_t(raw[1].data(), raw[1].size() - 1);
+    EXPECT_THROW(ed::ParseMessage(raw), coral::error::ProtocolViolationException);
+
+    // Invalid type tag
+    ed::CreateMessage(msg, raw, ed::Format::binary);
+    static_cast<char*>(raw[1].data())[4] = 100;
+    EXPECT_THROW(ed::ParseMessage(raw), coral::error::ProtocolViolationException);
+}
+
+
+TEST(coral_protocol_exe_data, CreateAndParseBatch)
+{
+    const std::vector<std::pair<coral::model::VariableID, coral::model::ScalarValue>>
+        values = {
+            {  1, 3.14 },
+            {  2, -123 },
+            { 10, true },
+            {  5, std::string("Hello World") },
+            {  7, std::string() },
+        };
 
     std::vector<zmq::message_t> raw;
-    ed::CreateMessage(msg, raw);
+    ed::CreateBatchMessage(123, 100, values.data(), values.size(), raw);
+    EXPECT_TRUE(ed::IsBatchMessage(raw));
 
-    const auto msg2 = ed::ParseMessage(raw);
-    EXPECT_EQ(msg.variable,   msg2.variable);
-    EXPECT_EQ(msg.value,      msg2.value);
-    EXPECT_EQ(msg.timestepID, msg2.timestepID);
+    ed::BatchMessage msg;
+    ed::ParseBatchMessage(raw, msg);
+    EXPECT_EQ(123, msg.slave);
+    EXPECT_EQ(100, msg.timestepID);
+    EXPECT_EQ(values, msg.values);
+
+    // Truncated message
+    raw[1] = zmq::message_t(raw[1].data(), raw[1].size() - 1);
+    EXPECT_THROW(ed::ParseBatchMessage(raw, msg), std::runtime_error);
+
+    // Value count which is larger than the message could possibly hold
+    ed::CreateBatchMessage(123, 100, values.data(), values.size(), raw);
+    coral::util::EncodeUint32(0xFFFFFFFFu, static_cast<char*>(raw[1].data()) + 4);
+    EXPECT_THROW(
+        ed::ParseBatchMessage(raw, msg),
+        coral::error::ProtocolViolationException);
+
+    // Ordinary messages are not batch messages
+    ed::Message single;
+    single.variable = coral::model::Variable(123, 456);
+    single.value = 3.14;
+    single.timestepID = 100;
+    ed::CreateMessage(single, raw);
+    EXPECT_FALSE(ed::IsBatchMessage(raw));
+    EXPECT_THROW(ed::ParseBatchMessage(raw, msg), std::runtime_error);
 }
+
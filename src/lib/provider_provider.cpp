@@ -8,12 +8,17 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <deque>
+#include <system_error>
+#include <unordered_map>
 
 #include <boost/numeric/conversion/cast.hpp>
 #include <zmq.hpp>
 
 #include <coral/bus/slave_provider_comm.hpp>
 #include <coral/error.hpp>
+#include <coral/log.hpp>
 #include <coral/net/reactor.hpp>
 #include <coral/net/service.hpp>
 #include <coral/net/zmqx.hpp>
@@ -28,13 +33,27 @@ namespace provider
 
 namespace
 {
+    // How often SlaveCreator::Maintain() is called.
+    const auto MAINTENANCE_INTERVAL = std::chrono::seconds(1);
+
+
     class MySlaveProviderOps : public coral::bus::SlaveProviderOps
     {
     public:
         MySlaveProviderOps(
-            std::vector<std::unique_ptr<SlaveCreator>>&& slaveTypes)
-            : m_slaveTypes(std::move(slaveTypes))
+            coral::net::Reactor& reactor,
+            std::vector<std::unique_ptr<SlaveCreator>>&& slaveTypes,
+            std::size_t maxConcurrentInstantiations)
+            : m_reactor(reactor)
+            , m_slaveTypes(std::move(slaveTypes))
+            , m_maxConcurrentInstantiations(maxConcurrentInstantiations)
         {
+            m_reactor.AddTimer(
+                MAINTENANCE_INTERVAL,
+                -1,
+                [this] (coral::net::Reactor&, int) {
+                    for (const auto& st : m_slaveTypes) st->Maintain();
+                });
         }
 
         int GetSlaveTypeCount() const noexcept override
@@ -50,6 +69,58 @@ namespace
         coral::net::SlaveLocator InstantiateSlave(
             const std::string& slaveTypeUUID,
             std::chrono::milliseconds timeout) override
+        {
+            const auto st = FindSlaveType(slaveTypeUUID);
+            if (st == nullptr) {
+                throw std::runtime_error("Unknown slave type");
+            }
+            coral::net::SlaveLocator loc;
+            if (!st->Instantiate(timeout, loc)) {
+                throw std::runtime_error(st->InstantiationFailureDescription());
+            }
+            return loc;
+        }
+
+        void InstantiateSlaveAsync(
+            const std::string& slaveTypeUUID,
+            std::chrono::milliseconds timeout,
+            InstantiateSlaveHandler onComplete) override
+        {
+            const auto st = FindSlaveType(slaveTypeUUID);
+            if (st == nullptr) {
+                onComplete(
+                    make_error_code(coral::error::generic_error::operation_failed),
+                    coral::net::SlaveLocator{},
+                    "Unknown slave type");
+                return;
+            }
+            if (m_activeInstantiations.size() >= m_maxConcurrentInstantiations) {
+                CORAL_LOG_DEBUG(boost::format(
+                    "%d instantiations in progress; queueing request")
+                    % m_activeInstantiations.size());
+                m_queuedInstantiations.push_back(
+                    QueuedInstantiation{st, timeout, std::move(onComplete)});
+                return;
+            }
+            StartInstantiation(st, timeout, std::move(onComplete));
+        }
+
+    private:
+        struct QueuedInstantiation
+        {
+            SlaveCreator* slaveType;
+            std::chrono::milliseconds timeout;
+            InstantiateSlaveHandler onComplete;
+        };
+
+        struct ActiveInstantiation
+        {
+            std::unique_ptr<PendingInstantiation> pending;
+            int timerID = coral::net::Reactor::invalidTimerID;
+            InstantiateSlaveHandler onComplete;
+        };
+
+        SlaveCreator* FindSlaveType(const std::string& slaveTypeUUID) const
         {
             const auto st = std::find_if(
                 begin(m_slaveTypes),
@@ -57,18 +128,107 @@ namespace
                 [&] (const decltype(m_slaveTypes)::value_type& e) {
                     return e->Description().UUID() == slaveTypeUUID;
                 });
-            if (st == end(m_slaveTypes)) {
-                throw std::runtime_error("Unknown slave type");
+            return st == end(m_slaveTypes) ? nullptr : st->get();
+        }
+
+        void StartInstantiation(
+            SlaveCreator* slaveType,
+            std::chrono::milliseconds timeout,
+            InstantiateSlaveHandler onComplete)
+        {
+            std::unique_ptr<PendingInstantiation> pending;
+            try {
+                pending = slaveType->StartInstantiation(timeout);
+            } catch (const std::runtime_error& e) {
+                onComplete(
+                    make_error_code(coral::error::generic_error::operation_failed),
+                    coral::net::SlaveLocator{},
+                    e.what());
+                return;
             }
-            coral::net::SlaveLocator loc;
-            if (!(*st)->Instantiate(timeout, loc)) {
-                throw std::runtime_error((*st)->InstantiationFailureDescription());
+
+            if (!pending) {
+                // This slave type only supports blocking instantiation.
+                coral::net::SlaveLocator loc;
+                if (slaveType->Instantiate(timeout, loc)) {
+                    onComplete(std::error_code{}, loc, std::string{});
+                } else {
+                    onComplete(
+                        make_error_code(coral::error::generic_error::operation_failed),
+                        coral::net::SlaveLocator{},
+                        slaveType->InstantiationFailureDescription());
+                }
+                return;
+            }
+
+            const auto id = ++m_lastInstantiationID;
+            auto& active = m_activeInstantiations[id];
+            active.pending = std::move(pending);
+            active.onComplete = std::move(onComplete);
+            m_reactor.AddSocket(
+                active.pending->Socket(),
+                [this, id] (coral::net::Reactor&, zmq::socket_t&) {
+                    auto& a = m_activeInstantiations.at(id);
+                    coral::net::SlaveLocator loc;
+                    std::string failureDescription;
+                    if (a.pending->Complete(loc, failureDescription)) {
+                        FinishInstantiation(id, std::error_code{}, loc, std::string{});
+                    } else {
+                        FinishInstantiation(
+                            id,
+                            make_error_code(coral::error::generic_error::operation_failed),
+                            coral::net::SlaveLocator{},
+                            failureDescription);
+                    }
+                });
+            if (timeout >= std::chrono::milliseconds(0)) {
+                active.timerID = m_reactor.AddTimer(
+                    timeout,
+                    1,
+                    [this, id, timeout] (coral::net::Reactor&, int) {
+                        FinishInstantiation(
+                            id,
+                            make_error_code(std::errc::timed_out),
+                            coral::net::SlaveLocator{},
+                            "Slave took more than "
+                                + std::to_string(timeout.count())
+                                + " milliseconds to start; presumably it has failed altogether");
+                    });
             }
-            return loc;
         }
 
-    private:
+        void FinishInstantiation(
+            int id,
+            const std::error_code& ec,
+            const coral::net::SlaveLocator& slaveLocator,
+            const std::string& errorMessage)
+        {
+            const auto it = m_activeInstantiations.find(id);
+            assert(it != m_activeInstantiations.end());
+            m_reactor.RemoveSocket(it->second.pending->Socket());
+            if (it->second.timerID != coral::net::Reactor::invalidTimerID) {
+                m_reactor.RemoveTimer(it->second.timerID);
+            }
+            const auto onComplete = std::move(it->second.onComplete);
+            m_activeInstantiations.erase(it);
+            onComplete(ec, slaveLocator, errorMessage);
+
+            while (!m_queuedInstantiations.empty()
+                    && m_activeInstantiations.size() < m_maxConcurrentInstantiations) {
+                auto next = std::move(m_queuedInstantiations.front());
+                m_queuedInstantiations.pop_front();
+                StartInstantiation(
+                    next.slaveType, next.timeout, std::move(next.onComplete));
+            }
+        }
+
+        coral::net::Reactor& m_reactor;
         const std::vector<std::unique_ptr<SlaveCreator>> m_slaveTypes;
+        const std::size_t m_maxConcurrentInstantiations;
+
+        int m_lastInstantiationID = 0;
+        std::unordered_map<int, ActiveInstantiation> m_activeInstantiations;
+        std::deque<QueuedInstantiation> m_queuedInstantiations;
     };
 
 
@@ -107,9 +267,11 @@ SlaveProvider::SlaveProvider(
     std::vector<std::unique_ptr<SlaveCreator>>&& slaveTypes,
     const coral::net::ip::Address& networkInterface,
     coral::net::ip::Port discoveryPort,
-    std::function<void(std::exception_ptr)> exceptionHandler)
+    std::function<void(std::exception_ptr)> exceptionHandler,
+    std::size_t maxConcurrentInstantiations)
 {
     CORAL_INPUT_CHECK(!slaveProviderID.empty());
+    CORAL_INPUT_CHECK(maxConcurrentInstantiations > 0);
 
     // We do as much as setup as possible in the "foreground" thread,
     // so that exceptions are most likely to be thrown here.
@@ -132,7 +294,10 @@ SlaveProvider::SlaveProvider(
         coral::net::ip::Endpoint{networkInterface, "*"}.ToEndpoint("tcp"));
     coral::bus::MakeSlaveProviderServer(
         *bg.server,
-        std::make_shared<MySlaveProviderOps>(std::move(slaveTypes)));
+        std::make_shared<MySlaveProviderOps>(
+            *bg.reactor,
+            std::move(slaveTypes),
+            maxConcurrentInstantiations));
 
     char beaconPayload[2];
     coral::util::EncodeUint16(
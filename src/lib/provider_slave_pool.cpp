@@ -0,0 +1,141 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include <coral/provider/slave_pool.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include <coral/error.hpp>
+#include <coral/log.hpp>
+#include <coral/net/zmqx.hpp>
+
+
+namespace coral
+{
+namespace provider
+{
+
+
+SlavePool::SlavePool(
+    std::size_t size,
+    std::chrono::milliseconds maxIdleTime,
+    SpawnSlave spawnSlave)
+    : m_size(size)
+    , m_maxIdleTime(maxIdleTime)
+    , m_spawnSlave(std::move(spawnSlave))
+{
+    CORAL_INPUT_CHECK(m_spawnSlave);
+}
+
+
+SlavePool::~SlavePool() noexcept
+{
+    ReleaseAll(std::chrono::milliseconds(0));
+}
+
+
+void SlavePool::Update()
+{
+    const auto now = std::chrono::steady_clock::now();
+    for (auto it = m_slaves.begin(); it != m_slaves.end(); ) {
+        if (!it->ready && coral::net::zmqx::WaitForIncoming(
+                it->statusSocket, std::chrono::milliseconds(0))) {
+            std::vector<zmq::message_t> status;
+            coral::net::zmqx::Receive(it->statusSocket, status);
+            if (coral::net::zmqx::ToString(status[0]) == "READY") {
+                it->ready = true;
+            } else {
+                coral::log::Log(
+                    coral::log::error,
+                    boost::format("Pooled slave failed to start: %s")
+                        % (status.size() == 2
+                            ? coral::net::zmqx::ToString(status[1])
+                            : std::string("Invalid data received from slave executable")));
+                it = m_slaves.erase(it);
+                continue;
+            }
+        }
+        if (m_maxIdleTime >= std::chrono::milliseconds(0) &&
+                now - it->startTime > m_maxIdleTime) {
+            CORAL_LOG_DEBUG("Discarding pooled slave which has been idle too long");
+            if (it->ready) it->statusSocket.send("RELEASE", 7, ZMQ_DONTWAIT);
+            it = m_slaves.erase(it);
+            continue;
+        }
+        ++it;
+    }
+}
+
+
+void SlavePool::Fill()
+{
+    while (m_slaves.size() < m_size) {
+        auto statusSocket = zmq::socket_t(
+            coral::net::zmqx::GlobalContext(),
+            ZMQ_DEALER);
+        statusSocket.setsockopt(ZMQ_LINGER, 100 /* ms */);
+        const auto statusPort = coral::net::zmqx::BindToEphemeralPort(statusSocket);
+        m_spawnSlave("tcp://localhost:" + std::to_string(statusPort));
+        m_slaves.push_back(PooledSlave{
+            std::move(statusSocket),
+            std::chrono::steady_clock::now(),
+            false});
+    }
+}
+
+
+std::unique_ptr<zmq::socket_t> SlavePool::Claim()
+{
+    const auto it = std::find_if(m_slaves.begin(), m_slaves.end(),
+        [] (const PooledSlave& s) { return s.ready; });
+    if (it == m_slaves.end()) return nullptr;
+    it->statusSocket.send("CLAIM", 5);
+    auto statusSocket = std::make_unique<zmq::socket_t>(
+        std::move(it->statusSocket));
+    m_slaves.erase(it);
+    return statusSocket;
+}
+
+
+void SlavePool::ReleaseAll(std::chrono::milliseconds wait)
+{
+    const auto deadline = std::chrono::steady_clock::now() + wait;
+    for (auto& s : m_slaves) {
+        try {
+            if (!s.ready) {
+                const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    deadline - std::chrono::steady_clock::now());
+                if (remaining.count() <= 0 ||
+                        !coral::net::zmqx::WaitForIncoming(s.statusSocket, remaining)) {
+                    continue;
+                }
+            }
+            s.statusSocket.send("RELEASE", 7, ZMQ_DONTWAIT);
+        } catch (const zmq::error_t& e) {
+            CORAL_LOG_DEBUG(boost::format("Failed to release pooled slave: %s")
+                % e.what());
+        }
+    }
+    m_slaves.clear();
+}
+
+
+std::size_t SlavePool::Size() const noexcept
+{
+    return m_slaves.size();
+}
+
+
+std::size_t SlavePool::ReadyCount() const noexcept
+{
+    return static_cast<std::size_t>(std::count_if(
+        m_slaves.begin(), m_slaves.end(),
+        [] (const PooledSlave& s) { return s.ready; }));
+}
+
+
+}} // namespace
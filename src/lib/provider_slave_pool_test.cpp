@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <zmq.hpp>
+
+#include <coral/net/zmqx.hpp>
+#include <coral/provider/slave_pool.hpp>
+
+
+using coral::provider::SlavePool;
+
+
+namespace
+{
+    // Stands in for a coralslave process started with --wait-for-claim.
+    // Each fake slave runs in its own thread and records the command it
+    // receives from the pool.
+    class FakeSlaves
+    {
+    public:
+        explicit FakeSlaves(bool fail = false) : m_fail(fail) { }
+
+        ~FakeSlaves()
+        {
+            for (auto& t : m_threads) t.join();
+        }
+
+        void Spawn(const std::string& statusEndpoint)
+        {
+            m_threads.emplace_back([this, statusEndpoint] () {
+                auto socket = zmq::socket_t(
+                    coral::net::zmqx::GlobalContext(),
+                    ZMQ_DEALER);
+                socket.setsockopt(ZMQ_LINGER, 1000);
+                socket.connect(statusEndpoint.c_str());
+                if (m_fail) {
+                    socket.send("ERROR", 5, ZMQ_SNDMORE);
+                    socket.send("Oops", 4);
+                    return;
+                }
+                socket.send("READY", 5);
+                std::string command = "TIMEOUT";
+                if (coral::net::zmqx::WaitForIncoming(
+                        socket, std::chrono::seconds(5))) {
+                    std::vector<zmq::message_t> msg;
+                    coral::net::zmqx::Receive(socket, msg);
+                    command = coral::net::zmqx::ToString(msg[0]);
+                }
+                if (command == "CLAIM") {
+                    socket.send("OK", 2, ZMQ_SNDMORE);
+                    socket.send("127.0.0.1:10001", 15, ZMQ_SNDMORE);
+                    socket.send("127.0.0.1:10002", 15);
+                }
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_commands.push_back(command);
+            });
+        }
+
+        // Waits for all fake slaves to finish, and returns their commands.
+        std::vector<std::string> Commands()
+        {
+            for (auto& t : m_threads) t.join();
+            m_threads.clear();
+            return m_commands;
+        }
+
+        std::size_t SpawnCount() const { return m_threads.size(); }
+
+    private:
+        bool m_fail;
+        std::vector<std::thread> m_threads;
+        std::mutex m_mutex;
+        std::vector<std::string> m_commands;
+    };
+
+    // Calls pool.Update() until `readyCount` slaves are ready, or a while
+    // has passed.
+    void WaitUntilReady(SlavePool& pool, std::size_t readyCount)
+    {
+        const auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (pool.ReadyCount() < readyCount &&
+                std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            pool.Update();
+        }
+    }
+}
+
+
+TEST(coral_provider, SlavePool_claimAndRelease)
+{
+    FakeSlaves slaves;
+    {
+        SlavePool pool(
+            2,
+            std::chrono::milliseconds(-1),
+            [&] (const std::string& ep) { slaves.Spawn(ep); });
+        EXPECT_EQ(nullptr, pool.Claim().get());
+        pool.Fill();
+        EXPECT_EQ(2U, pool.Size());
+        WaitUntilReady(pool, 2);
+        ASSERT_EQ(2U, pool.ReadyCount());
+
+        auto claimed = pool.Claim();
+        ASSERT_NE(nullptr, claimed.get());
+        EXPECT_EQ(1U, pool.Size());
+        ASSERT_TRUE(coral::net::zmqx::WaitForIncoming(
+            *claimed, std::chrono::seconds(5)));
+        std::vector<zmq::message_t> status;
+        coral::net::zmqx::Receive(*claimed, status);
+        ASSERT_EQ(3U, status.size());
+        EXPECT_EQ("OK", coral::net::zmqx::ToString(status[0]));
+        EXPECT_EQ("127.0.0.1:10001", coral::net::zmqx::ToString(status[1]));
+        EXPECT_EQ("127.0.0.1:10002", coral::net::zmqx::ToString(status[2]));
+
+        pool.ReleaseAll(std::chrono::seconds(1));
+        EXPECT_EQ(0U, pool.Size());
+    }
+    auto commands = slaves.Commands();
+    std::sort(commands.begin(), commands.end());
+    EXPECT_EQ((std::vector<std::string>{"CLAIM", "RELEASE"}), commands);
+}
+
+
+TEST(coral_provider, SlavePool_replaceStale)
+{
+    FakeSlaves slaves;
+    SlavePool pool(
+        1,
+        std::chrono::milliseconds(100),
+        [&] (const std::string& ep) { slaves.Spawn(ep); });
+    pool.Fill();
+    WaitUntilReady(pool, 1);
+    ASSERT_EQ(1U, pool.ReadyCount());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    pool.Update();
+    EXPECT_EQ(0U, pool.Size());
+    pool.Fill();
+    EXPECT_EQ(1U, pool.Size());
+    EXPECT_EQ(2U, slaves.SpawnCount());
+
+    pool.ReleaseAll(std::chrono::seconds(1));
+    EXPECT_EQ(
+        (std::vector<std::string>{"RELEASE", "RELEASE"}),
+        slaves.Commands());
+}
+
+
+TEST(coral_provider, SlavePool_failedSlave)
+{
+    FakeSlaves slaves(true);
+    SlavePool pool(
+        1,
+        std::chrono::milliseconds(-1),
+        [&] (const std::string& ep) { slaves.Spawn(ep); });
+    pool.Fill();
+    const auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (pool.Size() > 0 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        pool.Update();
+    }
+    EXPECT_EQ(0U, pool.Size());
+    EXPECT_EQ(nullptr, pool.Claim().get());
+}
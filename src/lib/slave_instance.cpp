@@ -0,0 +1,182 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include <coral/slave/instance.hpp>
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+
+namespace coral
+{
+namespace slave
+{
+
+
+namespace
+{
+    void CheckDataType(
+        const VariableList& variables,
+        coral::model::DataType expectedType)
+    {
+        if (variables.DataType() != expectedType) {
+            throw std::logic_error("Variable list has wrong data type");
+        }
+    }
+}
+
+
+VariableList::VariableList(
+    coral::model::DataType dataType,
+    std::vector<coral::model::VariableID> variables)
+    : m_dataType(dataType)
+    , m_variables(std::move(variables))
+{
+}
+
+
+coral::model::DataType VariableList::DataType() const noexcept
+{
+    return m_dataType;
+}
+
+
+const std::vector<coral::model::VariableID>& VariableList::Variables()
+    const noexcept
+{
+    return m_variables;
+}
+
+
+std::size_t VariableList::Size() const noexcept
+{
+    return m_variables.size();
+}
+
+
+std::unique_ptr<VariableList> Instance::PrepareVariables(
+    coral::model::DataType dataType,
+    std::vector<coral::model::VariableID> variables) const
+{
+    if (!variables.empty()) {
+        const auto typeDescription = TypeDescription();
+        for (const auto id : variables) {
+            if (typeDescription.Variable(id).DataType() != dataType) {
+                throw std::logic_error(
+                    "Variable " + std::to_string(id) + " has wrong data type");
+            }
+        }
+    }
+    return std::make_unique<VariableList>(dataType, std::move(variables));
+}
+
+
+void Instance::GetRealVariables(
+    const VariableList& variables,
+    double* values) const
+{
+    CheckDataType(variables, coral::model::REAL_DATATYPE);
+    const auto& ids = variables.Variables();
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        values[i] = GetRealVariable(ids[i]);
+    }
+}
+
+
+void Instance::GetIntegerVariables(
+    const VariableList& variables,
+    int* values) const
+{
+    CheckDataType(variables, coral::model::INTEGER_DATATYPE);
+    const auto& ids = variables.Variables();
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        values[i] = GetIntegerVariable(ids[i]);
+    }
+}
+
+
+void Instance::GetBooleanVariables(
+    const VariableList& variables,
+    bool* values) const
+{
+    CheckDataType(variables, coral::model::BOOLEAN_DATATYPE);
+    const auto& ids = variables.Variables();
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        values[i] = GetBooleanVariable(ids[i]);
+    }
+}
+
+
+void Instance::GetStringVariables(
+    const VariableList& variables,
+    std::string* values) const
+{
+    CheckDataType(variables, coral::model::STRING_DATATYPE);
+    const auto& ids = variables.Variables();
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        values[i] = GetStringVariable(ids[i]);
+    }
+}
+
+
+bool Instance::SetRealVariables(
+    const VariableList& variables,
+    const double* values)
+{
+    CheckDataType(variables, coral::model::REAL_DATATYPE);
+    const auto& ids = variables.Variables();
+    bool allGood = true;
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        if (!SetRealVariable(ids[i], values[i])) allGood = false;
+    }
+    return allGood;
+}
+
+
+bool Instance::SetIntegerVariables(
+    const VariableList& variables,
+    const int* values)
+{
+    CheckDataType(variables, coral::model::INTEGER_DATATYPE);
+    const auto& ids = variables.Variables();
+    bool allGood = true;
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        if (!SetIntegerVariable(ids[i], values[i])) allGood = false;
+    }
+    return allGood;
+}
+
+
+bool Instance::SetBooleanVariables(
+    const VariableList& variables,
+    const bool* values)
+{
+    CheckDataType(variables, coral::model::BOOLEAN_DATATYPE);
+    const auto& ids = variables.Variables();
+    bool allGood = true;
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        if (!SetBooleanVariable(ids[i], values[i])) allGood = false;
+    }
+    return allGood;
+}
+
+
+bool Instance::SetStringVariables(
+    const VariableList& variables,
+    const std::string* values)
+{
+    CheckDataType(variables, coral::model::STRING_DATATYPE);
+    const auto& ids = variables.Variables();
+    bool allGood = true;
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        if (!SetStringVariable(ids[i], values[i])) allGood = false;
+    }
+    return allGood;
+}
+
+
+}} // namespace
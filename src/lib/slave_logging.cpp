@@ -24,10 +24,15 @@ namespace slave
 
 LoggingInstance::LoggingInstance(
     std::shared_ptr<Instance> instance,
-    const std::string& outputFilePrefix)
+    const std::string& outputFilePrefix,
+    const RecordingSpec& spec)
     : m_instance{instance}
     , m_outputFilePrefix(outputFilePrefix)
+    , m_spec(spec)
+    , m_stepsSinceLogged(0)
+    , m_lastLoggedT(-coral::model::ETERNITY)
 {
+    CORAL_INPUT_CHECK(spec.stepInterval >= 1);
     if (m_outputFilePrefix.empty()) m_outputFilePrefix = "./";
 }
 
@@ -81,9 +86,16 @@ void LoggingInstance::Setup(
             e));
     }
 
-    m_outputStream << "Time";
-    const auto typeDescription  = TypeDescription();
+    const auto typeDescription = TypeDescription();
+    m_variables.clear();
     for (const auto& var : typeDescription.Variables()) {
+        if (m_spec.Includes(var)) m_variables.push_back(var);
+    }
+    m_stepsSinceLogged = 0;
+    m_lastLoggedT = -coral::model::ETERNITY;
+
+    m_outputStream << "Time";
+    for (const auto& var : m_variables) {
         m_outputStream << "," << var.Name();
     }
     m_outputStream << std::endl;
@@ -136,9 +148,13 @@ bool LoggingInstance::DoStep(
 {
     const auto ret = m_instance->DoStep(currentT, deltaT);
 
-    m_outputStream << std::fixed << (currentT + deltaT) << std::defaultfloat;
-    const auto typeDescription = TypeDescription();
-    for (const auto& var : typeDescription.Variables()) {
+    const auto t = currentT + deltaT;
+    if (!m_spec.IsDue(++m_stepsSinceLogged, t - m_lastLoggedT)) return ret;
+    m_stepsSinceLogged = 0;
+    m_lastLoggedT = t;
+
+    m_outputStream << std::fixed << t << std::defaultfloat;
+    for (const auto& var : m_variables) {
         PrintVariable(m_outputStream, var, *this);
     }
     m_outputStream << std::endl;
@@ -195,4 +211,76 @@ bool LoggingInstance::SetStringVariable(coral::model::VariableID varRef, const s
 }
 
 
+std::unique_ptr<VariableList> LoggingInstance::PrepareVariables(
+    coral::model::DataType dataType,
+    std::vector<coral::model::VariableID> variables) const
+{
+    return m_instance->PrepareVariables(dataType, std::move(variables));
+}
+
+
+void LoggingInstance::GetRealVariables(
+    const VariableList& variables,
+    double* values) const
+{
+    m_instance->GetRealVariables(variables, values);
+}
+
+
+void LoggingInstance::GetIntegerVariables(
+    const VariableList& variables,
+    int* values) const
+{
+    m_instance->GetIntegerVariables(variables, values);
+}
+
+
+void LoggingInstance::GetBooleanVariables(
+    const VariableList& variables,
+    bool* values) const
+{
+    m_instance->GetBooleanVariables(variables, values);
+}
+
+
+void LoggingInstance::GetStringVariables(
+    const VariableList& variables,
+    std::string* values) const
+{
+    m_instance->GetStringVariables(variables, values);
+}
+
+
+bool LoggingInstance::SetRealVariables(
+    const VariableList& variables,
+    const double* values)
+{
+    return m_instance->SetRealVariables(variables, values);
+}
+
+
+bool LoggingInstance::SetIntegerVariables(
+    const VariableList& variables,
+    const int* values)
+{
+    return m_instance->SetIntegerVariables(variables, values);
+}
+
+
+bool LoggingInstance::SetBooleanVariables(
+    const VariableList& variables,
+    const bool* values)
+{
+    return m_instance->SetBooleanVariables(variables, values);
+}
+
+
+bool LoggingInstance::SetStringVariables(
+    const VariableList& variables,
+    const std::string* values)
+{
+    return m_instance->SetStringVariables(variables, values);
+}
+
+
 }} // namespace
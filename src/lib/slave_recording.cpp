@@ -0,0 +1,1115 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include <coral/slave/recording.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <ios>
+#include <iomanip>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include <coral/error.hpp>
+#include <coral/log.hpp>
+#include <coral/util.hpp>
+
+
+/*
+File format
+-----------
+All integers are unsigned and little-endian, real numbers are IEEE 754
+doubles stored like 64-bit integers, and strings are stored as a 32-bit
+length followed by the characters (with no terminator).
+
+The file starts with a header:
+
+    magic                   8 bytes, "CORALREC"
+    format version          16 bits
+    execution name          string
+    slave name              string
+    slave type name         string
+    variable count          32 bits
+    variables               variable count times:
+        ID                  32 bits
+        data type           8 bits
+        causality           8 bits
+        variability         8 bits
+        name                string
+
+The header is followed by any number of blocks, each of which contains the
+values for a number of consecutive time steps ("rows"):
+
+    row count               32 bits
+    payload size            64 bits
+    payload:
+        time column         row count reals
+        real columns        one column of row count reals per real variable
+        integer columns     one column of row count 32-bit integers per
+                            integer variable
+        boolean columns     one column of row count 8-bit integers per
+                            boolean variable
+        string columns      one column of row count strings per string
+                            variable
+
+Within each data type, the columns are in the same order as the variables
+in the header.
+*/
+namespace
+{
+    const char RECORDING_MAGIC[8] = {'C', 'O', 'R', 'A', 'L', 'R', 'E', 'C'};
+    const std::uint16_t RECORDING_FORMAT_VERSION = 1;
+
+    const std::size_t UINT8_SIZE = 1;
+    const std::size_t UINT16_SIZE = 2;
+    const std::size_t UINT32_SIZE = 4;
+    const std::size_t UINT64_SIZE = 8;
+    const std::size_t BLOCK_HEADER_SIZE = UINT32_SIZE + UINT64_SIZE;
+
+    // Blocks are sized so they take up roughly this many bytes on disk,
+    // but never hold more than MAX_BLOCK_ROWS rows.
+    const std::size_t TARGET_BLOCK_SIZE = 1024 * 1024;
+    const std::size_t MAX_BLOCK_ROWS = 4096;
+    // A rough guess at the average size of a string value.
+    const std::size_t ESTIMATED_STRING_SIZE = 16;
+
+    char* EncodeReal(double value, char* target)
+    {
+        static_assert(sizeof(double) == UINT64_SIZE, "Unsupported double format");
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof bits);
+        coral::util::EncodeUint64(bits, target);
+        return target + UINT64_SIZE;
+    }
+
+    char* EncodeString(const std::string& value, char* target)
+    {
+        coral::util::EncodeUint32(
+            static_cast<std::uint32_t>(value.size()),
+            target);
+        std::memcpy(target + UINT32_SIZE, value.data(), value.size());
+        return target + UINT32_SIZE + value.size();
+    }
+
+    void AppendUint8(std::vector<char>& buffer, std::uint8_t value)
+    {
+        buffer.push_back(static_cast<char>(value));
+    }
+
+    void AppendUint16(std::vector<char>& buffer, std::uint16_t value)
+    {
+        char bytes[UINT16_SIZE];
+        coral::util::EncodeUint16(value, bytes);
+        buffer.insert(buffer.end(), bytes, bytes + UINT16_SIZE);
+    }
+
+    void AppendUint32(std::vector<char>& buffer, std::uint32_t value)
+    {
+        char bytes[UINT32_SIZE];
+        coral::util::EncodeUint32(value, bytes);
+        buffer.insert(buffer.end(), bytes, bytes + UINT32_SIZE);
+    }
+
+    void AppendString(std::vector<char>& buffer, const std::string& value)
+    {
+        AppendUint32(buffer, static_cast<std::uint32_t>(value.size()));
+        buffer.insert(buffer.end(), value.begin(), value.end());
+    }
+
+    std::vector<char> CreateFileHeader(
+        const std::string& executionName,
+        const std::string& slaveName,
+        const std::string& slaveTypeName,
+        const std::vector<coral::model::VariableDescription>& variables)
+    {
+        std::vector<char> header(RECORDING_MAGIC, RECORDING_MAGIC + sizeof RECORDING_MAGIC);
+        AppendUint16(header, RECORDING_FORMAT_VERSION);
+        AppendString(header, executionName);
+        AppendString(header, slaveName);
+        AppendString(header, slaveTypeName);
+        AppendUint32(header, static_cast<std::uint32_t>(variables.size()));
+        for (const auto& var : variables) {
+            AppendUint32(header, var.ID());
+            AppendUint8(header, static_cast<std::uint8_t>(var.DataType()));
+            AppendUint8(header, static_cast<std::uint8_t>(var.Causality()));
+            AppendUint8(header, static_cast<std::uint8_t>(var.Variability()));
+            AppendString(header, var.Name());
+        }
+        return header;
+    }
+
+    std::runtime_error CorruptRecording(const std::string& details)
+    {
+        return std::runtime_error("Invalid or corrupt recording file: " + details);
+    }
+
+    // Reads exactly `size` bytes from `in`, or throws.
+    void ReadExactly(std::istream& in, char* target, std::size_t size)
+    {
+        in.read(target, size);
+        if (static_cast<std::size_t>(in.gcount()) != size) {
+            if (in.bad()) throw std::runtime_error("Error reading recording file");
+            throw CorruptRecording("Unexpected end of file");
+        }
+    }
+
+    std::uint8_t ReadUint8(std::istream& in)
+    {
+        char byte;
+        ReadExactly(in, &byte, UINT8_SIZE);
+        return static_cast<std::uint8_t>(byte);
+    }
+
+    std::uint16_t ReadUint16(std::istream& in)
+    {
+        char bytes[UINT16_SIZE];
+        ReadExactly(in, bytes, UINT16_SIZE);
+        return coral::util::DecodeUint16(bytes);
+    }
+
+    std::uint32_t ReadUint32(std::istream& in)
+    {
+        char bytes[UINT32_SIZE];
+        ReadExactly(in, bytes, UINT32_SIZE);
+        return coral::util::DecodeUint32(bytes);
+    }
+
+    std::string ReadString(std::istream& in)
+    {
+        std::string s(ReadUint32(in), '\0');
+        if (!s.empty()) ReadExactly(in, &s[0], s.size());
+        return s;
+    }
+
+    // Decodes values from a block payload, checking that it doesn't run
+    // past the end of it.
+    class PayloadDecoder
+    {
+    public:
+        PayloadDecoder(const char* begin, const char* end)
+            : m_pos(begin), m_end(end)
+        { }
+
+        double Real()
+        {
+            std::uint64_t bits = coral::util::DecodeUint64(Take(UINT64_SIZE));
+            double value;
+            std::memcpy(&value, &bits, sizeof value);
+            return value;
+        }
+
+        int Integer()
+        {
+            return static_cast<std::int32_t>(coral::util::DecodeUint32(Take(UINT32_SIZE)));
+        }
+
+        char Boolean()
+        {
+            return *Take(UINT8_SIZE) != 0;
+        }
+
+        void String(std::string& value)
+        {
+            const auto size = coral::util::DecodeUint32(Take(UINT32_SIZE));
+            const auto data = Take(size);
+            value.assign(data, size);
+        }
+
+        bool AtEnd() const { return m_pos == m_end; }
+
+    private:
+        const char* Take(std::size_t size)
+        {
+            if (static_cast<std::size_t>(m_end - m_pos) < size) {
+                throw CorruptRecording("Block is shorter than expected");
+            }
+            const auto data = m_pos;
+            m_pos += size;
+            return data;
+        }
+
+        const char* m_pos;
+        const char* m_end;
+    };
+}
+
+
+namespace coral
+{
+namespace slave
+{
+
+
+// =============================================================================
+// RecordingSpec
+// =============================================================================
+
+
+bool RecordingSpec::Includes(const coral::model::VariableDescription& variable) const
+{
+    if (causalities != 0 && !(causalities & variable.Causality())) return false;
+    if (variables.empty()) return true;
+    for (const auto& pattern : variables) {
+        if (coral::util::GlobMatch(pattern, variable.Name())) return true;
+    }
+    return false;
+}
+
+
+bool RecordingSpec::IsDue(
+    int stepsSinceRecorded,
+    coral::model::TimeDuration timeSinceRecorded) const
+{
+    // The relative tolerance allows for round-off error in the time points,
+    // e.g. when the step size is an exact divisor of minTimeInterval.
+    const double tolerance = 1e-9;
+    return stepsSinceRecorded >= stepInterval
+        && timeSinceRecorded >= minTimeInterval * (1.0 - tolerance);
+}
+
+
+// =============================================================================
+// RecordingInstance::Writer
+// =============================================================================
+
+
+/*
+Collects values in blocks and writes them to file on a background thread.
+
+A fixed number of blocks are allocated up front.  The foreground thread
+fills the block returned by CurrentBlock() one row at a time, calling
+AddRow() after each.  When the block is full, it is handed over to the
+background thread, which encodes it into a reusable buffer, writes it with a
+single call, and returns it to the pool of free blocks.  If there are no free
+blocks when the foreground thread needs one, it either waits for one or drops
+values, depending on RecordingBufferOptions::dropWhenFull.
+*/
+class RecordingInstance::Writer
+{
+public:
+    // A number of consecutive rows, stored column by column.  The value in
+    // column `c` and row `r` is stored at index `c*BlockRows() + r` in the
+    // vector for the column's data type.
+    struct Block
+    {
+        std::size_t rowCount = 0;
+        std::vector<double> times;
+        std::vector<double> reals;
+        std::vector<int> integers;
+        std::vector<char> booleans;
+        std::vector<std::string> strings;
+    };
+
+    Writer(
+        const std::string& path,
+        const std::vector<char>& fileHeader,
+        const RecordingBufferOptions& bufferOptions,
+        std::size_t blockRows,
+        std::size_t realCount,
+        std::size_t integerCount,
+        std::size_t booleanCount,
+        std::size_t stringCount)
+        : m_path(path)
+        , m_dropWhenFull(bufferOptions.dropWhenFull)
+        , m_blockRows(blockRows)
+        , m_realCount(realCount)
+        , m_integerCount(integerCount)
+        , m_booleanCount(booleanCount)
+        , m_stringCount(stringCount)
+    {
+        for (std::size_t i = 0; i < bufferOptions.blockCount; ++i) {
+            m_freeBlocks.push_back(NewBlock());
+        }
+
+        CORAL_LOG_TRACE("RecordingInstance: Opening " + path);
+        m_file.open(
+            path,
+            std::ios_base::out | std::ios_base::trunc | std::ios_base::binary
+#ifdef _MSC_VER
+            , _SH_DENYWR // Don't let other processes/threads write to the file
+#endif
+            );
+        if (!m_file.is_open()) {
+            const int e = errno;
+            throw std::runtime_error(coral::error::ErrnoMessage(
+                "Error opening file \"" + path + "\" for writing",
+                e));
+        }
+        m_file.write(fileHeader.data(), fileHeader.size());
+        if (!m_file) {
+            throw std::runtime_error("Error writing to file \"" + path + '"');
+        }
+        m_thread = std::thread{&Writer::Run, this};
+    }
+
+    ~Writer() noexcept
+    {
+        try {
+            Close();
+        } catch (const std::exception& e) {
+            coral::log::Log(coral::log::error, e.what());
+        }
+    }
+
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+
+    std::size_t BlockRows() const { return m_blockRows; }
+
+    const RecordingStatistics& Statistics() const { return m_statistics; }
+
+    // Returns the block to which the next row should be added, waiting for
+    // one to become available if necessary.  Returns null if the values
+    // should be dropped instead.
+    Block* CurrentBlock()
+    {
+        if (m_current) return m_current.get();
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_freeBlocks.empty() && !m_error) {
+            if (m_dropWhenFull) {
+                ++m_statistics.droppedSteps;
+                return nullptr;
+            }
+            const auto waitStart = std::chrono::steady_clock::now();
+            m_blockFreed.wait(lock, [this] () {
+                return !m_freeBlocks.empty() || m_error;
+            });
+            ++m_statistics.blockedSteps;
+            m_statistics.blockedTime += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - waitStart);
+        }
+        if (m_error) std::rethrow_exception(m_error);
+        m_current = std::move(m_freeBlocks.back());
+        m_freeBlocks.pop_back();
+        return m_current.get();
+    }
+
+    // Must be called after a row has been added to the current block.
+    // Hands the block over to the background thread if it is full.
+    void AddRow()
+    {
+        assert(m_current);
+        ++m_statistics.recordedSteps;
+        if (++m_current->rowCount < m_blockRows) return;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_fullBlocks.push_back(std::move(m_current));
+        }
+        m_blockFilled.notify_one();
+    }
+
+    // Writes any outstanding values, waits for the background thread to
+    // finish, and closes the file.
+    void Close()
+    {
+        if (!m_thread.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_current && m_current->rowCount > 0) {
+                m_fullBlocks.push_back(std::move(m_current));
+            }
+            m_stopping = true;
+        }
+        m_blockFilled.notify_one();
+        m_thread.join();
+        m_file.close();
+        if (m_error) std::rethrow_exception(m_error);
+        if (m_file.fail()) {
+            throw std::runtime_error("Error closing file \"" + m_path + '"');
+        }
+
+        const auto& stats = m_statistics;
+        coral::log::Log(
+            stats.droppedSteps > 0 ? coral::log::warning : coral::log::info,
+            boost::format("Recorded %d time steps to %s. %d time steps were "
+                "dropped, and %d waited for disk output (%.3f s in total).")
+                % stats.recordedSteps
+                % m_path
+                % stats.droppedSteps
+                % stats.blockedSteps
+                % std::chrono::duration<double>(stats.blockedTime).count());
+    }
+
+private:
+    std::unique_ptr<Block> NewBlock() const
+    {
+        auto block = std::make_unique<Block>();
+        block->times.resize(m_blockRows);
+        block->reals.resize(m_realCount * m_blockRows);
+        block->integers.resize(m_integerCount * m_blockRows);
+        block->booleans.resize(m_booleanCount * m_blockRows);
+        block->strings.resize(m_stringCount * m_blockRows);
+        return block;
+    }
+
+    // The background thread function.
+    void Run()
+    {
+        for (;;) {
+            std::unique_ptr<Block> block;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_blockFilled.wait(lock, [this] () {
+                    return m_stopping || !m_fullBlocks.empty();
+                });
+                if (m_fullBlocks.empty()) return;
+                block = std::move(m_fullBlocks.front());
+                m_fullBlocks.pop_front();
+            }
+            try {
+                WriteBlock(*block);
+            } catch (...) {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_error = std::current_exception();
+                }
+                m_blockFreed.notify_one();
+                return;
+            }
+            block->rowCount = 0;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_freeBlocks.push_back(std::move(block));
+            }
+            m_blockFreed.notify_one();
+        }
+    }
+
+    void WriteBlock(const Block& block)
+    {
+        const auto rows = block.rowCount;
+        std::size_t payloadSize =
+            rows * (UINT64_SIZE * (1 + m_realCount)
+                    + UINT32_SIZE * m_integerCount
+                    + UINT8_SIZE * m_booleanCount);
+        for (std::size_t c = 0; c < m_stringCount; ++c) {
+            for (std::size_t r = 0; r < rows; ++r) {
+                payloadSize += UINT32_SIZE + block.strings[c*m_blockRows + r].size();
+            }
+        }
+
+        m_encodeBuffer.resize(BLOCK_HEADER_SIZE + payloadSize);
+        auto p = m_encodeBuffer.data();
+        coral::util::EncodeUint32(static_cast<std::uint32_t>(rows), p);
+        p += UINT32_SIZE;
+        coral::util::EncodeUint64(payloadSize, p);
+        p += UINT64_SIZE;
+
+        for (std::size_t r = 0; r < rows; ++r) {
+            p = EncodeReal(block.times[r], p);
+        }
+        for (std::size_t c = 0; c < m_realCount; ++c) {
+            const auto column = block.reals.data() + c*m_blockRows;
+            for (std::size_t r = 0; r < rows; ++r) {
+                p = EncodeReal(column[r], p);
+            }
+        }
+        for (std::size_t c = 0; c < m_integerCount; ++c) {
+            const auto column = block.integers.data() + c*m_blockRows;
+            for (std::size_t r = 0; r < rows; ++r) {
+                coral::util::EncodeUint32(static_cast<std::uint32_t>(column[r]), p);
+                p += UINT32_SIZE;
+            }
+        }
+        for (std::size_t c = 0; c < m_booleanCount; ++c) {
+            const auto column = block.booleans.data() + c*m_blockRows;
+            for (std::size_t r = 0; r < rows; ++r) {
+                *p++ = column[r] ? 1 : 0;
+            }
+        }
+        for (std::size_t c = 0; c < m_stringCount; ++c) {
+            const auto column = block.strings.data() + c*m_blockRows;
+            for (std::size_t r = 0; r < rows; ++r) {
+                p = EncodeString(column[r], p);
+            }
+        }
+        assert(p == m_encodeBuffer.data() + m_encodeBuffer.size());
+
+        m_file.write(m_encodeBuffer.data(), m_encodeBuffer.size());
+        if (!m_file) {
+            throw std::runtime_error("Error writing to file \"" + m_path + '"');
+        }
+    }
+
+    const std::string m_path;
+    const bool m_dropWhenFull;
+    const std::size_t m_blockRows;
+    const std::size_t m_realCount;
+    const std::size_t m_integerCount;
+    const std::size_t m_booleanCount;
+    const std::size_t m_stringCount;
+
+    // Only used by the foreground thread.
+    std::unique_ptr<Block> m_current;
+    RecordingStatistics m_statistics;
+
+    // Only used by the background thread, after construction.
+    std::ofstream m_file;
+    std::vector<char> m_encodeBuffer;
+
+    // Shared between the threads, protected by m_mutex.
+    std::mutex m_mutex;
+    std::condition_variable m_blockFilled;
+    std::condition_variable m_blockFreed;
+    std::deque<std::unique_ptr<Block>> m_fullBlocks;
+    std::vector<std::unique_ptr<Block>> m_freeBlocks;
+    bool m_stopping = false;
+    std::exception_ptr m_error;
+
+    std::thread m_thread;
+};
+
+
+// =============================================================================
+// RecordingInstance
+// =============================================================================
+
+
+RecordingInstance::RecordingInstance(
+    std::shared_ptr<Instance> instance,
+    const std::string& outputFilePrefix,
+    const RecordingSpec& spec,
+    const RecordingBufferOptions& bufferOptions)
+    : m_instance{instance}
+    , m_outputFilePrefix(outputFilePrefix)
+    , m_spec(spec)
+    , m_bufferOptions(bufferOptions)
+    , m_stepsSinceRecorded(0)
+    , m_lastRecordedT(-coral::model::ETERNITY)
+{
+    CORAL_INPUT_CHECK(spec.stepInterval >= 1);
+    CORAL_INPUT_CHECK(bufferOptions.blockCount >= 2);
+    if (m_outputFilePrefix.empty()) m_outputFilePrefix = "./";
+}
+
+
+RecordingInstance::~RecordingInstance() noexcept
+{
+    // Defined here because Writer is an incomplete type in the header.
+}
+
+
+coral::model::SlaveTypeDescription RecordingInstance::TypeDescription() const
+{
+    return m_instance->TypeDescription();
+}
+
+
+void RecordingInstance::Setup(
+    const std::string& slaveName,
+    const std::string& executionName,
+    coral::model::TimePoint startTime,
+    coral::model::TimePoint stopTime,
+    bool adaptiveStepSize,
+    double relativeTolerance)
+{
+    m_instance->Setup(
+        slaveName, executionName,
+        startTime, stopTime,
+        adaptiveStepSize, relativeTolerance);
+
+    const auto typeDescription = TypeDescription();
+
+    auto outputFileName = m_outputFilePrefix;
+    if (executionName.empty()) {
+        outputFileName += coral::util::Timestamp();
+    } else {
+        outputFileName += executionName;
+    }
+    outputFileName += '_';
+    if (slaveName.empty()) {
+        outputFileName += typeDescription.Name() + '_'
+            + coral::util::RandomString(6, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz");
+    } else {
+        outputFileName += slaveName;
+    }
+    outputFileName += ".coralrec";
+
+    std::vector<coral::model::VariableDescription> variables;
+    for (const auto& var : typeDescription.Variables()) {
+        if (m_spec.Includes(var)) variables.push_back(var);
+    }
+    CORAL_LOG_DEBUG(boost::format("RecordingInstance: Recording %d variables")
+        % variables.size());
+
+    std::vector<coral::model::VariableID> realIDs, integerIDs, booleanIDs, stringIDs;
+    for (const auto& var : variables) {
+        switch (var.DataType()) {
+            case coral::model::REAL_DATATYPE:
+                realIDs.push_back(var.ID());
+                break;
+            case coral::model::INTEGER_DATATYPE:
+                integerIDs.push_back(var.ID());
+                break;
+            case coral::model::BOOLEAN_DATATYPE:
+                booleanIDs.push_back(var.ID());
+                break;
+            case coral::model::STRING_DATATYPE:
+                stringIDs.push_back(var.ID());
+                break;
+            default:
+                assert(false);
+        }
+    }
+    m_realVariables = m_instance->PrepareVariables(
+        coral::model::REAL_DATATYPE, std::move(realIDs));
+    m_integerVariables = m_instance->PrepareVariables(
+        coral::model::INTEGER_DATATYPE, std::move(integerIDs));
+    m_booleanVariables = m_instance->PrepareVariables(
+        coral::model::BOOLEAN_DATATYPE, std::move(booleanIDs));
+    m_stringVariables = m_instance->PrepareVariables(
+        coral::model::STRING_DATATYPE, std::move(stringIDs));
+    m_realRow.resize(m_realVariables->Size());
+    m_integerRow.resize(m_integerVariables->Size());
+    m_booleanRow.reset(new bool[m_booleanVariables->Size()]);
+    m_stringRow.resize(m_stringVariables->Size());
+
+    const auto rowSize =
+        UINT64_SIZE * (1 + m_realVariables->Size())
+        + UINT32_SIZE * m_integerVariables->Size()
+        + UINT8_SIZE * m_booleanVariables->Size()
+        + (UINT32_SIZE + ESTIMATED_STRING_SIZE) * m_stringVariables->Size();
+    const auto blockRows = std::max<std::size_t>(
+        1,
+        std::min(TARGET_BLOCK_SIZE / rowSize, MAX_BLOCK_ROWS));
+
+    m_stepsSinceRecorded = 0;
+    m_lastRecordedT = -coral::model::ETERNITY;
+    m_writer.reset();
+    m_writer = std::make_unique<Writer>(
+        outputFileName,
+        CreateFileHeader(
+            executionName, slaveName, typeDescription.Name(), variables),
+        m_bufferOptions,
+        blockRows,
+        m_realVariables->Size(),
+        m_integerVariables->Size(),
+        m_booleanVariables->Size(),
+        m_stringVariables->Size());
+}
+
+
+void RecordingInstance::StartSimulation()
+{
+    m_instance->StartSimulation();
+}
+
+
+void RecordingInstance::EndSimulation()
+{
+    m_instance->EndSimulation();
+    if (m_writer) m_writer->Close();
+}
+
+
+RecordingStatistics RecordingInstance::Statistics() const
+{
+    return m_writer ? m_writer->Statistics() : RecordingStatistics{};
+}
+
+
+bool RecordingInstance::DoStep(
+    coral::model::TimePoint currentT,
+    coral::model::TimeDuration deltaT)
+{
+    const auto ret = m_instance->DoStep(currentT, deltaT);
+
+    const auto t = currentT + deltaT;
+    if (!m_spec.IsDue(++m_stepsSinceRecorded, t - m_lastRecordedT)) return ret;
+    m_stepsSinceRecorded = 0;
+    m_lastRecordedT = t;
+
+    assert(m_writer);
+    const auto blockPtr = m_writer->CurrentBlock();
+    if (!blockPtr) return ret;
+    auto& block = *blockPtr;
+    const auto stride = m_writer->BlockRows();
+    const auto row = block.rowCount;
+    assert(row < stride);
+
+    block.times[row] = t;
+    if (m_realVariables->Size() > 0) {
+        m_instance->GetRealVariables(*m_realVariables, m_realRow.data());
+        for (std::size_t c = 0; c < m_realVariables->Size(); ++c) {
+            block.reals[c*stride + row] = m_realRow[c];
+        }
+    }
+    if (m_integerVariables->Size() > 0) {
+        m_instance->GetIntegerVariables(*m_integerVariables, m_integerRow.data());
+        for (std::size_t c = 0; c < m_integerVariables->Size(); ++c) {
+            block.integers[c*stride + row] = m_integerRow[c];
+        }
+    }
+    if (m_booleanVariables->Size() > 0) {
+        m_instance->GetBooleanVariables(*m_booleanVariables, m_booleanRow.get());
+        for (std::size_t c = 0; c < m_booleanVariables->Size(); ++c) {
+            block.booleans[c*stride + row] = m_booleanRow[c];
+        }
+    }
+    if (m_stringVariables->Size() > 0) {
+        m_instance->GetStringVariables(*m_stringVariables, m_stringRow.data());
+        for (std::size_t c = 0; c < m_stringVariables->Size(); ++c) {
+            // Swapping lets the row buffer reuse the block's old storage.
+            block.strings[c*stride + row].swap(m_stringRow[c]);
+        }
+    }
+
+    m_writer->AddRow();
+    return ret;
+}
+
+
+double RecordingInstance::GetRealVariable(coral::model::VariableID varRef) const
+{
+    return m_instance->GetRealVariable(varRef);
+}
+
+
+int RecordingInstance::GetIntegerVariable(coral::model::VariableID varRef) const
+{
+    return m_instance->GetIntegerVariable(varRef);
+}
+
+
+bool RecordingInstance::GetBooleanVariable(coral::model::VariableID varRef) const
+{
+    return m_instance->GetBooleanVariable(varRef);
+}
+
+
+std::string RecordingInstance::GetStringVariable(coral::model::VariableID varRef) const
+{
+    return m_instance->GetStringVariable(varRef);
+}
+
+
+bool RecordingInstance::SetRealVariable(coral::model::VariableID varRef, double value)
+{
+    return m_instance->SetRealVariable(varRef, value);
+}
+
+
+bool RecordingInstance::SetIntegerVariable(coral::model::VariableID varRef, int value)
+{
+    return m_instance->SetIntegerVariable(varRef, value);
+}
+
+
+bool RecordingInstance::SetBooleanVariable(coral::model::VariableID varRef, bool value)
+{
+    return m_instance->SetBooleanVariable(varRef, value);
+}
+
+
+bool RecordingInstance::SetStringVariable(coral::model::VariableID varRef, const std::string& value)
+{
+    return m_instance->SetStringVariable(varRef, value);
+}
+
+
+std::unique_ptr<VariableList> RecordingInstance::PrepareVariables(
+    coral::model::DataType dataType,
+    std::vector<coral::model::VariableID> variables) const
+{
+    return m_instance->PrepareVariables(dataType, std::move(variables));
+}
+
+
+void RecordingInstance::GetRealVariables(
+    const VariableList& variables,
+    double* values) const
+{
+    m_instance->GetRealVariables(variables, values);
+}
+
+
+void RecordingInstance::GetIntegerVariables(
+    const VariableList& variables,
+    int* values) const
+{
+    m_instance->GetIntegerVariables(variables, values);
+}
+
+
+void RecordingInstance::GetBooleanVariables(
+    const VariableList& variables,
+    bool* values) const
+{
+    m_instance->GetBooleanVariables(variables, values);
+}
+
+
+void RecordingInstance::GetStringVariables(
+    const VariableList& variables,
+    std::string* values) const
+{
+    m_instance->GetStringVariables(variables, values);
+}
+
+
+bool RecordingInstance::SetRealVariables(
+    const VariableList& variables,
+    const double* values)
+{
+    return m_instance->SetRealVariables(variables, values);
+}
+
+
+bool RecordingInstance::SetIntegerVariables(
+    const VariableList& variables,
+    const int* values)
+{
+    return m_instance->SetIntegerVariables(variables, values);
+}
+
+
+bool RecordingInstance::SetBooleanVariables(
+    const VariableList& variables,
+    const bool* values)
+{
+    return m_instance->SetBooleanVariables(variables, values);
+}
+
+
+bool RecordingInstance::SetStringVariables(
+    const VariableList& variables,
+    const std::string* values)
+{
+    return m_instance->SetStringVariables(variables, values);
+}
+
+
+// =============================================================================
+// RecordingReader
+// =============================================================================
+
+
+RecordingReader::RecordingReader(const std::string& path)
+    : m_realCount(0)
+    , m_integerCount(0)
+    , m_booleanCount(0)
+    , m_stringCount(0)
+    , m_fileSize(0)
+    , m_blockRows(0)
+    , m_nextRow(0)
+{
+    m_file.open(path, std::ios_base::in | std::ios_base::binary);
+    if (!m_file.is_open()) {
+        const int e = errno;
+        throw std::runtime_error(coral::error::ErrnoMessage(
+            "Error opening file \"" + path + "\" for reading",
+            e));
+    }
+    m_file.seekg(0, std::ios_base::end);
+    const auto fileSize = m_file.tellg();
+    m_file.seekg(0, std::ios_base::beg);
+    if (fileSize < 0 || !m_file) {
+        throw std::runtime_error("Error reading file \"" + path + "\"");
+    }
+    m_fileSize = static_cast<std::uint64_t>(fileSize);
+
+    char magic[sizeof RECORDING_MAGIC];
+    ReadExactly(m_file, magic, sizeof magic);
+    if (std::memcmp(magic, RECORDING_MAGIC, sizeof magic) != 0) {
+        throw CorruptRecording("Not a Coral recording");
+    }
+    const auto version = ReadUint16(m_file);
+    if (version != RECORDING_FORMAT_VERSION) {
+        throw std::runtime_error(
+            "Unsupported recording format version: " + std::to_string(version));
+    }
+    m_executionName = ReadString(m_file);
+    m_slaveName = ReadString(m_file);
+    m_slaveTypeName = ReadString(m_file);
+
+    const auto variableCount = ReadUint32(m_file);
+    for (std::uint32_t i = 0; i < variableCount; ++i) {
+        const auto id = ReadUint32(m_file);
+        const auto dataType = static_cast<coral::model::DataType>(ReadUint8(m_file));
+        const auto causality = static_cast<coral::model::Causality>(ReadUint8(m_file));
+        const auto variability = static_cast<coral::model::Variability>(ReadUint8(m_file));
+        const auto name = ReadString(m_file);
+        switch (dataType) {
+            case coral::model::REAL_DATATYPE:
+                m_columns.push_back(m_realCount++);
+                break;
+            case coral::model::INTEGER_DATATYPE:
+                m_columns.push_back(m_integerCount++);
+                break;
+            case coral::model::BOOLEAN_DATATYPE:
+                m_columns.push_back(m_booleanCount++);
+                break;
+            case coral::model::STRING_DATATYPE:
+                m_columns.push_back(m_stringCount++);
+                break;
+            default:
+                throw CorruptRecording("Invalid data type for variable " + name);
+        }
+        m_variables.emplace_back(id, name, dataType, causality, variability);
+    }
+}
+
+
+const std::string& RecordingReader::ExecutionName() const
+{
+    return m_executionName;
+}
+
+
+const std::string& RecordingReader::SlaveName() const
+{
+    return m_slaveName;
+}
+
+
+const std::string& RecordingReader::SlaveTypeName() const
+{
+    return m_slaveTypeName;
+}
+
+
+const std::vector<coral::model::VariableDescription>&
+    RecordingReader::Variables() const
+{
+    return m_variables;
+}
+
+
+bool RecordingReader::ReadRow(
+    coral::model::TimePoint& time,
+    std::vector<coral::model::ScalarValue>& values)
+{
+    while (m_nextRow == m_blockRows) {
+        if (!ReadBlock()) return false;
+    }
+    const auto row = m_nextRow++;
+    time = m_times[row];
+    values.resize(m_variables.size());
+    for (std::size_t i = 0; i < m_variables.size(); ++i) {
+        const auto index = m_columns[i]*m_blockRows + row;
+        switch (m_variables[i].DataType()) {
+            case coral::model::REAL_DATATYPE:
+                values[i] = m_reals[index];
+                break;
+            case coral::model::INTEGER_DATATYPE:
+                values[i] = m_integers[index];
+                break;
+            case coral::model::BOOLEAN_DATATYPE:
+                values[i] = m_booleans[index] != 0;
+                break;
+            case coral::model::STRING_DATATYPE:
+                values[i] = m_strings[index];
+                break;
+            default:
+                assert(false);
+        }
+    }
+    return true;
+}
+
+
+bool RecordingReader::ReadBlock()
+{
+    char header[BLOCK_HEADER_SIZE];
+    m_file.read(header, BLOCK_HEADER_SIZE);
+    if (m_file.gcount() == 0 && m_file.eof()) return false;
+    if (static_cast<std::size_t>(m_file.gcount()) != BLOCK_HEADER_SIZE) {
+        if (m_file.bad()) throw std::runtime_error("Error reading recording file");
+        throw CorruptRecording("Unexpected end of file");
+    }
+    const auto rows = coral::util::DecodeUint32(header);
+    const auto payloadSize = coral::util::DecodeUint64(header + UINT32_SIZE);
+
+    // Check the sizes against the file before allocating anything, so a
+    // corrupt header can't make us allocate absurd amounts of memory.
+    const auto position = m_file.tellg();
+    if (position < 0) throw std::runtime_error("Error reading recording file");
+    if (payloadSize > m_fileSize - static_cast<std::uint64_t>(position)) {
+        throw CorruptRecording("Block is longer than the rest of the file");
+    }
+    const std::uint64_t minRowSize =
+        UINT64_SIZE * (1 + m_realCount)
+        + UINT32_SIZE * m_integerCount
+        + UINT8_SIZE * m_booleanCount
+        + UINT32_SIZE * m_stringCount;
+    if (rows > payloadSize / minRowSize) {
+        throw CorruptRecording("Block has more rows than it has room for");
+    }
+
+    m_buffer.resize(payloadSize);
+    ReadExactly(m_file, m_buffer.data(), m_buffer.size());
+
+    m_times.resize(rows);
+    m_reals.resize(m_realCount * rows);
+    m_integers.resize(m_integerCount * rows);
+    m_booleans.resize(m_booleanCount * rows);
+    m_strings.resize(m_stringCount * rows);
+
+    auto decoder = PayloadDecoder(m_buffer.data(), m_buffer.data() + m_buffer.size());
+    for (auto& v : m_times) v = decoder.Real();
+    for (auto& v : m_reals) v = decoder.Real();
+    for (auto& v : m_integers) v = decoder.Integer();
+    for (auto& v : m_booleans) v = decoder.Boolean();
+    for (auto& v : m_strings) decoder.String(v);
+    if (!decoder.AtEnd()) {
+        throw CorruptRecording("Block is longer than expected");
+    }
+
+    m_blockRows = rows;
+    m_nextRow = 0;
+    return true;
+}
+
+
+// =============================================================================
+// ExportCSV
+// =============================================================================
+
+
+void ExportCSV(RecordingReader& recording, std::ostream& output)
+{
+    const auto oldFlags = output.flags();
+    const auto oldPrecision = output.precision();
+    const auto restoreFormat = coral::util::OnScopeExit([&] () {
+        output.flags(oldFlags);
+        output.precision(oldPrecision);
+    });
+
+    output << "Time";
+    for (const auto& var : recording.Variables()) {
+        output << ',' << var.Name();
+    }
+    output << '\n';
+
+    // Unlike LoggingInstance, we print the variable values with enough
+    // digits that they can be read back without loss of precision.
+    const auto realPrecision = std::numeric_limits<double>::max_digits10;
+    coral::model::TimePoint time;
+    std::vector<coral::model::ScalarValue> values;
+    while (recording.ReadRow(time, values)) {
+        output << std::fixed << std::setprecision(oldPrecision) << time
+            << std::defaultfloat << std::setprecision(realPrecision);
+        for (const auto& value : values) {
+            output << ',' << value;
+        }
+        output << '\n';
+    }
+    output.flush();
+    if (!output) throw std::runtime_error("Error writing CSV output");
+}
+
+
+}} // namespace
@@ -0,0 +1,331 @@
+#include <cassert>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <gtest/gtest.h>
+
+#include <coral/model.hpp>
+#include <coral/slave/recording.hpp>
+#include <coral/util.hpp>
+#include <coral/util/filesystem.hpp>
+
+
+namespace
+{
+    // A slave with one output variable of each type, whose values are
+    // simple functions of the step number.
+    class Counter : public coral::slave::Instance
+    {
+    public:
+        coral::model::SlaveTypeDescription TypeDescription() const override
+        {
+            using namespace coral::model;
+            return SlaveTypeDescription(
+                "coral.test.internal.Counter",
+                "97c1b2a4-5d2f-4f37-8f0c-3d0c1b3e7a66",
+                "Slave type used internally in Coral test suite",
+                "Coral developers",
+                "0.1",
+                std::vector<VariableDescription>{
+                    VariableDescription(0, "real", REAL_DATATYPE, OUTPUT_CAUSALITY, CONTINUOUS_VARIABILITY),
+                    VariableDescription(1, "integer", INTEGER_DATATYPE, OUTPUT_CAUSALITY, DISCRETE_VARIABILITY),
+                    VariableDescription(2, "boolean", BOOLEAN_DATATYPE, OUTPUT_CAUSALITY, DISCRETE_VARIABILITY),
+                    VariableDescription(3, "string", STRING_DATATYPE, OUTPUT_CAUSALITY, DISCRETE_VARIABILITY)
+                });
+        }
+
+        void Setup(
+            const std::string& /*slaveName*/,
+            const std::string& /*executionName*/,
+            coral::model::TimePoint /*startTime*/,
+            coral::model::TimePoint /*stopTime*/,
+            bool /*adaptiveStepSize*/,
+            double /*relativeTolerance*/) override { }
+
+        void StartSimulation() override { }
+
+        void EndSimulation() override { }
+
+        bool DoStep(
+            coral::model::TimePoint /*currentT*/,
+            coral::model::TimeDuration /*deltaT*/) override
+        {
+            ++m_step;
+            return true;
+        }
+
+        double GetRealVariable(coral::model::VariableID /*variable*/) const override { return m_step * 0.5; }
+
+        int GetIntegerVariable(coral::model::VariableID /*variable*/) const override { return -m_step; }
+
+        bool GetBooleanVariable(coral::model::VariableID /*variable*/) const override { return m_step % 2 == 0; }
+
+        std::string GetStringVariable(coral::model::VariableID /*variable*/) const override { return "s" + std::to_string(m_step); }
+
+        bool SetRealVariable(coral::model::VariableID /*variable*/, double /*value*/) override { assert(false); return false; }
+
+        bool SetIntegerVariable(coral::model::VariableID /*variable*/, int /*value*/) override { assert(false); return false; }
+
+        bool SetBooleanVariable(coral::model::VariableID /*variable*/, bool /*value*/) override { assert(false); return false; }
+
+        bool SetStringVariable(coral::model::VariableID /*variable*/, const std::string& /*value*/) override { assert(false); return false; }
+
+    private:
+        int m_step = 0;
+    };
+}
+
+
+TEST(coral_slave, RecordingInstance)
+{
+    // Enough steps to fill a few blocks, and to end with a partial one.
+    const int stepCount = 10000;
+    const double stepSize = 0.25;
+
+    coral::util::TempDir tempDir;
+    {
+        coral::slave::RecordingInstance recorder(
+            std::make_shared<Counter>(),
+            tempDir.Path().string() + '/');
+        recorder.Setup("counter", "recording_test", 0.0, coral::model::ETERNITY, false, 0.0);
+        recorder.StartSimulation();
+        for (int i = 0; i < stepCount; ++i) {
+            ASSERT_TRUE(recorder.DoStep(i * stepSize, stepSize));
+        }
+        recorder.EndSimulation();
+        EXPECT_EQ(std::uint64_t(stepCount), recorder.Statistics().recordedSteps);
+        EXPECT_EQ(0U, recorder.Statistics().droppedSteps);
+    }
+
+    const auto path = tempDir.Path() / "recording_test_counter.coralrec";
+    ASSERT_TRUE(boost::filesystem::exists(path));
+
+    auto reader = coral::slave::RecordingReader(path.string());
+    EXPECT_EQ("recording_test", reader.ExecutionName());
+    EXPECT_EQ("counter", reader.SlaveName());
+    EXPECT_EQ("coral.test.internal.Counter", reader.SlaveTypeName());
+    ASSERT_EQ(4U, reader.Variables().size());
+    EXPECT_EQ("real", reader.Variables()[0].Name());
+    EXPECT_EQ(coral::model::INTEGER_DATATYPE, reader.Variables()[1].DataType());
+    EXPECT_EQ(coral::model::DISCRETE_VARIABILITY, reader.Variables()[2].Variability());
+    EXPECT_EQ(3U, reader.Variables()[3].ID());
+
+    coral::model::TimePoint t;
+    std::vector<coral::model::ScalarValue> values;
+    for (int i = 0; i < stepCount; ++i) {
+        ASSERT_TRUE(reader.ReadRow(t, values));
+        const int step = i + 1;
+        EXPECT_EQ(step * stepSize, t);
+        ASSERT_EQ(4U, values.size());
+        EXPECT_EQ(step * 0.5, boost::get<double>(values[0]));
+        EXPECT_EQ(-step, boost::get<int>(values[1]));
+        EXPECT_EQ(step % 2 == 0, boost::get<bool>(values[2]));
+        EXPECT_EQ("s" + std::to_string(step), boost::get<std::string>(values[3]));
+    }
+    EXPECT_FALSE(reader.ReadRow(t, values));
+
+    auto csvReader = coral::slave::RecordingReader(path.string());
+    std::ostringstream csv;
+    coral::slave::ExportCSV(csvReader, csv);
+    std::istringstream csvLines(csv.str());
+    std::string line;
+    ASSERT_TRUE(std::getline(csvLines, line));
+    EXPECT_EQ("Time,real,integer,boolean,string", line);
+    ASSERT_TRUE(std::getline(csvLines, line));
+    EXPECT_EQ("0.250000,0.5,-1,0,s1", line);
+    ASSERT_TRUE(std::getline(csvLines, line));
+    EXPECT_EQ("0.500000,1,-2,1,s2", line);
+}
+
+
+TEST(coral_slave, RecordingReader_invalidFile)
+{
+    coral::util::TempDir tempDir;
+    const auto path = tempDir.Path() / "invalid.coralrec";
+    std::ofstream(path.string()) << "This is not a recording";
+    EXPECT_THROW(coral::slave::RecordingReader(path.string()), std::runtime_error);
+    EXPECT_THROW(
+        coral::slave::RecordingReader((tempDir.Path() / "nonexistent").string()),
+        std::runtime_error);
+}
+
+
+TEST(coral_slave, RecordingReader_corruptBlock)
+{
+    coral::util::TempDir tempDir;
+    {
+        coral::slave::RecordingInstance recorder(
+            std::make_shared<Counter>(),
+            tempDir.Path().string() + '/');
+        recorder.Setup("counter", "corrupt_test", 0.0, coral::model::ETERNITY, false, 0.0);
+        recorder.StartSimulation();
+        recorder.EndSimulation();
+    }
+    const auto path = tempDir.Path() / "corrupt_test_counter.coralrec";
+    ASSERT_TRUE(boost::filesystem::exists(path));
+    const auto headerOnly = tempDir.Path() / "header_only.coralrec";
+    boost::filesystem::copy_file(path, headerOnly);
+
+    // Appends a block header, and possibly some payload, to a copy of the
+    // header-only recording.
+    const auto writeBlock = [&] (
+        const std::string& name,
+        std::uint32_t rows,
+        std::uint64_t payloadSize,
+        std::size_t actualPayloadSize)
+    {
+        const auto blockPath = tempDir.Path() / name;
+        boost::filesystem::copy_file(headerOnly, blockPath);
+        std::ofstream file(blockPath.string(), std::ios_base::binary | std::ios_base::app);
+        char header[12];
+        coral::util::EncodeUint32(rows, header);
+        coral::util::EncodeUint64(payloadSize, header + 4);
+        file.write(header, sizeof header);
+        file << std::string(actualPayloadSize, '\0');
+        return blockPath.string();
+    };
+
+    coral::model::TimePoint t;
+    std::vector<coral::model::ScalarValue> values;
+
+    // A payload size which is larger than the file must be rejected before
+    // any memory is allocated for it.
+    auto hugePayload = coral::slave::RecordingReader(
+        writeBlock("huge_payload.coralrec", 1, 0xFFFFFFFFFFFFull, 100));
+    EXPECT_THROW(hugePayload.ReadRow(t, values), std::runtime_error);
+
+    // Likewise for a row count which doesn't fit in the payload.
+    auto tooManyRows = coral::slave::RecordingReader(
+        writeBlock("too_many_rows.coralrec", 0xFFFFFFFFu, 100, 100));
+    EXPECT_THROW(tooManyRows.ReadRow(t, values), std::runtime_error);
+}
+
+TEST(coral_slave, RecordingSpec)
+{
+    using namespace coral::model;
+    const auto realOut = VariableDescription(
+        0, "body.position[1]", REAL_DATATYPE, OUTPUT_CAUSALITY, CONTINUOUS_VARIABILITY);
+    const auto intParam = VariableDescription(
+        1, "body.count", INTEGER_DATATYPE, PARAMETER_CAUSALITY, FIXED_VARIABILITY);
+
+    coral::slave::RecordingSpec spec;
+    EXPECT_TRUE(spec.Includes(realOut));
+    EXPECT_TRUE(spec.Includes(intParam));
+    EXPECT_TRUE(spec.IsDue(1, ETERNITY));
+    EXPECT_TRUE(spec.IsDue(1, 0.0));
+
+    spec.variables = {"body.position[?]"};
+    EXPECT_TRUE(spec.Includes(realOut));
+    EXPECT_FALSE(spec.Includes(intParam));
+    spec.variables = {"body.*"};
+    EXPECT_TRUE(spec.Includes(realOut));
+    EXPECT_TRUE(spec.Includes(intParam));
+    spec.variables = {"*count", "foo"};
+    EXPECT_FALSE(spec.Includes(realOut));
+    EXPECT_TRUE(spec.Includes(intParam));
+    spec.variables = {"body.*.count"};
+    EXPECT_FALSE(spec.Includes(intParam));
+
+    spec.variables.clear();
+    spec.causalities = OUTPUT_CAUSALITY | INPUT_CAUSALITY;
+    EXPECT_TRUE(spec.Includes(realOut));
+    EXPECT_FALSE(spec.Includes(intParam));
+
+    spec.stepInterval = 3;
+    EXPECT_FALSE(spec.IsDue(2, ETERNITY));
+    EXPECT_TRUE(spec.IsDue(3, ETERNITY));
+    spec.minTimeInterval = 0.3;
+    EXPECT_FALSE(spec.IsDue(3, 0.2));
+    EXPECT_TRUE(spec.IsDue(3, 0.1 + 0.1 + 0.1 - 1e-15));
+}
+
+
+TEST(coral_slave, RecordingInstance_selective)
+{
+    coral::slave::RecordingSpec spec;
+    spec.variables = {"real", "str*"};
+    spec.stepInterval = 4;
+
+    coral::util::TempDir tempDir;
+    {
+        coral::slave::RecordingInstance recorder(
+            std::make_shared<Counter>(),
+            tempDir.Path().string() + '/',
+            spec);
+        recorder.Setup("counter", "selective_test", 0.0, coral::model::ETERNITY, false, 0.0);
+        recorder.StartSimulation();
+        for (int i = 0; i < 10; ++i) {
+            ASSERT_TRUE(recorder.DoStep(i * 1.0, 1.0));
+        }
+        recorder.EndSimulation();
+    }
+
+    auto reader = coral::slave::RecordingReader(
+        (tempDir.Path() / "selective_test_counter.coralrec").string());
+    ASSERT_EQ(2U, reader.Variables().size());
+    EXPECT_EQ("real", reader.Variables()[0].Name());
+    EXPECT_EQ("string", reader.Variables()[1].Name());
+
+    coral::model::TimePoint t;
+    std::vector<coral::model::ScalarValue> values;
+    for (int step : {4, 8}) {
+        ASSERT_TRUE(reader.ReadRow(t, values));
+        EXPECT_EQ(step * 1.0, t);
+        ASSERT_EQ(2U, values.size());
+        EXPECT_EQ(step * 0.5, boost::get<double>(values[0]));
+        EXPECT_EQ("s" + std::to_string(step), boost::get<std::string>(values[1]));
+    }
+    EXPECT_FALSE(reader.ReadRow(t, values));
+}
+
+
+TEST(coral_slave, RecordingInstance_dropWhenFull)
+{
+    coral::slave::RecordingBufferOptions bufferOptions;
+    bufferOptions.blockCount = 2;
+    bufferOptions.dropWhenFull = true;
+
+    const int stepCount = 100000;
+    coral::util::TempDir tempDir;
+    coral::slave::RecordingStatistics stats;
+    {
+        coral::slave::RecordingInstance recorder(
+            std::make_shared<Counter>(),
+            tempDir.Path().string() + '/',
+            coral::slave::RecordingSpec{},
+            bufferOptions);
+        recorder.Setup("counter", "drop_test", 0.0, coral::model::ETERNITY, false, 0.0);
+        recorder.StartSimulation();
+        for (int i = 0; i < stepCount; ++i) {
+            ASSERT_TRUE(recorder.DoStep(i * 1.0, 1.0));
+        }
+        recorder.EndSimulation();
+        stats = recorder.Statistics();
+    }
+    // Whether anything is dropped depends on the speed of the disk, but
+    // every step must be accounted for, and we never wait.
+    EXPECT_EQ(std::uint64_t(stepCount), stats.recordedSteps + stats.droppedSteps);
+    EXPECT_EQ(0U, stats.blockedSteps);
+
+    auto reader = coral::slave::RecordingReader(
+        (tempDir.Path() / "drop_test_counter.coralrec").string());
+    coral::model::TimePoint t;
+    std::vector<coral::model::ScalarValue> values;
+    std::uint64_t rowCount = 0;
+    while (reader.ReadRow(t, values)) ++rowCount;
+    EXPECT_EQ(stats.recordedSteps, rowCount);
+
+    bufferOptions.blockCount = 1;
+    EXPECT_THROW(
+        coral::slave::RecordingInstance(
+            std::make_shared<Counter>(),
+            std::string{},
+            coral::slave::RecordingSpec{},
+            bufferOptions),
+        std::invalid_argument);
+}
@@ -26,7 +26,8 @@ Runner::Runner(
     std::shared_ptr<Instance> slaveInstance,
     const coral::net::Endpoint& controlEndpoint,
     const coral::net::Endpoint& dataPubEndpoint,
-    std::chrono::seconds commTimeout)
+    std::chrono::seconds commTimeout,
+    const PublishOptions& publishOptions)
     : m_slaveInstance(slaveInstance),
       m_reactor(std::make_unique<coral::net::Reactor>()),
       m_slaveAgent(std::make_unique<coral::bus::SlaveAgent>(
@@ -34,7 +35,8 @@ Runner::Runner(
         *slaveInstance,
         controlEndpoint,
         dataPubEndpoint,
-        commTimeout))
+        commTimeout,
+        publishOptions))
 {
 }
 
@@ -78,4 +80,16 @@ void Runner::Run()
 }
 
 
+const PublishPolicy& PublishOptions::PolicyFor(
+    const coral::model::VariableDescription& variable) const
+{
+    for (const auto& entry : variables) {
+        if (coral::util::GlobMatch(entry.first, variable.Name())) {
+            return entry.second;
+        }
+    }
+    return defaultPolicy;
+}
+
+
 }} // namespace
@@ -0,0 +1,309 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include <coral/trace.hpp>
+
+#ifdef _WIN32
+#   include <process.h>
+#else
+#   include <unistd.h>
+#endif
+
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include <coral/error.hpp>
+
+
+namespace coral
+{
+namespace trace
+{
+
+namespace detail
+{
+    std::atomic<bool> g_enabled{false};
+}
+
+
+namespace
+{
+    // Must be trivial, so that buffers can be allocated without touching
+    // their memory.
+    struct Event
+    {
+        const char* category;
+        const char* name;
+        const char* argName;
+        std::int64_t argValue;
+        std::int64_t id;
+        std::int64_t begin;
+        std::int64_t end;
+        bool async;
+    };
+
+    // A buffer which is only written to by one thread.  New events are
+    // published to Write() by incrementing `count`.
+    struct Buffer
+    {
+        Buffer(std::size_t capacity_, int tid_)
+            : events(new Event[capacity_])
+            , capacity(capacity_)
+            , tid(tid_)
+        { }
+
+        std::unique_ptr<Event[]> events;
+        const std::size_t capacity;
+        const int tid;
+        std::atomic<std::size_t> count{0};
+        std::atomic<const char*> threadName{nullptr};
+    };
+
+    const auto NO_CLOCK_OFFSET = std::numeric_limits<std::int64_t>::min();
+
+    std::mutex g_mutex;
+    std::vector<std::unique_ptr<Buffer>> g_buffers;
+    std::size_t g_bufferSize = 0;
+    std::string g_processName;
+    std::atomic<std::int64_t> g_clockOffset{NO_CLOCK_OFFSET};
+    std::atomic<std::uint64_t> g_droppedEvents{0};
+    thread_local Buffer* t_buffer = nullptr;
+
+    // Returns the calling thread's buffer, creating it if necessary, or
+    // null if it could not be created.  Buffers are never deleted, since
+    // Write() may be called after the thread has ended.
+    Buffer* ThreadBuffer() noexcept
+    {
+        if (t_buffer) return t_buffer;
+        try {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            g_buffers.push_back(std::make_unique<Buffer>(
+                g_bufferSize, static_cast<int>(g_buffers.size() + 1)));
+            t_buffer = g_buffers.back().get();
+        } catch (...) {
+            return nullptr;
+        }
+        return t_buffer;
+    }
+
+    void Record(const Event& event) noexcept
+    {
+        const auto buffer = ThreadBuffer();
+        if (!buffer) {
+            ++g_droppedEvents;
+            return;
+        }
+        const auto n = buffer->count.load(std::memory_order_relaxed);
+        if (n >= buffer->capacity) {
+            ++g_droppedEvents;
+            return;
+        }
+        buffer->events[n] = event;
+        buffer->count.store(n + 1, std::memory_order_release);
+    }
+
+    int ProcessID()
+    {
+#ifdef _WIN32
+        return _getpid();
+#else
+        return static_cast<int>(getpid());
+#endif
+    }
+
+    void WriteString(std::ostream& stream, const char* str)
+    {
+        stream << '"';
+        for (auto c = str; *c != '\0'; ++c) {
+            if (*c == '"' || *c == '\\') {
+                stream << '\\' << *c;
+            } else if (static_cast<unsigned char>(*c) < 0x20) {
+                stream << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+                    << static_cast<int>(*c) << std::dec << std::setfill(' ');
+            } else {
+                stream << *c;
+            }
+        }
+        stream << '"';
+    }
+
+    // Writes a timestamp in microseconds, which is the unit of the format.
+    void WriteTimestamp(std::ostream& stream, std::int64_t ns)
+    {
+        stream << std::fixed << std::setprecision(3) << (ns / 1000.0);
+    }
+
+    void WriteEventHeader(
+        std::ostream& stream,
+        const Event& event,
+        const char* phase,
+        std::int64_t ns,
+        int pid,
+        int tid)
+    {
+        stream << "{\"name\":";
+        WriteString(stream, event.name);
+        stream << ",\"cat\":";
+        WriteString(stream, event.category);
+        stream << ",\"ph\":\"" << phase << "\",\"ts\":";
+        WriteTimestamp(stream, ns);
+        stream << ",\"pid\":" << pid << ",\"tid\":" << tid;
+    }
+
+    void WriteArgs(std::ostream& stream, const Event& event)
+    {
+        if (event.argName) {
+            stream << ",\"args\":{";
+            WriteString(stream, event.argName);
+            stream << ':' << event.argValue << '}';
+        }
+    }
+
+    void WriteMetadata(
+        std::ostream& stream,
+        const char* name,
+        const char* value,
+        int pid,
+        int tid)
+    {
+        stream << "{\"name\":\"" << name << "\",\"ph\":\"M\",\"pid\":" << pid
+            << ",\"tid\":" << tid << ",\"args\":{\"name\":";
+        WriteString(stream, value);
+        stream << "}}";
+    }
+}
+
+
+void Enable(std::size_t bufferSize)
+{
+    CORAL_INPUT_CHECK(bufferSize > 0);
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_bufferSize = bufferSize;
+    detail::g_enabled = true;
+}
+
+
+void SetProcessName(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_processName = name;
+}
+
+
+void SetThreadName(const char* name) noexcept
+{
+    if (!Enabled()) return;
+    if (const auto buffer = ThreadBuffer()) buffer->threadName = name;
+}
+
+
+void AddClockOffsetSample(std::chrono::nanoseconds sample) noexcept
+{
+    const std::int64_t ns = sample.count();
+    auto current = g_clockOffset.load();
+    while (ns > current && !g_clockOffset.compare_exchange_weak(current, ns)) { }
+}
+
+
+std::int64_t ClockNanoseconds(Clock::time_point t) noexcept
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        t.time_since_epoch()).count();
+}
+
+
+void RecordEvent(
+    const char* category,
+    const char* name,
+    Clock::time_point begin,
+    Clock::time_point end,
+    const char* argName,
+    std::int64_t argValue) noexcept
+{
+    if (!Enabled()) return;
+    Record(Event{
+        category, name, argName, argValue, 0,
+        ClockNanoseconds(begin), ClockNanoseconds(end), false});
+}
+
+
+void RecordAsyncEvent(
+    const char* category,
+    const char* name,
+    std::int64_t id,
+    Clock::time_point begin,
+    Clock::time_point end,
+    const char* argName,
+    std::int64_t argValue) noexcept
+{
+    if (!Enabled()) return;
+    Record(Event{
+        category, name, argName, argValue, id,
+        ClockNanoseconds(begin), ClockNanoseconds(end), true});
+}
+
+
+void Write(std::ostream& stream)
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    const auto pid = ProcessID();
+    const auto clockOffset = g_clockOffset.load();
+    const auto offset = clockOffset == NO_CLOCK_OFFSET ? 0 : clockOffset;
+
+    stream << "{\"traceEvents\":[\n";
+    WriteMetadata(stream, "process_name",
+        g_processName.empty() ? "coral" : g_processName.c_str(), pid, 0);
+    for (const auto& buffer : g_buffers) {
+        if (const auto threadName = buffer->threadName.load()) {
+            stream << ",\n";
+            WriteMetadata(stream, "thread_name", threadName, pid, buffer->tid);
+        }
+        const auto count = buffer->count.load(std::memory_order_acquire);
+        for (std::size_t i = 0; i < count; ++i) {
+            const auto& event = buffer->events[i];
+            stream << ",\n";
+            if (event.async) {
+                WriteEventHeader(stream, event, "b", event.begin + offset, pid, buffer->tid);
+                stream << ",\"id\":" << event.id;
+                WriteArgs(stream, event);
+                stream << "},\n";
+                WriteEventHeader(stream, event, "e", event.end + offset, pid, buffer->tid);
+                stream << ",\"id\":" << event.id << '}';
+            } else {
+                WriteEventHeader(stream, event, "X", event.begin + offset, pid, buffer->tid);
+                stream << ",\"dur\":";
+                WriteTimestamp(stream, event.end - event.begin);
+                WriteArgs(stream, event);
+                stream << '}';
+            }
+        }
+    }
+    stream << "\n],\n\"displayTimeUnit\":\"ms\",\n\"otherData\":{\"droppedEvents\":"
+        << g_droppedEvents.load() << ",\"clockOffsetNs\":" << offset << "}}\n";
+}
+
+
+void Write(const std::string& path)
+{
+    std::ofstream file(path);
+    if (!file) throw std::runtime_error("Failed to open trace file: " + path);
+    Write(file);
+    if (!file) throw std::runtime_error("Failed to write trace file: " + path);
+}
+
+
+std::uint64_t DroppedEventCount() noexcept
+{
+    return g_droppedEvents.load();
+}
+
+
+}} // namespace
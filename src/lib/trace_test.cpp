@@ -0,0 +1,62 @@
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include <coral/trace.hpp>
+
+
+using namespace std::chrono_literals;
+
+
+TEST(coral_trace, Write)
+{
+    EXPECT_THROW(coral::trace::Enable(0), std::invalid_argument);
+
+    // Nothing is recorded while tracing is disabled.
+    ASSERT_FALSE(coral::trace::Enabled());
+    {
+        CORAL_TRACE_SCOPE("test", "disabled");
+    }
+
+    coral::trace::Enable(3);
+    ASSERT_TRUE(coral::trace::Enabled());
+    coral::trace::SetProcessName("test \"process\"");
+    coral::trace::SetThreadName("main");
+
+    const auto t0 = coral::trace::Clock::time_point(1s);
+    coral::trace::RecordEvent("test", "sync", t0, t0 + 1500ns, "step", 7);
+    coral::trace::RecordAsyncEvent("test", "async", 42, t0 + 1us, t0 + 3us);
+    {
+        CORAL_TRACE_SCOPE("test", "scoped");
+    }
+    // The buffer is full now.
+    coral::trace::RecordEvent("test", "dropped", t0, t0);
+    EXPECT_EQ(1u, coral::trace::DroppedEventCount());
+
+    // Only the largest offset sample is used.
+    coral::trace::AddClockOffsetSample(2us);
+    coral::trace::AddClockOffsetSample(-5us);
+
+    std::ostringstream stream;
+    coral::trace::Write(stream);
+    const auto json = stream.str();
+    EXPECT_EQ(0u, json.find("{\"traceEvents\":["));
+    EXPECT_NE(std::string::npos, json.find("\"args\":{\"name\":\"test \\\"process\\\"\"}"));
+    EXPECT_NE(std::string::npos, json.find("\"args\":{\"name\":\"main\"}"));
+    EXPECT_NE(std::string::npos, json.find(
+        "{\"name\":\"sync\",\"cat\":\"test\",\"ph\":\"X\",\"ts\":1000002.000,"));
+    EXPECT_NE(std::string::npos, json.find(
+        "\"dur\":1.500,\"args\":{\"step\":7}}"));
+    EXPECT_NE(std::string::npos, json.find(
+        "{\"name\":\"async\",\"cat\":\"test\",\"ph\":\"b\",\"ts\":1000003.000,"));
+    EXPECT_NE(std::string::npos, json.find(
+        "{\"name\":\"async\",\"cat\":\"test\",\"ph\":\"e\",\"ts\":1000005.000,"));
+    EXPECT_NE(std::string::npos, json.find("\"id\":42"));
+    EXPECT_NE(std::string::npos, json.find("\"name\":\"scoped\""));
+    EXPECT_EQ(std::string::npos, json.find("\"name\":\"disabled\""));
+    EXPECT_EQ(std::string::npos, json.find("\"name\":\"dropped\""));
+    EXPECT_NE(std::string::npos, json.find("\"droppedEvents\":1"));
+}
@@ -96,6 +96,33 @@ int coral::util::ArrayStringCmp(
 }
 
 
+bool coral::util::GlobMatch(const std::string& pattern, const std::string& text)
+{
+    std::size_t p = 0, t = 0;
+    // Where to resume if the current attempt fails: the position just
+    // after the last `*` in the pattern, and the text position it was
+    // tried at.
+    auto starP = std::string::npos;
+    std::size_t starT = 0;
+    while (t < text.size()) {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == text[t])) {
+            ++p;
+            ++t;
+        } else if (p < pattern.size() && pattern[p] == '*') {
+            starP = ++p;
+            starT = t;
+        } else if (starP != std::string::npos) {
+            p = starP;
+            t = ++starT;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*') ++p;
+    return p == pattern.size();
+}
+
+
 std::string coral::util::RandomUUID()
 {
     boost::uuids::random_generator gen;
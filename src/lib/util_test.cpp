@@ -202,6 +202,18 @@ TEST(coral_util, OnScopeExit)
     EXPECT_EQ(3, i);
 }
 
+TEST(coral_util, GlobMatch)
+{
+    EXPECT_TRUE(GlobMatch("foo", "foo"));
+    EXPECT_FALSE(GlobMatch("foo", "fo"));
+    EXPECT_TRUE(GlobMatch("f?o", "fxo"));
+    EXPECT_FALSE(GlobMatch("f?o", "fo"));
+    EXPECT_TRUE(GlobMatch("*", ""));
+    EXPECT_TRUE(GlobMatch("a*b*c", "aXbYbZc"));
+    EXPECT_FALSE(GlobMatch("a*b*c", "aXbYbZ"));
+    EXPECT_TRUE(GlobMatch("x.*", "x.y.z"));
+}
+
 TEST(coral_util, ThisExePath)
 {
 #ifdef _WIN32
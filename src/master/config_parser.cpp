@@ -7,6 +7,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include "config_parser.hpp"
 
 #include <algorithm>
+#include <cassert>
 #include <limits>
 #include <map>
 #include <set>
@@ -66,13 +67,13 @@ namespace
     typedef std::multimap<std::string, coral::master::ProviderCluster::SlaveType>
         SlaveTypeMap;
 
-    // Obtains the list of available slave types on the network and returns it
-    // in the form of a map where the keys are slave type names and the values
-    // are slave type descriptions.
-    SlaveTypeMap SlaveTypesByName(coral::master::ProviderCluster& providers)
+    // Converts a list of available slave types to a map where the keys are
+    // slave type names and the values are slave type descriptions.
+    SlaveTypeMap SlaveTypesByName(
+        const std::vector<coral::master::ProviderCluster::SlaveType>& slaveTypes)
     {
         SlaveTypeMap types;
-        for (const auto& st : providers.GetSlaveTypes(std::chrono::seconds(1))) {
+        for (const auto& st : slaveTypes) {
             types.insert(std::make_pair(st.description.Name(), st));
         }
         return types;
@@ -362,16 +363,18 @@ namespace
 
 void ParseSystemConfig(
     const std::string& path,
-    coral::master::ProviderCluster& providers,
+    const std::vector<coral::master::ProviderCluster::SlaveType>& availableSlaveTypes,
+    std::function<std::vector<coral::net::SlaveLocator>(
+            const std::vector<const coral::master::ProviderCluster::SlaveType*>&)>
+        instantiateSlaves,
     coral::master::Execution& execution,
     std::vector<SimulationEvent>& scenarioOut,
     std::chrono::milliseconds commTimeout,
-    std::chrono::milliseconds instantiationTimeout,
     std::ostream* warningLog,
     std::function<void()> postInstantiationHook)
 {
     const auto ptree = ReadPtreeInfoFile(path);
-    const auto slaveTypes = SlaveTypesByName(providers);
+    const auto slaveTypes = SlaveTypesByName(availableSlaveTypes);
 
     std::map<std::string, const coral::master::ProviderCluster::SlaveType*> slaves;
     std::map<std::string, std::vector<VariableValue>> variables;
@@ -386,14 +389,16 @@ void ParseSystemConfig(
     ParseScenarioNode(ptree, slaves, warningLog, scenario, scenarioEventSlaveName, varDescriptionCache);
 
     // Instantiate the slaves
+    std::vector<const coral::master::ProviderCluster::SlaveType*> typesToInstantiate;
+    for (const auto& slave : slaves) {
+        typesToInstantiate.push_back(slave.second);
+    }
+    const auto locators = instantiateSlaves(typesToInstantiate);
+    assert(locators.size() == slaves.size());
     std::vector<coral::master::AddedSlave> slavesToAdd;
+    std::size_t locatorIndex = 0;
     for (const auto& slave : slaves) {
-        slavesToAdd.emplace_back();
-        slavesToAdd.back().locator = providers.InstantiateSlave(
-            slave.second->providers.front(),
-            slave.second->description.UUID(),
-            instantiationTimeout);
-        slavesToAdd.back().name = slave.first;
+        slavesToAdd.emplace_back(locators[locatorIndex++], slave.first);
     }
     if (postInstantiationHook) postInstantiationHook();
 
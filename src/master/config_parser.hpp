@@ -17,6 +17,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include <coral/config.h>
 #include <coral/master.hpp>
 #include <coral/model.hpp>
+#include <coral/net.hpp>
 
 
 struct SimulationEvent
@@ -38,6 +39,12 @@ struct SimulationEvent
         configuration file.
 
 \param [in] path        The path to the configuration file.
+\param [in] availableSlaveTypes
+                        The slave types which may be used in the system.
+\param [in] instantiateSlaves
+                        A function which instantiates one slave of each of
+                        the given types, preferably concurrently, and
+                        returns their locators in the same order.
 \param [in] execution   The execution controller.
 
 \throws std::runtime_error if there were errors in the configuraiton file.
@@ -46,11 +53,13 @@ struct SimulationEvent
 // and one which applies it to the controller.
 void ParseSystemConfig(
     const std::string& path,
-    coral::master::ProviderCluster& providers,
+    const std::vector<coral::master::ProviderCluster::SlaveType>& availableSlaveTypes,
+    std::function<std::vector<coral::net::SlaveLocator>(
+            const std::vector<const coral::master::ProviderCluster::SlaveType*>&)>
+        instantiateSlaves,
     coral::master::Execution& execution,
     std::vector<SimulationEvent>& scenario,
     std::chrono::milliseconds commTimeout,
-    std::chrono::milliseconds instantiationTimeout,
     std::ostream* warningLog,
     std::function<void()> postInstantiationHook);
 
@@ -8,17 +8,25 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include <cassert>
 #include <chrono>
 #include <cstdint>
+#include <functional>
+#include <iomanip>
 #include <iostream>
+#include <memory>
 #include <queue>
 #include <map>
+#include <sstream>
 #include <string>
 #include <thread>
 #include <vector>
 
+#include <boost/filesystem.hpp>
 #include <boost/program_options.hpp>
 
+#include <coral/fmi.hpp>
 #include <coral/log.hpp>
 #include <coral/master.hpp>
+#include <coral/slave.hpp>
+#include <coral/trace.hpp>
 #include <coral/util/console.hpp>
 
 #include "config_parser.hpp"
@@ -29,6 +37,82 @@ namespace {
     const std::string DEFAULT_NETWORK_INTERFACE = "127.0.0.1";
     const std::uint16_t DEFAULT_DISCOVERY_PORT = 10272;
 
+    // Expands a list of FMU files and directories to a list of FMU files.
+    std::vector<boost::filesystem::path> FMUPaths(
+        const std::vector<std::string>& fmuSpecs)
+    {
+        namespace fs = boost::filesystem;
+        std::vector<fs::path> fmuPaths;
+        for (const auto& fmuSpec : fmuSpecs) {
+            if (fs::is_directory(fmuSpec)) {
+                for (auto it = fs::recursive_directory_iterator(fmuSpec);
+                     it != fs::recursive_directory_iterator();
+                     ++it)
+                {
+                    if (it->path().extension() == ".fmu") {
+                        fmuPaths.push_back(it->path());
+                    }
+                }
+            } else {
+                fmuPaths.push_back(fmuSpec);
+            }
+        }
+        return fmuPaths;
+    }
+
+    // Determines how long in-process slaves should wait for the master
+    // before they shut themselves down.  They are only waiting for us, so
+    // this is just long enough to cover the longest expected pause between
+    // commands.  It matters if the master fails without terminating the
+    // execution, because the slave threads must end before we can exit.
+    std::chrono::seconds InProcessSlaveTimeout(
+        const ExecutionConfig& execConfig,
+        std::chrono::milliseconds stepTimeout,
+        double realtimeMultiplier)
+    {
+        auto maxPause = std::max(execConfig.commTimeout, stepTimeout);
+        if (realtimeMultiplier > 0.0) {
+            maxPause += std::chrono::milliseconds(
+                boost::numeric_cast<std::chrono::milliseconds::rep>(
+                    execConfig.stepSize * 1000 / realtimeMultiplier));
+        }
+        return std::chrono::duration_cast<std::chrono::seconds>(2 * maxPause)
+            + std::chrono::seconds(1);
+    }
+
+    // Prints the mean and max. duration of each step phase for each slave.
+    void PrintStepStatistics(
+        std::ostream& out,
+        const coral::master::ExecutionStatistics& stats)
+    {
+        const auto print = [&out] (const coral::master::LatencyStatistics& s) {
+            std::ostringstream cell;
+            if (s.sampleCount > 0) {
+                cell << s.mean.count() << '/' << s.max.count();
+            } else {
+                cell << '-';
+            }
+            out << std::setw(16) << cell.str();
+        };
+        out << "Step statistics (mean/max, in microseconds):\n"
+            << std::left << std::setw(20) << "Slave" << std::right
+            << std::setw(16) << "doStep"
+            << std::setw(16) << "publish"
+            << std::setw(16) << "inputWait"
+            << std::setw(16) << "network"
+            << std::setw(16) << "roundTrip" << '\n';
+        for (const auto& slave : stats.slaves) {
+            out << std::left << std::setw(20) << slave.slaveName << std::right;
+            print(slave.doStep);
+            print(slave.publish);
+            print(slave.inputWait);
+            print(slave.network);
+            print(slave.roundTrip);
+            out << '\n';
+        }
+        out << std::flush;
+    }
+
     void PrintExecConfigHelp()
     {
         std::cout <<
@@ -141,12 +225,21 @@ int Run(const std::vector<std::string>& args)
             ("debug-pause",
                 "Wait for a user keypress after slaves have been spawned, "
                 "to allow time to attach a debugger.")
+            ("fmu", po::value<std::vector<std::string>>()->composing(),
+                "An FMU file, or a directory which will be searched for FMUs.  "
+                "If this option is given, all slaves are run inside the master "
+                "process, using the given FMUs, rather than by slave providers "
+                "on the network.  May be given several times.")
             ("interface", po::value<std::string>()->default_value(DEFAULT_NETWORK_INTERFACE),
                 "The IP address or (OS-specific) name of the network interface to "
                 "use for network communications, or \"*\" for all/any.")
             ("name,n", po::value<std::string>()->default_value(""),
                 "The execution name.  If left unspecified, a name will be created "
                 "based on the current date and time.")
+            ("output-dir,o", po::value<std::string>(),
+                "The directory to which variable values are written when slaves "
+                "are run inside the master process (see --fmu).  If left "
+                "unspecified, values are not recorded.")
             ("port", po::value<std::uint16_t>()->default_value(DEFAULT_DISCOVERY_PORT),
                 "The UDP port used to listen for slave providers.")
             ("realtime,r", po::value<double>()->default_value(0.0),
@@ -155,6 +248,27 @@ int Run(const std::vector<std::string>& args)
                 "simulation should run in real time, while e.g. 2 means twice as "
                 "fast.  The default is 0, which is a special value that means "
                 "\"as fast as possible\".")
+            ("realtime-overrun", po::value<std::string>()->default_value("catch-up"),
+                "What to do in real-time mode (see --realtime) when a time step "
+                "starts more than one step period late.  \"catch-up\" means that "
+                "the following steps are run as fast as possible until the "
+                "simulation has caught up with the wall clock, while \"skip\" "
+                "means that the lost time is given up.")
+            ("stats",
+                "Print a summary of how long each slave spent on the different "
+                "phases of its time steps when the simulation is done.")
+            ("step-threads", po::value<std::size_t>()->default_value(0),
+                "The maximum number of slaves which may perform a time step at "
+                "the same time when slaves are run inside the master process "
+                "(see --fmu).  The default, 0, means the number of hardware "
+                "threads.")
+            ("trace", po::value<std::string>(),
+                "Record the begin and end times of the phases of each time step, "
+                "and write them to the given file in the Trace Event Format "
+                "(viewable in chrome://tracing or the Perfetto UI) when the "
+                "simulation is done.  Slaves which run in separate processes "
+                "write their own trace files to their output directories, "
+                "unless they were started with --no-output.")
             ("warnings,w",
                 "Enable warnings while parsing configuration files.")
             ("help-exec-config",
@@ -198,27 +312,126 @@ int Run(const std::vector<std::string>& args)
         const auto execConfigFile = (*argValues)["exec-config"].as<std::string>();
         const auto sysConfigFile = (*argValues)["sys-config"].as<std::string>();
         const auto debugPause= !!argValues->count("debug-pause");
+        const auto printStats = !!argValues->count("stats");
         const auto networkInterface = coral::net::ip::Address{
             (*argValues)["interface"].as<std::string>()};
         const auto execName = (*argValues)["name"].as<std::string>();
         const auto discoveryPort = coral::net::ip::Port{
             (*argValues)["port"].as<std::uint16_t>()};
         const auto realtimeMultiplier = (*argValues)["realtime"].as<double>();
+        const auto realtimeOverrun = (*argValues)["realtime-overrun"].as<std::string>();
+        if (realtimeOverrun != "catch-up" && realtimeOverrun != "skip") {
+            throw std::runtime_error(
+                "Invalid value for --realtime-overrun: " + realtimeOverrun);
+        }
         const auto warningStream = argValues->count("warnings") ? &std::clog : nullptr;
-
-        auto providers = coral::master::ProviderCluster{
-            networkInterface,
-            discoveryPort};
-
-        // TODO: Handle this waiting more elegantly, e.g. wait until all required
-        // slave types are available.  Also, the waiting time is related to the
-        // slave provider heartbeat time.
-        std::cout << "Looking for slave providers..." << std::endl;
-        std::this_thread::sleep_for(std::chrono::seconds(2));
+        const auto traceFile = argValues->count("trace")
+            ? (*argValues)["trace"].as<std::string>()
+            : std::string{};
+        if (!traceFile.empty()) {
+            coral::trace::Enable();
+            coral::trace::SetProcessName("coralmaster");
+            coral::trace::SetThreadName("main");
+        }
 
         std::cout << "Parsing execution configuration file '" << execConfigFile
                   << "'" << std::endl;
         const auto execConfig = ParseExecutionConfig(execConfigFile);
+        const auto stepTimeout = std::chrono::milliseconds(
+            boost::numeric_cast<typename std::chrono::milliseconds::rep>(
+                execConfig.stepSize * 1000 * execConfig.stepTimeoutMultiplier));
+
+        // Slaves are either run by slave providers on the network, or inside
+        // this process.  The slave threads must outlive the execution, so
+        // these objects are created first.
+        std::unique_ptr<coral::master::ProviderCluster> providers;
+        std::shared_ptr<coral::fmi::Importer> importer;
+        std::map<std::string, std::shared_ptr<coral::fmi::FMU>> localFMUs;
+        coral::master::InProcessSlaves localSlaves(
+            (*argValues)["step-threads"].as<std::size_t>());
+        std::vector<coral::master::ProviderCluster::SlaveType> slaveTypes;
+        std::function<std::vector<coral::net::SlaveLocator>(
+                const std::vector<const coral::master::ProviderCluster::SlaveType*>&)>
+            instantiateSlaves;
+
+        if (argValues->count("fmu")) {
+            std::cout << "Loading FMUs" << std::endl;
+            importer = coral::fmi::Importer::Create(
+                boost::filesystem::temp_directory_path() / "coral" / "cache");
+            for (const auto& fmuPath : FMUPaths(
+                    (*argValues)["fmu"].as<std::vector<std::string>>())) {
+                auto fmu = importer->Import(fmuPath);
+                const auto& description = fmu->Description();
+                if (localFMUs.insert(std::make_pair(description.UUID(), fmu)).second) {
+                    slaveTypes.push_back({description, std::vector<std::string>{}});
+                }
+            }
+            const auto outputDir = argValues->count("output-dir")
+                ? (*argValues)["output-dir"].as<std::string>()
+                : std::string{};
+            const auto slaveTimeout = InProcessSlaveTimeout(
+                execConfig, stepTimeout, realtimeMultiplier);
+            instantiateSlaves = [&localFMUs, &localSlaves, outputDir, slaveTimeout]
+                (const std::vector<const coral::master::ProviderCluster::SlaveType*>& types)
+            {
+                std::vector<coral::net::SlaveLocator> locators;
+                for (const auto slaveType : types) {
+                    std::shared_ptr<coral::slave::Instance> instance =
+                        localFMUs.at(slaveType->description.UUID())->InstantiateSlave();
+                    if (!outputDir.empty()) {
+                        instance = std::make_shared<coral::slave::RecordingInstance>(
+                            instance,
+                            (boost::filesystem::path(outputDir) / "").string());
+                    }
+                    locators.push_back(localSlaves.Add(instance, slaveTimeout));
+                }
+                return locators;
+            };
+        } else {
+            providers = std::make_unique<coral::master::ProviderCluster>(
+                networkInterface,
+                discoveryPort);
+
+            // TODO: Handle this waiting more elegantly, e.g. wait until all required
+            // slave types are available.  Also, the waiting time is related to the
+            // slave provider heartbeat time.
+            std::cout << "Looking for slave providers..." << std::endl;
+            std::this_thread::sleep_for(std::chrono::seconds(2));
+            slaveTypes = providers->GetSlaveTypes(std::chrono::seconds(1));
+
+            const auto instantiationTimeout = execConfig.instantiationTimeout;
+            instantiateSlaves = [&providers, instantiationTimeout]
+                (const std::vector<const coral::master::ProviderCluster::SlaveType*>& types)
+            {
+                // All slaves are spawned concurrently.
+                std::vector<coral::master::ProviderCluster::SlaveInstantiation> requests;
+                for (const auto slaveType : types) {
+                    requests.emplace_back(
+                        slaveType->providers.front(),
+                        slaveType->description.UUID());
+                }
+                try {
+                    providers->InstantiateSlaves(requests, instantiationTimeout);
+                } catch (const std::runtime_error&) {
+                    for (std::size_t i = 0; i < requests.size(); ++i) {
+                        if (requests[i].error) {
+                            coral::log::Log(coral::log::error,
+                                boost::format("Error instantiating slave of type '%s' on slave provider %s: %s (%s)")
+                                    % types[i]->description.Name()
+                                    % requests[i].slaveProviderID
+                                    % requests[i].error.message()
+                                    % requests[i].errorMessage);
+                        }
+                    }
+                    throw;
+                }
+                std::vector<coral::net::SlaveLocator> locators;
+                for (const auto& request : requests) {
+                    locators.push_back(request.locator);
+                }
+                return locators;
+            };
+        }
         coral::master::ExecutionOptions execOptions;
         execOptions.startTime                   = execConfig.startTime;
         execOptions.maxTime                     = execConfig.stopTime;
@@ -242,11 +455,11 @@ int Run(const std::vector<std::string>& args)
 
         ParseSystemConfig(
             sysConfigFile,
-            providers,
+            slaveTypes,
+            instantiateSlaves,
             exec,
             unsortedScenario,
             execConfig.commTimeout,
-            execConfig.instantiationTimeout,
             warningStream,
             debugPauseCallback);
 
@@ -264,9 +477,6 @@ int Run(const std::vector<std::string>& args)
         const auto t0 = std::chrono::high_resolution_clock::now();
         const double maxTime = execConfig.stopTime - 0.9*execConfig.stepSize;
         double nextPerc = 0.05;
-        const auto stepTimeout = std::chrono::milliseconds(
-            boost::numeric_cast<typename std::chrono::milliseconds::rep>(
-                execConfig.stepSize * 1000 * execConfig.stepTimeoutMultiplier));
 
         const double clockRes = // the resolution of the clock, in secs/tick
             static_cast<double>(std::chrono::high_resolution_clock::duration::period::num)
@@ -274,24 +484,31 @@ int Run(const std::vector<std::string>& args)
         auto prevRealTime = std::chrono::high_resolution_clock::now();
         auto prevSimTime = execConfig.startTime;
 
-        auto targetWallClockTime = std::chrono::steady_clock::now();
-        const double wallClockTicksPerSec =
-            static_cast<double>(std::chrono::steady_clock::duration::period::den)
-            / std::chrono::steady_clock::duration::period::num;
-        const auto wallClockStepSize = std::chrono::steady_clock::duration(
-            static_cast<std::chrono::steady_clock::duration::rep>(
-                execConfig.stepSize * wallClockTicksPerSec / realtimeMultiplier));
         if (realtimeMultiplier > 0.0) {
-            CORAL_LOG_DEBUG(boost::format("Real-time step size is %d microseconds")
-                % std::chrono::duration_cast<std::chrono::microseconds>(
-                    wallClockStepSize).count());
+            coral::master::RealTimeOptions realTimeOptions;
+            realTimeOptions.realTimeFactor = realtimeMultiplier;
+            realTimeOptions.overrunPolicy = realtimeOverrun == "skip"
+                ? coral::master::OverrunPolicy::skip
+                : coral::master::OverrunPolicy::catchUp;
+            exec.EnableRealTime(realTimeOptions);
         }
 
+        // Each step is accepted together with the next one, so it takes a
+        // single round trip per slave.  The last step, and any step which
+        // is followed by a scenario event, is accepted separately.
+        const auto mergedStepTimeout = execConfig.commTimeout < std::chrono::milliseconds(0)
+            ? execConfig.commTimeout
+            : stepTimeout + execConfig.commTimeout;
+        bool stepPending = false;
         for (double time = execConfig.startTime;
              time < maxTime;
              time += execConfig.stepSize)
         {
             if (!scenario.empty() && scenario.top().timePoint <= time) {
+                if (stepPending) {
+                    exec.AcceptStep(execConfig.commTimeout);
+                    stepPending = false;
+                }
                 std::vector<coral::master::SlaveConfig> settings;
                 std::map<coral::model::SlaveID, std::size_t> indexes;
                 while (!scenario.empty() && scenario.top().timePoint <= time) {
@@ -312,10 +529,13 @@ int Run(const std::vector<std::string>& args)
                 }
                 exec.Reconfigure(settings, execConfig.commTimeout);
             }
-            if (exec.Step(execConfig.stepSize, stepTimeout) != coral::master::StepResult::completed) {
+            const auto stepResult = stepPending
+                ? exec.AcceptStepAndStep(execConfig.stepSize, mergedStepTimeout)
+                : exec.Step(execConfig.stepSize, stepTimeout);
+            if (stepResult != coral::master::StepResult::completed) {
                 throw std::runtime_error("One or more slaves failed to perform the time step");
             }
-            exec.AcceptStep(execConfig.commTimeout);
+            stepPending = true;
 
             // Print how far we've gotten in the simulation and how fast it's
             // going.
@@ -328,18 +548,36 @@ int Run(const std::vector<std::string>& args)
                 prevRealTime = realTime;
                 prevSimTime = time;
             }
-
-            if (realtimeMultiplier > 0.0) {
-                targetWallClockTime += wallClockStepSize;
-                std::this_thread::sleep_until(targetWallClockTime);
-            }
         }
 
+        if (stepPending) exec.AcceptStep(execConfig.commTimeout);
+
         // Termination
         const auto t1 = std::chrono::high_resolution_clock::now();
         const auto simTime = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0);
         std::cout << "Completed in " << simTime.count() << " ms." << std::endl;
+        if (realtimeMultiplier > 0.0) {
+            const auto rtStats = exec.RealTimeStatistics();
+            std::cout << "Real-time steps: " << rtStats.stepCount
+                << ", overruns: " << rtStats.overrunCount
+                << ", skipped periods: " << rtStats.skippedPeriods
+                << ", mean lateness: "
+                << std::chrono::duration_cast<std::chrono::microseconds>(
+                    rtStats.meanLateness).count() << " us"
+                << ", max lateness: "
+                << std::chrono::duration_cast<std::chrono::microseconds>(
+                    rtStats.maxLateness).count() << " us" << std::endl;
+        }
+        if (printStats) PrintStepStatistics(std::cout, exec.Statistics());
         exec.Terminate();
+        if (!traceFile.empty()) {
+            coral::trace::Write(traceFile);
+            std::cout << "Trace written to '" << traceFile << "'";
+            if (const auto dropped = coral::trace::DroppedEventCount()) {
+                std::cout << " (" << dropped << " events dropped)";
+            }
+            std::cout << std::endl;
+        }
     } catch (const std::runtime_error& e) {
         coral::log::Log(coral::log::error, e.what());
         return 1;
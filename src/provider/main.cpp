@@ -5,11 +5,13 @@ License, v. 2.0. If a copy of the MPL was not distributed with this
 file, You can obtain one at http://mozilla.org/MPL/2.0/.
 */
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <exception>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -25,6 +27,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include <coral/net.hpp>
 #include <coral/net/zmqx.hpp>
 #include <coral/provider.hpp>
+#include <coral/provider/slave_pool.hpp>
 #include <coral/util.hpp>
 #include <coral/util/console.hpp>
 
@@ -34,6 +37,9 @@ namespace
     const std::string MY_NAME = "coralslaveprovider";
     const std::string DEFAULT_NETWORK_INTERFACE = "127.0.0.1";
     const std::uint16_t DEFAULT_DISCOVERY_PORT = 10272;
+    const std::size_t DEFAULT_MAX_CONCURRENT_INSTANTIATIONS = 8;
+    const std::size_t DEFAULT_POOL_SIZE = 0;
+    const auto POOL_RELEASE_WAIT = std::chrono::seconds(2);
 #ifdef _WIN32
     const std::string DEFAULT_SLAVE_EXE = "coralslave.exe";
 #else
@@ -42,6 +48,76 @@ namespace
 }
 
 
+namespace
+{
+    // Receives and parses the status message which a newly started slave
+    // sends to the slave provider, and returns the slave's locator.
+    // Throws std::runtime_error if the slave reports a failure.
+    coral::net::SlaveLocator ReceiveSlaveStatus(zmq::socket_t& slaveStatusSocket)
+    {
+        std::vector<zmq::message_t> slaveStatus;
+        coral::net::zmqx::Receive(slaveStatusSocket, slaveStatus);
+        if (coral::net::zmqx::ToString(slaveStatus[0]) == "ERROR" &&
+                slaveStatus.size() == 2) {
+            throw std::runtime_error(coral::net::zmqx::ToString(slaveStatus[1]));
+        } else if (coral::net::zmqx::ToString(slaveStatus[0]) != "OK" ||
+                slaveStatus.size() < 3 ||
+                slaveStatus[1].size() == 0 ||
+                slaveStatus[2].size() == 0) {
+            throw std::runtime_error("Invalid data received from slave executable");
+        }
+        // At this point, we know that slaveStatus contains three frames, where
+        // the first one is "OK", signifying that the slave seems to be up and
+        // running.  The following two contains the endpoints to which the slave
+        // is bound.
+        return coral::net::SlaveLocator{
+            coral::net::ip::Endpoint{coral::net::zmqx::ToString(slaveStatus[1])}
+                .ToEndpoint("tcp"),
+            coral::net::ip::Endpoint{coral::net::zmqx::ToString(slaveStatus[2])}
+                .ToEndpoint("tcp")
+        };
+    }
+
+
+    // A slave process which has been started, but which has not yet reported
+    // back to us.
+    class MyPendingInstantiation : public coral::provider::PendingInstantiation
+    {
+    public:
+        MyPendingInstantiation(
+            zmq::socket_t slaveStatusSocket,
+            const boost::filesystem::path& fmuPath)
+            : m_slaveStatusSocket(std::move(slaveStatusSocket))
+            , m_fmuPath(fmuPath)
+        {
+        }
+
+        zmq::socket_t& Socket() override
+        {
+            return m_slaveStatusSocket;
+        }
+
+        bool Complete(
+            coral::net::SlaveLocator& slaveLocator,
+            std::string& failureDescription) override
+        {
+            try {
+                slaveLocator = ReceiveSlaveStatus(m_slaveStatusSocket);
+                std::clog << "Slave started: " << m_fmuPath << std::endl;
+                return true;
+            } catch (const std::exception& e) {
+                failureDescription = e.what();
+                return false;
+            }
+        }
+
+    private:
+        zmq::socket_t m_slaveStatusSocket;
+        boost::filesystem::path m_fmuPath;
+    };
+}
+
+
 struct MySlaveCreator : public coral::provider::SlaveCreator
 {
 public:
@@ -56,7 +132,8 @@ public:
         const std::string& logLevel,
         bool enableFileLogging,
         const std::string& logFileDir,
-        bool createConsoles)
+        bool createConsoles,
+        std::size_t poolSize)
         : m_fmuPath{fmuPath}
         , m_fmu{importer.Import(fmuPath)}
         , m_networkInterface{networkInterface}
@@ -68,7 +145,25 @@ public:
         , m_enableFileLogging(enableFileLogging)
         , m_logFileDir(logFileDir)
         , m_createConsoles(createConsoles)
+        , m_pool(
+            poolSize,
+            // Pooled slaves are discarded well before they would time out
+            // and shut themselves down.
+            masterInactivityTimeout < std::chrono::seconds(0)
+                ? std::chrono::milliseconds(-1)
+                : std::chrono::milliseconds(masterInactivityTimeout) / 2,
+            [this] (const std::string& statusEndpoint) {
+                StartSlave(statusEndpoint, true);
+            })
+    {
+        FillPool();
+    }
+
+    ~MySlaveCreator()
     {
+        // Tell idle pooled slaves to shut down.  Slaves which are still
+        // starting are given a moment to report in, so they can be told too.
+        m_pool.ReleaseAll(POOL_RELEASE_WAIT);
     }
 
     const coral::model::SlaveTypeDescription& Description() const override
@@ -82,37 +177,8 @@ public:
     {
         m_instantiationFailureDescription.clear();
         try {
-            auto slaveStatusSocket = zmq::socket_t(coral::net::zmqx::GlobalContext(), ZMQ_PULL);
-            const auto slaveStatusPort = coral::net::zmqx::BindToEphemeralPort(slaveStatusSocket);
-            const auto slaveStatusEp = "tcp://localhost:" + boost::lexical_cast<std::string>(slaveStatusPort);
-
-            std::vector<std::string> args;
-            args.push_back(m_fmuPath.string());
-            args.push_back("--coralslaveprovider-endpoint=" + slaveStatusEp);
-            args.push_back("--hangaround-time=" + std::to_string(m_masterInactivityTimeout.count()));
-            args.push_back("--interface=" + m_networkInterface.ToString());
-            if (!m_enableOutput) {
-                args.push_back("--no-output");
-            }
-            args.push_back("--output-dir=" + m_outputDir);
-            args.push_back("--log-level=" + m_logLevel);
-            if (m_enableFileLogging) {
-                args.push_back("--log-file");
-                args.push_back("--log-file-dir=" + m_logFileDir);
-            }
-
-            auto processOptions = coral::util::ProcessOptions::none;
-            if (m_createConsoles) processOptions |= coral::util::ProcessOptions::createNewConsole;
-
-            std::cout << "\nStarting slave...\n"
-                << "  FMU       : " << m_fmuPath << '\n'
-                << std::flush;
-            CORAL_LOG_DEBUG(boost::format("Starting process: %s %s")
-                % m_slaveExe % boost::algorithm::join(args, " "));
-            coral::util::SpawnProcess(m_slaveExe, args, processOptions);
-
+            auto slaveStatusSocket = StartUnpooledSlave();
             std::clog << "Waiting for verification..." << std::flush;
-            std::vector<zmq::message_t> slaveStatus;
             const auto feedbackTimedOut = !coral::net::zmqx::WaitForIncoming(
                 slaveStatusSocket,
                 timeout);
@@ -122,27 +188,7 @@ public:
                     + boost::lexical_cast<std::string>(timeout.count())
                     + " milliseconds to start; presumably it has failed altogether");
             }
-            coral::net::zmqx::Receive(slaveStatusSocket, slaveStatus);
-            if (coral::net::zmqx::ToString(slaveStatus[0]) == "ERROR" &&
-                    slaveStatus.size() == 2) {
-                throw std::runtime_error(coral::net::zmqx::ToString(slaveStatus[1]));
-            } else if (coral::net::zmqx::ToString(slaveStatus[0]) != "OK" ||
-                    slaveStatus.size() < 3 ||
-                    slaveStatus[1].size() == 0 ||
-                    slaveStatus[2].size() == 0) {
-                throw std::runtime_error("Invalid data received from slave executable");
-            }
-            // At this point, we know that slaveStatus contains three frames, where
-            // the first one is "OK", signifying that the slave seems to be up and
-            // running.  The following two contains the endpoints to which the slave
-            // is bound.
-            slaveLocator = coral::net::SlaveLocator{
-                coral::net::ip::Endpoint{coral::net::zmqx::ToString(slaveStatus[1])}
-                    .ToEndpoint("tcp"),
-                coral::net::ip::Endpoint{coral::net::zmqx::ToString(slaveStatus[2])}
-                    .ToEndpoint("tcp")
-            };
-
+            slaveLocator = ReceiveSlaveStatus(slaveStatusSocket);
             std::clog << "OK" << std::endl;
             return true;
         } catch (const std::exception& e) {
@@ -156,7 +202,103 @@ public:
         return m_instantiationFailureDescription;
     }
 
+    std::unique_ptr<coral::provider::PendingInstantiation> StartInstantiation(
+        std::chrono::milliseconds /*timeout*/) override
+    {
+        std::unique_ptr<coral::provider::PendingInstantiation> pending;
+        m_pool.Update();
+        if (auto pooled = m_pool.Claim()) {
+            std::clog << "\nClaiming pooled slave for " << m_fmuPath << std::endl;
+            pending = std::make_unique<MyPendingInstantiation>(
+                std::move(*pooled), m_fmuPath);
+        } else {
+            if (m_pool.Size() > 0) {
+                CORAL_LOG_DEBUG("No pooled slave is ready; starting a new one");
+            }
+            pending = std::make_unique<MyPendingInstantiation>(
+                StartUnpooledSlave(), m_fmuPath);
+        }
+        FillPool();
+        return pending;
+    }
+
+    void Maintain() override
+    {
+        // Replace pooled slaves which have failed or gone stale while the
+        // provider was idle, so the next request finds a ready one.
+        try {
+            m_pool.Update();
+        } catch (const std::exception& e) {
+            coral::log::Log(
+                coral::log::error,
+                boost::format("Failed to update slave pool for %s: %s")
+                    % m_fmuPath % e.what());
+        }
+        FillPool();
+    }
+
 private:
+    // Spawns a slave process which is not pooled, and returns the socket on
+    // which it will report its status.
+    zmq::socket_t StartUnpooledSlave()
+    {
+        auto slaveStatusSocket = zmq::socket_t(
+            coral::net::zmqx::GlobalContext(),
+            ZMQ_PULL);
+        const auto slaveStatusPort = coral::net::zmqx::BindToEphemeralPort(slaveStatusSocket);
+        StartSlave(
+            "tcp://localhost:" + boost::lexical_cast<std::string>(slaveStatusPort),
+            false);
+        return slaveStatusSocket;
+    }
+
+    // Spawns a slave process which reports its status to `statusEndpoint`.
+    // If `pooled` is true, the slave will wait for a "CLAIM" command on the
+    // same socket once it is ready.
+    void StartSlave(const std::string& statusEndpoint, bool pooled)
+    {
+        std::vector<std::string> args;
+        args.push_back(m_fmuPath.string());
+        args.push_back("--coralslaveprovider-endpoint=" + statusEndpoint);
+        args.push_back("--hangaround-time=" + std::to_string(m_masterInactivityTimeout.count()));
+        args.push_back("--interface=" + m_networkInterface.ToString());
+        if (!m_enableOutput) {
+            args.push_back("--no-output");
+        }
+        args.push_back("--output-dir=" + m_outputDir);
+        args.push_back("--log-level=" + m_logLevel);
+        if (m_enableFileLogging) {
+            args.push_back("--log-file");
+            args.push_back("--log-file-dir=" + m_logFileDir);
+        }
+        if (pooled) {
+            args.push_back("--wait-for-claim");
+        }
+
+        auto processOptions = coral::util::ProcessOptions::none;
+        if (m_createConsoles) processOptions |= coral::util::ProcessOptions::createNewConsole;
+
+        std::cout << (pooled ? "\nStarting pooled slave...\n" : "\nStarting slave...\n")
+            << "  FMU       : " << m_fmuPath << '\n'
+            << std::flush;
+        CORAL_LOG_DEBUG(boost::format("Starting process: %s %s")
+            % m_slaveExe % boost::algorithm::join(args, " "));
+        coral::util::SpawnProcess(m_slaveExe, args, processOptions);
+    }
+
+    // Starts new pooled slaves until the pool is full.
+    void FillPool()
+    {
+        try {
+            m_pool.Fill();
+        } catch (const std::exception& e) {
+            coral::log::Log(
+                coral::log::error,
+                boost::format("Failed to start pooled slave for %s: %s")
+                    % m_fmuPath % e.what());
+        }
+    }
+
     boost::filesystem::path m_fmuPath;
     std::shared_ptr<coral::fmi::FMU> m_fmu;
     coral::net::ip::Address m_networkInterface;
@@ -169,6 +311,7 @@ private:
     std::string m_logFileDir;
     bool m_createConsoles;
 
+    coral::provider::SlavePool m_pool;
     std::string m_instantiationFailureDescription;
 };
 
@@ -204,6 +347,9 @@ try {
         ("interface", po::value<std::string>()->default_value(DEFAULT_NETWORK_INTERFACE),
             "The IP address or (OS-specific) name of the network interface to "
             "use for network communications, or \"*\" for all/any.")
+        ("max-concurrent-instantiations", po::value<std::size_t>()->default_value(DEFAULT_MAX_CONCURRENT_INSTANTIATIONS),
+            "The maximum number of slaves which may be starting up at the same "
+            "time.  Further instantiation requests are queued.")
         ("no-output",
             "Disable file output of variable values.")
         ("no-slave-console",
@@ -213,6 +359,11 @@ try {
             "other platforms.")
         ("output-dir,o", po::value<std::string>()->default_value("."),
             "The directory where output files should be written.")
+        ("pool-size", po::value<std::size_t>()->default_value(DEFAULT_POOL_SIZE),
+            "The number of idle slaves to keep ready for each FMU.  Pooled "
+            "slaves have already loaded their FMU and bound their ports, so "
+            "they can be handed out to a master immediately.  The pool is "
+            "refilled in the background.  0 disables pooling.")
         ("port", po::value<std::uint16_t>()->default_value(DEFAULT_DISCOVERY_PORT),
             "The UDP port used to broadcast information about this slave provider. "
             "The master must listen on the same port.")
@@ -257,6 +408,12 @@ try {
     if (timeout < std::chrono::seconds(-1)) {
         throw std::runtime_error("Invalid timeout value");
     }
+    const auto maxConcurrentInstantiations =
+        (*optionValues)["max-concurrent-instantiations"].as<std::size_t>();
+    if (maxConcurrentInstantiations < 1) {
+        throw std::runtime_error("Invalid value for max-concurrent-instantiations");
+    }
+    const auto poolSize = (*optionValues)["pool-size"].as<std::size_t>();
     const auto logLevel = (*optionValues)["log-level"].as<std::string>();
     const auto enableFileLogging = optionValues->count("log-file") > 0;
     const auto logFileDir = (*optionValues)["log-file-dir"].as<std::string>();
@@ -302,7 +459,8 @@ try {
                 logLevel,
                 enableFileLogging,
                 logFileDir,
-                createConsoles));
+                createConsoles,
+                poolSize));
             std::cout << "FMU loaded: " << p << std::endl;
         } catch (const std::runtime_error& e) {
             ++failedFMUS;
@@ -328,7 +486,8 @@ try {
                 coral::log::Log(coral::log::error, e.what());
                 std::exit(1);
             }
-        }
+        },
+        maxConcurrentInstantiations
     };
     std::cout << "Press ENTER to quit" << std::flush;
     std::cin.ignore();
@@ -0,0 +1,85 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+#include <cerrno>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <boost/filesystem.hpp>
+
+#include <coral/config.h>
+#include <coral/error.hpp>
+#include <coral/log.hpp>
+#include <coral/slave/recording.hpp>
+#include <coral/util/console.hpp>
+
+
+namespace
+{
+    const char* MY_NAME = "coralrec2csv";
+}
+
+
+int main(int argc, const char** argv)
+{
+try {
+    namespace po = boost::program_options;
+    po::options_description options("Options");
+    options.add_options()
+        ("output,o", po::value<std::string>(),
+            "The CSV file to write.  If left unspecified, the name of the "
+            "recording file is used, with the extension replaced by \".csv\". "
+            "The special value \"-\" means standard output.");
+    po::options_description positionalOptions("Arguments");
+    positionalOptions.add_options()
+        ("recording", po::value<std::string>(),
+            "The recording file (.coralrec) to convert.");
+    po::positional_options_description positions;
+    positions.add("recording", 1);
+
+    const auto args = coral::util::CommandLine(argc-1, argv+1);
+    const auto optionValues = coral::util::ParseArguments(
+        args, options, positionalOptions, positions,
+        std::cerr,
+        MY_NAME,
+        "Recording converter (" CORAL_PROGRAM_NAME_VERSION ")\n\n"
+        "Converts a file written by coralslave in the binary output format "
+        "to CSV.");
+    if (!optionValues) return 0;
+
+    if (!optionValues->count("recording")) {
+        throw std::runtime_error("No recording file specified");
+    }
+    const auto recordingPath = (*optionValues)["recording"].as<std::string>();
+    const auto outputPath = optionValues->count("output")
+        ? (*optionValues)["output"].as<std::string>()
+        : boost::filesystem::path(recordingPath).replace_extension(".csv").string();
+
+    coral::slave::RecordingReader recording(recordingPath);
+    if (outputPath == "-") {
+        coral::slave::ExportCSV(recording, std::cout);
+    } else {
+        std::ofstream output(outputPath, std::ios_base::out | std::ios_base::trunc);
+        if (!output.is_open()) {
+            const int e = errno;
+            throw std::runtime_error(coral::error::ErrnoMessage(
+                "Error opening file \"" + outputPath + "\" for writing",
+                e));
+        }
+        coral::slave::ExportCSV(recording, output);
+    }
+
+} catch (const std::runtime_error& e) {
+    coral::log::Log(coral::log::error, e.what());
+    return 1;
+} catch (const std::exception& e) {
+    coral::log::Log(coral::log::error, std::string("Internal error (") + e.what() + ')');
+    return 2;
+}
+return 0;
+}
@@ -14,6 +14,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include <iostream>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #include <boost/filesystem.hpp>
 #include <zmq.hpp>
@@ -23,6 +24,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include <coral/log.hpp>
 #include <coral/net/zmqx.hpp>
 #include <coral/slave.hpp>
+#include <coral/trace.hpp>
 #include <coral/util/console.hpp>
 
 
@@ -30,6 +32,69 @@ namespace
 {
     const char* MY_NAME = "coralslave";
     const char* DEFAULT_NETWORK_INTERFACE = "127.0.0.1";
+
+    coral::model::Causality ParseCausality(const std::string& s)
+    {
+        if (s == "parameter")            return coral::model::PARAMETER_CAUSALITY;
+        if (s == "calculated_parameter") return coral::model::CALCULATED_PARAMETER_CAUSALITY;
+        if (s == "input")                return coral::model::INPUT_CAUSALITY;
+        if (s == "output")               return coral::model::OUTPUT_CAUSALITY;
+        if (s == "local")                return coral::model::LOCAL_CAUSALITY;
+        throw std::runtime_error("Invalid record-causality value: " + s);
+    }
+
+    coral::slave::RecordingSpec GetRecordingSpec(
+        const boost::program_options::variables_map& optionValues)
+    {
+        coral::slave::RecordingSpec spec;
+        if (optionValues.count("record")) {
+            spec.variables = optionValues["record"].as<std::vector<std::string>>();
+        }
+        if (optionValues.count("record-causality")) {
+            for (const auto& c :
+                    optionValues["record-causality"].as<std::vector<std::string>>()) {
+                spec.causalities |= ParseCausality(c);
+            }
+        }
+        spec.stepInterval = optionValues["record-every"].as<int>();
+        if (spec.stepInterval < 1) {
+            throw std::runtime_error("Invalid record-every value");
+        }
+        spec.minTimeInterval = optionValues["record-interval"].as<double>();
+        if (spec.minTimeInterval < 0.0) {
+            throw std::runtime_error("Invalid record-interval value");
+        }
+        return spec;
+    }
+
+    coral::slave::PublishOptions GetPublishOptions(
+        const boost::program_options::variables_map& optionValues)
+    {
+        auto policy = coral::slave::PublishPolicy{};
+        policy.onChange = true;
+        policy.absoluteDeadband = optionValues["publish-deadband"].as<double>();
+        policy.relativeDeadband =
+            optionValues["publish-relative-deadband"].as<double>();
+        if (policy.absoluteDeadband < 0.0) {
+            throw std::runtime_error("Invalid publish-deadband value");
+        }
+        if (policy.relativeDeadband < 0.0) {
+            throw std::runtime_error("Invalid publish-relative-deadband value");
+        }
+
+        coral::slave::PublishOptions options;
+        if (optionValues.count("publish-on-change")) {
+            for (const auto& pattern :
+                    optionValues["publish-on-change"].as<std::vector<std::string>>()) {
+                options.variables.emplace_back(pattern, policy);
+            }
+        }
+        options.keyframeInterval = optionValues["publish-keyframe-interval"].as<int>();
+        if (options.keyframeInterval < 0) {
+            throw std::runtime_error("Invalid publish-keyframe-interval value");
+        }
+        return options;
+    }
 }
 
 
@@ -57,12 +122,59 @@ try {
             "The IP address or (OS-specific) name of the network interface to "
             "use for network communications, or \"*\" for all/any.")
         ("no-output",
-            "Disable file output of variable values.")
+            "Disable file output of variable values and traces.")
         ("output-dir,o", po::value<std::string>()->default_value("."),
             "The directory where output files should be written.")
+        ("output-format", po::value<std::string>()->default_value("csv"),
+            "The format of the output files.  \"csv\" writes CSV files "
+            "directly.  \"binary\" is a compact format which is much faster "
+            "to write, and which can be converted to CSV with coralrec2csv.")
+        ("output-buffers", po::value<std::size_t>()->default_value(4),
+            "The number of blocks (of about 1 MB each) in which values are "
+            "buffered before being written to disk, in the binary output "
+            "format.  Must be at least 2.")
+        ("output-drop-when-full",
+            "In the binary output format, drop values rather than wait when "
+            "all buffers are waiting to be written to disk.")
+        ("publish-deadband", po::value<double>()->default_value(0.0),
+            "For real variables selected with --publish-on-change, the "
+            "smallest change in value which is published.")
+        ("publish-keyframe-interval", po::value<int>()->default_value(100),
+            "The number of time steps between each time all output values "
+            "are published, regardless of whether they have changed.  0 means "
+            "never (except when requested by the master).")
+        ("publish-on-change", po::value<std::vector<std::string>>()->composing(),
+            "The name of an output variable whose value should only be "
+            "published to other slaves when it changes.  The name may contain "
+            "the wildcards * and ?.  This option may be given several times.  "
+            "By default, all output values are published in every time step.")
+        ("publish-relative-deadband", po::value<double>()->default_value(0.0),
+            "For real variables selected with --publish-on-change, the "
+            "smallest change in value, relative to the magnitude of the last "
+            "published value, which is published.")
+        ("record", po::value<std::vector<std::string>>()->composing(),
+            "The name of a variable to record.  The name may contain the "
+            "wildcards * and ?.  This option may be given several times.  "
+            "By default, all variables are recorded.")
+        ("record-causality", po::value<std::vector<std::string>>()->composing(),
+            "Only record variables with this causality: parameter, "
+            "calculated_parameter, input, output or local.  This option may "
+            "be given several times.  By default, variables of all "
+            "causalities are recorded.")
+        ("record-every", po::value<int>()->default_value(1),
+            "Only record every Nth time step.")
+        ("record-interval", po::value<double>()->default_value(0.0),
+            "The minimum amount of simulation time between recorded time "
+            "steps.")
         ("coralslaveprovider-endpoint", po::value<std::string>(),
             "For use by coralslaveprovider: An endpoint on which the provider "
-            "is listening for status messages.");
+            "is listening for status messages.")
+        ("wait-for-claim",
+            "For use by coralslaveprovider: Load the FMU and bind the ports, "
+            "then wait for the provider to hand the slave out to a master "
+            "before reporting the endpoints.  The slave shuts down if it has "
+            "not been claimed within the hangaround time.  Requires "
+            "--coralslaveprovider-endpoint.");
     coral::util::AddLoggingOptions(options);
     po::options_description positionalOptions("Arguments");
     positionalOptions.add_options()
@@ -81,13 +193,21 @@ try {
     if (!optionValues) return 0;
     coral::util::UseLoggingArguments(*optionValues, MY_NAME);
 
+    const auto waitForClaim = optionValues->count("wait-for-claim") > 0;
     if (optionValues->count("coralslaveprovider-endpoint")) {
         CORAL_LOG_DEBUG("Assuming started by slave provider");
         const auto feedbackEndpoint =
             (*optionValues)["coralslaveprovider-endpoint"].as<std::string>();
-        feedbackSocket = std::make_unique<zmq::socket_t>(context, ZMQ_PUSH);
+        // A pooled slave also receives commands from the provider, so it
+        // needs a two-way socket.
+        feedbackSocket = std::make_unique<zmq::socket_t>(
+            context,
+            waitForClaim ? ZMQ_DEALER : ZMQ_PUSH);
         feedbackSocket->setsockopt(ZMQ_LINGER, 100 /* ms */);
         feedbackSocket->connect(feedbackEndpoint.c_str());
+    } else if (waitForClaim) {
+        throw std::runtime_error(
+            "wait-for-claim requires coralslaveprovider-endpoint");
     }
 
     const auto controlPortN = (*optionValues)["control-port"].as<std::uint16_t>();
@@ -107,6 +227,18 @@ try {
         (*optionValues)["interface"].as<std::string>()};
     const auto enableOutput = !optionValues->count("no-output");
     const auto outputDir = (*optionValues)["output-dir"].as<std::string>();
+    const auto outputFormat = (*optionValues)["output-format"].as<std::string>();
+    if (outputFormat != "binary" && outputFormat != "csv") {
+        throw std::runtime_error("Invalid output-format value: " + outputFormat);
+    }
+    const auto recordingSpec = GetRecordingSpec(*optionValues);
+    auto bufferOptions = coral::slave::RecordingBufferOptions{};
+    bufferOptions.blockCount = (*optionValues)["output-buffers"].as<std::size_t>();
+    if (bufferOptions.blockCount < 2) {
+        throw std::runtime_error("Invalid output-buffers value");
+    }
+    bufferOptions.dropWhenFull = optionValues->count("output-drop-when-full") > 0;
+    const auto publishOptions = GetPublishOptions(*optionValues);
 
     if (!optionValues->count("fmu")) {
         throw std::runtime_error("No FMU specified");
@@ -132,9 +264,18 @@ try {
 #else
         const char dirSep = '/';
 #endif
-        slave = std::make_shared<coral::slave::LoggingInstance>(
-            fmiSlave,
-            outputDir + dirSep);
+        if (outputFormat == "csv") {
+            slave = std::make_shared<coral::slave::LoggingInstance>(
+                fmiSlave,
+                outputDir + dirSep,
+                recordingSpec);
+        } else {
+            slave = std::make_shared<coral::slave::RecordingInstance>(
+                fmiSlave,
+                outputDir + dirSep,
+                recordingSpec,
+                bufferOptions);
+        }
     } else {
         slave = fmiSlave;
     }
@@ -142,13 +283,36 @@ try {
         slave,
         coral::net::ip::Endpoint(networkInterface, controlPort).ToEndpoint("tcp"),
         coral::net::ip::Endpoint(networkInterface, dataPort).ToEndpoint("tcp"),
-        hangaroundTime);
+        hangaroundTime,
+        publishOptions);
 
     const auto controlEndpoint =
         coral::net::ip::Endpoint{slaveRunner.BoundControlEndpoint().Address()};
     const auto dataPubEndpoint =
         coral::net::ip::Endpoint{slaveRunner.BoundDataPubEndpoint().Address()};
 
+    if (waitForClaim) {
+        // Everything is ready, so now we just wait for the slave provider to
+        // give us to a master.  The hangaround time only starts to run once
+        // we've been claimed.
+        feedbackSocket->send("READY", 5);
+        CORAL_LOG_DEBUG("Waiting to be claimed");
+        std::vector<zmq::message_t> command;
+        const auto claimTimeout = hangaroundTime < std::chrono::seconds(0)
+            ? std::chrono::milliseconds(-1)
+            : std::chrono::milliseconds(hangaroundTime);
+        if (!coral::net::zmqx::WaitForIncoming(*feedbackSocket, claimTimeout)) {
+            CORAL_LOG_DEBUG("Not claimed within hangaround time; shutting down");
+            return 0;
+        }
+        coral::net::zmqx::Receive(*feedbackSocket, command);
+        if (coral::net::zmqx::ToString(command[0]) != "CLAIM") {
+            CORAL_LOG_DEBUG("Released by slave provider; shutting down");
+            return 0;
+        }
+        CORAL_LOG_DEBUG("Claimed by slave provider");
+    }
+
     if (feedbackSocket) {
         const auto ceps = controlEndpoint.ToString();
         const auto deps = dataPubEndpoint.ToString();
@@ -171,6 +335,21 @@ try {
     slaveRunner.Run();
     CORAL_LOG_DEBUG("Normal shutdown");
 
+    // Tracing is enabled by the master, if it wants it.  The trace file is
+    // output like any other, so it is not written if output is disabled.
+    if (coral::trace::Enabled()) {
+        if (enableOutput) {
+            const auto traceFile = boost::filesystem::path(outputDir)
+                / (fmu->Description().Name() + "_" + std::to_string(getpid()) + ".trace.json");
+            coral::trace::Write(traceFile.string());
+            coral::log::Log(coral::log::info,
+                boost::format("Trace written to %s") % traceFile.string());
+        } else {
+            coral::log::Log(coral::log::info,
+                "Trace not written because file output is disabled");
+        }
+    }
+
 } catch (const std::runtime_error& e) {
     if (feedbackSocket) {
         feedbackSocket->send("ERROR", 5, ZMQ_SNDMORE);
@@ -0,0 +1,486 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+/*
+An FMI 2.0 co-simulation FMU with a configurable number of variables and a
+configurable compute kernel, used for testing and benchmarking the FMI
+code path.  See synthetic.h for a description of the model.
+
+The variable count is fixed at compile time, by defining the macro
+SYNTHETIC_VARIABLE_COUNT.
+*/
+#include <string.h>
+
+#include <FMI2/fmi2Functions.h>
+
+#include "synthetic.h"
+
+#ifndef SYNTHETIC_VARIABLE_COUNT
+#   error SYNTHETIC_VARIABLE_COUNT must be defined
+#endif
+
+#define PORT_COUNT (SYNTHETIC_VARIABLE_COUNT / 2)
+#define VR_COUNT (1 + 2 * PORT_COUNT)
+
+
+typedef struct
+{
+    fmi2CallbackFunctions callbacks;
+    fmi2String instanceName;
+    fmi2Integer iterations;
+    fmi2Real* values; /* indexed by value reference; element 0 is unused */
+    fmi2Real time;
+} Instance;
+
+
+static void Log(Instance* instance, fmi2Status status, fmi2String message)
+{
+    if (instance->callbacks.logger) {
+        instance->callbacks.logger(
+            instance->callbacks.componentEnvironment,
+            instance->instanceName,
+            status,
+            status == fmi2OK ? "logAll" : "logStatusError",
+            "%s",
+            message);
+    }
+}
+
+
+static fmi2Status Unsupported(fmi2Component c, fmi2String function)
+{
+    Log((Instance*) c, fmi2Error, function);
+    return fmi2Error;
+}
+
+
+static int IsReal(fmi2ValueReference vr)
+{
+    return vr != SYNTHETIC_VR_ITERATIONS && vr < VR_COUNT;
+}
+
+
+/* ========================================================================== */
+/* Common functions                                                           */
+/* ========================================================================== */
+
+FMI2_Export const char* fmi2GetTypesPlatform(void)
+{
+    return fmi2TypesPlatform;
+}
+
+
+FMI2_Export const char* fmi2GetVersion(void)
+{
+    return fmi2Version;
+}
+
+
+FMI2_Export fmi2Status fmi2SetDebugLogging(
+    fmi2Component c,
+    fmi2Boolean loggingOn,
+    size_t nCategories,
+    const fmi2String categories[])
+{
+    (void) c; (void) loggingOn; (void) nCategories; (void) categories;
+    return fmi2OK;
+}
+
+
+FMI2_Export fmi2Component fmi2Instantiate(
+    fmi2String instanceName,
+    fmi2Type fmuType,
+    fmi2String fmuGUID,
+    fmi2String fmuResourceLocation,
+    const fmi2CallbackFunctions* functions,
+    fmi2Boolean visible,
+    fmi2Boolean loggingOn)
+{
+    char guid[64];
+    Instance* instance;
+    char* name;
+    (void) fmuResourceLocation; (void) visible; (void) loggingOn;
+
+    if (!functions || !functions->allocateMemory || !functions->freeMemory) {
+        return NULL;
+    }
+    SyntheticGUID(SYNTHETIC_VARIABLE_COUNT, guid);
+    if (fmuType != fmi2CoSimulation || !fmuGUID || strcmp(fmuGUID, guid) != 0) {
+        if (functions->logger) {
+            functions->logger(functions->componentEnvironment, instanceName,
+                fmi2Error, "logStatusError", "Wrong FMU type or GUID");
+        }
+        return NULL;
+    }
+
+    instance = (Instance*) functions->allocateMemory(1, sizeof(Instance));
+    if (!instance) return NULL;
+    memcpy(&instance->callbacks, functions, sizeof(fmi2CallbackFunctions));
+    name = (char*) functions->allocateMemory(
+        strlen(instanceName ? instanceName : "") + 1, 1);
+    instance->values = (fmi2Real*) functions->allocateMemory(VR_COUNT, sizeof(fmi2Real));
+    if (!name || !instance->values) {
+        functions->freeMemory(name);
+        functions->freeMemory(instance->values);
+        functions->freeMemory(instance);
+        return NULL;
+    }
+    strcpy(name, instanceName ? instanceName : "");
+    instance->instanceName = name;
+    instance->iterations = 0;
+    instance->time = 0.0;
+    return instance;
+}
+
+
+FMI2_Export void fmi2FreeInstance(fmi2Component c)
+{
+    Instance* instance = (Instance*) c;
+    fmi2CallbackFreeMemory freeMemory;
+    if (!instance) return;
+    freeMemory = instance->callbacks.freeMemory;
+    freeMemory(instance->values);
+    freeMemory((void*) instance->instanceName);
+    freeMemory(instance);
+}
+
+
+FMI2_Export fmi2Status fmi2SetupExperiment(
+    fmi2Component c,
+    fmi2Boolean toleranceDefined,
+    fmi2Real tolerance,
+    fmi2Real startTime,
+    fmi2Boolean stopTimeDefined,
+    fmi2Real stopTime)
+{
+    (void) toleranceDefined; (void) tolerance; (void) stopTimeDefined; (void) stopTime;
+    ((Instance*) c)->time = startTime;
+    return fmi2OK;
+}
+
+
+FMI2_Export fmi2Status fmi2EnterInitializationMode(fmi2Component c)
+{
+    (void) c;
+    return fmi2OK;
+}
+
+
+FMI2_Export fmi2Status fmi2ExitInitializationMode(fmi2Component c)
+{
+    (void) c;
+    return fmi2OK;
+}
+
+
+FMI2_Export fmi2Status fmi2Terminate(fmi2Component c)
+{
+    (void) c;
+    return fmi2OK;
+}
+
+
+FMI2_Export fmi2Status fmi2Reset(fmi2Component c)
+{
+    Instance* instance = (Instance*) c;
+    memset(instance->values, 0, VR_COUNT * sizeof(fmi2Real));
+    instance->iterations = 0;
+    instance->time = 0.0;
+    return fmi2OK;
+}
+
+
+FMI2_Export fmi2Status fmi2GetReal(
+    fmi2Component c,
+    const fmi2ValueReference vr[],
+    size_t nvr,
+    fmi2Real value[])
+{
+    Instance* instance = (Instance*) c;
+    size_t i;
+    for (i = 0; i < nvr; ++i) {
+        if (!IsReal(vr[i])) return Unsupported(c, "Invalid real value reference");
+        value[i] = instance->values[vr[i]];
+    }
+    return fmi2OK;
+}
+
+
+FMI2_Export fmi2Status fmi2GetInteger(
+    fmi2Component c,
+    const fmi2ValueReference vr[],
+    size_t nvr,
+    fmi2Integer value[])
+{
+    size_t i;
+    for (i = 0; i < nvr; ++i) {
+        if (vr[i] != SYNTHETIC_VR_ITERATIONS) {
+            return Unsupported(c, "Invalid integer value reference");
+        }
+        value[i] = ((Instance*) c)->iterations;
+    }
+    return fmi2OK;
+}
+
+
+FMI2_Export fmi2Status fmi2GetBoolean(
+    fmi2Component c,
+    const fmi2ValueReference vr[],
+    size_t nvr,
+    fmi2Boolean value[])
+{
+    (void) vr; (void) value;
+    return nvr == 0 ? fmi2OK : Unsupported(c, "Invalid boolean value reference");
+}
+
+
+FMI2_Export fmi2Status fmi2GetString(
+    fmi2Component c,
+    const fmi2ValueReference vr[],
+    size_t nvr,
+    fmi2String value[])
+{
+    (void) vr; (void) value;
+    return nvr == 0 ? fmi2OK : Unsupported(c, "Invalid string value reference");
+}
+
+
+FMI2_Export fmi2Status fmi2SetReal(
+    fmi2Component c,
+    const fmi2ValueReference vr[],
+    size_t nvr,
+    const fmi2Real value[])
+{
+    Instance* instance = (Instance*) c;
+    size_t i;
+    for (i = 0; i < nvr; ++i) {
+        if (!IsReal(vr[i])) return Unsupported(c, "Invalid real value reference");
+        instance->values[vr[i]] = value[i];
+    }
+    return fmi2OK;
+}
+
+
+FMI2_Export fmi2Status fmi2SetInteger(
+    fmi2Component c,
+    const fmi2ValueReference vr[],
+    size_t nvr,
+    const fmi2Integer value[])
+{
+    size_t i;
+    for (i = 0; i < nvr; ++i) {
+        if (vr[i] != SYNTHETIC_VR_ITERATIONS || value[i] < 0) {
+            return Unsupported(c, "Invalid integer value reference or value");
+        }
+        ((Instance*) c)->iterations = value[i];
+    }
+    return fmi2OK;
+}
+
+
+FMI2_Export fmi2Status fmi2SetBoolean(
+    fmi2Component c,
+    const fmi2ValueReference vr[],
+    size_t nvr,
+    const fmi2Boolean value[])
+{
+    (void) vr; (void) value;
+    return nvr == 0 ? fmi2OK : Unsupported(c, "Invalid boolean value reference");
+}
+
+
+FMI2_Export fmi2Status fmi2SetString(
+    fmi2Component c,
+    const fmi2ValueReference vr[],
+    size_t nvr,
+    const fmi2String value[])
+{
+    (void) vr; (void) value;
+    return nvr == 0 ? fmi2OK : Unsupported(c, "Invalid string value reference");
+}
+
+
+FMI2_Export fmi2Status fmi2GetFMUstate(fmi2Component c, fmi2FMUstate* FMUstate)
+{
+    (void) FMUstate;
+    return Unsupported(c, "fmi2GetFMUstate is not supported");
+}
+
+
+FMI2_Export fmi2Status fmi2SetFMUstate(fmi2Component c, fmi2FMUstate FMUstate)
+{
+    (void) FMUstate;
+    return Unsupported(c, "fmi2SetFMUstate is not supported");
+}
+
+
+FMI2_Export fmi2Status fmi2FreeFMUstate(fmi2Component c, fmi2FMUstate* FMUstate)
+{
+    (void) FMUstate;
+    return Unsupported(c, "fmi2FreeFMUstate is not supported");
+}
+
+
+FMI2_Export fmi2Status fmi2SerializedFMUstateSize(
+    fmi2Component c,
+    fmi2FMUstate FMUstate,
+    size_t* size)
+{
+    (void) FMUstate; (void) size;
+    return Unsupported(c, "fmi2SerializedFMUstateSize is not supported");
+}
+
+
+FMI2_Export fmi2Status fmi2SerializeFMUstate(
+    fmi2Component c,
+    fmi2FMUstate FMUstate,
+    fmi2Byte serializedState[],
+    size_t size)
+{
+    (void) FMUstate; (void) serializedState; (void) size;
+    return Unsupported(c, "fmi2SerializeFMUstate is not supported");
+}
+
+
+FMI2_Export fmi2Status fmi2DeSerializeFMUstate(
+    fmi2Component c,
+    const fmi2Byte serializedState[],
+    size_t size,
+    fmi2FMUstate* FMUstate)
+{
+    (void) serializedState; (void) size; (void) FMUstate;
+    return Unsupported(c, "fmi2DeSerializeFMUstate is not supported");
+}
+
+
+FMI2_Export fmi2Status fmi2GetDirectionalDerivative(
+    fmi2Component c,
+    const fmi2ValueReference vUnknown_ref[],
+    size_t nUnknown,
+    const fmi2ValueReference vKnown_ref[],
+    size_t nKnown,
+    const fmi2Real dvKnown[],
+    fmi2Real dvUnknown[])
+{
+    (void) vUnknown_ref; (void) nUnknown; (void) vKnown_ref; (void) nKnown;
+    (void) dvKnown; (void) dvUnknown;
+    return Unsupported(c, "fmi2GetDirectionalDerivative is not supported");
+}
+
+
+/* ========================================================================== */
+/* Co-simulation functions                                                    */
+/* ========================================================================== */
+
+FMI2_Export fmi2Status fmi2SetRealInputDerivatives(
+    fmi2Component c,
+    const fmi2ValueReference vr[],
+    size_t nvr,
+    const fmi2Integer order[],
+    const fmi2Real value[])
+{
+    (void) vr; (void) nvr; (void) order; (void) value;
+    return Unsupported(c, "fmi2SetRealInputDerivatives is not supported");
+}
+
+
+FMI2_Export fmi2Status fmi2GetRealOutputDerivatives(
+    fmi2Component c,
+    const fmi2ValueReference vr[],
+    size_t nvr,
+    const fmi2Integer order[],
+    fmi2Real value[])
+{
+    (void) vr; (void) nvr; (void) order; (void) value;
+    return Unsupported(c, "fmi2GetRealOutputDerivatives is not supported");
+}
+
+
+FMI2_Export fmi2Status fmi2DoStep(
+    fmi2Component c,
+    fmi2Real currentCommunicationPoint,
+    fmi2Real communicationStepSize,
+    fmi2Boolean noSetFMUStatePriorToCurrentPoint)
+{
+    Instance* instance = (Instance*) c;
+    const fmi2Real* u = instance->values + 1;
+    fmi2Real* y = instance->values + 1 + PORT_COUNT;
+    const fmi2Real t = currentCommunicationPoint + communicationStepSize;
+    size_t i;
+    fmi2Integer k;
+    (void) noSetFMUStatePriorToCurrentPoint;
+
+    /* The compute kernel: a contracting recurrence per output, whose
+       fixed point is u[i] + t. */
+    for (i = 0; i < PORT_COUNT; ++i) {
+        fmi2Real v = y[i];
+        for (k = 0; k < instance->iterations; ++k) {
+            v = 0.5 * v + 0.5 * (u[i] + t);
+        }
+        y[i] = instance->iterations > 0 ? v : u[i] + t;
+    }
+    instance->time = t;
+    return fmi2OK;
+}
+
+
+FMI2_Export fmi2Status fmi2CancelStep(fmi2Component c)
+{
+    return Unsupported(c, "fmi2CancelStep is not supported");
+}
+
+
+FMI2_Export fmi2Status fmi2GetStatus(
+    fmi2Component c,
+    const fmi2StatusKind s,
+    fmi2Status* value)
+{
+    (void) s; (void) value;
+    return Unsupported(c, "fmi2GetStatus is not supported");
+}
+
+
+FMI2_Export fmi2Status fmi2GetRealStatus(
+    fmi2Component c,
+    const fmi2StatusKind s,
+    fmi2Real* value)
+{
+    if (s != fmi2LastSuccessfulTime) {
+        return Unsupported(c, "fmi2GetRealStatus: unsupported status kind");
+    }
+    *value = ((Instance*) c)->time;
+    return fmi2OK;
+}
+
+
+FMI2_Export fmi2Status fmi2GetIntegerStatus(
+    fmi2Component c,
+    const fmi2StatusKind s,
+    fmi2Integer* value)
+{
+    (void) s; (void) value;
+    return Unsupported(c, "fmi2GetIntegerStatus is not supported");
+}
+
+
+FMI2_Export fmi2Status fmi2GetBooleanStatus(
+    fmi2Component c,
+    const fmi2StatusKind s,
+    fmi2Boolean* value)
+{
+    (void) s; (void) value;
+    return Unsupported(c, "fmi2GetBooleanStatus is not supported");
+}
+
+
+FMI2_Export fmi2Status fmi2GetStringStatus(
+    fmi2Component c,
+    const fmi2StatusKind s,
+    fmi2String* value)
+{
+    (void) s; (void) value;
+    return Unsupported(c, "fmi2GetStringStatus is not supported");
+}
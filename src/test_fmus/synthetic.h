@@ -0,0 +1,67 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+/*
+Definitions shared by the synthetic FMU and the program that writes its
+model description.
+
+The FMU has `variableCount` variables, half of them real inputs and half
+of them real outputs, plus an integer parameter which sets the cost of
+the compute kernel.  In each time step, output `i` is computed from input
+`i` by `iterations` iterations of a simple recurrence, so the cost of a
+step grows with both the number of variables and the parameter.
+
+Value references:
+
+    0                   iterations (parameter)
+    1 ... M             u[1] ... u[M] (inputs)
+    M+1 ... 2M          y[1] ... y[M] (outputs)
+
+where M = variableCount / 2.  The value references are also the variables'
+positions in the model description, counting from zero.
+*/
+#ifndef CORAL_TEST_FMUS_SYNTHETIC_H
+#define CORAL_TEST_FMUS_SYNTHETIC_H
+
+#include <stdio.h>
+
+
+#define SYNTHETIC_MODEL_IDENTIFIER "synthetic"
+#define SYNTHETIC_VR_ITERATIONS 0
+
+
+/* The number of inputs, which is also the number of outputs. */
+static unsigned long SyntheticPortCount(unsigned long variableCount)
+{
+    return variableCount / 2;
+}
+
+
+/* The value reference of input `i`, where `i` is zero-based. */
+static unsigned long SyntheticInputVR(unsigned long i)
+{
+    return 1 + i;
+}
+
+
+/* The value reference of output `i` for a given port count. */
+static unsigned long SyntheticOutputVR(unsigned long portCount, unsigned long i)
+{
+    return 1 + portCount + i;
+}
+
+
+/*
+Writes the GUID for a model with the given variable count to `buffer`,
+which must have room for at least 40 characters.
+*/
+static void SyntheticGUID(unsigned long variableCount, char* buffer)
+{
+    sprintf(buffer, "{8b7e3f20-2c4d-4c1e-9a57-%012lu}", variableCount);
+}
+
+
+#endif /* header guard */
@@ -0,0 +1,99 @@
+/*
+Copyright 2013-present, SINTEF Ocean.
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.
+*/
+/*
+A program which writes the model description of the synthetic FMU
+(see synthetic.h) for a given variable count.  It is run at build time.
+
+Usage: synthetic_fmu_description <variable count> <output file>
+*/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "synthetic.h"
+
+
+int main(int argc, char** argv)
+{
+    unsigned long variableCount, portCount, i;
+    char guid[64];
+    FILE* f;
+
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <variable count> <output file>\n", argv[0]);
+        return 1;
+    }
+    variableCount = strtoul(argv[1], NULL, 10);
+    if (variableCount < 2) {
+        fprintf(stderr, "Variable count must be at least 2\n");
+        return 1;
+    }
+    portCount = SyntheticPortCount(variableCount);
+    SyntheticGUID(variableCount, guid);
+
+    f = fopen(argv[2], "w");
+    if (!f) {
+        perror(argv[2]);
+        return 1;
+    }
+
+    fprintf(f,
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<fmiModelDescription\n"
+        "  fmiVersion=\"2.0\"\n"
+        "  modelName=\"coral.test.Synthetic%lu\"\n"
+        "  guid=\"%s\"\n"
+        "  description=\"Synthetic model with %lu inputs and %lu outputs\"\n"
+        "  generationTool=\"Coral\"\n"
+        "  variableNamingConvention=\"structured\"\n"
+        "  numberOfEventIndicators=\"0\">\n"
+        "  <CoSimulation\n"
+        "    modelIdentifier=\"" SYNTHETIC_MODEL_IDENTIFIER "\"\n"
+        "    canHandleVariableCommunicationStepSize=\"true\"\n"
+        "    canBeInstantiatedOnlyOncePerProcess=\"false\"/>\n"
+        "  <ModelVariables>\n"
+        "    <ScalarVariable name=\"iterations\" valueReference=\"%d\""
+        " causality=\"parameter\" variability=\"tunable\">\n"
+        "      <Integer start=\"0\"/>\n"
+        "    </ScalarVariable>\n",
+        variableCount, guid, portCount, portCount, SYNTHETIC_VR_ITERATIONS);
+    for (i = 0; i < portCount; ++i) {
+        fprintf(f,
+            "    <ScalarVariable name=\"u[%lu]\" valueReference=\"%lu\""
+            " causality=\"input\" variability=\"continuous\">\n"
+            "      <Real start=\"0\"/>\n"
+            "    </ScalarVariable>\n",
+            i + 1, SyntheticInputVR(i));
+    }
+    for (i = 0; i < portCount; ++i) {
+        fprintf(f,
+            "    <ScalarVariable name=\"y[%lu]\" valueReference=\"%lu\""
+            " causality=\"output\" variability=\"continuous\">\n"
+            "      <Real/>\n"
+            "    </ScalarVariable>\n",
+            i + 1, SyntheticOutputVR(portCount, i));
+    }
+    fprintf(f,
+        "  </ModelVariables>\n"
+        "  <ModelStructure>\n"
+        "    <Outputs>\n");
+    /* Indices are one-based positions in ModelVariables, i.e. VR + 1. */
+    for (i = 0; i < portCount; ++i) {
+        fprintf(f,
+            "      <Unknown index=\"%lu\" dependencies=\"%lu\"/>\n",
+            SyntheticOutputVR(portCount, i) + 1, SyntheticInputVR(i) + 1);
+    }
+    fprintf(f,
+        "    </Outputs>\n"
+        "  </ModelStructure>\n"
+        "</fmiModelDescription>\n");
+
+    if (fclose(f) != 0) {
+        perror(argv[2]);
+        return 1;
+    }
+    return 0;
+}